@@ -1,46 +1,48 @@
 #include <chrono>
 #include <cmath>
+#include <cstdint>
 #include <iostream>
 #include "ufosim.h"
+#include "ufosim_fleet.h"
 
 int Ufosim::SPEEDUP = 1;
 
 Ufosim::Ufosim()
 {
-    simThread = std::thread(&Ufosim::runSim, this);
+    id = UfosimFleet::instance().add();
+    UfosimFleet::instance().start(std::chrono::milliseconds(100/SPEEDUP));
 }
 Ufosim::~Ufosim()
 {
-    running = false;
-    simThread.join();
+    UfosimFleet::instance().remove(id);
 }
 float Ufosim::getX() const
 {
-    return x;
+    return UfosimFleet::instance().getX(id);
 }
 float Ufosim::getY() const
 {
-    return y;
+    return UfosimFleet::instance().getY(id);
 }
 float Ufosim::getZ() const
 {
-    return z;
+    return UfosimFleet::instance().getZ(id);
 }
 int Ufosim::getV() const
 {
-    return v;
+    return UfosimFleet::instance().getV(id);
 }
 float Ufosim::getDist() const
 {
-    return dist;
+    return UfosimFleet::instance().getDist(id);
 }
 float Ufosim::getFtime() const
 {
-    return ftime;
+    return UfosimFleet::instance().getFtime(id);
 }
 void Ufosim::requestDeltaV(const int delta)
 {
-    deltaV = deltaV + delta;
+    UfosimFleet::instance().requestDeltaV(id, delta);
 }
 void Ufosim::setSpeedup(const int speedup)
 {
@@ -56,107 +58,37 @@ void Ufosim::setSpeedup(const int speedup)
     else
         SPEEDUP = speedup;
 }
-void Ufosim::updateSim()
+void Ufosim::setVirtualTime(const bool on)
 {
-    // update time if flying
-    if (z > 0.0)
-        ftime = ftime + 0.1f;
-
-    // update v, d, i, dist, x, y, z if not crashed
-    if (z >= 0.0)
-    {
-        // update v
-        if (deltaV > 0)
-        {
-            if (deltaV - ACCELERATION > 0)
-            {
-                if (v + ACCELERATION < VMAX)
-                    v = v + ACCELERATION;
-                else
-                    v = VMAX;
-                deltaV = deltaV - ACCELERATION;
-            }
-            else
-            {
-               if (v + deltaV < VMAX)
-                    v = v + deltaV;
-                else
-                    v = VMAX;
-                deltaV = 0;
-            }
-        }
-        else if (deltaV < 0)
-        {
-            if (deltaV + ACCELERATION < 0)
-            {
-                if (v - ACCELERATION > 0)
-                    v = v - ACCELERATION;
-                else
-                    v = 0.0;
-                deltaV = deltaV + ACCELERATION;
-            }
-            else
-            {
-                if (v + deltaV > 0.0)
-                    v = v + deltaV;
-                else
-                    v = 0.0;
-                deltaV = 0;
-            }
-        }
-    }
-
-    // update velocity in m/s
-    vel = (float)v / 3.6f;
-
-    // update distance
-    dist = dist + vel / 10.0f;
-
-    // calculate new position every 100 ms with 1/10 of v
-    x = x + vel / 10.0f * xvect;
-    y = y + vel / 10.0f * yvect;
-    z = z + vel / 10.0f * zvect;
-
-    // stop if landed or crashed
-    if (z <= 0.0)
+    if (!UfosimFleet::instance().setVirtual(on))
     {
-        if (v == 1)           // landed with slow velocity
-        {
-            z = 0.0;
-            v = 0;
-        }
-        else if (v > 1)       // crashed to the ground
-        {
-            z = -1.0;
-            v = 0;
-        }
+        /*std::cout << "ufosim warning: virtual time can be set only without objects"
+                  << std::endl;*/
     }
 }
-void Ufosim::runSim()
+void Ufosim::waitWhile(const std::function<bool()>& condition)
 {
-    while (running)
-    {
-        updateSim();
-        std::this_thread::sleep_for(std::chrono::milliseconds(100/SPEEDUP));
-    }
+    std::uint64_t tick = UfosimFleet::instance().getTicks();
+    while (condition())
+        tick = UfosimFleet::instance().awaitTick(tick);
 }
 void Ufosim::flyTo(const float xDest, const float yDest,
                    const float zDest, const int vFlight, const int vPost)
 {
-    float deltaX = xDest - x;
-    float deltaY = yDest - y;
-    float deltaZ = zDest - z;
+    UfosimFleet::instance().beginFlight(id);
+
+    float deltaX = xDest - getX();
+    float deltaY = yDest - getY();
+    float deltaZ = zDest - getZ();
     float distToDest = (float)sqrt(deltaX*deltaX + deltaY*deltaY + deltaZ*deltaZ);
-    float d = dist + distToDest;
-    xvect = deltaX / distToDest;
-    yvect = deltaY / distToDest;
-    zvect = deltaZ / distToDest;
+    float d = getDist() + distToDest;
+    UfosimFleet::instance().setVector(id, deltaX / distToDest, deltaY / distToDest,
+                                      deltaZ / distToDest);
 
     print("flying");
-    requestDeltaV(vFlight - v);        // de/accelerate to vFlight
+    requestDeltaV(vFlight - getV());   // de/accelerate to vFlight
 
-    while (d - dist > 4.0)             // fly until distance to dest <= 4.0
-        std::this_thread::sleep_for(std::chrono::milliseconds(100/SPEEDUP));
+    waitWhile([&] { return d - getDist() > 4.0; });   // fly until distance to dest <= 4.0
 
     if (vPost <= 0)
     {
@@ -164,36 +96,33 @@ void Ufosim::flyTo(const float xDest, const float yDest,
 
         if (zDest == 0.0)              // landing
         {
-            while (z > 0.0)            // fly until surface is reached, that sets v to 0
-                std::this_thread::sleep_for(std::chrono::milliseconds(100/SPEEDUP));
+            waitWhile([&] { return getZ() > 0.0; });    // fly until surface is reached, that sets v to 0
 
-            if (z < 0)
+            if (getZ() < 0)
                 print("crashed");
             else
                 print("landed");
         }
         else
         {
-            while (d - dist > 0.03)    // fly until distance to dest <= 0.03
-                std::this_thread::sleep_for(std::chrono::milliseconds(100/SPEEDUP));
+            waitWhile([&] { return d - getDist() > 0.03; });   // fly until distance to dest <= 0.03
 
             requestDeltaV(-1);         // de/accelerate to 0
        }
 
 
-        while (v != 0)                 // make sure that v is 0
-            std::this_thread::sleep_for(std::chrono::milliseconds(100/SPEEDUP));
+        waitWhile([&] { return getV() != 0; });     // make sure that v is 0
     }
     else
     {
         requestDeltaV(-vFlight + vPost);     // de/accelerate to vPost
 
-        while (d - dist > 0.03)        // fly until distance to dest <= 0.03
-            std::this_thread::sleep_for(std::chrono::milliseconds(100/SPEEDUP));
+        waitWhile([&] { return d - getDist() > 0.03; });   // fly until distance to dest <= 0.03
 
-        while (v != vPost)             // make sure that v is vPost
-            std::this_thread::sleep_for(std::chrono::milliseconds(100/SPEEDUP));
+        waitWhile([&] { return getV() != vPost; }); // make sure that v is vPost
     }
+
+    UfosimFleet::instance().endFlight(id);
 }
 
 void Ufosim::print(std::string message)
@@ -201,12 +130,12 @@ void Ufosim::print(std::string message)
     std::cout.setf(std::ios::fixed);
     std::cout.precision(1);
     std::cout.width(4);
-    std::cout << ftime << " ";
+    std::cout << getFtime() << " ";
     std::cout.precision(2);
     std::cout.width(6);
-    std::cout << x << " ";
+    std::cout << getX() << " ";
     std::cout.width(6);
-    std::cout << y << " ";
+    std::cout << getY() << " ";
     std::cout.width(5);
-    std::cout << z << " " << message << std::endl;
+    std::cout << getZ() << " " << message << std::endl;
 }
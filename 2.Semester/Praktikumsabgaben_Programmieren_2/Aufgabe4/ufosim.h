@@ -12,7 +12,7 @@
  * The code and information is provided "as-is" without
  * warranty of any kind, either expressed or implied.
  *
- * Version: 4.0.3c
+ * Version: 4.2.0
  *
  * Change history:
  *
@@ -44,34 +44,36 @@
  *   x = x + vel / 10.0f * xvect; y = y + vel / 10.0f * yvect;
  *   z = z + vel / 10.0f * zvect; float distToDest = 
  *   (float)sqrt(deltaX*deltaX + deltaY*deltaY + deltaZ*deltaZ);
+ *
+ * 4.1.0:
+ * - sim attributes moved into UfosimFleet (ufosim_fleet.h), one array per
+ *   attribute for all objects; a single thread steps every object per
+ *   tick with the arithmetic of updateSim()
+ * - thread per object, updateSim, runSim deleted
+ * - public methods unchanged
+ *
+ * 4.2.0:
+ * - flyTo checks its conditions once after every tick instead of sleeping
+ *   100/SPEEDUP ms between checks
+ * - setVirtualTime(): simulated time as fast as possible, independent of
+ *   the thread scheduling (see ufosim_fleet.h)
+ * - virtual time: a UFO that keeps the clock stopped for 5 s (wall clock)
+ *   is reported on std::cerr
 */
 
 #ifndef UFOSIM_H
 #define UFOSIM_H
 
+#include <cstddef>
+#include <functional>
 #include <string>
-#include <thread>
 
 class Ufosim
 {
 private:
-    // sim constants
-    static constexpr int VMAX = 50;         // maximal velocity [km/h]
-    static constexpr int ACCELERATION = 1;  // constant acceleration [km/h/0.1s]
-
     // sim attributes
     static int SPEEDUP;                     // real-time speedup factor > 0
-    volatile float x = 0.0;                 // x coordinate [m]
-    volatile float y = 0.0;                 // y coordinate [m]
-    volatile float z = 0.0;                 // z coordinate [m]
-    volatile int v = 0;                     // 0 <= velocity <= vMax [km/h]
-    volatile float dist = 0.0;              // distance covered since reset [m]
-    volatile float ftime = 0.0;             // elapsed flight time with v > 0 [s]
-    volatile float xvect = 0.0;             // flight vector in x direction
-    volatile float yvect = 0.0;             // flight vector in y direction
-    volatile float zvect = 0.0;             // flight vector in z direction
-    volatile int deltaV = 0;                // requested change of v
-    volatile float vel = 0.0;               // velocity [m/s]
+    std::size_t id;                         // slot in UfosimFleet
 
 public:
     // constructor
@@ -96,16 +98,8 @@ public:
     // setter
     static void setSpeedup(const int speedup);
 
-private:
-    // thread attributes
-    bool running = true;                    // simulation running
-    std::thread simThread;                  // simulation thread
-
-    // update simulation
-    void updateSim();
-
-    // thread function
-    void runSim();
+    // virtual time on/off, only before the first object is created
+    static void setVirtualTime(const bool on);
 
 public:
     // fly to
@@ -113,6 +107,9 @@ public:
                const int vFlight, const int vPost);
 
 private:
+    // wait while condition is true, checked once per tick
+    void waitWhile(const std::function<bool()>& condition);
+
     // print message to console
     void print(std::string message);
 };
@@ -0,0 +1,345 @@
+#include <iostream>
+#include "ufosim_fleet.h"
+
+UfosimFleet& UfosimFleet::instance()
+{
+    static UfosimFleet fleet;
+    return fleet;
+}
+UfosimFleet::~UfosimFleet()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        running = false;
+    }
+    wakeup.notify_all();
+    ticked.notify_all();
+    if (stepThread.joinable())
+        stepThread.join();
+}
+std::size_t UfosimFleet::add()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    std::size_t id;
+    if (!freeSlots.empty())
+    {
+        id = freeSlots.back();
+        freeSlots.pop_back();
+    }
+    else
+    {
+        id = used.size();
+        x.push_back(0.0f);
+        y.push_back(0.0f);
+        z.push_back(0.0f);
+        v.push_back(0);
+        dist.push_back(0.0f);
+        ftime.push_back(0.0f);
+        xvect.push_back(0.0f);
+        yvect.push_back(0.0f);
+        zvect.push_back(0.0f);
+        deltaV.push_back(0);
+        vel.push_back(0.0f);
+        used.push_back(0);
+        flying.push_back(0);
+        flown.push_back(0);
+        owner.emplace_back();
+    }
+    x[id] = y[id] = z[id] = 0.0f;
+    v[id] = 0;
+    dist[id] = ftime[id] = 0.0f;
+    xvect[id] = yvect[id] = zvect[id] = 0.0f;
+    deltaV[id] = 0;
+    vel[id] = 0.0f;
+    used[id] = 1;
+    flying[id] = 0;
+    flown[id] = 0;
+    owner[id] = std::this_thread::get_id();
+    count++;
+    return id;
+}
+void UfosimFleet::remove(const std::size_t id)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (id >= used.size() || !used[id])
+            return;
+        used[id] = 0;
+        flying[id] = 0;
+        freeSlots.push_back(id);
+        count--;
+    }
+    ticked.notify_all();
+    stopIfEmpty();
+}
+void UfosimFleet::start(const std::chrono::milliseconds tickPeriod)
+{
+    std::lock_guard<std::mutex> guard(lifecycle);
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        period = tickPeriod;
+        if (running || virtualTime)
+            return;
+        running = true;
+    }
+    stepThread = std::thread(&UfosimFleet::runSim, this);
+}
+void UfosimFleet::stopIfEmpty()
+{
+    std::lock_guard<std::mutex> guard(lifecycle);
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (count > 0 || !running)
+            return;
+        running = false;
+    }
+    wakeup.notify_all();
+    ticked.notify_all();
+    stepThread.join();
+}
+void UfosimFleet::step()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    stepAll();
+}
+bool UfosimFleet::setVirtual(const bool on)
+{
+    std::lock_guard<std::mutex> guard(lifecycle);
+    std::lock_guard<std::mutex> lock(mutex);
+    if (count > 0 || running)
+        return false;
+    virtualTime = on;
+    return true;
+}
+bool UfosimFleet::isVirtual() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return virtualTime;
+}
+void UfosimFleet::beginFlight(const std::size_t id)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    flying[id] = 1;
+    flown[id] = 1;
+    owner[id] = std::this_thread::get_id();
+}
+void UfosimFleet::endFlight(const std::size_t id)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        flying[id] = 0;
+    }
+    ticked.notify_all();
+}
+std::uint64_t UfosimFleet::awaitTick(const std::uint64_t seen)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    if (!virtualTime)
+    {
+        ticked.wait(lock, [this, seen] { return ticks > seen || !running; });
+        return ticks;
+    }
+
+    if (ticks > seen)
+        return ticks;
+    waiters.push_back(std::this_thread::get_id());
+    while (ticks == seen)
+    {
+        const std::size_t id = holder();
+        if (id == used.size())
+        {
+            // the tick releases every waiting thread
+            stepAll();
+            waiters.clear();
+            ticked.notify_all();
+        }
+        else if (ticked.wait_for(lock, STALL_REPORT) == std::cv_status::timeout &&
+                 ticks == seen && stallReported != seen + 1)
+        {
+            // only reported, the clock still waits for the UFO
+            stallReported = seen + 1;
+            reportStall(holder());
+        }
+    }
+    return ticks;
+}
+float UfosimFleet::getX(const std::size_t id) const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return x[id];
+}
+float UfosimFleet::getY(const std::size_t id) const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return y[id];
+}
+float UfosimFleet::getZ(const std::size_t id) const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return z[id];
+}
+int UfosimFleet::getV(const std::size_t id) const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return v[id];
+}
+float UfosimFleet::getDist(const std::size_t id) const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return dist[id];
+}
+float UfosimFleet::getFtime(const std::size_t id) const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return ftime[id];
+}
+std::size_t UfosimFleet::size() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return count;
+}
+std::uint64_t UfosimFleet::getTicks() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return ticks;
+}
+void UfosimFleet::requestDeltaV(const std::size_t id, const int delta)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    deltaV[id] = deltaV[id] + delta;
+}
+void UfosimFleet::setVector(const std::size_t id, const float xv, const float yv, const float zv)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    xvect[id] = xv;
+    yvect[id] = yv;
+    zvect[id] = zv;
+}
+void UfosimFleet::updateSim(const std::size_t i)
+{
+    // update time if flying
+    if (z[i] > 0.0)
+        ftime[i] = ftime[i] + 0.1f;
+
+    // update v, d, i, dist, x, y, z if not crashed
+    if (z[i] >= 0.0)
+    {
+        // update v
+        if (deltaV[i] > 0)
+        {
+            if (deltaV[i] - ACCELERATION > 0)
+            {
+                if (v[i] + ACCELERATION < VMAX)
+                    v[i] = v[i] + ACCELERATION;
+                else
+                    v[i] = VMAX;
+                deltaV[i] = deltaV[i] - ACCELERATION;
+            }
+            else
+            {
+                if (v[i] + deltaV[i] < VMAX)
+                    v[i] = v[i] + deltaV[i];
+                else
+                    v[i] = VMAX;
+                deltaV[i] = 0;
+            }
+        }
+        else if (deltaV[i] < 0)
+        {
+            if (deltaV[i] + ACCELERATION < 0)
+            {
+                if (v[i] - ACCELERATION > 0)
+                    v[i] = v[i] - ACCELERATION;
+                else
+                    v[i] = 0.0;
+                deltaV[i] = deltaV[i] + ACCELERATION;
+            }
+            else
+            {
+                if (v[i] + deltaV[i] > 0.0)
+                    v[i] = v[i] + deltaV[i];
+                else
+                    v[i] = 0.0;
+                deltaV[i] = 0;
+            }
+        }
+    }
+
+    // update velocity in m/s
+    vel[i] = (float)v[i] / 3.6f;
+
+    // update distance
+    dist[i] = dist[i] + vel[i] / 10.0f;
+
+    // calculate new position every 100 ms with 1/10 of v
+    x[i] = x[i] + vel[i] / 10.0f * xvect[i];
+    y[i] = y[i] + vel[i] / 10.0f * yvect[i];
+    z[i] = z[i] + vel[i] / 10.0f * zvect[i];
+
+    // stop if landed or crashed
+    if (z[i] <= 0.0)
+    {
+        if (v[i] == 1)        // landed with slow velocity
+        {
+            z[i] = 0.0;
+            v[i] = 0;
+        }
+        else if (v[i] > 1)    // crashed to the ground
+        {
+            z[i] = -1.0;
+            v[i] = 0;
+        }
+    }
+}
+void UfosimFleet::stepAll()
+{
+    const std::size_t slots = used.size();
+    for (std::size_t i = 0; i < slots; i++)
+        if (used[i])
+            updateSim(i);
+    ticks++;
+}
+std::size_t UfosimFleet::holder() const
+{
+    const std::size_t slots = used.size();
+    for (std::size_t i = 0; i < slots; i++)
+    {
+        if (!used[i])
+            continue;
+        bool waiting = false;
+        for (const std::thread::id& waiter : waiters)
+            if (waiter == owner[i])
+                waiting = true;
+        bool landed = !flying[i] && flown[i] && v[i] == 0 && deltaV[i] == 0 && z[i] <= 0.0;
+        if (!waiting && !landed)
+            return i;
+    }
+    return slots;
+}
+void UfosimFleet::reportStall(const std::size_t id)
+{
+    if (id >= used.size())
+        return;
+    std::cerr << "ufosim: virtual clock stopped at tick " << ticks << " for "
+              << STALL_REPORT.count() << " s by UFO " << id << " of thread " << owner[id];
+    if (!flown[id])
+        std::cerr << " (never flown)";
+    else if (flying[id])
+        std::cerr << " (in a flight, its thread does not wait for the tick)";
+    else
+        std::cerr << " (left in the air at " << x[id] << " " << y[id] << " " << z[id]
+                  << ", v = " << v[id] << ")";
+    std::cerr << ": fly it from its thread or destroy it" << std::endl;
+}
+void UfosimFleet::runSim()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    auto next = std::chrono::steady_clock::now();
+    while (running)
+    {
+        stepAll();
+        ticked.notify_all();
+        next = next + period;
+        wakeup.wait_until(lock, next, [this] { return !running; });
+    }
+}
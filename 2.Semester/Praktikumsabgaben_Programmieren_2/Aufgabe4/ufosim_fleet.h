@@ -0,0 +1,151 @@
+/*
+ * ufosim fleet
+ * Stepping of all simulated UFOs in one thread
+ *
+ * Every Ufosim is a slot in the fleet. The state of all UFOs is kept as
+ * one array per attribute (structure of arrays), and a single stepping
+ * thread advances every UFO once per tick (100/SPEEDUP ms) with exactly
+ * the arithmetic of the former Ufosim::updateSim(), instead of one thread
+ * per UFO. All access goes through the fleet mutex; a tick holds it once
+ * for the whole fleet.
+ *
+ * The stepping thread runs while the fleet has UFOs and start() was
+ * called (Ufosim does that); without it, step() advances the fleet by
+ * hand (benchmark).
+ *
+ * A flight (Ufosim::flyTo) checks its conditions once after every tick:
+ * awaitTick() returns when the tick after the one it has seen is done.
+ *
+ * In virtual time there is no stepping thread; the waiting threads step
+ * the fleet themselves, as fast as they can check their conditions. Every
+ * UFO holds the clock from its creation: a tick is only taken while the
+ * thread that created it or last flew it waits in awaitTick(). A UFO lets
+ * go when it has landed after a flight (v == 0, on the ground or crashed)
+ * and when it is destroyed. So a hovering UFO or one whose thread has not
+ * started flying yet stops the clock, as it would be seen in real time,
+ * and the results do not depend on the thread scheduling. A UFO that is
+ * never flown or left in the air must be destroyed before other flights
+ * from other threads can go on; if the clock stands still for
+ * STALL_REPORT (wall clock), the UFO holding it is reported on std::cerr.
+ */
+
+#ifndef UFOSIM_FLEET_H
+#define UFOSIM_FLEET_H
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class UfosimFleet
+{
+public:
+    // sim constants (as in Ufosim)
+    static constexpr int VMAX = 50;         // maximal velocity [km/h]
+    static constexpr int ACCELERATION = 1;  // constant acceleration [km/h/0.1s]
+    static constexpr std::chrono::seconds STALL_REPORT{5};  // virtual clock stopped
+
+    // the fleet of all Ufosim objects
+    static UfosimFleet& instance();
+
+    UfosimFleet() = default;
+    ~UfosimFleet();
+    UfosimFleet(const UfosimFleet&) = delete;
+    UfosimFleet& operator=(const UfosimFleet&) = delete;
+
+    // new UFO at (0, 0, 0), stepped from the next tick on; returns its slot
+    std::size_t add();
+
+    // remove a UFO; the stepping thread ends with the last one
+    void remove(const std::size_t id);
+
+    // run the stepping thread with this tick period (no effect if running)
+    void start(const std::chrono::milliseconds period);
+
+    // advance every UFO by one tick (0.1 s simulated)
+    void step();
+
+    // virtual time on/off; only while the fleet is empty
+    bool setVirtual(const bool on);
+    bool isVirtual() const;
+
+    // flight of one UFO in the calling thread
+    void beginFlight(const std::size_t id);
+    void endFlight(const std::size_t id);
+
+    // wait until tick seen + 1 is done and return the tick count (virtual
+    // time: take the tick once no UFO holds the clock)
+    std::uint64_t awaitTick(const std::uint64_t seen);
+
+    // getter
+    float getX(const std::size_t id) const;
+    float getY(const std::size_t id) const;
+    float getZ(const std::size_t id) const;
+    int getV(const std::size_t id) const;
+    float getDist(const std::size_t id) const;
+    float getFtime(const std::size_t id) const;
+    std::size_t size() const;
+    std::uint64_t getTicks() const;
+
+    // requester
+    void requestDeltaV(const std::size_t id, const int delta);
+
+    // setter
+    void setVector(const std::size_t id, const float xv, const float yv, const float zv);
+
+private:
+    // sim attributes, one array each, indexed by slot
+    std::vector<float> x;                   // x coordinate [m]
+    std::vector<float> y;                   // y coordinate [m]
+    std::vector<float> z;                   // z coordinate [m]
+    std::vector<int> v;                     // 0 <= velocity <= vMax [km/h]
+    std::vector<float> dist;                // distance covered since reset [m]
+    std::vector<float> ftime;               // elapsed flight time with v > 0 [s]
+    std::vector<float> xvect;               // flight vector in x direction
+    std::vector<float> yvect;               // flight vector in y direction
+    std::vector<float> zvect;               // flight vector in z direction
+    std::vector<int> deltaV;                // requested change of v
+    std::vector<float> vel;                 // velocity [m/s]
+    std::vector<unsigned char> used;        // slot holds a UFO
+    std::vector<unsigned char> flying;      // UFO in a flight
+    std::vector<unsigned char> flown;       // UFO flew at least once
+    std::vector<std::thread::id> owner;     // thread that created or last flew it
+    std::vector<std::size_t> freeSlots;     // slots to reuse
+    std::size_t count = 0;                  // UFOs in the fleet
+    std::uint64_t ticks = 0;                // steps since the start
+
+    // thread attributes
+    std::mutex lifecycle;                   // serializes start and stop
+    mutable std::mutex mutex;
+    std::condition_variable wakeup;
+    std::condition_variable ticked;         // tick done, UFO removed or flight ended
+    std::chrono::milliseconds period{100};
+    bool running = false;                   // stepping thread running
+    std::thread stepThread;                 // stepping thread
+    bool virtualTime = false;               // ticks taken by the waiting threads
+    std::vector<std::thread::id> waiters;   // threads in awaitTick() (virtual time)
+    std::uint64_t stallReported = 0;        // last tick a stop was reported for (+1)
+
+    // update one UFO (mutex held)
+    void updateSim(const std::size_t i);
+
+    // update every UFO (mutex held)
+    void stepAll();
+
+    // first UFO holding the clock, used.size() if none (mutex held)
+    std::size_t holder() const;
+
+    // report the UFO that keeps the clock from ticking (mutex held)
+    void reportStall(const std::size_t id);
+
+    // thread function
+    void runSim();
+
+    // end the stepping thread if the fleet is empty (mutex not held)
+    void stopIfEmpty();
+};
+
+#endif
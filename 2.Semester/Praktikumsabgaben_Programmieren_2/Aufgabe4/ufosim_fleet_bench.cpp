@@ -0,0 +1,218 @@
+/*
+ * ufosim fleet benchmark
+ * UFO-steps per second of UfosimFleet::step() for large fleets
+ *
+ * Every UFO gets a random flight vector and speed requests. The fleet is
+ * compared step by step against the former Ufosim::updateSim() (copied
+ * below) to show that the results are bit-identical.
+ *
+ * Compile with: g++ -std=c++20 -O2 -pthread -o ufosim_fleet_bench ufosim_fleet_bench.cpp ufosim_fleet.cpp
+ * Usage: ./ufosim_fleet_bench [steps]
+ */
+
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <vector>
+#include "ufosim_fleet.h"
+
+// state and update of Ufosim 4.0.3c
+struct ReferenceUfo
+{
+    static constexpr int VMAX = 50;
+    static constexpr int ACCELERATION = 1;
+
+    volatile float x = 0.0;
+    volatile float y = 0.0;
+    volatile float z = 0.0;
+    volatile int v = 0;
+    volatile float dist = 0.0;
+    volatile float ftime = 0.0;
+    volatile float xvect = 0.0;
+    volatile float yvect = 0.0;
+    volatile float zvect = 0.0;
+    volatile int deltaV = 0;
+    volatile float vel = 0.0;
+
+    void updateSim()
+    {
+        if (z > 0.0)
+            ftime = ftime + 0.1f;
+
+        if (z >= 0.0)
+        {
+            if (deltaV > 0)
+            {
+                if (deltaV - ACCELERATION > 0)
+                {
+                    if (v + ACCELERATION < VMAX)
+                        v = v + ACCELERATION;
+                    else
+                        v = VMAX;
+                    deltaV = deltaV - ACCELERATION;
+                }
+                else
+                {
+                    if (v + deltaV < VMAX)
+                        v = v + deltaV;
+                    else
+                        v = VMAX;
+                    deltaV = 0;
+                }
+            }
+            else if (deltaV < 0)
+            {
+                if (deltaV + ACCELERATION < 0)
+                {
+                    if (v - ACCELERATION > 0)
+                        v = v - ACCELERATION;
+                    else
+                        v = 0.0;
+                    deltaV = deltaV + ACCELERATION;
+                }
+                else
+                {
+                    if (v + deltaV > 0.0)
+                        v = v + deltaV;
+                    else
+                        v = 0.0;
+                    deltaV = 0;
+                }
+            }
+        }
+
+        vel = (float)v / 3.6f;
+        dist = dist + vel / 10.0f;
+        x = x + vel / 10.0f * xvect;
+        y = y + vel / 10.0f * yvect;
+        z = z + vel / 10.0f * zvect;
+
+        if (z <= 0.0)
+        {
+            if (v == 1)
+            {
+                z = 0.0;
+                v = 0;
+            }
+            else if (v > 1)
+            {
+                z = -1.0;
+                v = 0;
+            }
+        }
+    }
+};
+
+static bool same(const float a, const float b)
+{
+    return std::memcmp(&a, &b, sizeof a) == 0;
+}
+
+// flight vector pointing upwards first, so that the UFOs take off
+static void setVector(UfosimFleet& fleet, std::vector<ReferenceUfo>& reference,
+                      std::size_t i, std::mt19937& random)
+{
+    std::uniform_real_distribution<float> component(-1.0f, 1.0f);
+    const float xv = component(random);
+    const float yv = component(random);
+    const float zv = component(random);
+    const float length = (float)sqrt(xv*xv + yv*yv + zv*zv) + 0.001f;
+    fleet.setVector(i, xv / length, yv / length, zv / length);
+    reference[i].xvect = xv / length;
+    reference[i].yvect = yv / length;
+    reference[i].zvect = zv / length;
+}
+
+static bool compare(std::size_t ufos, int steps)
+{
+    UfosimFleet fleet;
+    std::vector<ReferenceUfo> reference(ufos);
+    std::mt19937 random(42);
+    std::uniform_int_distribution<int> delta(-60, 60);
+    for (std::size_t i = 0; i < ufos; i++)
+    {
+        fleet.add();
+        fleet.setVector(i, 0.0f, 0.0f, 1.0f);
+        reference[i].zvect = 1.0f;
+        fleet.requestDeltaV(i, 20);
+        reference[i].deltaV = reference[i].deltaV + 20;
+    }
+
+    for (int s = 0; s < steps; s++)
+    {
+        if (s % 50 == 10)
+        {
+            for (std::size_t i = 0; i < ufos; i++)
+            {
+                setVector(fleet, reference, i, random);
+                const int d = delta(random);
+                fleet.requestDeltaV(i, d);
+                reference[i].deltaV = reference[i].deltaV + d;
+            }
+        }
+        fleet.step();
+        for (std::size_t i = 0; i < ufos; i++)
+        {
+            reference[i].updateSim();
+            const ReferenceUfo& r = reference[i];
+            if (!same(fleet.getX(i), r.x) || !same(fleet.getY(i), r.y) ||
+                !same(fleet.getZ(i), r.z) || fleet.getV(i) != r.v ||
+                !same(fleet.getDist(i), r.dist) || !same(fleet.getFtime(i), r.ftime))
+            {
+                std::cout << "UFO " << i << " differs after step " << s + 1 << std::endl;
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+static void bench(std::size_t ufos, int steps)
+{
+    UfosimFleet fleet;
+    std::vector<ReferenceUfo> reference(ufos);
+    std::mt19937 random(7);
+    for (std::size_t i = 0; i < ufos; i++)
+    {
+        fleet.add();
+        setVector(fleet, reference, i, random);
+        fleet.requestDeltaV(i, 30);
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    for (int s = 0; s < steps; s++)
+        fleet.step();
+    const std::chrono::duration<double> seconds = std::chrono::steady_clock::now() - start;
+
+    const double ufoSteps = (double)ufos * steps;
+    std::cout.setf(std::ios::fixed);
+    std::cout.precision(1);
+    std::cout.width(6);
+    std::cout << ufos << " UFOs: ";
+    std::cout.width(8);
+    std::cout << seconds.count() * 1e6 / steps << " us/step ";
+    std::cout.precision(0);
+    std::cout.width(12);
+    std::cout << ufoSteps / seconds.count() << " UFO-steps/s" << std::endl;
+}
+
+int main(int argc, char* argv[])
+{
+    const int steps = argc > 1 ? std::atoi(argv[1]) : 2000;
+    if (steps <= 0)
+    {
+        std::cout << "usage: " << argv[0] << " [steps]" << std::endl;
+        return 2;
+    }
+
+    if (!compare(1000, 600))
+        return 1;
+    std::cout << "1000 UFOs, 600 steps: identical to Ufosim::updateSim()" << std::endl;
+
+    for (std::size_t ufos : {1000, 10000, 100000})
+        bench(ufos, ufos >= 100000 ? steps / 10 : steps);
+    return 0;
+}
@@ -0,0 +1,103 @@
+/*
+ * ufosim virtual time test
+ * Concurrent flights of a Vertical and a Ballistic in real and virtual time
+ *
+ * Both UFOs fly two destinations each in their own thread, first in real
+ * time, then in virtual time (Ufosim::setVirtualTime). Positions, flight
+ * times and the number of ticks the flights took have to be identical.
+ * A second virtual run starts the threads with delays of real time, which
+ * must not change anything either: the UFOs hold the clock until their
+ * threads fly them.
+ *
+ * Compile with: g++ -std=c++20 -O2 -pthread -o ufosim_virtual_test ufosim_virtual_test.cpp ufo.cpp vertical.cpp ballistic.cpp route.cpp ufosim.cpp ufosim_fleet.cpp
+ * Takes about 15 s (the real-time run)
+ */
+
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "ballistic.h"
+#include "ufosim.h"
+#include "ufosim_fleet.h"
+#include "vertical.h"
+
+struct Result
+{
+    std::vector<float> vertical;            // x, y, z
+    std::vector<float> ballistic;
+    float verticalFtime = 0.0;
+    float ballisticFtime = 0.0;
+    std::uint64_t ticks = 0;                // ticks from the start to the last landing
+};
+
+static Result fly(const bool virtualTime, const int delayMs)
+{
+    Result result;
+    Vertical vert("vert");
+    Ballistic ball("ball", 45.0, 70.0);
+
+    // real time: start right after a tick, so that both threads begin
+    // their first flight in the same tick
+    UfosimFleet& fleet = UfosimFleet::instance();
+    std::uint64_t start = fleet.getTicks();
+    if (!virtualTime)
+        start = fleet.awaitTick(start);
+
+    std::thread vertThread([&]
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(delayMs));
+        vert.flyToDest(4.0, 3.0, 3.0, 20);
+        vert.flyToDest(0.0, -2.0, 2.0, 20);
+    });
+    std::thread ballThread([&]
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(2 * delayMs));
+        ball.flyToDest(6.0, 6.0, 4.0, 10);
+        ball.flyToDest(-3.0, 0.0, 3.0, 10);
+    });
+    vertThread.join();
+    ballThread.join();
+
+    result.ticks = fleet.getTicks() - start;
+    result.vertical = vert.getPosition();
+    result.ballistic = ball.getPosition();
+    result.verticalFtime = vert.getFtime();
+    result.ballisticFtime = ball.getFtime();
+    return result;
+}
+
+static bool same(const Result& a, const Result& b, const std::string& what)
+{
+    bool ok = a.vertical == b.vertical && a.ballistic == b.ballistic &&
+              a.verticalFtime == b.verticalFtime && a.ballisticFtime == b.ballisticFtime &&
+              a.ticks == b.ticks;
+    std::cout << (ok ? "ok:     " : "FAILED: ") << what << " (ftime " << a.verticalFtime << "/"
+              << b.verticalFtime << " s, " << a.ballisticFtime << "/" << b.ballisticFtime << " s, ticks "
+              << a.ticks << "/" << b.ticks << ")" << std::endl;
+    return ok;
+}
+
+int main()
+{
+    const Result real = fly(false, 0);
+
+    Ufosim::setVirtualTime(true);
+    if (!UfosimFleet::instance().isVirtual())
+    {
+        std::cout << "FAILED: virtual time not switched on" << std::endl;
+        return 1;
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    const Result virt = fly(true, 0);
+    const std::chrono::duration<double> seconds = std::chrono::steady_clock::now() - start;
+    const Result delayed = fly(true, 100);
+
+    bool ok = same(real, virt, "real time == virtual time");
+    ok = same(virt, delayed, "virtual time with threads delayed") && ok;
+    std::cout << "virtual run: " << seconds.count() * 1000.0 << " ms for " << virt.ticks << " ticks" << std::endl;
+    return ok ? 0 : 1;
+}
@@ -7,6 +7,18 @@
 #include "ballistic.h"
 #include "vertical.h"
 #include "route.h"
+#include "ufosim.h"
+
+// Flights in simulated time (Ufosim 4.2.0, build against Aufgabe4): the
+// results match real time tick for tick, without waiting for them
+struct VirtualTime
+{
+    VirtualTime()
+    {
+        Ufosim::setVirtualTime(true);
+    }
+};
+BOOST_GLOBAL_FIXTURE(VirtualTime);
 
 BOOST_AUTO_TEST_SUITE(pa_utest)
 
@@ -0,0 +1,392 @@
+/*
+ * Benchmarks for the kart_control hot paths
+ * =========================================
+ *
+ * Runs the real ESCController with simulated GPIO (TEST_MODE,
+ * kart_gpio_sim.h) and a PWM backend that only records pulses, and
+ * measures
+ * - set_motor_speed() throughput with 1 to 8 producer threads
+ * - command to PWM latency: set_motor_speed() until the backend receives
+ *   the new pulse, at 1 kHz control frequency
+ * - the output part of a control cycle (update_motor_speeds(), flush
+ *   included) and the whole cycle for 1 to 32 motors, on a virtual clock
+ *   so that cycles run back to back (the cycle in real time per cycle:
+ *   virtual time stands still while a cycle runs)
+ * - get_status() and Logger::log() per call
+ *
+ * Results are printed as a table; --json writes them for CI. With
+ * --baseline the run fails when a result is worse than in that file by
+ * more than --tolerance (0.5: 50 % slower or 33 % less throughput).
+ *
+ * Usage: bench_kart [--quick] [--json FILE] [--baseline FILE] [--tolerance X]
+ *
+ * Compile with: g++ -std=c++20 -O2 -pthread -DTEST_MODE -o bench_kart bench_kart.cpp -lrt
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include "kart_sim.h"
+
+static Logger::Options bench_log_options() {
+    Logger::Options options = Logger::default_options();
+    options.text_path.clear();
+    options.binary_path.clear();
+    options.console_output = false;
+    options.min_level = Logger::INFO;
+    // The writer drains the rings every millisecond between logger bursts
+    options.flush_interval = std::chrono::milliseconds(1);
+    return options;
+}
+
+Logger g_logger(bench_log_options());
+
+struct BenchResult {
+    std::string name;
+    const char* unit;
+    double value;
+    bool lower_is_better;
+};
+
+static std::vector<BenchResult> results;
+
+static void report(const std::string& name, const char* unit, double value, bool lower_is_better = true) {
+    results.push_back(BenchResult{name, unit, value, lower_is_better});
+    std::printf("%-40s %14.1f %s\n", name.c_str(), value, unit);
+}
+
+// Records the last pulse per pin; a probe notes when one expected pulse
+// arrives on one pin
+class ProbePwmBackend : public PwmBackend {
+public:
+    const char* name() const override {
+        return "probe";
+    }
+
+    bool setup(int, std::uint32_t) override {
+        return true;
+    }
+
+    void write(int pin, std::uint32_t pulse_ns) override {
+        if (pin == probe_pin.load(std::memory_order_relaxed) &&
+            pulse_ns == probe_pulse.load(std::memory_order_relaxed) &&
+            seen_ns.load(std::memory_order_relaxed) == 0) {
+            seen_ns.store(EmergencyStop::now_ns(), std::memory_order_release);
+        }
+        last_pulse.store(pulse_ns, std::memory_order_relaxed);
+    }
+
+    void arm(int pin, std::uint32_t pulse_ns) {
+        seen_ns.store(0, std::memory_order_relaxed);
+        probe_pulse.store(pulse_ns, std::memory_order_relaxed);
+        probe_pin.store(pin, std::memory_order_release);
+    }
+
+    // CLOCK_MONOTONIC time of the probed write, 0 until then
+    std::int64_t seen() const {
+        return seen_ns.load(std::memory_order_acquire);
+    }
+
+private:
+    std::atomic<int> probe_pin{-1};
+    std::atomic<std::uint32_t> probe_pulse{0};
+    std::atomic<std::int64_t> seen_ns{0};
+    std::atomic<std::uint32_t> last_pulse{0};
+};
+
+// Motors on pins 2.. that skip the stop and LED pins of the default config
+static KartConfig bench_config(int motors, int control_frequency) {
+    KartConfig config = simulation_config(create_default_config());
+    config.motors.clear();
+    for (int i = 0; i < motors; ++i) {
+        config.motors.emplace_back(i < 18 ? 2 + i : 4 + i, "motor" + std::to_string(i));
+    }
+    config.control_frequency = control_frequency;
+    config.safety_limits.max_speed = 100.0;
+    config.safety_limits.watchdog_timeout = 3600.0;
+    compute_pulse_params(config);
+    SimGpio::board().release(config.emergency_pin, HIGH);
+    return config;
+}
+
+static void bench_producers(bool quick) {
+    const auto duration = std::chrono::milliseconds(quick ? 100 : 400);
+    for (int threads : {1, 2, 4, 8}) {
+        ESCController controller(bench_config(4, 1000), std::make_unique<ProbePwmBackend>());
+        if (!controller.start()) {
+            std::printf("controller did not start\n");
+            std::exit(1);
+        }
+        std::atomic<bool> go{false};
+        std::atomic<bool> done{false};
+        std::atomic<std::uint64_t> accepted{0};
+        std::atomic<std::uint64_t> refused{0};
+        std::vector<std::thread> producers;
+        for (int t = 0; t < threads; ++t) {
+            producers.emplace_back([&, t] {
+                const MotorHandle motor = static_cast<MotorHandle>(t % 4);
+                std::uint64_t ok = 0;
+                std::uint64_t failed = 0;
+                while (!go.load(std::memory_order_acquire)) {
+                    std::this_thread::yield();
+                }
+                for (std::uint64_t k = 0; !done.load(std::memory_order_relaxed); ++k) {
+                    if (controller.set_motor_speed(motor, (k & 1) ? 20.0 : 30.0)) {
+                        ++ok;
+                    } else {
+                        ++failed;
+                    }
+                }
+                accepted.fetch_add(ok);
+                refused.fetch_add(failed);
+            });
+        }
+        const auto start = std::chrono::steady_clock::now();
+        go.store(true, std::memory_order_release);
+        std::this_thread::sleep_for(duration);
+        done.store(true);
+        for (std::thread& producer : producers) {
+            producer.join();
+        }
+        const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        controller.stop();
+        report("set_motor_speed_" + std::to_string(threads) + "_threads", "calls/s",
+               static_cast<double>(accepted.load() + refused.load()) / seconds, false);
+        if (refused.load() != 0) {
+            std::printf("  (%llu refused)\n", static_cast<unsigned long long>(refused.load()));
+        }
+    }
+}
+
+static void bench_command_latency(bool quick) {
+    const int samples = quick ? 200 : 1000;
+    KartConfig config = bench_config(2, 1000);
+    // Steps of 2 % land within one cycle
+    config.safety_limits.max_acceleration_rate = 1.0;
+    auto sink = std::make_unique<ProbePwmBackend>();
+    ProbePwmBackend* probe = sink.get();
+    ESCController controller(config, std::move(sink));
+    if (!controller.start()) {
+        std::printf("controller did not start\n");
+        std::exit(1);
+    }
+
+    std::vector<std::int64_t> latency;
+    latency.reserve(samples);
+    for (int i = 0; i < samples; ++i) {
+        // Spread the commands over the control period
+        std::this_thread::sleep_for(std::chrono::microseconds(1000 + (i * 137) % 1000));
+        const double speed = (i & 1) ? 10.0 : 12.0;
+        probe->arm(config.motors[0].pin, pulse_ns(config.pulses[0], speed));
+        const std::int64_t sent = EmergencyStop::now_ns();
+        controller.set_motor_speed(MotorHandle{0}, speed);
+        const auto give_up = std::chrono::steady_clock::now() + std::chrono::milliseconds(100);
+        while (probe->seen() == 0 && std::chrono::steady_clock::now() < give_up) {
+            std::this_thread::yield();
+        }
+        if (probe->seen() != 0) {
+            latency.push_back(probe->seen() - sent);
+        }
+    }
+    controller.stop();
+
+    if (latency.empty()) {
+        std::printf("no command reached the PWM backend\n");
+        std::exit(1);
+    }
+    std::sort(latency.begin(), latency.end());
+    auto percentile = [&](double p) {
+        return static_cast<double>(latency[std::min(latency.size() - 1,
+                                                    static_cast<std::size_t>(latency.size() * p / 100.0))]);
+    };
+    report("command_to_pwm_p50", "ns", percentile(50.0));
+    report("command_to_pwm_p90", "ns", percentile(90.0));
+    report("command_to_pwm_p99", "ns", percentile(99.0));
+    report("command_to_pwm_max", "ns", static_cast<double>(latency.back()));
+}
+
+static void bench_cycle_cost(bool quick) {
+    const std::uint64_t cycles = quick ? 5000 : 20000;
+    for (int motors : {1, 2, 4, 8, 16, 32}) {
+        SimClock clock;
+        ESCController controller(bench_config(motors, 1000), std::make_unique<ProbePwmBackend>(), &clock);
+        // Every motor ramps all the time: a new direction every 400 cycles
+        std::uint64_t ticks = 0;
+        clock.set_tick([&](std::int64_t) {
+            if (ticks++ % 400 == 0) {
+                controller.set_all_motors_speed((ticks / 400) % 2 ? -50.0 : 50.0);
+            }
+        });
+        if (!controller.start()) {
+            std::printf("controller did not start\n");
+            std::exit(1);
+        }
+        // Skip the start-up cycles
+        const std::atomic<std::uint64_t>& done = controller.loop_timing().cycles;
+        while (done.load() < cycles / 10) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        const std::uint64_t first = done.load();
+        const auto start = std::chrono::steady_clock::now();
+        while (done.load() < first + cycles) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+        const std::uint64_t last = done.load();
+        const double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        clock.halt();
+        const LatencyHistogram::Snapshot output = controller.output_timing().snapshot();
+        controller.stop();
+        report("update_motor_speeds_" + std::to_string(motors) + "_motors", "ns",
+               static_cast<double>(output.mean_ns()));
+        report("control_cycle_" + std::to_string(motors) + "_motors", "ns", ns / static_cast<double>(last - first));
+    }
+}
+
+static void bench_status(bool quick) {
+    const int calls = quick ? 2000 : 20000;
+    ESCController controller(bench_config(8, 1000), std::make_unique<ProbePwmBackend>());
+    if (!controller.start()) {
+        std::printf("controller did not start\n");
+        std::exit(1);
+    }
+    std::size_t length = 0;
+    const auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < calls; ++i) {
+        length += controller.get_status().size();
+    }
+    const double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    controller.stop();
+    report("get_status_8_motors", "ns/call", ns / calls);
+    if (length == 0) {
+        std::printf("empty status\n");
+    }
+}
+
+// Bursts that fit the per-thread ring, so no message is dropped
+static void bench_logger(bool quick) {
+    const int bursts = quick ? 50 : 400;
+    const int burst = static_cast<int>(Logger::RING_CAPACITY / 4);
+    const std::string text = "motor0(current:12.500000 target:20.000000) Running:1 Emergency:0";
+    const std::uint64_t dropped = g_logger.dropped_messages();
+
+    auto run = [&](const char* name, auto log) {
+        double ns = 0.0;
+        for (int b = 0; b < bursts; ++b) {
+            const auto start = std::chrono::steady_clock::now();
+            for (int i = 0; i < burst; ++i) {
+                log(i);
+            }
+            ns += std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+            // Let the writer thread drain the ring
+            std::this_thread::sleep_for(std::chrono::milliseconds(3));
+        }
+        report(name, "ns/call", ns / (static_cast<double>(bursts) * burst));
+    };
+    run("logger_log_numbers", [](int i) { g_logger.log(Logger::INFO, LogMsg::MOTOR_INITIALIZED, "motor0", i); });
+    run("logger_log_text", [&](int) { g_logger.log(Logger::INFO, LogMsg::STATUS, text); });
+    run("logger_log_filtered", [](int i) { g_logger.log(Logger::DEBUG, LogMsg::MOTOR_INITIALIZED, "motor0", i); });
+    if (g_logger.dropped_messages() != dropped) {
+        std::printf("  (%llu messages dropped)\n",
+                    static_cast<unsigned long long>(g_logger.dropped_messages() - dropped));
+    }
+}
+
+static bool write_json(const std::string& path, bool quick) {
+    std::FILE* out = std::fopen(path.c_str(), "w");
+    if (!out) {
+        return false;
+    }
+    std::fprintf(out, "{\n  \"suite\": \"kart_control\",\n  \"quick\": %s,\n  \"results\": [\n",
+                 quick ? "true" : "false");
+    for (std::size_t i = 0; i < results.size(); ++i) {
+        const BenchResult& r = results[i];
+        std::fprintf(out, "    {\"name\": \"%s\", \"unit\": \"%s\", \"value\": %.1f, \"better\": \"%s\"}%s\n",
+                     r.name.c_str(), r.unit, r.value, r.lower_is_better ? "lower" : "higher",
+                     i + 1 < results.size() ? "," : "");
+    }
+    std::fprintf(out, "  ]\n}\n");
+    return std::fclose(out) == 0;
+}
+
+// Values of a file written by write_json(), one result per line
+static bool baseline_value(const std::string& path, const std::string& name, double& value) {
+    std::ifstream in(path);
+    const std::string key = "{\"name\": \"" + name + "\",";
+    std::string line;
+    while (std::getline(in, line)) {
+        const std::size_t at = line.find(key);
+        const std::size_t field = line.find("\"value\": ");
+        if (at != std::string::npos && field != std::string::npos) {
+            value = std::strtod(line.c_str() + field + 9, nullptr);
+            return true;
+        }
+    }
+    return false;
+}
+
+static int compare(const std::string& path, double tolerance) {
+    int regressions = 0;
+    int compared = 0;
+    for (const BenchResult& r : results) {
+        double base;
+        if (!baseline_value(path, r.name, base) || base <= 0.0) {
+            continue;
+        }
+        ++compared;
+        const bool worse = r.lower_is_better ? r.value > base * (1.0 + tolerance)
+                                             : r.value < base / (1.0 + tolerance);
+        if (worse) {
+            std::printf("REGRESSION %s: %.1f %s, baseline %.1f\n", r.name.c_str(), r.value, r.unit, base);
+            ++regressions;
+        }
+    }
+    std::printf("Compared %d results with %s: %d regressions\n", compared, path.c_str(), regressions);
+    return regressions == 0 ? 0 : 1;
+}
+
+int main(int argc, char* argv[]) {
+    bool quick = false;
+    std::string json_path;
+    std::string baseline_path;
+    double tolerance = 0.5;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg == "--quick") {
+            quick = true;
+        } else if (arg == "--json" && i + 1 < argc) {
+            json_path = argv[++i];
+        } else if (arg == "--baseline" && i + 1 < argc) {
+            baseline_path = argv[++i];
+        } else if (arg == "--tolerance" && i + 1 < argc) {
+            tolerance = std::atof(argv[++i]);
+        } else {
+            std::printf("Usage: %s [--quick] [--json FILE] [--baseline FILE] [--tolerance X]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    std::printf("Kart control benchmarks (simulated GPIO%s)\n", quick ? ", quick" : "");
+    bench_producers(quick);
+    bench_command_latency(quick);
+    bench_cycle_cost(quick);
+    bench_status(quick);
+    bench_logger(quick);
+
+    if (!json_path.empty()) {
+        if (!write_json(json_path, quick)) {
+            std::printf("cannot write %s\n", json_path.c_str());
+            return 2;
+        }
+        std::printf("Results written to %s\n", json_path.c_str());
+    }
+    return baseline_path.empty() ? 0 : compare(baseline_path, tolerance);
+}
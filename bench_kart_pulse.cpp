@@ -0,0 +1,103 @@
+/*
+ * Microbenchmark for the speed -> pulse width conversion
+ * ======================================================
+ *
+ * Converts a sweep of speeds for a set of motors with
+ * - the former floating-point speed_to_duty_cycle() (divisions, branches
+ *   and the period computation every call)
+ * - precomputed fixed-point PulseParams (kart_pulse.h)
+ * - a compile-time ESC profile (FixedEsc<>)
+ *
+ * Usage: bench_kart_pulse [iterations]
+ *
+ * Compile with: g++ -std=c++20 -O2 -o bench_kart_pulse bench_kart_pulse.cpp
+ */
+
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include "kart_pulse.h"
+
+struct FloatMotor {
+    double min_pulse_width = 1.0;
+    double neutral_pulse_width = 1.5;
+    double max_pulse_width = 2.0;
+    int frequency = 50;
+};
+
+static constexpr int MOTORS = 8;
+static constexpr int SPEEDS = 1024;
+
+// The conversion kart_control.cpp used before PulseParams
+__attribute__((noinline)) static std::uint32_t float_pulse(const FloatMotor& motor, double speed, std::uint32_t& period) {
+    double pulse_width;
+    if (speed == 0.0) {
+        pulse_width = motor.neutral_pulse_width;
+    } else if (speed > 0) {
+        pulse_width = motor.neutral_pulse_width +
+                      (speed / 100.0) * (motor.max_pulse_width - motor.neutral_pulse_width);
+    } else {
+        pulse_width = motor.neutral_pulse_width +
+                      (speed / 100.0) * (motor.neutral_pulse_width - motor.min_pulse_width);
+    }
+    period = static_cast<std::uint32_t>(1000000000u / static_cast<unsigned>(std::max(motor.frequency, 1)));
+    return static_cast<std::uint32_t>(std::lround(pulse_width * 1e6));
+}
+
+__attribute__((noinline)) static std::uint32_t fixed_pulse(const PulseParams& params, double speed) {
+    return pulse_ns(params, speed);
+}
+
+__attribute__((noinline)) static std::uint32_t profile_pulse(double speed) {
+    return FixedEsc<ESC_STANDARD_PWM>::pulse(speed);
+}
+
+template <typename Convert>
+static double run(const char* name, long iterations, const std::vector<double>& speeds, Convert convert) {
+    std::uint64_t checksum = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (long i = 0; i < iterations; ++i) {
+        for (int s = 0; s < SPEEDS; ++s) {
+            for (int m = 0; m < MOTORS; ++m) {
+                checksum += convert(m, speeds[s]);
+            }
+        }
+    }
+    auto elapsed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    double per_call = elapsed / (static_cast<double>(iterations) * SPEEDS * MOTORS);
+    std::printf("%-22s %7.2f ns/conversion (checksum %llu)\n", name, per_call,
+                static_cast<unsigned long long>(checksum));
+    return per_call;
+}
+
+int main(int argc, char* argv[]) {
+    long iterations = argc > 1 ? std::atol(argv[1]) : 2000;
+    if (iterations <= 0) {
+        iterations = 2000;
+    }
+
+    std::vector<double> speeds(SPEEDS);
+    for (int s = 0; s < SPEEDS; ++s) {
+        speeds[s] = -100.0 + 200.0 * s / (SPEEDS - 1);
+    }
+    std::vector<FloatMotor> motors(MOTORS);
+    std::vector<PulseParams> params(MOTORS, make_pulse_params(1.0, 1.5, 2.0, 50));
+
+    std::printf("Pulse conversion: %d motors x %d speeds x %ld iterations\n", MOTORS, SPEEDS, iterations);
+    double reference = run("float (former)", iterations, speeds, [&](int m, double speed) {
+        std::uint32_t period;
+        std::uint32_t pulse = float_pulse(motors[m], speed, period);
+        return pulse + period;
+    });
+    double fixed = run("fixed PulseParams", iterations, speeds, [&](int m, double speed) {
+        return fixed_pulse(params[m], speed) + params[m].period_ns;
+    });
+    double profile = run("FixedEsc<STANDARD_PWM>", iterations, speeds, [&](int, double speed) {
+        return profile_pulse(speed) + ESC_STANDARD_PWM.period_ns;
+    });
+    std::printf("Speedup: fixed %.2fx, profile %.2fx\n", reference / fixed, reference / profile);
+    return 0;
+}
@@ -12,6 +12,12 @@ used in kart motor control systems. It includes:
 - Calibration and initialization procedures
 - Real-time monitoring and logging
 
+ESCController drives the C++ controller core (kart_native.cpp, built with
+'make python-native'): control loop, emergency stop and watchdog run on
+native threads and every call releases the GIL. Without the extension the
+RPi.GPIO implementation (PythonESCController) is used instead. KART_CORE
+selects explicitly: native, sim (simulated GPIO, for tests) or python.
+
 Hardware Requirements:
 - Raspberry Pi with GPIO pins
 - ESC compatible with servo PWM signals (typically 1-2ms pulse width, 50Hz)
@@ -26,7 +32,7 @@ Pin Configuration:
 Author: Created for kart motor control system
 """
 
-import RPi.GPIO as GPIO
+import os
 import time
 import threading
 import signal
@@ -48,6 +54,23 @@ logging.basicConfig(
 )
 logger = logging.getLogger(__name__)
 
+# RPi.GPIO is only needed by the Python implementation
+try:
+    import RPi.GPIO as GPIO
+except ImportError:
+    GPIO = None
+
+# C++ controller core
+_CORE = os.environ.get('KART_CORE', 'native')
+_native = None
+if _CORE == 'sim':
+    import _kart_native_sim as _native
+elif _CORE == 'native':
+    try:
+        import _kart_native as _native
+    except ImportError:
+        _native = None
+
 @dataclass
 class MotorConfig:
     """Configuration for a single motor/ESC"""
@@ -66,9 +89,12 @@ class SafetyLimits:
     emergency_stop_timeout: float = 0.1  # seconds
     watchdog_timeout: float = 2.0  # seconds
 
-class ESCController:
+class PythonESCController:
     """
     Enhanced ESC Controller with safety features and parallel processing
+
+    Pure Python implementation on RPi.GPIO, used when the native core is
+    not built. Its loops run under the GIL (5-15 ms jitter).
     """
     
     def __init__(self, motors: List[MotorConfig], safety_limits: SafetyLimits):
@@ -515,6 +541,188 @@ class ESCController:
         except Exception as e:
             logger.error(f"Error during GPIO cleanup: {e}")
 
+class NativeESCController:
+    """
+    Thin wrapper around the C++ ESCController (kart_native.cpp)
+
+    Same API as PythonESCController. Timing is owned by the native
+    threads; every method releases the GIL while the core runs.
+    """
+    
+    def __init__(self, motors: List[MotorConfig], safety_limits: SafetyLimits,
+                 config_file: Optional[str] = None, telemetry_shm: Optional[str] = None, core=None):
+        """
+        Initialize ESC controller
+        
+        Args:
+            motors: List of motor configurations
+            safety_limits: Safety limits configuration
+            config_file: kart_config.ini for the remaining settings (C++ defaults otherwise)
+            telemetry_shm: Shared-memory telemetry segment instead of the configured one
+            core: Extension module to use (default: the one KART_CORE selected)
+        """
+        self.motors = motors
+        self.safety_limits = safety_limits
+        self.last_heartbeat = time.time()
+        self.core = (core or _native).Controller(
+            [(m.pin, m.name, m.min_pulse_width, m.max_pulse_width, m.neutral_pulse_width, m.frequency)
+             for m in motors],
+            (safety_limits.max_acceleration_rate, safety_limits.max_speed,
+             safety_limits.emergency_stop_timeout, safety_limits.watchdog_timeout),
+            config_file=config_file, telemetry_shm=telemetry_shm)
+        
+        # Setup signal handlers for graceful shutdown
+        signal.signal(signal.SIGINT, self._signal_handler)
+        signal.signal(signal.SIGTERM, self._signal_handler)
+        
+        logger.info("ESC Controller initialized (native core)")
+    
+    @property
+    def is_running(self) -> bool:
+        return self.core.running()
+    
+    @property
+    def emergency_stop(self) -> bool:
+        return self.core.emergency_stop_active()
+    
+    @property
+    def current_speeds(self) -> dict:
+        return {motor.name: self.core.motor_speeds(motor.name)[0] for motor in self.motors}
+    
+    @property
+    def target_speeds(self) -> dict:
+        return {motor.name: self.core.motor_speeds(motor.name)[1] for motor in self.motors}
+    
+    def initialize(self) -> bool:
+        """The core sets up its outputs in start()"""
+        return True
+    
+    def calibrate_escs(self) -> bool:
+        """
+        Calibrate ESCs (max, min, neutral); returns when the control loop is done
+        
+        Returns:
+            bool: True if calibration successful
+        """
+        logger.info("Starting ESC calibration...")
+        if not self.core.calibrate_escs():
+            logger.error("ESC calibration refused or aborted")
+            return False
+        logger.info("ESC calibration complete")
+        return True
+    
+    def start(self) -> bool:
+        """
+        Start the motor control system
+        
+        Returns:
+            bool: True if started successfully
+        """
+        if not self.core.start():
+            logger.error("Failed to start motor control system")
+            return False
+        self.last_heartbeat = time.time()
+        logger.info("Motor control system started")
+        return True
+    
+    def stop(self):
+        """Stop the motor control system safely"""
+        logger.info("Stopping motor control system...")
+        self.core.stop()
+        logger.info("Motor control system stopped")
+    
+    def set_motor_speed(self, motor_name: str, speed: float, immediate: bool = False) -> bool:
+        """
+        Set target speed for a motor (clamped to the safety limits by the control loop)
+        
+        Args:
+            motor_name: Name of the motor
+            speed: Speed percentage (-100 to 100)
+            immediate: If True, bypass acceleration limits
+            
+        Returns:
+            bool: True if command accepted
+        """
+        if not self.core.set_motor_speed(motor_name, speed, immediate):
+            return False
+        self.last_heartbeat = time.time()
+        return True
+    
+    def set_all_motors_speed(self, speed: float, immediate: bool = False) -> bool:
+        """
+        Set speed for all motors in the same control cycle
+        
+        Args:
+            speed: Speed percentage (-100 to 100)
+            immediate: If True, bypass acceleration limits
+            
+        Returns:
+            bool: True if the command was accepted
+        """
+        if not self.core.set_all_motors_speed(speed, immediate):
+            return False
+        self.last_heartbeat = time.time()
+        return True
+    
+    def emergency_stop_all(self):
+        """Emergency stop all motors immediately (neutral before this returns)"""
+        logger.warning("EMERGENCY STOP ACTIVATED")
+        self.core.emergency_stop_all()
+    
+    def reset_emergency_stop(self) -> bool:
+        """
+        Reset emergency stop condition
+        
+        Returns:
+            bool: True if reset successful
+        """
+        if not self.core.reset_emergency_stop():
+            logger.warning("Cannot reset emergency stop - hardware switch still active")
+            return False
+        self.last_heartbeat = time.time()
+        logger.info("Emergency stop reset")
+        return True
+    
+    def get_motor_status(self) -> dict:
+        """
+        Get current status of all motors
+        
+        Returns:
+            dict: Motor status information
+        """
+        motors = {}
+        for motor in self.motors:
+            current, target = self.core.motor_speeds(motor.name)
+            motors[motor.name] = {'current_speed': current, 'target_speed': target, 'pin': motor.pin}
+        return {
+            'motors': motors,
+            'system': {
+                'running': self.is_running,
+                'emergency_stop': self.emergency_stop,
+                'last_heartbeat': self.last_heartbeat
+            }
+        }
+    
+    def telemetry(self):
+        """
+        Live telemetry of the control loop without copies
+        
+        Returns:
+            Telemetry: current_speed/target_speed are memoryviews on the
+            shared-memory segment; compare .sequence before and after a
+            read (even and unchanged) or call .read() for a consistent copy
+        """
+        return self.core.telemetry()
+    
+    def _signal_handler(self, signum, frame):
+        """Handle system signals for graceful shutdown"""
+        logger.info(f"Received signal {signum}, shutting down...")
+        self.stop()
+        sys.exit(0)
+
+# Native core when built, RPi.GPIO implementation otherwise
+ESCController = NativeESCController if _native is not None else PythonESCController
+
 def create_default_config() -> Tuple[List[MotorConfig], SafetyLimits]:
     """
     Create default configuration for kart motor control
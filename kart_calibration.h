@@ -0,0 +1,131 @@
+/*
+ * ESC calibration as a per-motor state machine
+ * ============================================
+ *
+ * Calibrating an ESC means holding the maximum pulse for calibration_time
+ * seconds, then the minimum pulse for as long, then returning to neutral.
+ * Instead of sleeping through that, the control loop calls advance() once
+ * per cycle and writes override_speed() to every motor that is
+ * calibrating; all other motors keep following their targets.
+ *
+ * Calibrations run per motor and independently, can be cancelled at any
+ * time and are aborted as a whole by an emergency stop. The sequencer only
+ * decides phases and deadlines: writing pulses, logging and the interlocks
+ * are up to the caller. Used by the control thread only, no locking.
+ */
+
+#ifndef KART_CALIBRATION_H
+#define KART_CALIBRATION_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+class CalibrationSequencer {
+public:
+    static constexpr std::size_t MAX_MOTORS = 32;
+
+    // MAX_PULSE/MIN_PULSE rather than HIGH/LOW, which wiringPi defines as macros
+    enum Phase : std::uint8_t { IDLE, MAX_PULSE, MIN_PULSE };
+
+    // Reported to the advance()/cancel()/abort_all() callback
+    enum Transition : std::uint8_t { MIN_PULSE_STARTED, COMPLETED, CANCELLED, ABORTED };
+
+    using Clock = std::chrono::steady_clock;
+
+    // Start calibrating a motor now (maximum pulse first); false if it is
+    // already calibrating or out of range
+    bool start(std::size_t motor, Clock::time_point now, std::chrono::nanoseconds step_time) {
+        if (motor >= MAX_MOTORS || phases[motor] != IDLE) {
+            return false;
+        }
+        phases[motor] = MAX_PULSE;
+        deadlines[motor] = now + step_time;
+        active_motors |= 1u << motor;
+        return true;
+    }
+
+    // Move every motor whose step time is up to its next phase.
+    // step_time applies to phases entered now, so a reloaded
+    // calibration_time takes effect at the next step.
+    template <typename Fn>
+    void advance(Clock::time_point now, std::chrono::nanoseconds step_time, Fn&& on_transition) {
+        for (std::uint32_t mask = active_motors; mask != 0; mask &= mask - 1) {
+            const std::size_t motor = static_cast<std::size_t>(__builtin_ctz(mask));
+            if (now < deadlines[motor]) {
+                continue;
+            }
+            if (phases[motor] == MAX_PULSE) {
+                phases[motor] = MIN_PULSE;
+                deadlines[motor] = now + step_time;
+                on_transition(motor, MIN_PULSE_STARTED);
+            } else {
+                finish(motor);
+                on_transition(motor, COMPLETED);
+            }
+        }
+    }
+
+    // False if the motor was not calibrating
+    template <typename Fn>
+    bool cancel(std::size_t motor, Fn&& on_transition) {
+        if (motor >= MAX_MOTORS || phases[motor] == IDLE) {
+            return false;
+        }
+        finish(motor);
+        on_transition(motor, CANCELLED);
+        return true;
+    }
+
+    // Emergency stop: end every calibration
+    template <typename Fn>
+    void abort_all(Fn&& on_transition) {
+        for (std::uint32_t mask = active_motors; mask != 0; mask &= mask - 1) {
+            const std::size_t motor = static_cast<std::size_t>(__builtin_ctz(mask));
+            finish(motor);
+            on_transition(motor, ABORTED);
+        }
+    }
+
+    Phase phase(std::size_t motor) const {
+        return motor < MAX_MOTORS ? phases[motor] : IDLE;
+    }
+
+    bool calibrating(std::size_t motor) const {
+        return phase(motor) != IDLE;
+    }
+
+    bool active() const {
+        return active_motors != 0;
+    }
+
+    std::uint32_t active_mask() const {
+        return active_motors;
+    }
+
+    // Speed to output while calibrating: full forward, then full reverse
+    double override_speed(std::size_t motor) const {
+        return phase(motor) == MAX_PULSE ? 100.0 : -100.0;
+    }
+
+    static const char* phase_name(Phase phase) {
+        switch (phase) {
+            case IDLE: return "idle";
+            case MAX_PULSE: return "max";
+            case MIN_PULSE: return "min";
+        }
+        return "unknown";
+    }
+
+private:
+    Phase phases[MAX_MOTORS] = {};
+    Clock::time_point deadlines[MAX_MOTORS] = {};
+    std::uint32_t active_motors = 0;
+
+    void finish(std::size_t motor) {
+        phases[motor] = IDLE;
+        active_motors &= ~(1u << motor);
+    }
+};
+
+#endif // KART_CALIBRATION_H
@@ -0,0 +1,329 @@
+/*
+ * Command path between clients and the ESC control loop
+ * =====================================================
+ *
+ * Clients (console, joystick, network) push fixed-size commands into a
+ * per-producer lock-free ring. The control loop drains all rings at the
+ * start of every cycle, so a command never takes a lock or wakes a thread.
+ *
+ * Overflow policy: when a producer's ring is full the command is either
+ * coalesced into a per-producer overflow slot (latest target per motor wins)
+ * or rejected, depending on OverflowPolicy. Coalescing never loses the most
+ * recent target of a motor and keeps per-producer ordering intact.
+ *
+ * Batches (push(std::span<const Command>)) are published as one unit: either
+ * with a single ring tail store or under a single overflow slot update, so
+ * the control loop sees all commands of a batch in the same cycle or none.
+ */
+
+#ifndef KART_COMMAND_H
+#define KART_COMMAND_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <span>
+#include <thread>
+#include <type_traits>
+#include "kart_ring.h"
+
+// Upper bound for motors per controller (bit masks are 32 bit wide)
+static constexpr int MAX_MOTORS = 32;
+
+// Command structure for thread communication (no heap data)
+struct Command {
+    enum Type : std::uint8_t { SET_SPEED, EMERGENCY_STOP, CALIBRATE, SHUTDOWN, CANCEL_CALIBRATION };
+
+    // motor value of CALIBRATE / CANCEL_CALIBRATION addressing every motor
+    static constexpr std::uint16_t ALL_MOTORS = 0xffff;
+
+    Type type;
+    bool immediate;
+    std::uint16_t motor;       // index into the controller's motor list
+    double speed;
+    std::int64_t timestamp_ns; // steady_clock, set by CommandQueue::push()
+
+    // Trivial, so that command buffers cost nothing until they are filled
+    Command() = default;
+
+    Command(Type t, std::uint16_t motor_index = 0, double spd = 0.0, bool imm = false)
+        : type(t), immediate(imm), motor(motor_index), speed(spd), timestamp_ns(0) {}
+};
+
+static_assert(std::is_trivially_default_constructible_v<Command>);
+
+// Multi-client command queue built from single-producer rings
+class CommandQueue {
+public:
+    enum OverflowPolicy { COALESCE, REJECT };
+
+    static constexpr int MAX_PRODUCERS = 8;
+    static constexpr std::size_t RING_CAPACITY = 256;
+
+    struct Stats {
+        std::uint64_t pushed;      // commands that went through a ring
+        std::uint64_t coalesced;   // commands merged into an overflow slot
+        std::uint64_t dropped;     // commands rejected on overflow
+        std::uint64_t consumed;    // commands handed to the control loop
+        std::uint64_t max_depth;   // highest ring occupancy seen by the consumer
+        std::uint64_t batches;     // multi-command batches accepted
+        int producers;             // producer slots claimed so far
+    };
+
+private:
+    // Latest-wins mailbox used while a producer's ring is full
+    struct OverflowSlot {
+        enum State : std::uint8_t { EMPTY, WRITING, READY, READING };
+
+        std::atomic<std::uint8_t> state{EMPTY};
+        std::uint32_t speed_mask = 0;       // motors with a pending target
+        std::uint32_t immediate_mask = 0;
+        std::uint32_t type_mask = 0;        // pending emergency stop / shutdown
+        std::uint32_t calibrate_mask = 0;   // motors to calibrate (all bits: ALL_MOTORS)
+        std::uint32_t cancel_mask = 0;      // motors whose calibration to cancel
+        double speeds[MAX_MOTORS] = {};
+        std::int64_t timestamp_ns = 0;      // push time of the latest merged command
+    };
+
+    struct alignas(CACHE_LINE_SIZE) Producer {
+        SpscRing<Command, RING_CAPACITY> ring;
+        OverflowSlot overflow;
+    };
+
+    Producer producers[MAX_PRODUCERS];
+    ProducerRegistry<MAX_PRODUCERS> registry;
+    OverflowPolicy policy;
+
+    alignas(CACHE_LINE_SIZE) std::atomic<std::uint64_t> pushed{0};
+    std::atomic<std::uint64_t> coalesced{0};
+    std::atomic<std::uint64_t> dropped{0};
+    std::atomic<std::uint64_t> batches{0};
+
+    // Written by the consumer only
+    alignas(CACHE_LINE_SIZE) std::atomic<std::uint64_t> consumed{0};
+    std::atomic<std::uint64_t> max_depth{0};
+
+    bool push_to(Producer& p, std::span<const Command> cmds) {
+        if (p.overflow.state.load(std::memory_order_acquire) == OverflowSlot::EMPTY &&
+            (cmds.size() == 1 ? p.ring.try_push(cmds[0]) : p.ring.try_push_n(cmds.data(), cmds.size()))) {
+            pushed.fetch_add(cmds.size(), std::memory_order_relaxed);
+            return true;
+        }
+
+        if (policy == REJECT) {
+            dropped.fetch_add(cmds.size(), std::memory_order_relaxed);
+            return false;
+        }
+
+        coalesce(p.overflow, cmds);
+        coalesced.fetch_add(cmds.size(), std::memory_order_relaxed);
+        return true;
+    }
+
+    // Merges all commands into the slot within one WRITING -> READY transition
+    static void coalesce(OverflowSlot& slot, std::span<const Command> cmds) {
+        std::uint8_t state;
+        for (;;) {
+            state = slot.state.load(std::memory_order_acquire);
+            if (state == OverflowSlot::READING) {
+                // Consumer is copying the slot out; that takes nanoseconds
+                std::this_thread::yield();
+                continue;
+            }
+            if (slot.state.compare_exchange_weak(state, OverflowSlot::WRITING, std::memory_order_acquire)) {
+                break;
+            }
+        }
+
+        if (state == OverflowSlot::EMPTY) {
+            slot.speed_mask = 0;
+            slot.immediate_mask = 0;
+            slot.type_mask = 0;
+            slot.calibrate_mask = 0;
+            slot.cancel_mask = 0;
+        }
+
+        for (const Command& cmd : cmds) {
+            if (cmd.type == Command::SET_SPEED && cmd.motor < MAX_MOTORS) {
+                const std::uint32_t bit = 1u << cmd.motor;
+                slot.speeds[cmd.motor] = cmd.speed;
+                slot.speed_mask |= bit;
+                if (cmd.immediate) {
+                    slot.immediate_mask |= bit;
+                } else {
+                    slot.immediate_mask &= ~bit;
+                }
+            } else if (cmd.type == Command::CALIBRATE || cmd.type == Command::CANCEL_CALIBRATION) {
+                // The later of calibrate and cancel wins per motor
+                const std::uint32_t bits = cmd.motor == Command::ALL_MOTORS ? ~0u
+                                         : cmd.motor < MAX_MOTORS          ? 1u << cmd.motor
+                                                                           : 0u;
+                std::uint32_t& set = cmd.type == Command::CALIBRATE ? slot.calibrate_mask : slot.cancel_mask;
+                std::uint32_t& cleared = cmd.type == Command::CALIBRATE ? slot.cancel_mask : slot.calibrate_mask;
+                set |= bits;
+                cleared &= ~bits;
+            } else if (cmd.type != Command::SET_SPEED) {
+                slot.type_mask |= 1u << cmd.type;
+            }
+        }
+
+        slot.timestamp_ns = cmds.back().timestamp_ns;
+        slot.state.store(OverflowSlot::READY, std::memory_order_release);
+    }
+
+    // Motor within the 32-bit masks of the overflow slot
+    static bool addressable(const Command& cmd) {
+        switch (cmd.type) {
+            case Command::SET_SPEED:
+                return cmd.motor < MAX_MOTORS;
+            case Command::CALIBRATE:
+            case Command::CANCEL_CALIBRATION:
+                return cmd.motor < MAX_MOTORS || cmd.motor == Command::ALL_MOTORS;
+            default:
+                return true;
+        }
+    }
+
+    static Command stamp(Command cmd, const OverflowSlot& slot) {
+        cmd.timestamp_ns = slot.timestamp_ns;
+        return cmd;
+    }
+
+    // Consumer side of an overflow slot. Speed targets are applied before
+    // calibration, emergency stop and shutdown so that the latter win.
+    // Calibrate and cancel never overlap per motor (see coalesce()).
+    template <typename Fn>
+    static std::size_t take_overflow(OverflowSlot& slot, Fn& fn) {
+        std::uint8_t expected = OverflowSlot::READY;
+        if (!slot.state.compare_exchange_strong(expected, OverflowSlot::READING, std::memory_order_acquire)) {
+            return 0;
+        }
+
+        std::size_t count = 0;
+        for (std::uint32_t mask = slot.speed_mask; mask != 0; mask &= mask - 1) {
+            const auto motor = static_cast<std::uint16_t>(__builtin_ctz(mask));
+            fn(stamp(Command(Command::SET_SPEED, motor, slot.speeds[motor], (slot.immediate_mask >> motor) & 1u), slot));
+            ++count;
+        }
+        for (Command::Type type : {Command::CANCEL_CALIBRATION, Command::CALIBRATE}) {
+            const std::uint32_t motors = type == Command::CALIBRATE ? slot.calibrate_mask : slot.cancel_mask;
+            if (motors == ~0u) {
+                fn(stamp(Command(type, Command::ALL_MOTORS), slot));
+                ++count;
+                continue;
+            }
+            for (std::uint32_t mask = motors; mask != 0; mask &= mask - 1) {
+                fn(stamp(Command(type, static_cast<std::uint16_t>(__builtin_ctz(mask))), slot));
+                ++count;
+            }
+        }
+        for (Command::Type type : {Command::EMERGENCY_STOP, Command::SHUTDOWN}) {
+            if (slot.type_mask & (1u << type)) {
+                fn(stamp(Command(type), slot));
+                ++count;
+            }
+        }
+
+        slot.state.store(OverflowSlot::EMPTY, std::memory_order_release);
+        return count;
+    }
+
+public:
+    explicit CommandQueue(OverflowPolicy overflow_policy = COALESCE)
+        : policy(overflow_policy) {}
+
+    CommandQueue(const CommandQueue&) = delete;
+    CommandQueue& operator=(const CommandQueue&) = delete;
+
+    // Largest batch accepted by push(std::span<const Command>)
+    static constexpr std::size_t MAX_BATCH = MAX_MOTORS;
+
+    // Any thread. Never blocks on the consumer.
+    bool push(const Command& cmd) {
+        return push(std::span<const Command>(&cmd, 1));
+    }
+
+    // Any thread. Queues all commands as one unit; the control loop applies
+    // them in the same cycle. Fails without queueing anything if the batch is
+    // empty, larger than MAX_BATCH, addresses a motor beyond MAX_MOTORS (the
+    // overflow slot could not hold it; counted as dropped) or is rejected by
+    // the overflow policy.
+    bool push(std::span<const Command> cmds) {
+        if (cmds.empty() || cmds.size() > MAX_BATCH) {
+            return false;
+        }
+        for (const Command& cmd : cmds) {
+            if (!addressable(cmd)) {
+                dropped.fetch_add(cmds.size(), std::memory_order_relaxed);
+                return false;
+            }
+        }
+
+        // One clock read per push, shared by all commands of a batch
+        Command stamped[MAX_BATCH];
+        const std::int64_t now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+        for (std::size_t i = 0; i < cmds.size(); ++i) {
+            stamped[i] = cmds[i];
+            stamped[i].timestamp_ns = now;
+        }
+        const std::span<const Command> batch(stamped, cmds.size());
+
+        const int slot = registry.slot();
+        bool result;
+        if (slot != registry.SHARED_SLOT) {
+            result = push_to(producers[slot], batch);
+        } else {
+            registry.lock_shared();
+            result = push_to(producers[slot], batch);
+            registry.unlock_shared();
+        }
+
+        if (result && cmds.size() > 1) {
+            batches.fetch_add(1, std::memory_order_relaxed);
+        }
+        return result;
+    }
+
+    // Control thread only. Calls fn for every pending command in per-producer
+    // order and returns the number of commands consumed.
+    template <typename Fn>
+    std::size_t drain(Fn&& fn) {
+        std::size_t total = 0;
+        const int active = registry.active();
+
+        for (int i = 0; i < active; ++i) {
+            Producer& p = producers[i];
+
+            const std::size_t depth = p.ring.size();
+            if (depth > max_depth.load(std::memory_order_relaxed)) {
+                max_depth.store(depth, std::memory_order_relaxed);
+            }
+
+            total += p.ring.drain(fn);
+
+            if (p.overflow.state.load(std::memory_order_acquire) == OverflowSlot::READY) {
+                // The producer stops using the ring while its overflow slot is
+                // in use, so everything still in the ring is older than the slot.
+                total += p.ring.drain(fn);
+                total += take_overflow(p.overflow, fn);
+            }
+        }
+
+        consumed.fetch_add(total, std::memory_order_relaxed);
+        return total;
+    }
+
+    Stats stats() const {
+        return Stats{pushed.load(std::memory_order_relaxed),
+                     coalesced.load(std::memory_order_relaxed),
+                     dropped.load(std::memory_order_relaxed),
+                     consumed.load(std::memory_order_relaxed),
+                     max_depth.load(std::memory_order_relaxed),
+                     batches.load(std::memory_order_relaxed),
+                     registry.active()};
+    }
+};
+
+#endif // KART_COMMAND_H
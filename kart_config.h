@@ -0,0 +1,641 @@
+/*
+ * Configuration subsystem for the kart controller
+ * ===============================================
+ *
+ * kart_config.ini is parsed into an immutable KartConfig snapshot. The
+ * ConfigStore publishes snapshots RCU-style so that a reload never blocks
+ * the control loop:
+ *
+ * - the control loop (the one real-time reader) loads the current snapshot
+ *   pointer once per cycle and reports a quiescent state at the end of the
+ *   cycle; it never takes a lock or frees memory
+ * - other threads get a shared_ptr copy under the writer mutex
+ * - a replaced snapshot is freed by the writer once the control loop has
+ *   finished the cycle that might still use it
+ *
+ * A reload only swaps in a snapshot that validated completely; settings
+ * that need a restart (motor set, pins, frequencies, real-time setup) must
+ * match the running snapshot.
+ */
+
+#ifndef KART_CONFIG_H
+#define KART_CONFIG_H
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include <arpa/inet.h>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#include "kart_command.h"
+#include "kart_dshot.h"
+#include "kart_ini.h"
+#include "kart_pulse.h"
+#include "kart_pwm.h"
+#include "kart_rt.h"
+
+// Motor configuration structure
+struct MotorConfig {
+    int pin;
+    std::string name;
+    double min_pulse_width;    // milliseconds
+    double max_pulse_width;    // milliseconds
+    double neutral_pulse_width; // milliseconds
+    int frequency;             // Hz
+    EscProtocol protocol;      // DShot: pulse widths and frequency unused
+    int tach_pin = -1;         // tachometer GPIO line, -1: none
+    double pulses_per_rev = 1.0;
+    double max_rpm = 0.0;      // at 100 %, for the closed loop
+
+    MotorConfig(int p, const std::string& n, double min_pw = 1.0,
+                double max_pw = 2.0, double neutral_pw = 1.5, int freq = 50,
+                EscProtocol proto = EscProtocol::PWM)
+        : pin(p), name(n), min_pulse_width(min_pw), max_pulse_width(max_pw),
+          neutral_pulse_width(neutral_pw), frequency(freq), protocol(proto) {}
+};
+
+// Safety limits configuration
+struct SafetyLimits {
+    double max_acceleration_rate;  // Maximum change per update cycle
+    double max_speed;              // Maximum speed percentage
+    double emergency_stop_timeout; // seconds
+    double watchdog_timeout;       // seconds
+
+    SafetyLimits(double max_accel = 0.05, double max_spd = 80.0,
+                 double emerg_timeout = 0.1, double wd_timeout = 2.0)
+        : max_acceleration_rate(max_accel), max_speed(max_spd),
+          emergency_stop_timeout(emerg_timeout), watchdog_timeout(wd_timeout) {}
+};
+
+struct KartConfig {
+    std::vector<MotorConfig> motors;
+    SafetyLimits safety_limits;
+
+    // Fixed-point pulse conversion per motor (same order as motors)
+    std::vector<PulseParams> pulses;
+
+    int emergency_pin = 21;
+    int status_led_pin = 20;
+
+    // PCA9685 boards on I2C (kart_pca9685.h) instead of GPIO PWM; motor
+    // pins are then board * 16 + channel, boards on consecutive addresses
+    bool pca9685_enabled = false;
+    std::string pca9685_bus = "/dev/i2c-1";
+    int pca9685_address = 0x40;
+
+    std::uint8_t log_level = 1;        // Logger::Level (DEBUG, INFO, WARNING, ERROR)
+
+    int calibration_time = 3;          // seconds per calibration step
+    bool auto_calibrate = false;
+
+    int control_frequency = 50;        // Hz
+    RtSettings rt;
+
+    std::string telemetry_shm = "/kart_telemetry";   // POSIX shm name, empty: no telemetry
+    
+    // Binary control loop trace (kart_trace.h)
+    std::string trace_file = "/tmp/kart_trace.bin";  // rolling file, empty: no trace
+    int trace_capacity_mb = 16;
+
+    // Binary remote commands (kart_remote.h); both off by default
+    std::string remote_unix_socket;    // datagram socket path, empty: none
+    std::string remote_udp_address = "127.0.0.1";
+    int remote_udp_port = 0;           // 0: no UDP
+
+    // Prometheus metrics over HTTP (kart_metrics.h)
+    std::string metrics_address = "127.0.0.1";
+    int metrics_port = 9101;           // 0: no metrics endpoint
+
+    // Tachometer edges (kart_tach.h) of motors with a tach_pin; the closed
+    // loop corrects each motor's output towards target / 100 * max_rpm
+    std::string tach_chip = "/dev/gpiochip0";
+    int tach_window_ms = 50;
+    bool closed_loop = false;
+    double speed_kp = 0.5;             // percent output per percent of max_rpm
+    double speed_ki = 2.0;             // the same per second
+};
+
+// Derive the per-motor pulse parameters; call after changing motors
+inline void compute_pulse_params(KartConfig& config) {
+    config.pulses.clear();
+    for (const MotorConfig& m : config.motors) {
+        if (is_dshot(m.protocol)) {
+            config.pulses.push_back(make_dshot_params(m.protocol));
+        } else {
+            config.pulses.push_back(make_pulse_params(m.min_pulse_width, m.neutral_pulse_width,
+                                                      m.max_pulse_width, m.frequency));
+        }
+    }
+}
+
+namespace config_detail {
+
+// Typed access to one section that records the first error
+class SectionReader {
+private:
+    const IniFile& ini;
+    std::string section;
+    std::string& error;
+
+    void fail(const std::string& key, const std::string& message) {
+        if (error.empty()) {
+            error = "[" + section + "] " + key + ": " + message;
+        }
+    }
+
+public:
+    SectionReader(const IniFile& file, const std::string& name, std::string& first_error)
+        : ini(file), section(name), error(first_error) {}
+
+    std::string text(const std::string& key, const std::string& fallback) {
+        return ini.get(section, key, fallback);
+    }
+
+    long integer(const std::string& key, long fallback, long min, long max) {
+        if (!ini.has(section, key)) {
+            return fallback;
+        }
+        std::string value = ini.get(section, key);
+        char* end = nullptr;
+        long result = std::strtol(value.c_str(), &end, 10);
+        if (value.empty() || *end != '\0') {
+            fail(key, "'" + value + "' is not an integer");
+        } else if (result < min || result > max) {
+            fail(key, value + " is outside " + std::to_string(min) + ".." + std::to_string(max));
+        }
+        return result;
+    }
+
+    double number(const std::string& key, double fallback, double min, double max) {
+        if (!ini.has(section, key)) {
+            return fallback;
+        }
+        std::string value = ini.get(section, key);
+        char* end = nullptr;
+        double result = std::strtod(value.c_str(), &end);
+        if (value.empty() || *end != '\0') {
+            fail(key, "'" + value + "' is not a number");
+        } else if (!(result >= min && result <= max)) {
+            fail(key, value + " is outside " + std::to_string(min) + ".." + std::to_string(max));
+        }
+        return result;
+    }
+
+    bool boolean(const std::string& key, bool fallback) {
+        if (!ini.has(section, key)) {
+            return fallback;
+        }
+        std::string value = ini.get(section, key);
+        if (value == "true" || value == "yes" || value == "on" || value == "1") {
+            return true;
+        }
+        if (value != "false" && value != "no" && value != "off" && value != "0") {
+            fail(key, "'" + value + "' is not a boolean");
+        }
+        return false;
+    }
+
+    void check(bool condition, const std::string& key, const std::string& message) {
+        if (!condition) {
+            fail(key, message);
+        }
+    }
+};
+
+} // namespace config_detail
+
+// Build a validated snapshot from a parsed INI file. Motors come from the
+// [motor_*] sections in file order (skipped with enabled = false). Keys that
+// are missing keep the defaults of KartConfig.
+inline bool parse_kart_config(const IniFile& ini, KartConfig& config, std::string& error) {
+    using config_detail::SectionReader;
+    config = KartConfig{};
+    error.clear();
+
+    for (const std::string& section : ini.sections()) {
+        if (section.rfind("motor_", 0) != 0) {
+            continue;
+        }
+        SectionReader motor(ini, section, error);
+        if (!motor.boolean("enabled", true)) {
+            continue;
+        }
+        // The protocol gives the defaults of the pulse widths and frequency
+        EscProtocol protocol = EscProtocol::PWM;
+        const std::string protocol_name = motor.text("protocol", "pwm");
+        motor.check(parse_esc_protocol(protocol_name, protocol), "protocol", "'" + protocol_name +
+                    "' is not pwm, oneshot125, oneshot42, multishot, dshot150, dshot300 or dshot600");
+        const EscProfile profile = esc_profile(protocol);
+        MotorConfig m(static_cast<int>(motor.integer("pin", -1, 0, MAX_GPIO_PIN - 1)),
+                      motor.text("name", section.substr(6)),
+                      motor.number("min_pulse_width", profile.min_ns / 1e6, 0.0, 1000.0),
+                      motor.number("max_pulse_width", profile.max_ns / 1e6, 0.0, 1000.0),
+                      motor.number("neutral_pulse_width", profile.neutral_ns / 1e6, 0.0, 1000.0),
+                      static_cast<int>(motor.integer("frequency", 1000000000 / profile.period_ns, 1, 40000)),
+                      protocol);
+        motor.check(m.pin >= 0, "pin", "missing");
+        m.tach_pin = static_cast<int>(motor.integer("tach_pin", m.tach_pin, -1, MAX_GPIO_PIN - 1));
+        m.pulses_per_rev = motor.number("pulses_per_rev", m.pulses_per_rev, 0.01, 1000.0);
+        m.max_rpm = motor.number("max_rpm", m.max_rpm, 0.0, 1000000.0);
+        if (is_dshot(protocol)) {
+            motor.check(SpidevWaveformSink::bus_for_pin(m.pin) >= 0, "pin",
+                        "DShot needs an SPI MOSI pin (GPIO 10, 20, 2, 6 or 14)");
+        } else {
+            motor.check(m.min_pulse_width < m.neutral_pulse_width && m.neutral_pulse_width < m.max_pulse_width,
+                        "neutral_pulse_width", "pulse widths must satisfy min < neutral < max");
+            motor.check(m.max_pulse_width < 1000.0 / m.frequency, "max_pulse_width",
+                        "pulse must be shorter than the PWM period");
+        }
+        for (const MotorConfig& other : config.motors) {
+            motor.check(other.pin != m.pin, "pin", "GPIO " + std::to_string(m.pin) + " used twice");
+            motor.check(other.name != m.name, "name", "motor name '" + m.name + "' used twice");
+            motor.check(m.tach_pin < 0 || m.tach_pin != other.tach_pin, "tach_pin",
+                        "GPIO " + std::to_string(m.tach_pin) + " used twice");
+        }
+        config.motors.push_back(m);
+    }
+    if (error.empty() && (config.motors.empty() || config.motors.size() > static_cast<std::size_t>(MAX_MOTORS))) {
+        error = "between 1 and " + std::to_string(MAX_MOTORS) + " enabled [motor_*] sections required";
+    }
+
+    SectionReader pca9685(ini, "pca9685", error);
+    config.pca9685_enabled = pca9685.boolean("enabled", config.pca9685_enabled);
+    config.pca9685_bus = pca9685.text("bus", config.pca9685_bus);
+    std::string address = pca9685.text("address", "0x40");
+    char* address_end = nullptr;
+    config.pca9685_address = static_cast<int>(std::strtol(address.c_str(), &address_end, 0));
+    int last_board = 0;
+    for (const MotorConfig& m : config.motors) {
+        last_board = std::max(last_board, m.pin / 16);
+    }
+    pca9685.check(!address.empty() && *address_end == '\0' && config.pca9685_address >= 0x40 &&
+                  config.pca9685_address + (config.pca9685_enabled ? last_board : 0) <= 0x7F,
+                  "address", "'" + address + "' is not a PCA9685 address (0x40..0x7f for every board)");
+    for (const MotorConfig& m : config.motors) {
+        pca9685.check(!config.pca9685_enabled || !is_dshot(m.protocol), "enabled",
+                      "motor " + m.name + " uses DShot, which PCA9685 boards cannot send");
+    }
+
+    // Short pulses need the hardware PWM, whose channels drive one pin each
+    bool short_pulses = false;
+    for (const MotorConfig& m : config.motors) {
+        short_pulses = short_pulses || (m.protocol != EscProtocol::PWM && !is_dshot(m.protocol));
+    }
+    if (short_pulses && !config.pca9685_enabled) {
+        for (std::size_t i = 0; i < config.motors.size() && error.empty(); ++i) {
+            const MotorConfig& m = config.motors[i];
+            const int channel = is_dshot(m.protocol) ? -1 : SysfsPwmBackend::channel_for_pin(m.pin);
+            for (std::size_t j = 0; j < i && channel >= 0 && error.empty(); ++j) {
+                const MotorConfig& other = config.motors[j];
+                if (!is_dshot(other.protocol) && SysfsPwmBackend::channel_for_pin(other.pin) == channel) {
+                    error = "motors " + other.name + " and " + m.name + " share PWM channel " +
+                            std::to_string(channel) + " (GPIO " + std::to_string(other.pin) + " and " +
+                            std::to_string(m.pin) + "); oneshot and multishot need a channel each";
+                }
+            }
+        }
+    }
+
+    SectionReader safety(ini, "safety_limits", error);
+    SafetyLimits& limits = config.safety_limits;
+    limits.max_acceleration_rate = safety.number("max_acceleration_rate", limits.max_acceleration_rate, 0.001, 1.0);
+    limits.max_speed = safety.number("max_speed", limits.max_speed, 0.0, 100.0);
+    limits.emergency_stop_timeout = safety.number("emergency_stop_timeout", limits.emergency_stop_timeout, 0.0, 10.0);
+    limits.watchdog_timeout = safety.number("watchdog_timeout", limits.watchdog_timeout, 0.01, 3600.0);
+
+    SectionReader gpio(ini, "gpio_pins", error);
+    config.emergency_pin = static_cast<int>(gpio.integer("emergency_stop", config.emergency_pin, 0, MAX_GPIO_PIN - 1));
+    config.status_led_pin = static_cast<int>(gpio.integer("status_led", config.status_led_pin, 0, MAX_GPIO_PIN - 1));
+    // PCA9685 channels are not GPIOs
+    for (const MotorConfig& m : config.motors) {
+        gpio.check(config.pca9685_enabled || (m.pin != config.emergency_pin && m.pin != config.status_led_pin),
+                   "emergency_stop", "GPIO " + std::to_string(m.pin) + " is also a motor pin");
+        gpio.check(m.tach_pin < 0 || (m.tach_pin != config.emergency_pin && m.tach_pin != config.status_led_pin),
+                   "emergency_stop", "GPIO " + std::to_string(m.tach_pin) + " is also a tachometer pin");
+        for (const MotorConfig& other : config.motors) {
+            gpio.check(config.pca9685_enabled || m.tach_pin != other.pin, "emergency_stop",
+                       "tachometer GPIO " + std::to_string(m.tach_pin) + " is also a motor pin");
+        }
+    }
+
+    SectionReader logging(ini, "logging", error);
+    static const char* const levels[] = {"DEBUG", "INFO", "WARNING", "ERROR"};
+    std::string level = logging.text("log_level", levels[config.log_level]);
+    bool known_level = false;
+    for (std::uint8_t i = 0; i < 4; ++i) {
+        if (level == levels[i]) {
+            config.log_level = i;
+            known_level = true;
+        }
+    }
+    logging.check(known_level, "log_level", "'" + level + "' is not DEBUG, INFO, WARNING or ERROR");
+
+    SectionReader calibration(ini, "calibration", error);
+    config.calibration_time = static_cast<int>(calibration.integer("calibration_time", config.calibration_time, 1, 60));
+    config.auto_calibrate = calibration.boolean("auto_calibrate", config.auto_calibrate);
+
+    SectionReader performance(ini, "performance", error);
+    RtSettings& rt = config.rt;
+    config.control_frequency = static_cast<int>(performance.integer("control_frequency", config.control_frequency, 1, 1000));
+    rt.priority = static_cast<int>(performance.integer("real_time_priority", rt.priority, 1, 99));
+    rt.lock_memory = performance.boolean("lock_memory", rt.lock_memory);
+    rt.stack_prefault_bytes = static_cast<std::size_t>(
+        performance.integer("prefault_stack_kb", static_cast<long>(rt.stack_prefault_bytes / 1024), 0, 8192)) * 1024;
+    rt.heap_reserve_bytes = static_cast<std::size_t>(
+        performance.integer("heap_reserve_kb", static_cast<long>(rt.heap_reserve_bytes / 1024), 0, 1 << 20)) * 1024;
+    rt.control_cpu = static_cast<int>(performance.integer("control_cpu", rt.control_cpu, -1, CPU_SETSIZE - 1));
+    rt.worker_cpus = performance.text("worker_cpus", rt.worker_cpus);
+    rt.deadline_runtime = std::chrono::microseconds(
+        performance.integer("deadline_runtime_us", static_cast<long>(rt.deadline_runtime.count()), 1, 1000000));
+    std::string scheduler = performance.text("scheduler", "fifo");
+    performance.check(RtSettings::parse_scheduler(scheduler, rt.scheduler), "scheduler",
+                      "'" + scheduler + "' is not fifo, deadline or other");
+    cpu_set_t cpus;
+    performance.check(rt.worker_cpus.empty() || parse_cpu_list(rt.worker_cpus, cpus), "worker_cpus",
+                      "'" + rt.worker_cpus + "' is not a CPU list");
+    performance.check(rt.scheduler != RtSettings::DEADLINE ||
+                      rt.deadline_runtime < std::chrono::microseconds(1000000 / config.control_frequency),
+                      "deadline_runtime_us", "must be shorter than the control period");
+
+    SectionReader telemetry(ini, "telemetry", error);
+    config.telemetry_shm = telemetry.text("shm_name", config.telemetry_shm);
+    telemetry.check(config.telemetry_shm.empty() ||
+                    (config.telemetry_shm[0] == '/' && config.telemetry_shm.find('/', 1) == std::string::npos &&
+                     config.telemetry_shm.size() > 1 && config.telemetry_shm.size() < 256),
+                    "shm_name", "'" + config.telemetry_shm + "' is not a shared memory name like /kart_telemetry");
+
+    SectionReader trace(ini, "trace", error);
+    config.trace_file = trace.text("file", config.trace_file);
+    config.trace_capacity_mb = static_cast<int>(trace.integer("capacity_mb", config.trace_capacity_mb, 1, 4096));
+
+    SectionReader remote(ini, "remote", error);
+    config.remote_unix_socket = remote.text("unix_socket", config.remote_unix_socket);
+    remote.check(config.remote_unix_socket.size() < 108, "unix_socket", "path too long");
+    config.remote_udp_address = remote.text("udp_address", config.remote_udp_address);
+    in_addr udp_address;
+    remote.check(inet_pton(AF_INET, config.remote_udp_address.c_str(), &udp_address) == 1, "udp_address",
+                 "'" + config.remote_udp_address + "' is not an IPv4 address");
+    config.remote_udp_port = static_cast<int>(remote.integer("udp_port", config.remote_udp_port, 0, 65535));
+
+    SectionReader metrics(ini, "metrics", error);
+    config.metrics_address = metrics.text("address", config.metrics_address);
+    in_addr metrics_address;
+    metrics.check(inet_pton(AF_INET, config.metrics_address.c_str(), &metrics_address) == 1, "address",
+                  "'" + config.metrics_address + "' is not an IPv4 address");
+    config.metrics_port = static_cast<int>(metrics.integer("port", config.metrics_port, 0, 65535));
+
+    SectionReader tach(ini, "tachometer", error);
+    config.tach_chip = tach.text("chip", config.tach_chip);
+    config.tach_window_ms = static_cast<int>(tach.integer("window_ms", config.tach_window_ms, 5, 1000));
+    config.closed_loop = tach.boolean("closed_loop", config.closed_loop);
+    config.speed_kp = tach.number("kp", config.speed_kp, 0.0, 100.0);
+    config.speed_ki = tach.number("ki", config.speed_ki, 0.0, 1000.0);
+    for (const MotorConfig& m : config.motors) {
+        tach.check(!config.closed_loop || m.tach_pin < 0 || m.max_rpm > 0.0, "closed_loop",
+                   "motor " + m.name + " has a tach_pin but no max_rpm");
+    }
+
+    compute_pulse_params(config);
+    return error.empty();
+}
+
+inline bool load_kart_config(const std::string& path, KartConfig& config, std::string& error) {
+    IniFile ini;
+    if (!ini.load(path)) {
+        error = "cannot read " + path;
+        return false;
+    }
+    return parse_kart_config(ini, config, error);
+}
+
+// A running controller can only switch to a snapshot that keeps everything
+// it set up at startup; returns false and the first difference otherwise
+inline bool config_reloadable(const KartConfig& running, const KartConfig& next, std::string& error) {
+    if (next.motors.size() != running.motors.size()) {
+        error = "number of motors changed (restart required)";
+        return false;
+    }
+    for (std::size_t i = 0; i < running.motors.size(); ++i) {
+        const MotorConfig& a = running.motors[i];
+        const MotorConfig& b = next.motors[i];
+        if (a.name != b.name || a.pin != b.pin || a.frequency != b.frequency || a.protocol != b.protocol) {
+            error = "name, pin, frequency or protocol of motor " + a.name + " changed (restart required)";
+            return false;
+        }
+        if (a.tach_pin != b.tach_pin || a.pulses_per_rev != b.pulses_per_rev) {
+            error = "tachometer of motor " + a.name + " changed (restart required)";
+            return false;
+        }
+    }
+    if (next.emergency_pin != running.emergency_pin || next.status_led_pin != running.status_led_pin) {
+        error = "GPIO pins changed (restart required)";
+        return false;
+    }
+    if (next.pca9685_enabled != running.pca9685_enabled || next.pca9685_bus != running.pca9685_bus ||
+        next.pca9685_address != running.pca9685_address) {
+        error = "[pca9685] changed (restart required)";
+        return false;
+    }
+    const RtSettings& a = running.rt;
+    const RtSettings& b = next.rt;
+    if (next.control_frequency != running.control_frequency || a.scheduler != b.scheduler ||
+        a.priority != b.priority || a.deadline_runtime != b.deadline_runtime || a.control_cpu != b.control_cpu ||
+        a.worker_cpus != b.worker_cpus || a.lock_memory != b.lock_memory ||
+        a.stack_prefault_bytes != b.stack_prefault_bytes || a.heap_reserve_bytes != b.heap_reserve_bytes) {
+        error = "[performance] changed (restart required)";
+        return false;
+    }
+    if (next.telemetry_shm != running.telemetry_shm) {
+        error = "[telemetry] changed (restart required)";
+        return false;
+    }
+    if (next.trace_file != running.trace_file || next.trace_capacity_mb != running.trace_capacity_mb) {
+        error = "[trace] changed (restart required)";
+        return false;
+    }
+    if (next.remote_unix_socket != running.remote_unix_socket ||
+        next.remote_udp_address != running.remote_udp_address || next.remote_udp_port != running.remote_udp_port) {
+        error = "[remote] changed (restart required)";
+        return false;
+    }
+    if (next.metrics_address != running.metrics_address || next.metrics_port != running.metrics_port) {
+        error = "[metrics] changed (restart required)";
+        return false;
+    }
+    if (next.tach_chip != running.tach_chip || next.tach_window_ms != running.tach_window_ms) {
+        error = "[tachometer] changed (restart required)";
+        return false;
+    }
+    return true;
+}
+
+class ConfigStore {
+private:
+    std::atomic<const KartConfig*> current;
+    std::atomic<std::uint64_t> epoch{0};
+    std::atomic<bool> reader_online{false};
+
+    // Writer side
+    mutable std::mutex writer_mutex;
+    std::shared_ptr<const KartConfig> owner;
+    std::vector<std::pair<std::uint64_t, std::shared_ptr<const KartConfig>>> retired;
+
+    void reclaim_locked() {
+        const std::uint64_t now = epoch.load(std::memory_order_seq_cst);
+        const bool online = reader_online.load(std::memory_order_seq_cst);
+        retired.erase(std::remove_if(retired.begin(), retired.end(),
+                                     [&](const auto& entry) { return !online || now > entry.first; }),
+                      retired.end());
+    }
+
+public:
+    explicit ConfigStore(std::shared_ptr<const KartConfig> initial)
+        : current(initial.get()), owner(std::move(initial)) {}
+
+    ConfigStore(const ConfigStore&) = delete;
+    ConfigStore& operator=(const ConfigStore&) = delete;
+
+    // Real-time reader (control loop): bracket the loop with reader_enter()/
+    // reader_exit(), call read() at the start and quiescent() at the end of
+    // every cycle. The pointer is valid until the next quiescent().
+    void reader_enter() {
+        reader_online.store(true, std::memory_order_seq_cst);
+    }
+
+    void reader_exit() {
+        reader_online.store(false, std::memory_order_seq_cst);
+    }
+
+    // seq_cst on both sides: the writer's pointer swap and epoch read must
+    // not pass the reader's epoch store and pointer load (store/load order)
+    const KartConfig* read() const {
+        return current.load(std::memory_order_seq_cst);
+    }
+
+    void quiescent() {
+        epoch.store(epoch.load(std::memory_order_relaxed) + 1, std::memory_order_seq_cst);
+    }
+
+    // Any other thread
+    std::shared_ptr<const KartConfig> snapshot() const {
+        std::lock_guard<std::mutex> lock(writer_mutex);
+        return owner;
+    }
+
+    // Swap in a new snapshot; the old one is freed once the reader moved on
+    void publish(std::shared_ptr<const KartConfig> next) {
+        std::lock_guard<std::mutex> lock(writer_mutex);
+        current.store(next.get(), std::memory_order_seq_cst);
+        retired.emplace_back(epoch.load(std::memory_order_seq_cst), std::move(owner));
+        owner = std::move(next);
+        reclaim_locked();
+    }
+
+    // Free snapshots the reader can no longer see; returns how many remain
+    std::size_t reclaim() {
+        std::lock_guard<std::mutex> lock(writer_mutex);
+        reclaim_locked();
+        return retired.size();
+    }
+};
+
+// Calls back when the config file is written or replaced (editors usually
+// write a new file and rename it, so the directory is watched)
+class ConfigWatcher {
+private:
+    std::thread thread;
+    std::atomic<bool> running{false};
+    int inotify_fd = -1;
+    std::string file_name;
+
+    void run(std::function<void()> on_change) {
+        pollfd fds{inotify_fd, POLLIN, 0};
+        while (running.load()) {
+            if (::poll(&fds, 1, 200) <= 0) {
+                continue;
+            }
+            if (read_changes()) {
+                on_change();
+            }
+        }
+    }
+
+public:
+    ~ConfigWatcher() {
+        stop();
+    }
+
+    // Watch the file without a thread: poll fd() and call read_changes()
+    // when it is readable (event loop mode)
+    bool open(const std::string& path) {
+        std::size_t slash = path.rfind('/');
+        std::string directory = slash == std::string::npos ? "." : path.substr(0, slash == 0 ? 1 : slash);
+        file_name = slash == std::string::npos ? path : path.substr(slash + 1);
+
+        inotify_fd = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (inotify_fd < 0) {
+            return false;
+        }
+        if (::inotify_add_watch(inotify_fd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+            ::close(inotify_fd);
+            inotify_fd = -1;
+            return false;
+        }
+        return true;
+    }
+
+    int fd() const {
+        return inotify_fd;
+    }
+
+    // Consume pending inotify events; true if the watched file changed
+    bool read_changes() {
+        alignas(inotify_event) char buffer[4096];
+        bool changed = false;
+        ssize_t length;
+        while ((length = ::read(inotify_fd, buffer, sizeof(buffer))) > 0) {
+            for (ssize_t offset = 0; offset < length;) {
+                const inotify_event* event = reinterpret_cast<const inotify_event*>(buffer + offset);
+                if (event->len > 0 && file_name == event->name) {
+                    changed = true;
+                }
+                offset += static_cast<ssize_t>(sizeof(inotify_event) + event->len);
+            }
+        }
+        return changed;
+    }
+
+    // Watch the file on a background thread
+    bool start(const std::string& path, std::function<void()> on_change) {
+        if (!open(path)) {
+            return false;
+        }
+        running.store(true);
+        thread = std::thread(&ConfigWatcher::run, this, std::move(on_change));
+        return true;
+    }
+
+    void stop() {
+        running.store(false);
+        if (thread.joinable()) {
+            thread.join();
+        }
+        if (inotify_fd >= 0) {
+            ::close(inotify_fd);
+            inotify_fd = -1;
+        }
+    }
+};
+
+#endif // KART_CONFIG_H
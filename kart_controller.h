@@ -0,0 +1,1593 @@
+/*
+ * ESC controller for the kart
+ * ===========================
+ *
+ * ESCController owns the control loop, the emergency stop path, the
+ * watchdog, calibration and every command interface. kart_control.cpp
+ * wraps it in the console program; the simulator (kart_sim.cpp) drives
+ * the same class against simulated hardware and a virtual clock.
+ *
+ * TEST_MODE builds use the simulated GPIO of kart_gpio_sim.h instead of
+ * wiringPi, so they build and run without a Raspberry Pi.
+ */
+
+#ifndef KART_CONTROLLER_H
+#define KART_CONTROLLER_H
+
+#include <iostream>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <cstdlib>
+#include <cerrno>
+#include <cstring>
+#include <signal.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include <cmath>
+#include <algorithm>
+#include <span>
+#include <unordered_map>
+#ifdef TEST_MODE
+#include "kart_gpio_sim.h"
+#else
+#include <wiringPi.h>
+#include <softPwm.h>
+#endif
+#include "kart_calibration.h"
+#include "kart_command.h"
+#include "kart_config.h"
+#include "kart_dshot.h"
+#include "kart_estop.h"
+#include "kart_logger.h"
+#include "kart_metrics.h"
+#include "kart_motor_state.h"
+#include "kart_pca9685.h"
+#include "kart_pwm.h"
+#include "kart_reactor.h"
+#include "kart_remote.h"
+#include "kart_tach.h"
+#include "kart_telemetry.h"
+#include "kart_timing.h"
+#include "kart_trace.h"
+
+// Defined by the program (kart_control.cpp, kart_sim.cpp)
+extern Logger g_logger;
+
+// wiringPi software PWM fallback (one thread per pin, 100 us resolution)
+class SoftPwmBackend : public PwmBackend {
+private:
+    static constexpr std::uint32_t SOFT_PWM_UNIT_NS = 100000;  // softPwm pulse unit
+    // OneShot and Multishot pulses are shorter than a few units
+    static constexpr std::uint32_t MIN_PERIOD_NS = 5000000;
+    
+public:
+    const char* name() const override {
+        return "softpwm";
+    }
+    
+    bool setup(int pin, std::uint32_t period_ns) override {
+        if (period_ns < MIN_PERIOD_NS) {
+            return false;
+        }
+        pinMode(pin, OUTPUT);
+        return softPwmCreate(pin, 0, static_cast<int>(period_ns / SOFT_PWM_UNIT_NS)) == 0;
+    }
+    
+    void write(int pin, std::uint32_t pulse_ns) override {
+        softPwmWrite(pin, static_cast<int>((pulse_ns + SOFT_PWM_UNIT_NS / 2) / SOFT_PWM_UNIT_NS));
+    }
+    
+    void release(int pin) override {
+        softPwmStop(pin);
+    }
+};
+
+// Motor handle: index into the controller's motor list, resolved once by name
+using MotorHandle = int;
+static constexpr MotorHandle INVALID_MOTOR = -1;
+
+// Target speed of one motor in a batched command
+struct MotorTarget {
+    MotorHandle motor;
+    double speed;
+};
+
+// Label of each EmergencyStop::Source, in enum order
+inline constexpr const char* ESTOP_SOURCE_LABELS[EmergencyStop::SOURCES] = {
+    "source=\"console\"", "source=\"hardware\"", "source=\"watchdog\"",
+    "source=\"command\"", "source=\"shutdown\"", "source=\"benchmark\"",
+};
+
+// High-performance ESC Controller class
+class ESCController {
+private:
+    // Current configuration snapshot (hot reloadable, see kart_config.h)
+    ConfigStore config;
+    ConfigWatcher config_watcher;
+    
+    // Fixed at startup (a reload must not change them)
+    const std::size_t motor_count;
+    const int emergency_pin;
+    const int status_led_pin;
+    
+    // Motor names by MotorHandle and the reverse table, built once so that
+    // name lookups never touch the config store (reloads keep the names)
+    const std::vector<std::string> motor_names;
+    const std::unordered_map<std::string, MotorHandle> motor_handles;
+    
+    // State variables (thread-safe)
+    std::atomic<bool> is_running{false};
+    std::atomic<bool> shutdown_requested{false};
+    
+    // Lock-free stop path; logging and LED are handled by the monitor loop
+    EmergencyStop estop;
+    static_assert(EmergencyStop::MAX_OUTPUTS >= static_cast<std::size_t>(MAX_MOTORS), "estop outputs");
+    
+    // Motor speeds indexed by MotorHandle: owned by the control thread
+    // (commands reach it through command_queue), published every cycle for
+    // other threads
+    std::vector<double> current_speeds;
+    std::vector<double> target_speeds;
+    MotorStateBoard motor_states;
+    
+    // Threading
+    std::unique_ptr<std::thread> control_thread;
+    std::unique_ptr<std::thread> monitor_thread;
+    
+    // PWM output backend (selected in initialize() unless given)
+    std::unique_ptr<PwmBackend> pwm;
+    
+    // Command rings, drained by the control loop at the start of each cycle
+    CommandQueue command_queue;
+    
+    // ESC calibration, advanced by the control loop (control thread only);
+    // calibrating_motors mirrors its active mask for other threads
+    CalibrationSequencer calibration;
+    std::atomic<std::uint32_t> calibrating_motors{0};
+    static_assert(CalibrationSequencer::MAX_MOTORS >= static_cast<std::size_t>(MAX_MOTORS), "calibration motors");
+    
+    // Event loop mode (start(&reactor)): monitor, LED and config watching
+    // run as reactor handlers instead of a thread
+    Reactor* reactor = nullptr;
+    int led_timer = -1;
+    
+    // Shared-memory telemetry, written by the control loop once per cycle
+    TelemetryWriter telemetry;
+    std::uint64_t telemetry_publishes = 0;
+    
+    // Binary trace of the control loop ([trace] in kart_config.ini), written
+    // by the control thread only
+    TraceWriter trace;
+    std::uint32_t trace_cycle = 0;
+    bool trace_stopped = false;
+    
+    // Binary datagram commands ([remote] in kart_config.ini)
+    CommandSocket remote;
+    static_assert(REMOTE_MAX_MOTORS == static_cast<std::size_t>(MAX_MOTORS), "remote motor mask");
+    
+    // Prometheus endpoint ([metrics] in kart_config.ini); labels are
+    // formatted at startup so that a scrape never allocates
+    MetricsServer metrics;
+    std::vector<std::string> metric_motor_labels;
+    
+    // Commands refused before reaching the queue
+    std::atomic<std::uint64_t> rejected_estop{0};
+    std::atomic<std::uint64_t> rejected_invalid{0};
+    std::atomic<std::uint64_t> rejected_queue_full{0};
+    
+    // Watchdog timeouts during a calibration, which stop only the motors
+    // that are not calibrating instead of tripping the emergency stop
+    std::atomic<std::uint64_t> watchdog_motor_stops{0};
+    
+    // Time per cycle to write all outputs, backend flush included (control thread)
+    LatencyHistogram pwm_write_time;
+    
+    // Tachometer edges ([tachometer] in kart_config.ini) on their own
+    // thread; the closed-loop integrators belong to the control thread
+    std::unique_ptr<Tachometer> tach;
+    std::unique_ptr<TachSource> tach_source;
+    std::vector<double> speed_integrals;
+    
+    // Monitor state (monitor thread or reactor thread)
+    int led_toggles = 0;
+    std::chrono::steady_clock::time_point next_status;
+    
+    // Timing (on clock_now())
+    std::atomic<std::chrono::steady_clock::time_point> last_heartbeat;
+    ControlClock* const clock;
+    // Start of the current cycle: the one time the control loop's
+    // decisions use, so a replay with the traced times decides the same
+    std::chrono::steady_clock::time_point cycle_now;
+    
+    // Real-time performance
+    // Period that SafetyLimits::max_acceleration_rate refers to
+    static constexpr std::chrono::microseconds ACCELERATION_REFERENCE_PERIOD{20000};
+    CycleTimer cycle_timer;
+    
+    // Monitor loop cadence
+    static constexpr std::chrono::seconds MONITOR_INTERVAL{1};
+    static constexpr std::chrono::seconds STATUS_INTERVAL{10};
+    static constexpr std::chrono::milliseconds LED_FLASH_INTERVAL{100};
+    static constexpr int LED_FLASH_TOGGLES = 20;
+    static constexpr std::chrono::milliseconds BENCH_ESTOP_SPACING{1};
+
+public:
+    // control_clock replaces CLOCK_MONOTONIC for the control loop, the
+    // watchdog and calibration (simulation); the caller keeps it alive
+    ESCController(const KartConfig& initial_config,
+                  std::unique_ptr<PwmBackend> pwm_backend = nullptr,
+                  ControlClock* control_clock = nullptr)
+        : config(std::make_shared<const KartConfig>(initial_config)),
+          motor_count(std::min(initial_config.motors.size(), static_cast<std::size_t>(MAX_MOTORS))),
+          emergency_pin(initial_config.emergency_pin), status_led_pin(initial_config.status_led_pin),
+          motor_names(names_of(initial_config, motor_count)), motor_handles(handles_of(motor_names)),
+          current_speeds(motor_count, 0.0), target_speeds(motor_count, 0.0), motor_states(motor_count),
+          pwm(std::move(pwm_backend)),
+          speed_integrals(motor_count, 0.0),
+          clock(control_clock),
+          cycle_timer(std::chrono::nanoseconds(1000000000 / std::max(initial_config.control_frequency, 1))) {
+        cycle_timer.set_clock(clock);
+        
+        if (initial_config.motors.size() > static_cast<std::size_t>(MAX_MOTORS)) {
+            g_logger.log(Logger::WARNING, LogMsg::CONTROLLER_TOO_MANY_MOTORS, MAX_MOTORS);
+        }
+        
+        last_heartbeat.store(clock_now());
+        
+        g_logger.log(Logger::INFO, LogMsg::CONTROLLER_INITIALIZED, motor_count);
+    }
+    
+    ~ESCController() {
+        stop();
+    }
+    
+    bool initialize() {
+        try {
+            // Initialize wiringPi
+            if (wiringPiSetupGpio() == -1) {
+                g_logger.log(Logger::ERROR, LogMsg::WIRINGPI_INIT_FAILED);
+                return false;
+            }
+            
+            // Setup motor pins on the PWM backend, starting at neutral
+            auto cfg = config.snapshot();
+            if (!pwm) {
+                pwm = select_pwm_backend(*cfg);
+            }
+            g_logger.log(Logger::INFO, LogMsg::PWM_BACKEND_SELECTED, pwm->name());
+            
+            for (std::size_t i = 0; i < motor_count; ++i) {
+                const MotorConfig& motor = cfg->motors[i];
+                const bool ready = is_dshot(motor.protocol) ? pwm->setup_dshot(motor.pin, motor.protocol)
+                                                            : pwm->setup(motor.pin, cfg->pulses[i].period_ns);
+                if (!ready) {
+                    g_logger.log(Logger::ERROR, LogMsg::PWM_CREATE_FAILED, motor.name);
+                    return false;
+                }
+                pwm->write(motor.pin, cfg->pulses[i].neutral_ns);
+                estop.add_output(motor.pin, cfg->pulses[i].neutral_ns);
+                g_logger.log(Logger::INFO, LogMsg::MOTOR_INITIALIZED, motor.name, motor.pin);
+            }
+            pwm->flush();
+            estop.attach(pwm.get());
+            
+            // Setup emergency stop pin
+            pinMode(emergency_pin, INPUT);
+            pullUpDnControl(emergency_pin, PUD_UP);
+            if (wiringPiISR(emergency_pin, INT_EDGE_FALLING, &emergency_interrupt) < 0) {
+                g_logger.log(Logger::ERROR, LogMsg::EMERGENCY_ISR_FAILED);
+                return false;
+            }
+            
+            // Setup status LED
+            pinMode(status_led_pin, OUTPUT);
+            digitalWrite(status_led_pin, LOW);
+            
+            g_logger.log(Logger::INFO, LogMsg::GPIO_INIT_COMPLETE);
+            return true;
+            
+        } catch (const std::exception& e) {
+            g_logger.log(Logger::ERROR, LogMsg::INIT_FAILED, e.what());
+            return false;
+        }
+    }
+    
+    // Without an event loop the monitor thread is started; with one, its
+    // work is registered on it and only the control thread runs
+    // separately. The caller runs the reactor.
+    bool start(Reactor* event_loop = nullptr) {
+        if (!initialize()) {
+            return false;
+        }
+        
+        if (event_loop && !attach_reactor(*event_loop)) {
+            g_logger.log(Logger::ERROR, LogMsg::START_FAILED, "cannot register on the event loop");
+            return false;
+        }
+        
+        try {
+            is_running.store(true);
+            estop.reset();
+            shutdown_requested.store(false);
+            
+            // Lock memory and move everything but the control loop off its CPU
+            // (the monitor thread inherits the main thread's affinity)
+            const RtSettings rt_settings = config.snapshot()->rt;
+            std::string rt_report;
+            bool rt_ok = rt_prepare_process(rt_settings, rt_report);
+            rt_ok = rt_pin_thread(pthread_self(), "main/monitor", rt_settings.worker_cpus, rt_report) && rt_ok;
+            rt_ok = rt_pin_thread(g_logger.native_handle(), "logger", rt_settings.worker_cpus, rt_report) && rt_ok;
+            g_logger.log(rt_ok ? Logger::INFO : Logger::WARNING, LogMsg::RT_PROCESS_SETUP,
+                         rt_report.empty() ? "none" : rt_report);
+            
+            start_telemetry(*config.snapshot());
+            start_trace(*config.snapshot());
+            start_remote(*config.snapshot());
+            start_metrics(*config.snapshot());
+            start_tach(*config.snapshot());
+            
+            // Start worker threads
+            control_thread = std::make_unique<std::thread>(&ESCController::control_loop, this);
+            if (!reactor) {
+                monitor_thread = std::make_unique<std::thread>(&ESCController::monitor_loop, this);
+            }
+            
+            digitalWrite(status_led_pin, HIGH);
+            
+            if (config.snapshot()->auto_calibrate) {
+                calibrate_escs();
+            }
+            
+            g_logger.log(Logger::INFO, LogMsg::SYSTEM_STARTED);
+            return true;
+            
+        } catch (const std::exception& e) {
+            g_logger.log(Logger::ERROR, LogMsg::START_FAILED, e.what());
+            return false;
+        }
+    }
+    
+    void stop() {
+        g_logger.log(Logger::INFO, LogMsg::SYSTEM_STOPPING);
+        
+        shutdown_requested.store(true);
+        is_running.store(false);
+        config_watcher.stop();
+        remote.stop();
+        metrics.stop();
+        
+        // Stop all motors immediately
+        estop.trigger(EmergencyStop::SHUTDOWN);
+        
+        // Wait for threads to finish
+        if (control_thread && control_thread->joinable()) {
+            control_thread->join();
+        }
+        if (monitor_thread && monitor_thread->joinable()) {
+            monitor_thread->join();
+        }
+        
+        if (tach) {
+            tach->stop();
+        }
+        
+        // Control loop is gone: final state for readers, then remove the segment
+        if (telemetry.is_open()) {
+            publish_telemetry();
+            telemetry.close();
+        }
+        trace.close();
+        
+        cleanup_gpio();
+        g_logger.log(Logger::INFO, LogMsg::SYSTEM_STOPPED);
+    }
+    
+    // Load, validate and swap in a new configuration snapshot. The control
+    // loop picks it up at its next cycle; on any error the running
+    // configuration stays untouched.
+    bool reload_config(const std::string& path) {
+        auto next = std::make_shared<KartConfig>();
+        std::string error;
+        if (!load_kart_config(path, *next, error) || !config_reloadable(*config.snapshot(), *next, error)) {
+            g_logger.log(Logger::WARNING, LogMsg::CONFIG_RELOAD_REJECTED, error);
+            return false;
+        }
+        g_logger.set_level(static_cast<Logger::Level>(next->log_level));
+        for (std::size_t i = 0; i < motor_count; ++i) {
+            estop.set_neutral(i, next->pulses[i].neutral_ns);
+        }
+        config.publish(std::move(next));
+        g_logger.log(Logger::INFO, LogMsg::CONFIG_RELOADED, path);
+        return true;
+    }
+    
+    // Reload automatically whenever the file is written or replaced
+    bool watch_config(const std::string& path) {
+        if (reactor) {
+            return config_watcher.open(path) &&
+                   reactor->add(config_watcher.fd(), EPOLLIN, [this, path](std::uint32_t) {
+                       if (config_watcher.read_changes()) {
+                           reload_config(path);
+                       }
+                   });
+        }
+        return config_watcher.start(path, [this, path] { reload_config(path); });
+    }
+    
+    // ESC calibration runs in the control loop: these only queue the
+    // request and return. Motors that are moving, and all motors during
+    // an emergency stop, refuse to calibrate; progress goes to the log.
+    bool calibrate_escs() {
+        return command_queue.push(Command(Command::CALIBRATE, Command::ALL_MOTORS));
+    }
+    
+    bool calibrate_esc(MotorHandle handle) {
+        if (handle < 0 || handle >= static_cast<MotorHandle>(motor_count)) {
+            g_logger.log(Logger::WARNING, LogMsg::INVALID_MOTOR_HANDLE, handle);
+            return false;
+        }
+        return command_queue.push(Command(Command::CALIBRATE, static_cast<std::uint16_t>(handle)));
+    }
+    
+    // The cancelled motors return to neutral and then follow new targets
+    bool cancel_calibration() {
+        return command_queue.push(Command(Command::CANCEL_CALIBRATION, Command::ALL_MOTORS));
+    }
+    
+    // Queue a command exactly as a trace recorded it (kart_replay): no
+    // checks here, the control loop validates as it did when recording
+    bool replay_command(const Command& cmd) {
+        return command_queue.push(cmd);
+    }
+    
+    bool calibration_active() const {
+        return calibrating_motors.load(std::memory_order_relaxed) != 0;
+    }
+    
+    bool calibrating(MotorHandle handle) const {
+        return handle >= 0 && handle < static_cast<MotorHandle>(motor_count) &&
+               ((calibrating_motors.load(std::memory_order_relaxed) >> handle) & 1u) != 0;
+    }
+    
+    // Control loop timing statistics with wake-up and execution histograms
+    std::string timing_report() const {
+        return cycle_timer.report() + estop.summary() + "\n";
+    }
+    
+    const LoopTimingStats& loop_timing() const {
+        return cycle_timer.timing();
+    }
+    
+    // Time per cycle to compute and write all motor outputs, flush included
+    const LatencyHistogram& output_timing() const {
+        return pwm_write_time;
+    }
+    
+    // Resolve a motor name to a handle once; returns INVALID_MOTOR if unknown
+    MotorHandle motor_handle(const std::string& motor_name) const {
+        const auto it = motor_handles.find(motor_name);
+        return it != motor_handles.end() ? it->second : INVALID_MOTOR;
+    }
+    
+    bool set_motor_speed(const std::string& motor_name, double speed, bool immediate = false) {
+        MotorHandle handle = motor_handle(motor_name);
+        if (handle == INVALID_MOTOR) {
+            rejected_invalid.fetch_add(1, std::memory_order_relaxed);
+            g_logger.log(Logger::WARNING, LogMsg::UNKNOWN_MOTOR, motor_name);
+            return false;
+        }
+        return set_motor_speed(handle, speed, immediate);
+    }
+    
+    bool set_motor_speed(MotorHandle handle, double speed, bool immediate = false) {
+        if (estop.active()) {
+            rejected_estop.fetch_add(1, std::memory_order_relaxed);
+            g_logger.log(Logger::WARNING, LogMsg::COMMAND_REJECTED_ESTOP);
+            return false;
+        }
+        
+        if (handle < 0 || handle >= static_cast<MotorHandle>(motor_count)) {
+            rejected_invalid.fetch_add(1, std::memory_order_relaxed);
+            g_logger.log(Logger::WARNING, LogMsg::INVALID_MOTOR_HANDLE, handle);
+            return false;
+        }
+        
+        // Queue command (picked up by the control loop at its next cycle,
+        // which clamps it to the safety limits of that cycle's config)
+        if (!command_queue.push(Command(Command::SET_SPEED, static_cast<std::uint16_t>(handle), speed, immediate))) {
+            rejected_queue_full.fetch_add(1, std::memory_order_relaxed);
+            g_logger.log(Logger::WARNING, LogMsg::COMMAND_QUEUE_FULL);
+            return false;
+        }
+        
+        // Update heartbeat
+        last_heartbeat.store(clock_now());
+        
+        return true;
+    }
+    
+    // Set several motors as one unit: the control loop applies all targets
+    // in the same cycle. One queue operation and one heartbeat per batch; an
+    // invalid handle rejects the whole batch.
+    bool apply(std::span<const MotorTarget> targets, bool immediate = false) {
+        if (estop.active()) {
+            rejected_estop.fetch_add(1, std::memory_order_relaxed);
+            g_logger.log(Logger::WARNING, LogMsg::COMMAND_REJECTED_ESTOP);
+            return false;
+        }
+        
+        if (targets.empty() || targets.size() > CommandQueue::MAX_BATCH) {
+            rejected_invalid.fetch_add(1, std::memory_order_relaxed);
+            g_logger.log(Logger::WARNING, LogMsg::INVALID_BATCH_SIZE, targets.size());
+            return false;
+        }
+        
+        Command batch[CommandQueue::MAX_BATCH];
+        for (std::size_t i = 0; i < targets.size(); ++i) {
+            const MotorHandle handle = targets[i].motor;
+            if (handle < 0 || handle >= static_cast<MotorHandle>(motor_count)) {
+                rejected_invalid.fetch_add(1, std::memory_order_relaxed);
+                g_logger.log(Logger::WARNING, LogMsg::INVALID_MOTOR_HANDLE, handle);
+                return false;
+            }
+            batch[i] = Command(Command::SET_SPEED, static_cast<std::uint16_t>(handle), targets[i].speed, immediate);
+        }
+        
+        if (!command_queue.push(std::span<const Command>(batch, targets.size()))) {
+            rejected_queue_full.fetch_add(1, std::memory_order_relaxed);
+            g_logger.log(Logger::WARNING, LogMsg::COMMAND_QUEUE_FULL);
+            return false;
+        }
+        
+        last_heartbeat.store(clock_now());
+        
+        return true;
+    }
+    
+    // One packet from the command socket: targets go through apply() as a
+    // batch, an empty mask only feeds the watchdog. Rejections while the
+    // emergency stop is active are counted by the socket, not logged, so a
+    // client streaming at a high rate cannot flood the log.
+    bool apply_remote(const RemoteCommand& cmd) {
+        if (cmd.emergency_stop()) {
+            estop.trigger(EmergencyStop::COMMAND);
+            return true;
+        }
+        if (estop.active() || (motor_count < static_cast<std::size_t>(MAX_MOTORS) && (cmd.motor_mask >> motor_count) != 0)) {
+            return false;
+        }
+        if (cmd.heartbeat()) {
+            last_heartbeat.store(clock_now());
+            return true;
+        }
+        MotorTarget targets[MAX_MOTORS];
+        std::size_t count = 0;
+        for (std::uint32_t mask = cmd.motor_mask; mask != 0; mask &= mask - 1) {
+            const int motor = __builtin_ctz(mask);
+            targets[count++] = MotorTarget{static_cast<MotorHandle>(motor), cmd.speed(motor)};
+        }
+        return apply(std::span<const MotorTarget>(targets, count), cmd.immediate());
+    }
+    
+    bool set_all_motors_speed(double speed, bool immediate = false) {
+        MotorTarget targets[MAX_MOTORS];
+        for (std::size_t i = 0; i < motor_count; ++i) {
+            targets[i] = MotorTarget{static_cast<MotorHandle>(i), speed};
+        }
+        return apply(std::span<const MotorTarget>(targets, motor_count), immediate);
+    }
+    
+    // Neutral on all outputs before returning; the control loop zeroes the
+    // speeds at its next cycle, the monitor loop logs and flashes the LED
+    void emergency_stop_all() {
+        estop.trigger(EmergencyStop::CONSOLE);
+    }
+    
+    bool reset_emergency_stop() {
+        if (digitalRead(emergency_pin) == LOW) {
+            g_logger.log(Logger::WARNING, LogMsg::ESTOP_RESET_BLOCKED);
+            return false;
+        }
+        
+        estop.reset();
+        last_heartbeat.store(clock_now());
+        digitalWrite(status_led_pin, HIGH);
+        
+        g_logger.log(Logger::INFO, LogMsg::ESTOP_RESET);
+        return true;
+    }
+    
+    // Speed the control loop last wrote for a motor (0 for unknown handles)
+    double current_speed(MotorHandle handle) const {
+        return motor_speeds(handle).current;
+    }
+    
+    // Measured speed of a motor with a tachometer (0 without one or before start())
+    double current_rpm(MotorHandle handle) const {
+        if (!tach || handle < 0 || handle >= static_cast<MotorHandle>(motor_count)) {
+            return 0.0;
+        }
+        return tach->rpm(static_cast<std::size_t>(handle));
+    }
+    
+    // Edges from this source instead of the configured GPIO lines; call
+    // before start() (tests, benches)
+    void set_tach_source(std::unique_ptr<TachSource> source) {
+        tach_source = std::move(source);
+    }
+    
+    // Current and target speed of one motor from the same cycle
+    MotorSpeeds motor_speeds(MotorHandle handle) const {
+        if (handle < 0 || handle >= static_cast<MotorHandle>(motor_count)) {
+            return MotorSpeeds{};
+        }
+        return motor_states.read(static_cast<std::size_t>(handle));
+    }
+    
+    bool emergency_stop_active() const {
+        return estop.active();
+    }
+    
+    bool running() const {
+        return is_running.load();
+    }
+    
+    std::string get_status() const {
+        const std::uint32_t calibrating = calibrating_motors.load(std::memory_order_relaxed);
+        std::string status = "Motors: ";
+        for (std::size_t i = 0; i < motor_count; ++i) {
+            const MotorSpeeds speeds = motor_states.read(i);
+            status += motor_names[i] + "(current:" + std::to_string(speeds.current) +
+                     " target:" + std::to_string(speeds.target) +
+                     (tach && tach->has_sensor(i) ? " rpm:" + std::to_string(tach->rpm(i)) : "") +
+                     ((calibrating >> i) & 1u ? " calibrating" : "") + ") ";
+        }
+        
+        status += "Running:" + std::to_string(is_running.load()) +
+                 " Emergency:" + std::to_string(estop.active());
+        
+        CommandQueue::Stats queue_stats = command_queue.stats();
+        status += " Commands(pushed:" + std::to_string(queue_stats.pushed) +
+                 " coalesced:" + std::to_string(queue_stats.coalesced) +
+                 " dropped:" + std::to_string(queue_stats.dropped) +
+                 " consumed:" + std::to_string(queue_stats.consumed) +
+                 " max_depth:" + std::to_string(queue_stats.max_depth) +
+                 " batches:" + std::to_string(queue_stats.batches) +
+                 " producers:" + std::to_string(queue_stats.producers) + ")";
+        
+        CommandSocket::Stats remote_stats = remote.stats();
+        status += " Remote(received:" + std::to_string(remote_stats.received) +
+                 " accepted:" + std::to_string(remote_stats.accepted) +
+                 " malformed:" + std::to_string(remote_stats.malformed) +
+                 " stale:" + std::to_string(remote_stats.stale) +
+                 " rejected:" + std::to_string(remote_stats.rejected) + ")";
+        
+        status += " " + cycle_timer.summary();
+        status += " " + estop.summary();
+        if (tach) {
+            status += " " + tach->summary();
+        }
+        if (pwm) {
+            const std::string bus = pwm->summary();
+            if (!bus.empty()) {
+                status += " " + bus;
+            }
+        }
+        
+        return status;
+    }
+    
+    // Prometheus text exposition of the controller (GET /metrics). Loads
+    // atomics and seqlock slots only: never blocks or allocates.
+    void render_metrics(MetricsWriter& out) const {
+        out.family("kart_running", "gauge", "Control loop running");
+        out.sample("kart_running", "", std::uint64_t{is_running.load() ? 1u : 0u});
+        
+        const CommandQueue::Stats queue_stats = command_queue.stats();
+        out.family("kart_commands_queued_total", "counter", "Commands that went through a command ring");
+        out.sample("kart_commands_queued_total", "", queue_stats.pushed);
+        out.family("kart_commands_coalesced_total", "counter", "Commands merged into a full ring's overflow slot");
+        out.sample("kart_commands_coalesced_total", "", queue_stats.coalesced);
+        out.family("kart_commands_applied_total", "counter", "Commands handed to the control loop");
+        out.sample("kart_commands_applied_total", "", queue_stats.consumed);
+        out.family("kart_commands_rejected_total", "counter", "Commands refused before reaching the queue");
+        out.sample("kart_commands_rejected_total", "reason=\"emergency_stop\"",
+                   rejected_estop.load(std::memory_order_relaxed));
+        out.sample("kart_commands_rejected_total", "reason=\"invalid_motor\"",
+                   rejected_invalid.load(std::memory_order_relaxed));
+        out.sample("kart_commands_rejected_total", "reason=\"queue_full\"",
+                   rejected_queue_full.load(std::memory_order_relaxed));
+        out.family("kart_command_queue_max_depth", "gauge", "Highest ring occupancy seen by the control loop");
+        out.sample("kart_command_queue_max_depth", "", queue_stats.max_depth);
+        
+        const CommandSocket::Stats remote_stats = remote.stats();
+        out.family("kart_remote_packets_total", "counter", "Remote command datagrams by outcome");
+        out.sample("kart_remote_packets_total", "result=\"accepted\"", remote_stats.accepted);
+        out.sample("kart_remote_packets_total", "result=\"malformed\"", remote_stats.malformed);
+        out.sample("kart_remote_packets_total", "result=\"stale\"", remote_stats.stale);
+        out.sample("kart_remote_packets_total", "result=\"rejected\"", remote_stats.rejected);
+        
+        const LoopTimingStats& timing = cycle_timer.timing();
+        out.family("kart_control_cycles_total", "counter", "Control loop cycles");
+        out.sample("kart_control_cycles_total", "", timing.cycles.load(std::memory_order_relaxed));
+        out.family("kart_control_overruns_total", "counter", "Cycles that ended after the next deadline");
+        out.sample("kart_control_overruns_total", "", timing.overruns.load(std::memory_order_relaxed));
+        out.family("kart_control_missed_cycles_total", "counter", "Deadlines skipped after overruns");
+        out.sample("kart_control_missed_cycles_total", "", timing.missed.load(std::memory_order_relaxed));
+        out.family("kart_control_late_cycles_total", "counter", "Cycles that woke up late");
+        out.sample("kart_control_late_cycles_total", "", timing.late.load(std::memory_order_relaxed));
+        out.family("kart_control_wakeup_latency_seconds", "histogram", "Wake-up delay after the cycle deadline");
+        out.histogram("kart_control_wakeup_latency_seconds", "", timing.wakeup.snapshot());
+        out.family("kart_control_execution_seconds", "histogram", "Control cycle execution time");
+        out.histogram("kart_control_execution_seconds", "", timing.execution.snapshot());
+        out.family("kart_pwm_write_seconds", "histogram",
+                   "Time per cycle to compute and write all outputs, backend flush included");
+        out.histogram("kart_pwm_write_seconds", "", pwm_write_time.snapshot());
+        
+        out.family("kart_watchdog_trips_total", "counter", "Emergency stops by the command watchdog");
+        out.sample("kart_watchdog_trips_total", "", estop.triggers(EmergencyStop::WATCHDOG));
+        out.family("kart_watchdog_motor_stops_total", "counter",
+                   "Watchdog timeouts during a calibration that stopped the other motors");
+        out.sample("kart_watchdog_motor_stops_total", "", watchdog_motor_stops.load(std::memory_order_relaxed));
+        out.family("kart_emergency_stop_active", "gauge", "Emergency stop engaged");
+        out.sample("kart_emergency_stop_active", "", std::uint64_t{estop.active() ? 1u : 0u});
+        out.family("kart_emergency_stops_total", "counter", "Emergency stop triggers by source");
+        for (std::size_t source = 0; source < EmergencyStop::SOURCES; ++source) {
+            out.sample("kart_emergency_stops_total", ESTOP_SOURCE_LABELS[source],
+                       estop.triggers(static_cast<EmergencyStop::Source>(source)));
+        }
+        out.family("kart_emergency_stop_latency_seconds", "histogram", "Emergency stop trigger to neutral outputs");
+        out.histogram("kart_emergency_stop_latency_seconds", "", estop.latency().snapshot());
+        
+        // Labels exist once start() ran
+        const std::size_t labelled = std::min(metric_motor_labels.size(), motor_count);
+        MotorSpeeds speeds[MAX_MOTORS];
+        for (std::size_t i = 0; i < labelled; ++i) {
+            speeds[i] = motor_states.read(i);
+        }
+        out.family("kart_motor_target_speed_percent", "gauge", "Target speed after clamping to the safety limits");
+        for (std::size_t i = 0; i < labelled; ++i) {
+            out.sample("kart_motor_target_speed_percent", metric_motor_labels[i], speeds[i].target);
+        }
+        out.family("kart_motor_current_speed_percent", "gauge", "Speed the control loop last wrote");
+        for (std::size_t i = 0; i < labelled; ++i) {
+            out.sample("kart_motor_current_speed_percent", metric_motor_labels[i], speeds[i].current);
+        }
+        out.family("kart_motor_speed_error_percent", "gauge", "Target minus current speed (acceleration limit lag)");
+        for (std::size_t i = 0; i < labelled; ++i) {
+            out.sample("kart_motor_speed_error_percent", metric_motor_labels[i], speeds[i].target - speeds[i].current);
+        }
+        if (tach) {
+            out.family("kart_motor_rpm", "gauge", "Measured speed from the tachometer edges");
+            for (std::size_t i = 0; i < labelled; ++i) {
+                if (tach->has_sensor(i)) {
+                    out.sample("kart_motor_rpm", metric_motor_labels[i], tach->rpm(i));
+                }
+            }
+            const Tachometer::Stats tach_stats = tach->stats();
+            out.family("kart_tach_edges_total", "counter", "Tachometer edges read");
+            out.sample("kart_tach_edges_total", "", tach_stats.edges);
+            out.family("kart_tach_batches_total", "counter", "Wake-ups of the tachometer thread with edges");
+            out.sample("kart_tach_batches_total", "", tach_stats.batches);
+        }
+    }
+    
+    // --bench-estop: run the stop path `samples` times and print the
+    // trigger-to-neutral latency distribution. "direct" calls it on this
+    // thread; "interrupt" first wakes a waiting thread through an eventfd,
+    // like the wiringPi interrupt thread that polls the GPIO value file.
+    bool benchmark_emergency_stop(int samples) {
+        if (!initialize()) {
+            return false;
+        }
+        
+        auto cfg = config.snapshot();
+        std::string rt_report;
+        rt_prepare_process(cfg->rt, rt_report);
+        std::cout << "Emergency stop benchmark: " << samples << " samples, " << motor_count
+                  << " outputs, " << pwm->name() << " backend" << std::endl;
+        std::cout << "Real-time setup: " << (rt_report.empty() ? "none" : rt_report) << std::endl;
+        
+        std::vector<std::uint64_t> direct(samples);
+        for (int i = 0; i < samples; ++i) {
+            std::this_thread::sleep_for(BENCH_ESTOP_SPACING);
+            direct[i] = estop.trigger(EmergencyStop::BENCHMARK);
+            estop.reset();
+        }
+        print_latency("direct", direct);
+        
+        int event_fd = eventfd(0, EFD_CLOEXEC);
+        if (event_fd < 0) {
+            std::cout << "eventfd failed: " << std::strerror(errno) << std::endl;
+            return false;
+        }
+        std::vector<std::uint64_t> interrupt(samples);
+        std::atomic<std::int64_t> trigger_ns{0};
+        std::atomic<int> completed{0};
+        std::thread isr([&] {
+            // wiringPi runs its interrupt threads at real-time priority too
+            sched_param param{};
+            param.sched_priority = cfg->rt.priority;
+            pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+            for (int i = 0; i < samples; ++i) {
+                pollfd pfd{event_fd, POLLIN, 0};
+                std::uint64_t value;
+                if (poll(&pfd, 1, -1) < 0 || read(event_fd, &value, sizeof(value)) != sizeof(value)) {
+                    --i;
+                    continue;
+                }
+                interrupt[i] = estop.trigger(EmergencyStop::BENCHMARK, trigger_ns.load(std::memory_order_acquire));
+                completed.store(i + 1, std::memory_order_release);
+            }
+        });
+        for (int i = 0; i < samples; ++i) {
+            std::this_thread::sleep_for(BENCH_ESTOP_SPACING);
+            const std::uint64_t one = 1;
+            trigger_ns.store(EmergencyStop::now_ns(), std::memory_order_release);
+            if (write(event_fd, &one, sizeof(one)) != sizeof(one)) {
+                break;
+            }
+            while (completed.load(std::memory_order_acquire) <= i) {
+                std::this_thread::yield();
+            }
+            estop.reset();
+        }
+        isr.join();
+        close(event_fd);
+        print_latency("interrupt", interrupt);
+        
+        cleanup_gpio();
+        return true;
+    }
+
+private:
+    static std::vector<std::string> names_of(const KartConfig& cfg, std::size_t count) {
+        std::vector<std::string> names;
+        for (std::size_t i = 0; i < count; ++i) {
+            names.push_back(cfg.motors[i].name);
+        }
+        return names;
+    }
+    
+    // With duplicate names the first motor wins, as the linear search did
+    static std::unordered_map<std::string, MotorHandle> handles_of(const std::vector<std::string>& names) {
+        std::unordered_map<std::string, MotorHandle> handles;
+        for (std::size_t i = 0; i < names.size(); ++i) {
+            handles.emplace(names[i], static_cast<MotorHandle>(i));
+        }
+        return handles;
+    }
+    
+    void control_loop() {
+        g_logger.log(Logger::INFO, LogMsg::CONTROL_LOOP_STARTED);
+        
+        config.reader_enter();
+        
+        // Scheduling, affinity and stack prefault of this thread
+        std::string rt_report;
+        bool rt_ok = rt_prepare_control_thread(config.read()->rt, cycle_timer.period(), rt_report);
+        g_logger.log(rt_ok ? Logger::INFO : Logger::WARNING, LogMsg::RT_CONTROL_THREAD_SETUP, rt_report);
+        g_logger.log(Logger::INFO, LogMsg::CONTROL_LOOP_FREQUENCY, 1e9 / cycle_timer.period().count());
+        
+        cycle_timer.start();
+        
+        while (is_running.load() && !shutdown_requested.load()) {
+            // One config snapshot per cycle, valid until quiescent()
+            const KartConfig& cfg = *config.read();
+            
+            cycle_now = clock_now();
+            trace_record(TraceRecord::CYCLE);
+            
+            try {
+                // Apply commands queued since the last cycle
+                command_queue.drain([this, &cfg](const Command& cmd) {
+                    trace_command(cmd);
+                    process_command(cfg, cmd);
+                });
+                
+                // Update motor speeds with acceleration limiting
+                update_motor_speeds(cfg);
+                
+                // Check watchdog
+                check_watchdog(cfg);
+                
+                publish_telemetry();
+                
+            } catch (const std::exception& e) {
+                g_logger.log(Logger::ERROR, LogMsg::CONTROL_LOOP_ERROR, e.what());
+            }
+            
+            config.quiescent();
+            
+            // Sleep until the next absolute deadline (no drift, overruns counted)
+            cycle_timer.wait();
+            ++trace_cycle;
+        }
+        
+        config.reader_exit();
+        
+        g_logger.log(Logger::INFO, LogMsg::CONTROL_LOOP_STOPPED);
+    }
+    
+    void monitor_loop() {
+        g_logger.log(Logger::INFO, LogMsg::MONITOR_LOOP_STARTED);
+        
+        next_status = std::chrono::steady_clock::now() + STATUS_INTERVAL;
+        
+        while (is_running.load() && !shutdown_requested.load()) {
+            try {
+                // Wakes up right away on an emergency stop, every 100 ms while the LED flashes
+                estop.wait_event(led_toggles > 0 ? LED_FLASH_INTERVAL : MONITOR_INTERVAL);
+                
+                handle_estop_event();
+                step_led_flash();
+                monitor_tick();
+                
+            } catch (const std::exception& e) {
+                g_logger.log(Logger::ERROR, LogMsg::MONITOR_LOOP_ERROR, e.what());
+            }
+        }
+        
+        g_logger.log(Logger::INFO, LogMsg::MONITOR_LOOP_STOPPED);
+    }
+    
+    void start_trace(const KartConfig& cfg) {
+        if (cfg.trace_file.empty()) {
+            return;
+        }
+        const std::uint64_t capacity = static_cast<std::uint64_t>(cfg.trace_capacity_mb) * 1024 * 1024 /
+            sizeof(TraceRecord);
+        if (trace.create(cfg.trace_file, capacity, static_cast<std::uint32_t>(cfg.control_frequency),
+                         static_cast<std::uint32_t>(motor_count), clock_now().time_since_epoch().count())) {
+            g_logger.log(Logger::INFO, LogMsg::TRACE_STARTED, cfg.trace_file, cfg.trace_capacity_mb);
+        } else {
+            g_logger.log(Logger::WARNING, LogMsg::TRACE_FAILED, cfg.trace_file);
+        }
+    }
+    
+    void trace_record(TraceRecord::Type type, std::uint8_t code = 0, std::size_t motor = 0, double speed = 0.0,
+                      std::uint32_t pulse = 0) {
+        trace.append(TraceRecord{cycle_now.time_since_epoch().count(), trace_cycle, type, code,
+                                 static_cast<std::uint16_t>(motor), speed, pulse, 0});
+    }
+    
+    void trace_command(const Command& cmd) {
+        trace.append(TraceRecord{cmd.timestamp_ns, trace_cycle, TraceRecord::COMMAND,
+                                 cmd.type, cmd.motor, cmd.speed, 0, cmd.immediate ? TraceRecord::IMMEDIATE : 0u});
+    }
+    
+    void start_telemetry(const KartConfig& cfg) {
+        if (cfg.telemetry_shm.empty()) {
+            return;
+        }
+        TelemetryHeader header{};
+        header.motor_count = static_cast<std::uint32_t>(std::min(motor_count, TELEMETRY_MAX_MOTORS));
+        header.control_frequency = static_cast<std::uint32_t>(cfg.control_frequency);
+        for (std::size_t i = 0; i < header.motor_count; ++i) {
+            header.motor_pins[i] = cfg.motors[i].pin;
+            std::strncpy(header.motor_names[i], cfg.motors[i].name.c_str(), TELEMETRY_NAME_BYTES - 1);
+        }
+        if (telemetry.create(cfg.telemetry_shm, header)) {
+            g_logger.log(Logger::INFO, LogMsg::TELEMETRY_STARTED, cfg.telemetry_shm);
+        } else {
+            g_logger.log(Logger::WARNING, LogMsg::TELEMETRY_FAILED, cfg.telemetry_shm);
+        }
+    }
+    
+    // Open the configured command sockets and receive on the event loop or
+    // on the socket's own thread
+    void start_remote(const KartConfig& cfg) {
+        std::string endpoints;
+        bool ok = true;
+        if (!cfg.remote_unix_socket.empty()) {
+            ok = remote.open_unix(cfg.remote_unix_socket);
+            endpoints = cfg.remote_unix_socket;
+        }
+        if (ok && cfg.remote_udp_port != 0) {
+            ok = remote.open_udp(cfg.remote_udp_address, cfg.remote_udp_port);
+            endpoints += (endpoints.empty() ? "udp " : ", udp ") + cfg.remote_udp_address + ":" +
+                         std::to_string(cfg.remote_udp_port);
+        }
+        if (endpoints.empty()) {
+            return;
+        }
+        
+        CommandSocket::Handler handler = [this](const RemoteCommand& cmd) { return apply_remote(cmd); };
+        if (ok && reactor) {
+            for (int fd : {remote.unix_fd(), remote.udp_fd()}) {
+                if (fd >= 0) {
+                    ok = ok && reactor->add(fd, EPOLLIN, [this, fd, handler](std::uint32_t) {
+                        remote.receive(fd, handler);
+                    });
+                }
+            }
+        } else if (ok) {
+            ok = remote.start(handler);
+        }
+        
+        if (ok) {
+            g_logger.log(Logger::INFO, LogMsg::REMOTE_LISTENING, endpoints);
+        } else {
+            if (reactor) {
+                reactor->remove(remote.unix_fd());
+                reactor->remove(remote.udp_fd());
+            }
+            remote.stop();
+            g_logger.log(Logger::WARNING, LogMsg::REMOTE_FAILED, endpoints);
+        }
+    }
+    
+    // Scrapes get a thread of their own: a slow client must not hold up the
+    // remote commands on the event loop
+    void start_metrics(const KartConfig& cfg) {
+        metric_motor_labels.clear();
+        for (std::size_t i = 0; i < motor_count; ++i) {
+            metric_motor_labels.push_back(metrics_label("motor", cfg.motors[i].name));
+        }
+        if (cfg.metrics_port == 0) {
+            return;
+        }
+        
+        const std::string endpoint = cfg.metrics_address + ":" + std::to_string(cfg.metrics_port);
+        if (metrics.open(cfg.metrics_address, cfg.metrics_port) &&
+            metrics.start([this](MetricsWriter& out) { render_metrics(out); })) {
+            g_logger.log(Logger::INFO, LogMsg::METRICS_LISTENING, endpoint);
+        } else {
+            metrics.stop();
+            g_logger.log(Logger::WARNING, LogMsg::METRICS_FAILED, endpoint);
+        }
+    }
+    
+    // Motors with a tach_pin get a window each; without libgpiod only an
+    // injected source can feed them
+    void start_tach(const KartConfig& cfg) {
+        std::vector<double> pulses(motor_count, 0.0);
+        std::vector<int> lines(motor_count, -1);
+        bool any = false;
+        for (std::size_t i = 0; i < motor_count; ++i) {
+            if (cfg.motors[i].tach_pin >= 0) {
+                pulses[i] = cfg.motors[i].pulses_per_rev;
+                lines[i] = cfg.motors[i].tach_pin;
+                any = true;
+            }
+        }
+        if (!any) {
+            return;
+        }
+        
+        std::unique_ptr<TachSource> source = std::move(tach_source);
+        std::string name = source ? source->name() : cfg.tach_chip;
+#ifdef KART_HAVE_GPIOD
+        if (!source) {
+            auto lines_source = std::make_unique<GpiodTachSource>(cfg.tach_chip, lines);
+            if (lines_source->ok()) {
+                source = std::move(lines_source);
+            }
+        }
+#else
+        if (!source) {
+            g_logger.log(Logger::WARNING, LogMsg::TACH_UNAVAILABLE);
+            return;
+        }
+#endif
+        if (!source) {
+            g_logger.log(Logger::WARNING, LogMsg::TACH_FAILED, name);
+            return;
+        }
+        tach = std::make_unique<Tachometer>(pulses, std::chrono::milliseconds(cfg.tach_window_ms));
+        if (!tach->start(std::move(source))) {
+            tach.reset();
+            g_logger.log(Logger::WARNING, LogMsg::TACH_FAILED, name);
+            return;
+        }
+        std::string report;
+        rt_pin_thread(tach->native_handle(), "tachometer", cfg.rt.worker_cpus, report);
+        g_logger.log(Logger::INFO, LogMsg::TACH_STARTED, name, std::count_if(pulses.begin(), pulses.end(),
+                                                                             [](double p) { return p > 0.0; }));
+    }
+    
+    // PI correction of the ramped speed towards speed / 100 * max_rpm.
+    // The measurement has no sign: the correction works on the magnitude
+    // and the output stays on the commanded side (0 to max_speed), so an
+    // overspeeding motor is let go, never reversed. The integral alone
+    // never reaches past those bounds (anti-windup). Stopped motors and
+    // zero speeds reset the integrator.
+    double closed_loop_speed(const KartConfig& cfg, std::size_t motor, double speed, double dt) {
+        const MotorConfig& m = cfg.motors[motor];
+        if (!cfg.closed_loop || !tach || !tach->has_sensor(motor) || m.max_rpm <= 0.0 || speed == 0.0) {
+            speed_integrals[motor] = 0.0;
+            return speed;
+        }
+        const double max_speed = cfg.safety_limits.max_speed;
+        const double magnitude = std::min(std::abs(speed), max_speed);
+        const double error = magnitude - tach->rpm(motor) / m.max_rpm * 100.0;
+        double& integral = speed_integrals[motor];
+        integral = std::clamp(integral + cfg.speed_ki * error * dt, -magnitude, max_speed - magnitude);
+        const double output = std::clamp(magnitude + cfg.speed_kp * error + integral, 0.0, max_speed);
+        return speed > 0.0 ? output : -output;
+    }
+    
+    // Control thread only (or after it stopped): it owns the speeds
+    void publish_telemetry() {
+        if (!telemetry.is_open()) {
+            return;
+        }
+        TelemetryData data{};
+        timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        data.timestamp_ns = static_cast<std::uint64_t>(now.tv_sec) * 1000000000u + static_cast<std::uint64_t>(now.tv_nsec);
+        data.publishes = ++telemetry_publishes;
+        data.running = is_running.load() ? 1 : 0;
+        data.emergency_stop = estop.active() ? 1 : 0;
+        
+        const LoopTimingStats& timing = cycle_timer.timing();
+        data.cycles = timing.cycles.load(std::memory_order_relaxed);
+        data.overruns = timing.overruns.load(std::memory_order_relaxed);
+        data.missed = timing.missed.load(std::memory_order_relaxed);
+        data.late = timing.late.load(std::memory_order_relaxed);
+        LatencyHistogram::Snapshot wakeup = timing.wakeup.snapshot();
+        LatencyHistogram::Snapshot execution = timing.execution.snapshot();
+        LatencyHistogram::Snapshot estop_latency = estop.latency().snapshot();
+        data.wakeup_p99_ns = wakeup.percentile_ns(99.0);
+        data.wakeup_max_ns = wakeup.max_ns;
+        data.execution_p99_ns = execution.percentile_ns(99.0);
+        data.execution_max_ns = execution.max_ns;
+        data.estop_count = estop_latency.count;
+        data.estop_latency_max_ns = estop_latency.max_ns;
+        
+        // The published state, as status and metrics report it: current is
+        // the speed written to the ESC (closed-loop correction included)
+        for (std::size_t i = 0; i < motor_count && i < TELEMETRY_MAX_MOTORS; ++i) {
+            const MotorSpeeds speeds = motor_states.read(i);
+            data.current_speed[i] = speeds.current;
+            data.target_speed[i] = speeds.target;
+        }
+        telemetry.publish(data);
+    }
+    
+    // Deferred half of the emergency stop path: log it, start flashing
+    bool handle_estop_event() {
+        EmergencyStop::Event event;
+        if (!estop.take_event(event)) {
+            return false;
+        }
+        log_emergency_stop(event);
+        led_toggles = LED_FLASH_TOGGLES;
+        return true;
+    }
+    
+    // One LED toggle; false once flashing is over
+    bool step_led_flash() {
+        if (led_toggles == 0) {
+            return false;
+        }
+        --led_toggles;
+        if (!estop.active()) {
+            led_toggles = 0;   // reset_emergency_stop() turned the LED on
+            return false;
+        }
+        digitalWrite(status_led_pin, led_toggles % 2 ? HIGH : LOW);
+        return led_toggles > 0;
+    }
+    
+    void monitor_tick() {
+        // Free config snapshots the control loop no longer uses
+        config.reclaim();
+        
+        // Log status periodically
+        auto now = std::chrono::steady_clock::now();
+        if (now >= next_status) {
+            g_logger.log(Logger::INFO, LogMsg::STATUS, get_status());
+            next_status = now + STATUS_INTERVAL;
+        }
+    }
+    
+    // Event loop mode: everything the monitor thread does, as handlers.
+    // Nothing wakes up while the kart idles except the status timer.
+    bool attach_reactor(Reactor& event_loop) {
+        reactor = &event_loop;
+        next_status = std::chrono::steady_clock::now();
+        
+        bool ok = reactor->add(estop.wakeup_fd(), EPOLLIN, [this](std::uint32_t) {
+            if (handle_estop_event()) {
+                step_led_flash();
+                reactor->set_timer(led_timer, LED_FLASH_INTERVAL);
+            }
+        });
+        led_timer = reactor->add_timer(std::chrono::nanoseconds::zero(), [this] {
+            if (!step_led_flash()) {
+                reactor->set_timer(led_timer, std::chrono::nanoseconds::zero());
+            }
+        });
+        ok = ok && led_timer >= 0;
+        ok = ok && reactor->add_timer(STATUS_INTERVAL, [this] { monitor_tick(); }) >= 0;
+        return ok;
+    }
+    
+    void process_command(const KartConfig& cfg, const Command& cmd) {
+        switch (cmd.type) {
+            case Command::SET_SPEED: {
+                if (cmd.motor >= motor_count) {
+                    break;
+                }
+                
+                // Clamp speed to safety limits
+                const double max_speed = cfg.safety_limits.max_speed;
+                const double speed = std::clamp(cmd.speed, -max_speed, max_speed);
+                
+                if (cmd.immediate) {
+                    current_speeds[cmd.motor] = speed;
+                }
+                target_speeds[cmd.motor] = speed;
+                break;
+            }
+            case Command::EMERGENCY_STOP:
+                estop.trigger(EmergencyStop::COMMAND);
+                break;
+            case Command::CALIBRATE:
+            case Command::CANCEL_CALIBRATION: {
+                const bool all = cmd.motor == Command::ALL_MOTORS;
+                for (std::size_t i = 0; i < motor_count; ++i) {
+                    if (!all && i != cmd.motor) {
+                        continue;
+                    }
+                    if (cmd.type == Command::CALIBRATE) {
+                        start_calibration(cfg, i);
+                    } else {
+                        calibration.cancel(i, [this, &cfg](std::size_t motor, CalibrationSequencer::Transition t) {
+                            log_calibration(cfg, motor, t);
+                        });
+                    }
+                }
+                calibrating_motors.store(calibration.active_mask(), std::memory_order_relaxed);
+                break;
+            }
+            case Command::SHUTDOWN:
+                shutdown_requested.store(true);
+                break;
+        }
+    }
+    
+    // Interlocks: never while an emergency stop is active or the motor is
+    // still moving (the first calibration pulse is full throttle)
+    void start_calibration(const KartConfig& cfg, std::size_t motor) {
+        if (calibration.calibrating(motor)) {
+            return;
+        }
+        if (estop.active() || current_speeds[motor] != 0.0) {
+            g_logger.log(Logger::WARNING, LogMsg::CALIBRATION_REJECTED, cfg.motors[motor].name);
+            return;
+        }
+        // DShot throttle is digital: the full-throttle pulse would spin the motor
+        if (is_dshot(cfg.motors[motor].protocol)) {
+            g_logger.log(Logger::WARNING, LogMsg::CALIBRATION_NOT_APPLICABLE, cfg.motors[motor].name);
+            return;
+        }
+        const std::chrono::seconds step_time(cfg.calibration_time);
+        calibration.start(motor, cycle_now, step_time);
+        g_logger.log(Logger::INFO, LogMsg::CALIBRATION_MOTOR_MAX, cfg.motors[motor].name, step_time.count());
+    }
+    
+    void log_calibration(const KartConfig& cfg, std::size_t motor, CalibrationSequencer::Transition transition) {
+        const std::string& name = cfg.motors[motor].name;
+        switch (transition) {
+            case CalibrationSequencer::MIN_PULSE_STARTED:
+                g_logger.log(Logger::INFO, LogMsg::CALIBRATION_MOTOR_MIN, name, cfg.calibration_time);
+                break;
+            case CalibrationSequencer::COMPLETED:
+                g_logger.log(Logger::INFO, LogMsg::CALIBRATION_MOTOR_COMPLETE, name);
+                break;
+            case CalibrationSequencer::CANCELLED:
+                g_logger.log(Logger::INFO, LogMsg::CALIBRATION_MOTOR_CANCELLED, name);
+                break;
+            case CalibrationSequencer::ABORTED:
+                g_logger.log(Logger::WARNING, LogMsg::CALIBRATION_MOTOR_ABORTED, name);
+                break;
+        }
+    }
+    
+    void update_motor_speeds(const KartConfig& cfg) {
+        const bool stopped = estop.active();
+        if (stopped != trace_stopped) {
+            trace_stopped = stopped;
+            trace_record(stopped ? TraceRecord::ESTOP : TraceRecord::ESTOP_RESET, estop.source());
+        }
+        if (calibration.active()) {
+            auto log = [this, &cfg](std::size_t motor, CalibrationSequencer::Transition t) {
+                log_calibration(cfg, motor, t);
+            };
+            if (stopped) {
+                calibration.abort_all(log);
+            } else {
+                calibration.advance(cycle_now, std::chrono::seconds(cfg.calibration_time), log);
+            }
+            calibrating_motors.store(calibration.active_mask(), std::memory_order_relaxed);
+        }
+        const SafetyLimits& limits = cfg.safety_limits;
+        // Same ramp time at every control frequency
+        const double max_change = limits.max_acceleration_rate * 100.0 *
+            std::chrono::duration<double>(cycle_timer.period()) / ACCELERATION_REFERENCE_PERIOD;
+        const std::int64_t write_start = EmergencyStop::now_ns();
+        const double dt = std::chrono::duration<double>(cycle_timer.period()).count();
+        
+        for (std::size_t i = 0; i < motor_count; ++i) {
+            if (calibration.calibrating(i)) {
+                // Calibration pulse instead of the target; the motor starts
+                // from neutral once calibration ends
+                current_speeds[i] = 0.0;
+                target_speeds[i] = 0.0;
+                const std::uint32_t pulse = pulse_ns(cfg.pulses[i], calibration.override_speed(i));
+                write_pulse(cfg, i, pulse);
+                trace_record(TraceRecord::MOTOR, 0, i, 0.0, pulse);
+                motor_states.publish(i, 0.0, 0.0);
+                speed_integrals[i] = 0.0;
+                continue;
+            }
+            
+            double current = current_speeds[i];
+            // A reloaded max_speed also limits targets set before the reload
+            double target = std::clamp(target_speeds[i], -limits.max_speed, limits.max_speed);
+            
+            if (stopped) {
+                // The stop path already wrote neutral: no ramp down
+                current = 0.0;
+                target = 0.0;
+            }
+            target_speeds[i] = target;
+            
+            // Apply acceleration limiting
+            double diff = target - current;
+            
+            double new_speed;
+            if (std::abs(diff) > max_change) {
+                new_speed = current + (diff > 0 ? max_change : -max_change);
+            } else {
+                new_speed = target;
+            }
+            
+            // The ramp continues from the commanded speed; the output may
+            // differ from it by the closed-loop correction
+            const double output = closed_loop_speed(cfg, i, new_speed, dt);
+            
+            // Update PWM
+            const std::uint32_t pulse = pulse_ns(cfg.pulses[i], output);
+            write_pulse(cfg, i, pulse);
+            trace_record(TraceRecord::MOTOR, 0, i, output, pulse);
+            
+            current_speeds[i] = new_speed;
+            motor_states.publish(i, output, target);
+        }
+        
+        // A stop that fired while this cycle was writing may have been
+        // overwritten: the flag is set before its neutral writes, so
+        // checking it after ours catches that case
+        if (!stopped && estop.active()) {
+            for (std::size_t i = 0; i < motor_count; ++i) {
+                write_pulse(cfg, i, cfg.pulses[i].neutral_ns);
+            }
+        }
+        // Batching backends send the whole cycle at once
+        if (pwm) {
+            pwm->flush();
+        }
+        const std::int64_t write_ns = EmergencyStop::now_ns() - write_start;
+        pwm_write_time.record(static_cast<std::uint64_t>(std::max<std::int64_t>(write_ns, 0)));
+    }
+    
+    void check_watchdog(const KartConfig& cfg) {
+        auto now = cycle_now;
+        auto last_beat = last_heartbeat.load();
+        
+        // Calibration is deliberate output without operator commands. Only
+        // the calibrating motors are exempt: while the others are at rest
+        // the timeout restarts, so it runs from the end of the last
+        // calibration; while they move the heartbeat still counts.
+        const bool calibrating = calibration.active();
+        if (calibrating && !others_moving()) {
+            last_heartbeat.store(now);
+            return;
+        }
+        
+        auto elapsed = std::chrono::duration_cast<std::chrono::duration<double>>(now - last_beat);
+        
+        if (elapsed.count() > cfg.safety_limits.watchdog_timeout && !estop.active()) {
+            if (calibrating) {
+                // An emergency stop would abort the calibration as well
+                stop_others(cfg);
+            } else {
+                estop.trigger(EmergencyStop::WATCHDOG);
+            }
+        }
+    }
+    
+    // Motors outside a calibration with a target or still ramping
+    bool others_moving() const {
+        for (std::size_t i = 0; i < motor_count; ++i) {
+            if (!calibration.calibrating(i) && (target_speeds[i] != 0.0 || current_speeds[i] != 0.0)) {
+                return true;
+            }
+        }
+        return false;
+    }
+    
+    // Watchdog timeout during a calibration: neutral at once (no ramp)
+    // for every motor that is not calibrating
+    void stop_others(const KartConfig& cfg) {
+        g_logger.log(Logger::WARNING, LogMsg::WATCHDOG_TIMEOUT);
+        watchdog_motor_stops.fetch_add(1, std::memory_order_relaxed);
+        for (std::size_t i = 0; i < motor_count; ++i) {
+            if (calibration.calibrating(i)) {
+                continue;
+            }
+            current_speeds[i] = 0.0;
+            target_speeds[i] = 0.0;
+            speed_integrals[i] = 0.0;
+            write_pulse(cfg, i, cfg.pulses[i].neutral_ns);
+            trace_record(TraceRecord::MOTOR, 0, i, 0.0, cfg.pulses[i].neutral_ns);
+            motor_states.publish(i, 0.0, 0.0);
+        }
+        if (pwm) {
+            pwm->flush();
+        }
+    }
+    
+    std::chrono::steady_clock::time_point clock_now() const {
+        if (clock != nullptr) {
+            return std::chrono::steady_clock::time_point(std::chrono::nanoseconds(clock->now_ns()));
+        }
+        return std::chrono::steady_clock::now();
+    }
+    
+    // Pulse widths come from the snapshot's precomputed PulseParams (kart_pulse.h)
+    void write_pulse(const KartConfig& cfg, std::size_t motor, std::uint32_t pulse) {
+        if (pwm) {
+            pwm->write(cfg.motors[motor].pin, pulse);
+        }
+    }
+    
+    // PCA9685 boards if configured; else hardware PWM if the PWM chip is
+    // present and every analog motor pin has a PWM channel of its own,
+    // wiringPi softPwm otherwise. DShot motors put SPI in front of that.
+    std::unique_ptr<PwmBackend> select_pwm_backend(const KartConfig& cfg) const {
+        if (cfg.pca9685_enabled) {
+            return std::make_unique<Pca9685Backend>(std::make_unique<LinuxI2cBus>(cfg.pca9685_bus),
+                                                    cfg.pca9685_address);
+        }
+        auto hardware = std::make_unique<SysfsPwmBackend>();
+        bool usable = hardware->available();
+        bool dshot = false;
+        unsigned used_channels = 0;
+        for (const auto& motor : cfg.motors) {
+            dshot = dshot || is_dshot(motor.protocol);
+            if (!is_dshot(motor.protocol)) {
+                const int channel = SysfsPwmBackend::channel_for_pin(motor.pin);
+                usable = usable && channel >= 0 && (used_channels & (1u << channel)) == 0;
+                used_channels |= channel >= 0 ? 1u << channel : 0u;
+            }
+        }
+        std::unique_ptr<PwmBackend> analog;
+        if (usable) {
+            analog = std::move(hardware);
+        } else {
+            analog = std::make_unique<SoftPwmBackend>();
+        }
+        if (dshot) {
+            return std::make_unique<DshotBackend>(std::make_unique<SpidevWaveformSink>(), std::move(analog));
+        }
+        return analog;
+    }
+    
+    static void print_latency(const char* name, std::vector<std::uint64_t> samples) {
+        std::sort(samples.begin(), samples.end());
+        auto at = [&samples](double percentile) {
+            std::size_t index = static_cast<std::size_t>(percentile / 100.0 * static_cast<double>(samples.size() - 1));
+            return samples[index] / 1000.0;
+        };
+        std::printf("%-10s min %.2f us  p50 %.2f us  p99 %.2f us  p99.9 %.2f us  max %.2f us\n", name,
+                    at(0.0), at(50.0), at(99.0), at(99.9), at(100.0));
+    }
+    
+    void log_emergency_stop(const EmergencyStop::Event& event) {
+        if (event.source == EmergencyStop::HARDWARE) {
+            g_logger.log(Logger::WARNING, LogMsg::HARDWARE_ESTOP);
+        } else if (event.source == EmergencyStop::WATCHDOG) {
+            g_logger.log(Logger::WARNING, LogMsg::WATCHDOG_TIMEOUT);
+        }
+        g_logger.log(Logger::WARNING, LogMsg::EMERGENCY_STOP_ACTIVATED);
+        g_logger.log(Logger::INFO, LogMsg::ESTOP_LATENCY, EmergencyStop::source_name(event.source),
+                     event.latency_ns, event.triggers);
+    }
+    
+    void cleanup_gpio() {
+        try {
+            // Turn off status LED
+            digitalWrite(status_led_pin, LOW);
+            
+            // Set all motors to neutral
+            auto cfg = config.snapshot();
+            for (std::size_t i = 0; i < cfg->motors.size(); ++i) {
+                write_pulse(*cfg, i, cfg->pulses[i].neutral_ns);
+            }
+            if (pwm) {
+                pwm->flush();
+            }
+            
+            g_logger.log(Logger::INFO, LogMsg::GPIO_CLEANUP_COMPLETE);
+            
+        } catch (const std::exception& e) {
+            g_logger.log(Logger::ERROR, LogMsg::CLEANUP_FAILED, e.what());
+        }
+    }
+    
+public:
+    // Controller the hardware stop switch interrupt reaches
+    inline static ESCController* instance = nullptr;
+    
+    // SIGINT/SIGTERM for a main loop without a reactor: the handler only
+    // records the signal and makes the returned eventfd readable, the loop
+    // polls it and shuts down outside signal context. -1 without an eventfd
+    // (the signals then keep their default action).
+    static int watch_signals() {
+        if (signal_event < 0) {
+            signal_event = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+            if (signal_event < 0) {
+                return -1;
+            }
+        }
+        signal(SIGINT, signal_handler);
+        signal(SIGTERM, signal_handler);
+        return signal_event;
+    }
+    
+    // Signal recorded since the last call (0: none); clears the eventfd
+    static int take_signal() {
+        std::uint64_t count;
+        if (signal_event >= 0 && read(signal_event, &count, sizeof(count)) < 0) {
+            count = 0;
+        }
+        return pending_signal.exchange(0, std::memory_order_relaxed);
+    }
+    
+private:
+    inline static int signal_event = -1;
+    inline static std::atomic<int> pending_signal{0};
+    static_assert(std::atomic<int>::is_always_lock_free, "signal handler needs a lock-free flag");
+    
+    // Async-signal-safe: an atomic store and write(2), errno preserved
+    static void signal_handler(int signum) {
+        const int saved_errno = errno;
+        pending_signal.store(signum, std::memory_order_relaxed);
+        const std::uint64_t one = 1;
+        if (write(signal_event, &one, sizeof(one)) < 0) {
+            // Counter saturated: the loop has not read the previous signal yet
+        }
+        errno = saved_errno;
+    }
+    
+    // Runs on the wiringPi interrupt thread: stop path only, no logging
+    static void emergency_interrupt() {
+        if (instance) {
+            instance->estop.trigger(EmergencyStop::HARDWARE);
+        }
+    }
+};
+
+// Factory function for default configuration (used without kart_config.ini)
+inline KartConfig create_default_config() {
+    KartConfig config;
+    config.motors = {
+        MotorConfig(18, "main_motor", 1.0, 2.0, 1.5, 50)
+    };
+    
+    config.safety_limits = SafetyLimits(0.05, 80.0, 0.1, 2.0);
+    compute_pulse_params(config);
+    
+    return config;
+}
+
+#endif // KART_CONTROLLER_H
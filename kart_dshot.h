@@ -0,0 +1,488 @@
+/*
+ * DShot digital ESC output as hardware-clocked bit streams
+ * ========================================================
+ *
+ * A DShot frame is 16 bits sent MSB first at 150, 300 or 600 kbit/s. Every
+ * bit starts high; a 1 stays high for 75 % of the bit time, a 0 for
+ * 37.5 %. The frame itself (throttle, telemetry bit, checksum) comes from
+ * pulse_ns() in kart_pulse.h.
+ *
+ * DshotEncoder turns a frame into a bit stream with 8 samples per DShot
+ * bit, so each DShot bit is one byte (11111100 or 11100000) and the whole
+ * frame two lookups in a precomputed table of 256 8-byte patterns. A shift
+ * register clocked at 8 times the bit rate sends it with hardware timing:
+ * SPI MOSI (SpidevWaveformSink) or the PWM serializer fed by DMA take the
+ * same format.
+ *
+ * DshotBackend stores frames in write() (lock-free, also from the stop
+ * path) and encodes and sends every DShot pin on flush(), changed or not:
+ * ESCs disarm when frames stop. Pins with analog protocols go to a wrapped
+ * PwmBackend. Flushes follow the single-flusher rule of Pca9685Backend.
+ *
+ * WaveformCapture is a software sink that keeps the last stream per pin and
+ * decodes it back, measuring the bit timing, so the encoder can be checked
+ * on any Linux machine.
+ */
+
+#ifndef KART_DSHOT_H
+#define KART_DSHOT_H
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <fcntl.h>
+#include <linux/spi/spidev.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+#include "kart_pulse.h"
+#include "kart_pwm.h"
+
+namespace dshot_detail {
+
+static constexpr std::uint8_t ONE = 0xFC;       // 6 of 8 samples high
+static constexpr std::uint8_t ZERO = 0xE0;      // 3 of 8 samples high
+
+using Pattern = std::array<std::uint8_t, 8>;
+
+// Samples of the 8 DShot bits of every byte value
+constexpr std::array<Pattern, 256> make_patterns() {
+    std::array<Pattern, 256> patterns{};
+    for (int byte = 0; byte < 256; ++byte) {
+        for (int bit = 0; bit < 8; ++bit) {
+            patterns[byte][bit] = (byte >> (7 - bit)) & 1 ? ONE : ZERO;
+        }
+    }
+    return patterns;
+}
+
+inline constexpr std::array<Pattern, 256> PATTERNS = make_patterns();
+
+} // namespace dshot_detail
+
+class DshotEncoder {
+public:
+    static constexpr int SAMPLES_PER_BIT = 8;
+    static constexpr std::uint8_t ONE = dshot_detail::ONE;
+    static constexpr std::uint8_t ZERO = dshot_detail::ZERO;
+    static constexpr std::size_t FRAME_BYTES = DSHOT_FRAME_BITS;
+    // Low samples after the frame: the line idles low between frames
+    // whatever the shift register does once it runs empty
+    static constexpr std::size_t GAP_BYTES = 2;
+    static constexpr std::size_t WAVEFORM_BYTES = FRAME_BYTES + GAP_BYTES;
+
+    static constexpr std::uint32_t sample_rate(EscProtocol protocol) {
+        return dshot_bitrate(protocol) * SAMPLES_PER_BIT;
+    }
+
+    static void encode(std::uint16_t frame, std::uint8_t* out) {
+        std::memcpy(out, dshot_detail::PATTERNS[frame >> 8].data(), 8);
+        std::memcpy(out + 8, dshot_detail::PATTERNS[frame & 0xFF].data(), 8);
+        std::memset(out + FRAME_BYTES, 0, GAP_BYTES);
+    }
+};
+
+// Where bit streams go: one hardware-clocked output per pin
+class WaveformSink {
+public:
+    virtual ~WaveformSink() = default;
+
+    virtual const char* name() const = 0;
+
+    // Prepare the output of a pin for sample_hz samples per second
+    virtual bool open(int pin, std::uint32_t sample_hz) = 0;
+
+    // Shift out samples MSB first; false if the output refused them
+    virtual bool send(int pin, const std::uint8_t* samples, std::size_t bytes) = 0;
+
+    virtual void close(int pin) {
+        (void)pin;
+    }
+};
+
+// SPI MOSI as the shift register, through /dev/spidevB.0
+class SpidevWaveformSink : public WaveformSink {
+public:
+    explicit SpidevWaveformSink(const std::string& device_dir = "/dev") : directory(device_dir) {
+        for (int pin = 0; pin < MAX_GPIO_PIN; ++pin) {
+            fds[pin] = -1;
+            speeds[pin] = 0;
+        }
+    }
+
+    ~SpidevWaveformSink() override {
+        for (int fd : fds) {
+            if (fd >= 0) {
+                ::close(fd);
+            }
+        }
+    }
+
+    SpidevWaveformSink(const SpidevWaveformSink&) = delete;
+    SpidevWaveformSink& operator=(const SpidevWaveformSink&) = delete;
+
+    const char* name() const override {
+        return "spidev";
+    }
+
+    // SPI bus whose MOSI is routed to a GPIO (BCM2711: SPI0, SPI1, SPI3-5
+    // with their overlays), -1 if none
+    static int bus_for_pin(int pin) {
+        switch (pin) {
+            case 10: return 0;
+            case 20: return 1;
+            case 2: return 3;
+            case 6: return 4;
+            case 14: return 5;
+            default: return -1;
+        }
+    }
+
+    bool open(int pin, std::uint32_t sample_hz) override {
+        const int bus = bus_for_pin(pin);
+        if (pin < 0 || pin >= MAX_GPIO_PIN || bus < 0) {
+            return false;
+        }
+        const std::string path = directory + "/spidev" + std::to_string(bus) + ".0";
+        int fd = ::open(path.c_str(), O_RDWR | O_CLOEXEC);
+        if (fd < 0) {
+            return false;
+        }
+        std::uint8_t mode = SPI_MODE_0;
+        std::uint8_t bits = 8;
+        if (::ioctl(fd, SPI_IOC_WR_MODE, &mode) < 0 || ::ioctl(fd, SPI_IOC_WR_BITS_PER_WORD, &bits) < 0 ||
+            ::ioctl(fd, SPI_IOC_WR_MAX_SPEED_HZ, &sample_hz) < 0) {
+            ::close(fd);
+            return false;
+        }
+        close(pin);
+        fds[pin] = fd;
+        speeds[pin] = sample_hz;
+        return true;
+    }
+
+    bool send(int pin, const std::uint8_t* samples, std::size_t bytes) override {
+        if (pin < 0 || pin >= MAX_GPIO_PIN || fds[pin] < 0) {
+            return false;
+        }
+        spi_ioc_transfer transfer{};
+        transfer.tx_buf = reinterpret_cast<std::uintptr_t>(samples);
+        transfer.len = static_cast<std::uint32_t>(bytes);
+        transfer.speed_hz = speeds[pin];
+        transfer.bits_per_word = 8;
+        return ::ioctl(fds[pin], SPI_IOC_MESSAGE(1), &transfer) == static_cast<int>(bytes);
+    }
+
+    void close(int pin) override {
+        if (pin >= 0 && pin < MAX_GPIO_PIN && fds[pin] >= 0) {
+            ::close(fds[pin]);
+            fds[pin] = -1;
+        }
+    }
+
+private:
+    std::string directory;
+    int fds[MAX_GPIO_PIN];
+    std::uint32_t speeds[MAX_GPIO_PIN];
+};
+
+class DshotBackend : public PwmBackend {
+public:
+    struct Stats {
+        std::uint64_t flushes = 0;     // flushes that sent frames
+        std::uint64_t frames = 0;      // frames handed to the sink
+        std::uint64_t errors = 0;      // frames the sink refused
+    };
+
+    // analog: backend for pins with pulse protocols, may be null
+    DshotBackend(std::unique_ptr<WaveformSink> waveform_sink, std::unique_ptr<PwmBackend> analog_backend = nullptr)
+        : sink(std::move(waveform_sink)), analog(std::move(analog_backend)) {
+        for (int pin = 0; pin < MAX_GPIO_PIN; ++pin) {
+            frames[pin].store(dshot_frame(DSHOT_STOP), std::memory_order_relaxed);
+            active[pin].store(false, std::memory_order_relaxed);
+        }
+    }
+
+    ~DshotBackend() override {
+        for (int pin = 0; pin < MAX_GPIO_PIN; ++pin) {
+            if (active[pin].load()) {
+                sink->close(pin);
+            }
+        }
+    }
+
+    DshotBackend(const DshotBackend&) = delete;
+    DshotBackend& operator=(const DshotBackend&) = delete;
+
+    const char* name() const override {
+        return "dshot";
+    }
+
+    bool setup(int pin, std::uint32_t period_ns) override {
+        return analog && !dshot_pin(pin) && analog->setup(pin, period_ns);
+    }
+
+    bool setup_dshot(int pin, EscProtocol protocol) override {
+        if (pin < 0 || pin >= MAX_GPIO_PIN || !is_dshot(protocol) || !sink ||
+            !sink->open(pin, DshotEncoder::sample_rate(protocol))) {
+            return false;
+        }
+        frames[pin].store(dshot_frame(DSHOT_STOP), std::memory_order_relaxed);
+        active[pin].store(true, std::memory_order_release);
+        return true;
+    }
+
+    void write(int pin, std::uint32_t pulse_ns) override {
+        if (dshot_pin(pin)) {
+            frames[pin].store(static_cast<std::uint16_t>(pulse_ns), std::memory_order_release);
+        } else if (analog) {
+            analog->write(pin, pulse_ns);
+        }
+    }
+
+    void flush() override {
+        if (analog) {
+            analog->flush();
+        }
+        // Single flusher: a flush that finds another one running leaves its
+        // request behind, and the running one goes again
+        flush_again.store(true);
+        while (flush_again.load() && !flushing.test_and_set()) {
+            flush_again.store(false);
+            send_frames();
+            flushing.clear();
+        }
+    }
+
+    // Frames stop: the ESC disarms
+    void release(int pin) override {
+        if (dshot_pin(pin)) {
+            active[pin].store(false, std::memory_order_release);
+            // Let a flush that still sends to the pin finish
+            while (flushing.test_and_set()) {
+                std::this_thread::yield();
+            }
+            sink->close(pin);
+            flushing.clear();
+            if (flush_again.load()) {
+                flush();    // requested while we held the flag
+            }
+        } else if (analog) {
+            analog->release(pin);
+        }
+    }
+
+    Stats stats() const {
+        Stats s;
+        s.flushes = flushes.load(std::memory_order_relaxed);
+        s.frames = frames_sent.load(std::memory_order_relaxed);
+        s.errors = errors.load(std::memory_order_relaxed);
+        return s;
+    }
+
+    std::string summary() const override {
+        const Stats s = stats();
+        char buf[128];
+        std::snprintf(buf, sizeof(buf), "DShot(%s flushes:%llu frames:%llu errors:%llu)", sink ? sink->name() : "none",
+                      static_cast<unsigned long long>(s.flushes), static_cast<unsigned long long>(s.frames),
+                      static_cast<unsigned long long>(s.errors));
+        std::string text(buf);
+        if (analog && !analog->summary().empty()) {
+            text += " " + analog->summary();
+        }
+        return text;
+    }
+
+private:
+    std::unique_ptr<WaveformSink> sink;
+    std::unique_ptr<PwmBackend> analog;
+
+    std::atomic<std::uint16_t> frames[MAX_GPIO_PIN];
+    std::atomic<bool> active[MAX_GPIO_PIN];
+    std::atomic_flag flushing = ATOMIC_FLAG_INIT;
+    std::atomic<bool> flush_again{false};
+    std::uint8_t waveform[DshotEncoder::WAVEFORM_BYTES];   // owned by the flusher
+
+    std::atomic<std::uint64_t> flushes{0};
+    std::atomic<std::uint64_t> frames_sent{0};
+    std::atomic<std::uint64_t> errors{0};
+
+    bool dshot_pin(int pin) const {
+        return pin >= 0 && pin < MAX_GPIO_PIN && active[pin].load(std::memory_order_acquire);
+    }
+
+    void send_frames() {
+        std::uint64_t sent = 0;
+        std::uint64_t refused = 0;
+        for (int pin = 0; pin < MAX_GPIO_PIN; ++pin) {
+            if (!active[pin].load(std::memory_order_acquire)) {
+                continue;
+            }
+            DshotEncoder::encode(frames[pin].load(std::memory_order_acquire), waveform);
+            if (sink->send(pin, waveform, sizeof(waveform))) {
+                ++sent;
+            } else {
+                ++refused;
+            }
+        }
+        if (sent + refused == 0) {
+            return;
+        }
+        flushes.fetch_add(1, std::memory_order_relaxed);
+        frames_sent.fetch_add(sent, std::memory_order_relaxed);
+        errors.fetch_add(refused, std::memory_order_relaxed);
+    }
+};
+
+// Software sink: the last stream per pin, decoded back with its timing
+class WaveformCapture : public WaveformSink {
+public:
+    static constexpr std::size_t MAX_BYTES = 64;
+
+    // One decoded DShot frame; times in ns from the sample rate
+    struct Decoded {
+        int bits = 0;                   // rising edges found
+        std::uint16_t frame = 0;
+        std::uint16_t value = 0;
+        bool telemetry = false;
+        bool checksum_ok = false;
+        double bit_ns = 0.0;            // rising edge to rising edge
+        double one_high_ns = 0.0;       // longest high time of a 1
+        double one_high_min_ns = 0.0;
+        double zero_high_ns = 0.0;      // longest high time of a 0
+        double zero_high_min_ns = 0.0;
+    };
+
+    const char* name() const override {
+        return "capture";
+    }
+
+    bool open(int pin, std::uint32_t sample_hz) override {
+        if (pin < 0 || pin >= MAX_GPIO_PIN || sample_hz == 0) {
+            return false;
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        outputs[pin] = Output{};
+        outputs[pin].sample_hz = sample_hz;
+        return true;
+    }
+
+    bool send(int pin, const std::uint8_t* samples, std::size_t bytes) override {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (pin < 0 || pin >= MAX_GPIO_PIN || outputs[pin].sample_hz == 0 || bytes > MAX_BYTES || failing) {
+            return false;
+        }
+        std::memcpy(outputs[pin].samples.data(), samples, bytes);
+        outputs[pin].bytes = bytes;
+        ++outputs[pin].sends;
+        return true;
+    }
+
+    void close(int pin) override {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (pin >= 0 && pin < MAX_GPIO_PIN) {
+            outputs[pin].sample_hz = 0;
+        }
+    }
+
+    // Refuse every following send
+    void set_failing(bool fail) {
+        std::lock_guard<std::mutex> lock(mutex);
+        failing = fail;
+    }
+
+    std::uint64_t sends(int pin) const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return pin >= 0 && pin < MAX_GPIO_PIN ? outputs[pin].sends : 0;
+    }
+
+    bool is_open(int pin) const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return pin >= 0 && pin < MAX_GPIO_PIN && outputs[pin].sample_hz != 0;
+    }
+
+    Decoded decode(int pin) const {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (pin < 0 || pin >= MAX_GPIO_PIN || outputs[pin].sample_hz == 0) {
+            return Decoded{};
+        }
+        const Output& out = outputs[pin];
+        return decode(out.samples.data(), out.bytes, out.sample_hz);
+    }
+
+    // A bit is a 1 if it is high for more than half of its time. The last
+    // bit's time is taken from the one before it.
+    static Decoded decode(const std::uint8_t* samples, std::size_t bytes, std::uint32_t sample_hz) {
+        Decoded result;
+        const double sample_ns = 1e9 / sample_hz;
+        std::size_t starts[DSHOT_FRAME_BITS + 1];
+        std::size_t highs[DSHOT_FRAME_BITS + 1];
+        int edges = 0;
+        bool previous = false;
+        for (std::size_t i = 0; i < bytes * 8; ++i) {
+            const bool level = (samples[i / 8] >> (7 - i % 8)) & 1;
+            if (level && !previous) {
+                if (edges == DSHOT_FRAME_BITS + 1) {
+                    result.bits = edges + 1;
+                    return result;    // more than a frame
+                }
+                starts[edges] = i;
+                highs[edges] = 0;
+                ++edges;
+            }
+            if (level) {
+                ++highs[edges - 1];
+            }
+            previous = level;
+        }
+        result.bits = edges;
+        if (edges != DSHOT_FRAME_BITS) {
+            return result;
+        }
+
+        const std::size_t period = starts[1] - starts[0];
+        result.bit_ns = static_cast<double>(starts[edges - 1] - starts[0]) / (edges - 1) * sample_ns;
+        result.one_high_min_ns = result.zero_high_min_ns = 1e12;
+        for (int bit = 0; bit < edges; ++bit) {
+            const std::size_t length = bit + 1 < edges ? starts[bit + 1] - starts[bit] : period;
+            const double high_ns = static_cast<double>(highs[bit]) * sample_ns;
+            const bool one = highs[bit] * 2 > length;
+            result.frame = static_cast<std::uint16_t>((result.frame << 1) | (one ? 1 : 0));
+            double& longest = one ? result.one_high_ns : result.zero_high_ns;
+            double& shortest = one ? result.one_high_min_ns : result.zero_high_min_ns;
+            longest = std::max(longest, high_ns);
+            shortest = std::min(shortest, high_ns);
+        }
+        if (result.one_high_min_ns > result.one_high_ns) {
+            result.one_high_min_ns = 0.0;
+        }
+        if (result.zero_high_min_ns > result.zero_high_ns) {
+            result.zero_high_min_ns = 0.0;
+        }
+        result.value = dshot_frame_value(result.frame);
+        result.telemetry = (result.frame >> 4) & 1;
+        result.checksum_ok = dshot_frame_valid(result.frame);
+        return result;
+    }
+
+private:
+    struct Output {
+        std::uint32_t sample_hz = 0;
+        std::array<std::uint8_t, MAX_BYTES> samples{};
+        std::size_t bytes = 0;
+        std::uint64_t sends = 0;
+    };
+
+    mutable std::mutex mutex;
+    Output outputs[MAX_GPIO_PIN];
+    bool failing = false;
+};
+
+#endif // KART_DSHOT_H
@@ -0,0 +1,218 @@
+/*
+ * Emergency stop path for the kart controller
+ * ===========================================
+ *
+ * trigger() is what runs when the stop switch fires (wiringPi ISR thread),
+ * the watchdog expires or an operator stops the kart. It sets the stop
+ * flag and writes the neutral pulse of every output straight through the
+ * PWM backend (flushed at once on batching backends), then returns. It
+ * takes no locks, allocates nothing and does not log: logging, the LED
+ * and everything else slow is left to a deferred handler that waits with
+ * wait_event() (or polls wakeup_fd() in an event loop) and picks up the
+ * event with take_event().
+ *
+ * Each stop records the time from trigger to the last neutral write in a
+ * latency histogram (see --bench-estop in kart_control.cpp).
+ *
+ * Setup (add_output, attach) happens before the first trigger can fire;
+ * set_neutral() may run concurrently (config reload).
+ */
+
+#ifndef KART_ESTOP_H
+#define KART_ESTOP_H
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <time.h>
+#include <unistd.h>
+#include "kart_pwm.h"
+#include "kart_timing.h"
+
+class EmergencyStop {
+public:
+    static constexpr std::size_t MAX_OUTPUTS = 32;
+
+    enum Source : std::uint8_t { CONSOLE, HARDWARE, WATCHDOG, COMMAND, SHUTDOWN, BENCHMARK };
+    static constexpr std::size_t SOURCES = BENCHMARK + 1;
+
+    // What the deferred handler gets to see of a stop
+    struct Event {
+        Source source = CONSOLE;
+        std::uint64_t latency_ns = 0;
+        std::uint64_t triggers = 0;   // triggers since the previous event, including this one
+    };
+
+    EmergencyStop() {
+        event_fd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    }
+
+    ~EmergencyStop() {
+        if (event_fd >= 0) {
+            ::close(event_fd);
+        }
+    }
+
+    EmergencyStop(const EmergencyStop&) = delete;
+    EmergencyStop& operator=(const EmergencyStop&) = delete;
+
+    void attach(PwmBackend* backend) {
+        pwm = backend;
+    }
+
+    // Register an output before the stop path can fire; false when full
+    bool add_output(int pin, std::uint32_t neutral_ns) {
+        if (output_count >= MAX_OUTPUTS) {
+            return false;
+        }
+        pins[output_count] = pin;
+        neutral[output_count].store(neutral_ns, std::memory_order_relaxed);
+        ++output_count;
+        return true;
+    }
+
+    void set_neutral(std::size_t output, std::uint32_t neutral_ns) {
+        if (output < output_count) {
+            neutral[output].store(neutral_ns, std::memory_order_relaxed);
+        }
+    }
+
+    // Stop path: flag, neutral pulses, wake the deferred handler. Safe to
+    // call from any thread, also concurrently. Returns the trigger-to-
+    // neutral latency in nanoseconds.
+    std::uint64_t trigger(Source source, std::int64_t trigger_ns = now_ns()) {
+        stopped.store(true, std::memory_order_seq_cst);
+
+        if (pwm != nullptr) {
+            for (std::size_t i = 0; i < output_count; ++i) {
+                pwm->write(pins[i], neutral[i].load(std::memory_order_relaxed));
+            }
+            pwm->flush();
+        }
+
+        const std::uint64_t latency = static_cast<std::uint64_t>(std::max<std::int64_t>(now_ns() - trigger_ns, 0));
+
+        // The histogram has a single writer: a trigger racing with another
+        // one still stops the outputs but is only counted
+        pending_triggers.fetch_add(1, std::memory_order_relaxed);
+        source_triggers[source].fetch_add(1, std::memory_order_relaxed);
+        if (!recording.test_and_set(std::memory_order_acquire)) {
+            latency_histogram.record(latency);
+            last_source.store(source, std::memory_order_relaxed);
+            last_latency_ns.store(latency, std::memory_order_relaxed);
+            recording.clear(std::memory_order_release);
+        }
+        events.fetch_add(1, std::memory_order_release);
+        const std::uint64_t one = 1;
+        ssize_t ignored = ::write(event_fd, &one, sizeof(one));
+        (void)ignored;
+
+        return latency;
+    }
+
+    bool active() const {
+        return stopped.load(std::memory_order_seq_cst);
+    }
+
+    void reset() {
+        stopped.store(false, std::memory_order_seq_cst);
+    }
+
+    // Source of the latest recorded trigger
+    Source source() const {
+        return static_cast<Source>(last_source.load(std::memory_order_relaxed));
+    }
+
+    // Readable after a trigger until take_event()
+    int wakeup_fd() const {
+        return event_fd;
+    }
+
+    // Deferred side: sleep until a trigger or the timeout; true on a trigger
+    bool wait_event(std::chrono::nanoseconds timeout) {
+        pollfd fds{event_fd, POLLIN, 0};
+        timespec wait{static_cast<time_t>(timeout.count() / 1000000000),
+                      static_cast<long>(timeout.count() % 1000000000)};
+        int result;
+        while ((result = ::ppoll(&fds, 1, &wait, nullptr)) < 0 && errno == EINTR) {
+        }
+        return result > 0;
+    }
+
+    // Latest stop since the previous call, if any (single consumer)
+    bool take_event(Event& event) {
+        // Drain the wake-up first: a trigger after this read leaves the fd
+        // readable, so it is picked up by the next call
+        std::uint64_t wakeups;
+        ssize_t ignored = ::read(event_fd, &wakeups, sizeof(wakeups));
+        (void)ignored;
+        const std::uint64_t seen = events.load(std::memory_order_acquire);
+        if (seen == taken_events) {
+            return false;
+        }
+        taken_events = seen;
+        event.source = static_cast<Source>(last_source.load(std::memory_order_relaxed));
+        event.latency_ns = last_latency_ns.load(std::memory_order_relaxed);
+        event.triggers = pending_triggers.exchange(0, std::memory_order_relaxed);
+        return true;
+    }
+
+    const LatencyHistogram& latency() const {
+        return latency_histogram;
+    }
+
+    // Every trigger from a source, also those that raced with another one
+    std::uint64_t triggers(Source source) const {
+        return source_triggers[source].load(std::memory_order_relaxed);
+    }
+
+    // One-line summary for status output
+    std::string summary() const {
+        LatencyHistogram::Snapshot snap = latency_histogram.snapshot();
+        char buf[128];
+        std::snprintf(buf, sizeof(buf), "Estop(active:%d stops:%llu latency_p99_us:%.1f latency_max_us:%.1f)",
+                      active() ? 1 : 0, static_cast<unsigned long long>(snap.count),
+                      snap.percentile_ns(99.0) / 1000.0, snap.max_ns / 1000.0);
+        return buf;
+    }
+
+    static const char* source_name(Source source) {
+        switch (source) {
+            case CONSOLE: return "console";
+            case HARDWARE: return "hardware";
+            case WATCHDOG: return "watchdog";
+            case COMMAND: return "command";
+            case SHUTDOWN: return "shutdown";
+            case BENCHMARK: return "benchmark";
+        }
+        return "unknown";
+    }
+
+    static std::int64_t now_ns() {
+        timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return static_cast<std::int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+    }
+
+private:
+    std::atomic<bool> stopped{false};
+    PwmBackend* pwm = nullptr;
+    std::size_t output_count = 0;
+    int pins[MAX_OUTPUTS] = {};
+    std::atomic<std::uint32_t> neutral[MAX_OUTPUTS] = {};
+
+    std::atomic_flag recording = ATOMIC_FLAG_INIT;
+    LatencyHistogram latency_histogram;
+    std::atomic<std::uint8_t> last_source{CONSOLE};
+    std::atomic<std::uint64_t> last_latency_ns{0};
+    std::atomic<std::uint64_t> pending_triggers{0};
+    std::atomic<std::uint64_t> source_triggers[SOURCES] = {};
+    std::atomic<std::uint64_t> events{0};
+    std::uint64_t taken_events = 0;
+    int event_fd = -1;
+};
+
+#endif // KART_ESTOP_H
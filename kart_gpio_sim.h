@@ -0,0 +1,165 @@
+/*
+ * Simulated GPIO with the wiringPi API
+ * ====================================
+ *
+ * TEST_MODE builds of the controller include this instead of wiringPi.h
+ * and softPwm.h, so they compile and run on any Linux box. The functions
+ * the controller uses operate on one simulated board (SimGpio::board()):
+ * outputs remember their level, inputs follow their pull resistor until a
+ * test or scenario drives them, and a driven edge runs the registered
+ * interrupt handler right away on the driving thread (wiringPi would run
+ * it on its interrupt thread), which keeps simulations deterministic.
+ */
+
+#ifndef KART_GPIO_SIM_H
+#define KART_GPIO_SIM_H
+
+#include <atomic>
+
+#define INPUT 0
+#define OUTPUT 1
+#define LOW 0
+#define HIGH 1
+#define PUD_OFF 0
+#define PUD_DOWN 1
+#define PUD_UP 2
+#define INT_EDGE_SETUP 0
+#define INT_EDGE_FALLING 1
+#define INT_EDGE_RISING 2
+#define INT_EDGE_BOTH 3
+
+class SimGpio {
+public:
+    static constexpr int PIN_COUNT = 64;
+
+    static SimGpio& board() {
+        static SimGpio instance;
+        return instance;
+    }
+
+    void set_mode(int pin, int mode) {
+        if (valid(pin)) {
+            pins[pin].mode.store(mode);
+        }
+    }
+
+    // An undriven input reads its pull level
+    void set_pull(int pin, int pud) {
+        if (valid(pin) && !pins[pin].driven.load()) {
+            pins[pin].level.store(pud == PUD_UP ? HIGH : LOW);
+        }
+    }
+
+    int read(int pin) const {
+        return valid(pin) ? pins[pin].level.load() : LOW;
+    }
+
+    void write(int pin, int value) {
+        if (valid(pin) && pins[pin].mode.load() == OUTPUT) {
+            pins[pin].level.store(value ? HIGH : LOW);
+        }
+    }
+
+    // External signal on an input (switch, sensor); fires the interrupt
+    // handler if the change matches its edge
+    void drive(int pin, int value) {
+        if (!valid(pin)) {
+            return;
+        }
+        Pin& p = pins[pin];
+        p.driven.store(true);
+        const int before = p.level.exchange(value ? HIGH : LOW);
+        const int edge = p.edge.load();
+        void (*handler)() = p.handler.load();
+        const bool falling = before == HIGH && !value;
+        const bool rising = before == LOW && value;
+        if (handler != nullptr && ((falling && (edge == INT_EDGE_FALLING || edge == INT_EDGE_BOTH)) ||
+                                   (rising && (edge == INT_EDGE_RISING || edge == INT_EDGE_BOTH)))) {
+            handler();
+        }
+    }
+
+    // Stop driving the input: it returns to the level given (its pull)
+    void release(int pin, int level) {
+        if (valid(pin)) {
+            pins[pin].level.store(level);
+            pins[pin].driven.store(false);
+        }
+    }
+
+    bool set_interrupt(int pin, int edge, void (*handler)()) {
+        if (!valid(pin)) {
+            return false;
+        }
+        pins[pin].edge.store(edge);
+        pins[pin].handler.store(handler);
+        return true;
+    }
+
+    int soft_pwm_value(int pin) const {
+        return valid(pin) ? pins[pin].soft_pwm.load() : 0;
+    }
+
+    void set_soft_pwm(int pin, int value) {
+        if (valid(pin)) {
+            pins[pin].soft_pwm.store(value);
+        }
+    }
+
+private:
+    struct Pin {
+        std::atomic<int> mode{INPUT};
+        std::atomic<int> level{LOW};
+        std::atomic<bool> driven{false};
+        std::atomic<int> edge{INT_EDGE_SETUP};
+        std::atomic<void (*)()> handler{nullptr};
+        std::atomic<int> soft_pwm{0};
+    };
+
+    Pin pins[PIN_COUNT];
+
+    static bool valid(int pin) {
+        return pin >= 0 && pin < PIN_COUNT;
+    }
+};
+
+// The subset of wiringPi / softPwm the controller calls
+
+inline int wiringPiSetupGpio() {
+    return 0;
+}
+
+inline void pinMode(int pin, int mode) {
+    SimGpio::board().set_mode(pin, mode);
+}
+
+inline void pullUpDnControl(int pin, int pud) {
+    SimGpio::board().set_pull(pin, pud);
+}
+
+inline int digitalRead(int pin) {
+    return SimGpio::board().read(pin);
+}
+
+inline void digitalWrite(int pin, int value) {
+    SimGpio::board().write(pin, value);
+}
+
+inline int wiringPiISR(int pin, int edge, void (*function)()) {
+    return SimGpio::board().set_interrupt(pin, edge, function) ? 0 : -1;
+}
+
+inline int softPwmCreate(int pin, int initial, int) {
+    SimGpio::board().set_soft_pwm(pin, initial);
+    return 0;
+}
+
+inline void softPwmWrite(int pin, int value) {
+    SimGpio::board().set_soft_pwm(pin, value);
+}
+
+inline void softPwmStop(int pin) {
+    SimGpio::board().set_soft_pwm(pin, 0);
+}
+
+#endif // KART_GPIO_SIM_H
@@ -0,0 +1,114 @@
+/*
+ * Minimal INI reader for kart_config.ini
+ * ======================================
+ *
+ * Understands the subset used by kart_config.ini: [sections], key = value
+ * pairs, full-line comments starting with '#' or ';' and trailing
+ * "# comment" after a value. Section and key names are case-sensitive.
+ */
+
+#ifndef KART_INI_H
+#define KART_INI_H
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+class IniFile {
+private:
+    std::map<std::pair<std::string, std::string>, std::string> values;
+    std::vector<std::string> section_order;
+
+    static std::string trim(const std::string& text) {
+        const char* whitespace = " \t\r\n";
+        std::size_t begin = text.find_first_not_of(whitespace);
+        if (begin == std::string::npos) {
+            return "";
+        }
+        std::size_t end = text.find_last_not_of(whitespace);
+        return text.substr(begin, end - begin + 1);
+    }
+
+public:
+    // Returns false if the file cannot be opened
+    bool load(const std::string& path) {
+        std::ifstream file(path);
+        if (!file) {
+            return false;
+        }
+
+        std::string section;
+        std::string line;
+        while (std::getline(file, line)) {
+            line = trim(line);
+            if (line.empty() || line[0] == '#' || line[0] == ';') {
+                continue;
+            }
+            if (line[0] == '[') {
+                std::size_t end = line.find(']');
+                section = trim(line.substr(1, end == std::string::npos ? std::string::npos : end - 1));
+                if (std::find(section_order.begin(), section_order.end(), section) == section_order.end()) {
+                    section_order.push_back(section);
+                }
+                continue;
+            }
+            std::size_t equals = line.find('=');
+            if (equals == std::string::npos) {
+                continue;
+            }
+            std::string value = line.substr(equals + 1);
+            std::size_t comment = value.find('#');
+            if (comment != std::string::npos) {
+                value.erase(comment);
+            }
+            values[{section, trim(line.substr(0, equals))}] = trim(value);
+        }
+        return true;
+    }
+
+    // Section names in file order
+    const std::vector<std::string>& sections() const {
+        return section_order;
+    }
+
+    bool has(const std::string& section, const std::string& key) const {
+        return values.count({section, key}) != 0;
+    }
+
+    std::string get(const std::string& section, const std::string& key, const std::string& fallback = "") const {
+        auto it = values.find({section, key});
+        return it != values.end() ? it->second : fallback;
+    }
+
+    // Numeric and boolean getters return the fallback for missing or malformed values
+    long get_int(const std::string& section, const std::string& key, long fallback) const {
+        std::string text = get(section, key);
+        char* end = nullptr;
+        long value = std::strtol(text.c_str(), &end, 10);
+        return !text.empty() && *end == '\0' ? value : fallback;
+    }
+
+    double get_double(const std::string& section, const std::string& key, double fallback) const {
+        std::string text = get(section, key);
+        char* end = nullptr;
+        double value = std::strtod(text.c_str(), &end);
+        return !text.empty() && *end == '\0' ? value : fallback;
+    }
+
+    bool get_bool(const std::string& section, const std::string& key, bool fallback) const {
+        std::string text = get(section, key);
+        if (text == "true" || text == "yes" || text == "on" || text == "1") {
+            return true;
+        }
+        if (text == "false" || text == "no" || text == "off" || text == "0") {
+            return false;
+        }
+        return fallback;
+    }
+};
+
+#endif // KART_INI_H
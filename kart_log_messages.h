@@ -0,0 +1,105 @@
+/*
+ * Log message catalog for the kart controller
+ * ===========================================
+ *
+ * Every log call records a message id plus numeric arguments instead of a
+ * formatted string. The format strings live here and are shared by the
+ * background log writer and the offline decoder (kart_logdecode).
+ *
+ * Placeholders: "{}" takes the next numeric argument, "{s}" the text argument.
+ *
+ * Ids end up in binary log files: only append new messages at the end.
+ */
+
+#ifndef KART_LOG_MESSAGES_H
+#define KART_LOG_MESSAGES_H
+
+#include <cstdint>
+
+#define KART_LOG_MESSAGES(X)                                                              \
+    X(TEXT, "{s}")                                                                        \
+    X(LOG_RECORDS_DROPPED, "{} log records dropped (buffer full)")                        \
+    X(CONTROLLER_TOO_MANY_MOTORS, "Only the first {} motors can be addressed by commands") \
+    X(CONTROLLER_INITIALIZED, "ESC Controller initialized with {} motors")                \
+    X(WIRINGPI_INIT_FAILED, "Failed to initialize wiringPi")                              \
+    X(PWM_CREATE_FAILED, "Failed to create PWM for motor {s}")                            \
+    X(MOTOR_INITIALIZED, "Initialized motor {s} on pin {}")                               \
+    X(EMERGENCY_ISR_FAILED, "Failed to setup emergency stop interrupt")                   \
+    X(GPIO_INIT_COMPLETE, "GPIO initialization complete")                                 \
+    X(INIT_FAILED, "Initialization failed: {s}")                                          \
+    X(SYSTEM_STARTED, "Motor control system started")                                     \
+    X(START_FAILED, "Failed to start: {s}")                                               \
+    X(SYSTEM_STOPPING, "Stopping motor control system...")                                \
+    X(SYSTEM_STOPPED, "Motor control system stopped")                                     \
+    X(UNKNOWN_MOTOR, "Unknown motor: {s}")                                                \
+    X(COMMAND_REJECTED_ESTOP, "Emergency stop active - command rejected")                 \
+    X(INVALID_MOTOR_HANDLE, "Invalid motor handle {}")                                    \
+    X(COMMAND_QUEUE_FULL, "Command queue full - command dropped")                         \
+    X(EMERGENCY_STOP_ACTIVATED, "EMERGENCY STOP ACTIVATED")                               \
+    X(ESTOP_RESET_BLOCKED, "Cannot reset - hardware switch still active")                 \
+    X(ESTOP_RESET, "Emergency stop reset")                                                \
+    X(CALIBRATION_STARTED, "Starting ESC calibration...")                                 \
+    X(CALIBRATION_MAX, "Sending maximum signal for {} seconds...")                        \
+    X(CALIBRATION_MIN, "Sending minimum signal for {} seconds...")                        \
+    X(CALIBRATION_COMPLETE, "ESC calibration complete")                                   \
+    X(CALIBRATION_FAILED, "ESC calibration failed: {s}")                                  \
+    X(CONTROL_LOOP_STARTED, "Control loop started")                                       \
+    X(CONTROL_LOOP_STOPPED, "Control loop stopped")                                       \
+    X(CONTROL_LOOP_ERROR, "Error in control loop: {s}")                                   \
+    X(MONITOR_LOOP_STARTED, "Monitor loop started")                                       \
+    X(MONITOR_LOOP_STOPPED, "Monitor loop stopped")                                       \
+    X(MONITOR_LOOP_ERROR, "Error in monitor loop: {s}")                                   \
+    X(COMMAND_LOOP_STARTED, "Command loop started")                                       \
+    X(COMMAND_LOOP_STOPPED, "Command loop stopped")                                       \
+    X(STATUS, "Status: {s}")                                                              \
+    X(WATCHDOG_TIMEOUT, "Watchdog timeout - stopping motors")                             \
+    X(GPIO_CLEANUP_COMPLETE, "GPIO cleanup complete")                                     \
+    X(CLEANUP_FAILED, "Error during cleanup: {s}")                                        \
+    X(THREAD_PRIORITY_FAILED, "Failed to set thread priority")                            \
+    X(SIGNAL_RECEIVED, "Received signal {}, shutting down...")                            \
+    X(HARDWARE_ESTOP, "Hardware emergency stop triggered")                                \
+    X(PWM_BACKEND_SELECTED, "Using {s} PWM backend")                                      \
+    X(CONTROL_LOOP_FREQUENCY, "Control loop running at {} Hz")                             \
+    X(RT_PROCESS_SETUP, "Real-time process setup: {s}")                                   \
+    X(RT_CONTROL_THREAD_SETUP, "Real-time control thread setup: {s}")                     \
+    X(CONFIG_RELOADED, "Configuration reloaded from {s}")                                 \
+    X(CONFIG_RELOAD_REJECTED, "Configuration reload rejected: {s}")                       \
+    X(INVALID_BATCH_SIZE, "Invalid command batch size {}")                                \
+    X(ESTOP_LATENCY, "Emergency stop ({s}): outputs neutral {} ns after trigger, {} trigger(s)") \
+    X(TELEMETRY_STARTED, "Publishing telemetry to shared memory {s}")                     \
+    X(TELEMETRY_FAILED, "Cannot create telemetry segment {s} - telemetry disabled") \
+    X(REMOTE_LISTENING, "Accepting remote commands on {s}")                               \
+    X(REMOTE_FAILED, "Cannot open remote command socket {s} - remote commands disabled") \
+    X(CALIBRATION_MOTOR_MAX, "Calibrating {s}: maximum signal for {} seconds...")        \
+    X(CALIBRATION_MOTOR_MIN, "Calibrating {s}: minimum signal for {} seconds...")        \
+    X(CALIBRATION_MOTOR_COMPLETE, "ESC calibration of {s} complete")                      \
+    X(CALIBRATION_MOTOR_CANCELLED, "ESC calibration of {s} cancelled")                    \
+    X(CALIBRATION_MOTOR_ABORTED, "ESC calibration of {s} aborted by emergency stop")      \
+    X(CALIBRATION_REJECTED, "Cannot calibrate {s}: motor moving or emergency stop active") \
+    X(TRACE_STARTED, "Tracing the control loop to {s} ({} MB ring)")                      \
+    X(TRACE_FAILED, "Cannot create trace file {s} - tracing disabled")                    \
+    X(METRICS_LISTENING, "Serving metrics on http://{s}/metrics")                         \
+    X(METRICS_FAILED, "Cannot listen for metrics on {s} - metrics disabled")              \
+    X(CALIBRATION_NOT_APPLICABLE, "Not calibrating {s}: DShot ESCs need no throttle range")\
+    X(TACH_STARTED, "Reading tachometer edges through {s} for {} motors")                 \
+    X(TACH_FAILED, "Cannot read tachometer edges from {s} - RPM feedback disabled")       \
+    X(TACH_UNAVAILABLE, "Built without libgpiod - tachometer pins ignored")
+
+enum class LogMsg : std::uint16_t {
+#define KART_LOG_ENUM(id, format) id,
+    KART_LOG_MESSAGES(KART_LOG_ENUM)
+#undef KART_LOG_ENUM
+    COUNT
+};
+
+// Format string of a message id (nullptr for ids this build does not know)
+inline const char* log_message_format(std::uint16_t id) {
+    static const char* const formats[] = {
+#define KART_LOG_FORMAT(id, format) format,
+        KART_LOG_MESSAGES(KART_LOG_FORMAT)
+#undef KART_LOG_FORMAT
+    };
+    return id < static_cast<std::uint16_t>(LogMsg::COUNT) ? formats[id] : nullptr;
+}
+
+#endif // KART_LOG_MESSAGES_H
@@ -0,0 +1,111 @@
+/*
+ * Offline decoder for kart controller binary logs
+ * ===============================================
+ *
+ * Converts the binary records written by the asynchronous Logger
+ * (kart_logger.h) into the same text lines the controller prints.
+ *
+ * Usage: kart_logdecode [-l LEVEL] [-t] <file.bin> [file.bin.1 ...]
+ *   -l LEVEL  only show messages at or above DEBUG, INFO, WARNING or ERROR
+ *   -t        prefix every line with the logging thread's slot
+ *
+ * Compile with: g++ -std=c++17 -o kart_logdecode kart_logdecode.cpp
+ */
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "kart_logger.h"
+
+static int parse_level(const char* name) {
+    for (int level = Logger::DEBUG; level <= Logger::ERROR; ++level) {
+        if (std::strcmp(name, log_level_name(static_cast<std::uint8_t>(level))) == 0) {
+            return level;
+        }
+    }
+    return -1;
+}
+
+static bool decode_file(const char* path, int min_level, bool show_thread) {
+    std::FILE* file = std::fopen(path, "rb");
+    if (file == nullptr) {
+        std::fprintf(stderr, "kart_logdecode: cannot open %s\n", path);
+        return false;
+    }
+
+    LogFileHeader header{};
+    if (std::fread(&header, sizeof(header), 1, file) != 1 || std::memcmp(header.magic, "KLOG", 4) != 0) {
+        std::fprintf(stderr, "kart_logdecode: %s is not a kart binary log\n", path);
+        std::fclose(file);
+        return false;
+    }
+    if (header.version != LOG_FILE_VERSION || header.record_size != sizeof(LogRecord)) {
+        std::fprintf(stderr, "kart_logdecode: %s has unsupported format version %u (record size %u)\n", path,
+                     header.version, header.record_size);
+        std::fclose(file);
+        return false;
+    }
+
+    std::vector<LogRecord> message;
+    LogRecord record;
+    char line[1024];
+
+    while (std::fread(&record, sizeof(record), 1, file) == 1) {
+        message.push_back(record);
+        if ((record.flags & LOG_FLAG_CONTINUED) && message.size() < LOG_MAX_RECORDS_PER_MESSAGE) {
+            continue;
+        }
+
+        if (message[0].level >= min_level) {
+            format_log_line(line, sizeof(line), message.data(), message.size());
+            if (show_thread) {
+                std::printf("[%2u] %s\n", message[0].thread, line);
+            } else {
+                std::printf("%s\n", line);
+            }
+        }
+        message.clear();
+    }
+
+    if (!message.empty()) {
+        std::fprintf(stderr, "kart_logdecode: %s ends with an incomplete message\n", path);
+    }
+
+    std::fclose(file);
+    return true;
+}
+
+int main(int argc, char** argv) {
+    int min_level = Logger::DEBUG;
+    bool show_thread = false;
+    std::vector<const char*> files;
+
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "-l") == 0 && i + 1 < argc) {
+            min_level = parse_level(argv[++i]);
+            if (min_level < 0) {
+                std::fprintf(stderr, "kart_logdecode: unknown level %s\n", argv[i]);
+                return 2;
+            }
+        } else if (std::strcmp(argv[i], "-t") == 0) {
+            show_thread = true;
+        } else if (argv[i][0] == '-') {
+            std::fprintf(stderr, "Usage: %s [-l LEVEL] [-t] <file.bin> [...]\n", argv[0]);
+            return 2;
+        } else {
+            files.push_back(argv[i]);
+        }
+    }
+
+    if (files.empty()) {
+        std::fprintf(stderr, "Usage: %s [-l LEVEL] [-t] <file.bin> [...]\n", argv[0]);
+        return 2;
+    }
+
+    bool ok = true;
+    for (const char* path : files) {
+        ok = decode_file(path, min_level, show_thread) && ok;
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,470 @@
+/*
+ * Asynchronous binary logger for the kart controller
+ * ==================================================
+ *
+ * A log call only fills fixed-size binary records (timestamp, level,
+ * message id, numeric arguments, short text) and publishes them into the
+ * calling thread's lock-free ring. It never takes a lock, allocates,
+ * formats or touches the disk, so it is safe on the control thread and in
+ * the emergency-stop path.
+ *
+ * A background thread drains the rings, writes the raw records to a binary
+ * log (decoded offline by kart_logdecode), formats a text log and the
+ * console output, and rotates and size-caps both files.
+ */
+
+#ifndef KART_LOGGER_H
+#define KART_LOGGER_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+#include <vector>
+#include <pthread.h>
+#include <signal.h>
+#include "kart_log_messages.h"
+#include "kart_ring.h"
+
+static constexpr int LOG_MAX_ARGS = 4;
+static constexpr std::size_t LOG_TEXT_BYTES = 48;
+static constexpr std::size_t LOG_MAX_RECORDS_PER_MESSAGE = 8;
+
+// One binary log record. Text longer than one record continues in the
+// following records of the same message (LOG_FLAG_CONTINUED).
+struct LogRecord {
+    std::uint64_t timestamp_ns;    // CLOCK_REALTIME
+    std::uint16_t msg;             // LogMsg
+    std::uint8_t level;            // Logger::Level
+    std::uint8_t arg_count;
+    std::uint8_t double_mask;      // bit i set: args[i] holds a double
+    std::uint8_t flags;
+    std::uint8_t thread;           // producer slot of the logging thread
+    std::uint8_t reserved;
+    union {
+        std::int64_t i;
+        double d;
+    } args[LOG_MAX_ARGS];
+    char text[LOG_TEXT_BYTES];     // NUL-terminated chunk of the text argument
+};
+static_assert(sizeof(LogRecord) == 96, "LogRecord layout is part of the binary log format");
+
+static constexpr std::uint8_t LOG_FLAG_CONTINUED = 0x01;   // next record carries more text
+
+// Header at the start of every binary log file
+struct LogFileHeader {
+    char magic[4];                 // "KLOG"
+    std::uint16_t version;
+    std::uint16_t record_size;
+    std::uint32_t reserved[2];
+};
+static_assert(sizeof(LogFileHeader) == 16, "LogFileHeader layout is part of the binary log format");
+
+static constexpr std::uint16_t LOG_FILE_VERSION = 1;
+
+inline const char* log_level_name(std::uint8_t level) {
+    static const char* const names[] = {"DEBUG", "INFO", "WARNING", "ERROR"};
+    return level < 4 ? names[level] : "UNKNOWN";
+}
+
+// Formats the message of records[0..count) (head record plus continuations)
+// into out. Shared by the log writer and the offline decoder.
+inline std::size_t format_log_message(char* out, std::size_t size, const LogRecord* records, std::size_t count) {
+    if (size == 0) {
+        return 0;
+    }
+
+    std::size_t len = 0;
+    auto put = [&](const char* s, std::size_t n) {
+        n = std::min(n, size - 1 - len);
+        std::memcpy(out + len, s, n);
+        len += n;
+    };
+
+    const LogRecord& head = records[0];
+    const char* format = log_message_format(head.msg);
+    char number[32];
+
+    if (format == nullptr) {
+        int n = std::snprintf(number, sizeof(number), "<unknown message %u>", head.msg);
+        put(number, static_cast<std::size_t>(n));
+        format = " {s}";
+    }
+
+    int next_arg = 0;
+    for (const char* p = format; *p != '\0'; ++p) {
+        if (p[0] == '{' && p[1] == '}') {
+            if (next_arg < head.arg_count) {
+                int n = (head.double_mask >> next_arg) & 1u
+                            ? std::snprintf(number, sizeof(number), "%g", head.args[next_arg].d)
+                            : std::snprintf(number, sizeof(number), "%lld",
+                                            static_cast<long long>(head.args[next_arg].i));
+                put(number, static_cast<std::size_t>(n));
+            }
+            ++next_arg;
+            ++p;
+        } else if (p[0] == '{' && p[1] == 's' && p[2] == '}') {
+            for (std::size_t i = 0; i < count; ++i) {
+                put(records[i].text, strnlen(records[i].text, LOG_TEXT_BYTES));
+            }
+            p += 2;
+        } else {
+            put(p, 1);
+        }
+    }
+
+    out[len] = '\0';
+    return len;
+}
+
+// Formats "YYYY-mm-dd HH:MM:SS.mmm - LEVEL - message" into out
+inline std::size_t format_log_line(char* out, std::size_t size, const LogRecord* records, std::size_t count) {
+    const LogRecord& head = records[0];
+    std::time_t seconds = static_cast<std::time_t>(head.timestamp_ns / 1000000000ull);
+    unsigned millis = static_cast<unsigned>((head.timestamp_ns / 1000000ull) % 1000ull);
+
+    std::tm local{};
+    localtime_r(&seconds, &local);
+
+    char timestamp[32];
+    std::strftime(timestamp, sizeof(timestamp), "%Y-%m-%d %H:%M:%S", &local);
+
+    int prefix = std::snprintf(out, size, "%s.%03u - %s - ", timestamp, millis, log_level_name(head.level));
+    if (prefix < 0 || static_cast<std::size_t>(prefix) >= size) {
+        return size > 0 ? size - 1 : 0;
+    }
+    return static_cast<std::size_t>(prefix) +
+           format_log_message(out + prefix, size - static_cast<std::size_t>(prefix), records, count);
+}
+
+// File that is rotated to path.1 ... path.N once it reaches max_bytes
+class RotatingFile {
+private:
+    std::string path;
+    std::size_t max_bytes;
+    int max_files;
+    bool binary;
+    std::FILE* file = nullptr;
+    std::size_t written = 0;
+
+    void open() {
+        file = std::fopen(path.c_str(), binary ? "wb" : "w");
+        written = 0;
+        if (file != nullptr && binary) {
+            LogFileHeader header{{'K', 'L', 'O', 'G'}, LOG_FILE_VERSION, sizeof(LogRecord), {0, 0}};
+            written += std::fwrite(&header, 1, sizeof(header), file);
+        }
+    }
+
+    void rotate() {
+        std::fclose(file);
+        file = nullptr;
+
+        for (int i = max_files - 1; i >= 1; --i) {
+            std::string from = i == 1 ? path : path + "." + std::to_string(i - 1);
+            std::string to = path + "." + std::to_string(i);
+            std::rename(from.c_str(), to.c_str());
+        }
+        if (max_files <= 1) {
+            std::remove(path.c_str());
+        }
+        open();
+    }
+
+public:
+    RotatingFile(const std::string& file_path, std::size_t max_file_bytes, int file_count, bool binary_file)
+        : path(file_path), max_bytes(max_file_bytes), max_files(std::max(file_count, 1)), binary(binary_file) {
+        if (!path.empty()) {
+            open();
+        }
+    }
+
+    ~RotatingFile() {
+        if (file != nullptr) {
+            std::fclose(file);
+        }
+    }
+
+    RotatingFile(const RotatingFile&) = delete;
+    RotatingFile& operator=(const RotatingFile&) = delete;
+
+    bool is_open() const {
+        return file != nullptr;
+    }
+
+    void write(const void* data, std::size_t size) {
+        if (file == nullptr) {
+            return;
+        }
+        if (written + size > max_bytes && written > sizeof(LogFileHeader)) {
+            rotate();
+            if (file == nullptr) {
+                return;
+            }
+        }
+        written += std::fwrite(data, 1, size, file);
+    }
+
+    void flush() {
+        if (file != nullptr) {
+            std::fflush(file);
+        }
+    }
+};
+
+class Logger {
+public:
+    enum Level : std::uint8_t { DEBUG, INFO, WARNING, ERROR };
+
+    struct Options {
+        std::string text_path;         // formatted log, empty to disable
+        std::string binary_path;       // binary records, empty to disable
+        bool console_output;
+        Level min_level;
+        std::size_t max_file_bytes;    // rotate when a file reaches this size
+        int max_files;                 // files kept per log (current + rotated)
+        std::chrono::milliseconds flush_interval;
+    };
+
+    static constexpr int MAX_THREADS = 16;
+    static constexpr std::size_t RING_CAPACITY = 512;
+
+    static Options default_options() {
+        return Options{"/tmp/kart_motor_cpp.log", "/tmp/kart_motor_cpp.bin", true, DEBUG,
+                       4u << 20, 5, std::chrono::milliseconds(50)};
+    }
+
+private:
+    struct alignas(CACHE_LINE_SIZE) ThreadBuffer {
+        SpscRing<LogRecord, RING_CAPACITY> ring;
+    };
+
+    ThreadBuffer buffers[MAX_THREADS];
+    ProducerRegistry<MAX_THREADS> registry;
+
+    std::atomic<std::uint8_t> min_level;
+    std::atomic<std::uint64_t> dropped{0};
+    std::uint64_t dropped_reported = 0;
+
+    // Writer side (background thread only)
+    RotatingFile text_file;
+    RotatingFile binary_file;
+    const bool console_output;
+    const std::chrono::milliseconds flush_interval;
+    std::vector<LogRecord> batch;
+    std::vector<std::pair<std::uint64_t, std::size_t>> order;   // (timestamp, first record)
+
+    std::mutex wake_mutex;
+    std::condition_variable wake_cv;
+    bool stopping = false;
+    std::thread writer;
+
+    static std::uint64_t now_ns() {
+        timespec ts;
+        clock_gettime(CLOCK_REALTIME, &ts);
+        return static_cast<std::uint64_t>(ts.tv_sec) * 1000000000ull + static_cast<std::uint64_t>(ts.tv_nsec);
+    }
+
+    template <typename T>
+    static void add_arg(LogRecord& record, std::string_view& text, const T& value) {
+        if constexpr (std::is_convertible_v<const T&, std::string_view>) {
+            text = std::string_view(value);
+        } else if constexpr (std::is_floating_point_v<T>) {
+            if (record.arg_count < LOG_MAX_ARGS) {
+                record.double_mask |= static_cast<std::uint8_t>(1u << record.arg_count);
+                record.args[record.arg_count++].d = static_cast<double>(value);
+            }
+        } else {
+            static_assert(std::is_integral_v<T> || std::is_enum_v<T>, "log arguments must be numbers or text");
+            if (record.arg_count < LOG_MAX_ARGS) {
+                record.args[record.arg_count++].i = static_cast<std::int64_t>(value);
+            }
+        }
+    }
+
+    void push(const LogRecord* records, std::size_t count) {
+        const int slot = registry.slot();
+        bool ok;
+        if (slot != registry.SHARED_SLOT) {
+            ok = buffers[slot].ring.try_push_n(records, count);
+        } else {
+            registry.lock_shared();
+            ok = buffers[slot].ring.try_push_n(records, count);
+            registry.unlock_shared();
+        }
+        if (!ok) {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    void writer_loop() {
+        // The logger starts before main(): keep process signals away from
+        // it so that signalfd/handlers in the main thread receive them
+        sigset_t all;
+        sigfillset(&all);
+        pthread_sigmask(SIG_BLOCK, &all, nullptr);
+
+        std::unique_lock<std::mutex> lock(wake_mutex);
+        while (!stopping) {
+            wake_cv.wait_for(lock, flush_interval, [this] { return stopping; });
+            lock.unlock();
+            write_pending();
+            lock.lock();
+        }
+        lock.unlock();
+        write_pending();
+    }
+
+    void write_pending() {
+        batch.clear();
+        order.clear();
+
+        const int active = registry.active();
+        for (int i = 0; i < active; ++i) {
+            buffers[i].ring.drain([this](const LogRecord& record) { batch.push_back(record); });
+        }
+
+        std::uint64_t lost = dropped.load(std::memory_order_relaxed);
+        if (lost != dropped_reported) {
+            LogRecord note{};
+            note.timestamp_ns = now_ns();
+            note.msg = static_cast<std::uint16_t>(LogMsg::LOG_RECORDS_DROPPED);
+            note.level = WARNING;
+            note.arg_count = 1;
+            note.args[0].i = static_cast<std::int64_t>(lost - dropped_reported);
+            batch.push_back(note);
+            dropped_reported = lost;
+        }
+
+        if (batch.empty()) {
+            return;
+        }
+
+        // Messages from different threads are merged in timestamp order;
+        // continuation records stay attached to their head record.
+        for (std::size_t i = 0; i < batch.size(); ++i) {
+            order.emplace_back(batch[i].timestamp_ns, i);
+            while ((batch[i].flags & LOG_FLAG_CONTINUED) && i + 1 < batch.size()) {
+                ++i;
+            }
+        }
+        std::stable_sort(order.begin(), order.end(),
+                         [](const auto& a, const auto& b) { return a.first < b.first; });
+
+        char line[1024];
+        for (const auto& entry : order) {
+            std::size_t first = entry.second;
+            std::size_t count = 1;
+            while ((batch[first + count - 1].flags & LOG_FLAG_CONTINUED) && first + count < batch.size()) {
+                ++count;
+            }
+
+            binary_file.write(&batch[first], count * sizeof(LogRecord));
+
+            std::size_t len = format_log_line(line, sizeof(line) - 1, &batch[first], count);
+            line[len++] = '\n';
+            text_file.write(line, len);
+            if (console_output) {
+                std::fwrite(line, 1, len, stdout);
+            }
+        }
+
+        binary_file.flush();
+        text_file.flush();
+        if (console_output) {
+            std::fflush(stdout);
+        }
+    }
+
+public:
+    Logger() : Logger(default_options()) {}
+
+    explicit Logger(const Options& options)
+        : min_level(options.min_level),
+          text_file(options.text_path, options.max_file_bytes, options.max_files, false),
+          binary_file(options.binary_path, options.max_file_bytes, options.max_files, true),
+          console_output(options.console_output), flush_interval(options.flush_interval) {
+        batch.reserve(MAX_THREADS * RING_CAPACITY);
+        order.reserve(MAX_THREADS * RING_CAPACITY);
+        writer = std::thread(&Logger::writer_loop, this);
+    }
+
+    ~Logger() {
+        {
+            std::lock_guard<std::mutex> lock(wake_mutex);
+            stopping = true;
+        }
+        wake_cv.notify_all();
+        if (writer.joinable()) {
+            writer.join();
+        }
+    }
+
+    Logger(const Logger&) = delete;
+    Logger& operator=(const Logger&) = delete;
+
+    // Records a message. Arguments are numbers (filling "{}" in order) and
+    // at most one text argument (filling "{s}"). Lock-free and allocation-free;
+    // the message is dropped and counted if the thread's buffer is full.
+    template <typename... Args>
+    void log(Level level, LogMsg msg, const Args&... args) {
+        if (level < min_level.load(std::memory_order_relaxed)) {
+            return;
+        }
+
+        // Only the records in use are filled, but those completely (unused
+        // arguments and text tails are zero), so log files are deterministic
+        LogRecord records[LOG_MAX_RECORDS_PER_MESSAGE];
+        LogRecord& head = records[0];
+        head = LogRecord{};
+        head.timestamp_ns = now_ns();
+        head.msg = static_cast<std::uint16_t>(msg);
+        head.level = level;
+        head.thread = static_cast<std::uint8_t>(registry.slot());
+
+        std::string_view text;
+        (add_arg(head, text, args), ...);
+
+        std::size_t count = 0;
+        do {
+            LogRecord& record = records[count];
+            if (count > 0) {
+                record = head;
+                record.flags = 0;
+                record.arg_count = 0;
+                record.double_mask = 0;
+                records[count - 1].flags |= LOG_FLAG_CONTINUED;
+            }
+            std::size_t chunk = std::min(text.size(), LOG_TEXT_BYTES - 1);
+            std::memcpy(record.text, text.data(), chunk);
+            std::memset(record.text + chunk, 0, LOG_TEXT_BYTES - chunk);
+            text.remove_prefix(chunk);
+            ++count;
+        } while (!text.empty() && count < LOG_MAX_RECORDS_PER_MESSAGE);
+
+        push(records, count);
+    }
+
+    void set_level(Level level) {
+        min_level.store(level, std::memory_order_relaxed);
+    }
+
+    std::uint64_t dropped_messages() const {
+        return dropped.load(std::memory_order_relaxed);
+    }
+
+    std::thread::native_handle_type native_handle() {
+        return writer.native_handle();
+    }
+};
+
+#endif // KART_LOGGER_H
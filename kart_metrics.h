@@ -0,0 +1,405 @@
+/*
+ * Prometheus metrics endpoint for the kart controller
+ * ===================================================
+ *
+ * MetricsServer answers GET /metrics on a small HTTP listener (default
+ * 127.0.0.1:9101, [metrics] in kart_config.ini) in the Prometheus text
+ * exposition format, for a local agent that feeds Grafana. Every value it
+ * reports is kept in relaxed atomics by the component that owns it (loop
+ * timing, emergency stop, command queue, ...); rendering only loads them,
+ * so a scrape never takes a lock or writes memory the control thread uses.
+ *
+ * The response is rendered into a buffer allocated when the server is
+ * created. MetricsWriter formats numbers with std::to_chars and never
+ * allocates; a response that does not fit is answered with 500 and
+ * counted as an overflow.
+ *
+ * One connection at a time, closed after the response. Requests are read
+ * with a short timeout so a stalled client cannot hold the listener.
+ */
+
+#ifndef KART_METRICS_H
+#define KART_METRICS_H
+
+#include <atomic>
+#include <cerrno>
+#include <charconv>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include "kart_timing.h"
+
+// Text exposition format into a fixed buffer
+class MetricsWriter {
+public:
+    MetricsWriter(char* buffer, std::size_t capacity) : begin(buffer), end(buffer + capacity), cursor(buffer) {}
+
+    // HELP and TYPE lines of a metric family
+    void family(std::string_view name, std::string_view type, std::string_view help) {
+        append("# HELP ");
+        append(name);
+        append(" ");
+        append(help);
+        append("\n# TYPE ");
+        append(name);
+        append(" ");
+        append(type);
+        append("\n");
+    }
+
+    // labels: preformatted pairs without braces (motor="left"), may be empty
+    void sample(std::string_view name, std::string_view labels, std::uint64_t value) {
+        series(name, labels);
+        number(value);
+        append("\n");
+    }
+
+    void sample(std::string_view name, std::string_view labels, double value) {
+        series(name, labels);
+        number(value);
+        append("\n");
+    }
+
+    // LatencyHistogram as a histogram in seconds: one cumulative bucket per
+    // power of two of nanoseconds, the last one only as +Inf
+    void histogram(std::string_view name, std::string_view labels, const LatencyHistogram::Snapshot& snap) {
+        // Buckets and count from the same loads: a concurrent record() may
+        // have bumped one before the other
+        std::uint64_t cumulative = 0;
+        for (int k = 0; k < LatencyHistogram::BUCKETS - 1; ++k) {
+            cumulative += snap.buckets[k];
+            bucket(name, labels, static_cast<double>(LatencyHistogram::bucket_limit_ns(k)) * 1e-9);
+            number(cumulative);
+            append("\n");
+        }
+        cumulative += snap.buckets[LatencyHistogram::BUCKETS - 1];
+        bucket(name, labels, -1.0);
+        number(cumulative);
+        append("\n");
+        series(name, "_sum", labels);
+        number(static_cast<double>(snap.sum_ns) * 1e-9);
+        append("\n");
+        series(name, "_count", labels);
+        number(cumulative);
+        append("\n");
+    }
+
+    std::string_view text() const {
+        return std::string_view(begin, static_cast<std::size_t>(cursor - begin));
+    }
+
+    bool overflow() const {
+        return overflowed;
+    }
+
+private:
+    char* const begin;
+    char* const end;
+    char* cursor;
+    bool overflowed = false;
+
+    void append(std::string_view text) {
+        if (static_cast<std::size_t>(end - cursor) < text.size()) {
+            overflowed = true;
+            cursor = end;
+            return;
+        }
+        std::memcpy(cursor, text.data(), text.size());
+        cursor += text.size();
+    }
+
+    void number(std::uint64_t value) {
+        std::to_chars_result result = std::to_chars(cursor, end, value);
+        take(result);
+    }
+
+    void number(double value) {
+        std::to_chars_result result = std::to_chars(cursor, end, value);
+        take(result);
+    }
+
+    void take(const std::to_chars_result& result) {
+        if (result.ec != std::errc()) {
+            overflowed = true;
+            cursor = end;
+        } else {
+            cursor = result.ptr;
+        }
+    }
+
+    void series(std::string_view name, std::string_view labels) {
+        series(name, "", labels);
+    }
+
+    void series(std::string_view name, std::string_view suffix, std::string_view labels) {
+        append(name);
+        append(suffix);
+        if (!labels.empty()) {
+            append("{");
+            append(labels);
+            append("}");
+        }
+        append(" ");
+    }
+
+    // le < 0: +Inf
+    void bucket(std::string_view name, std::string_view labels, double le) {
+        append(name);
+        append("_bucket{");
+        if (!labels.empty()) {
+            append(labels);
+            append(",");
+        }
+        append("le=\"");
+        if (le < 0.0) {
+            append("+Inf");
+        } else {
+            number(le);
+        }
+        append("\"} ");
+    }
+};
+
+// Label pair with the value escaped for the exposition format
+inline std::string metrics_label(std::string_view name, std::string_view value) {
+    std::string label(name);
+    label += "=\"";
+    for (char c : value) {
+        if (c == '\\' || c == '"') {
+            label += '\\';
+            label += c;
+        } else if (c == '\n') {
+            label += "\\n";
+        } else {
+            label += c;
+        }
+    }
+    label += '"';
+    return label;
+}
+
+class MetricsServer {
+public:
+    // Fills the response body; runs on the serving thread
+    using Renderer = std::function<void(MetricsWriter&)>;
+
+    static constexpr std::size_t DEFAULT_CAPACITY = 64 * 1024;
+    static constexpr int IO_TIMEOUT_MS = 200;
+
+    struct Stats {
+        std::uint64_t scrapes;     // GET /metrics answered with 200
+        std::uint64_t errors;      // other paths, malformed or timed-out requests
+        std::uint64_t overflows;   // response larger than the buffer (500)
+    };
+
+    explicit MetricsServer(std::size_t capacity = DEFAULT_CAPACITY)
+        : body_capacity(capacity), body(std::make_unique<char[]>(capacity)) {}
+
+    ~MetricsServer() {
+        stop();
+    }
+
+    MetricsServer(const MetricsServer&) = delete;
+    MetricsServer& operator=(const MetricsServer&) = delete;
+
+    // Listen on an IPv4 address; port 0 picks a free port (see port())
+    bool open(const std::string& ip, int port) {
+        sockaddr_in address{};
+        address.sin_family = AF_INET;
+        address.sin_port = htons(static_cast<std::uint16_t>(port));
+        if (::inet_pton(AF_INET, ip.c_str(), &address.sin_addr) != 1) {
+            return false;
+        }
+        int fd = ::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (fd < 0) {
+            return false;
+        }
+        const int reuse = 1;
+        ::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+        if (::bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || ::listen(fd, 8) != 0) {
+            ::close(fd);
+            return false;
+        }
+        listen_socket = fd;
+        return true;
+    }
+
+    int fd() const {
+        return listen_socket;
+    }
+
+    int port() const {
+        sockaddr_in address{};
+        socklen_t length = sizeof(address);
+        if (listen_socket < 0 || ::getsockname(listen_socket, reinterpret_cast<sockaddr*>(&address), &length) != 0) {
+            return -1;
+        }
+        return ntohs(address.sin_port);
+    }
+
+    // Answer every pending connection; returns the number served. One
+    // thread serves at a time (the response buffer is shared).
+    std::size_t serve(const Renderer& render) {
+        std::size_t count = 0;
+        for (;;) {
+            int client = ::accept4(listen_socket, nullptr, nullptr, SOCK_CLOEXEC);
+            if (client < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                return count;
+            }
+            ++count;
+            const timeval timeout{0, IO_TIMEOUT_MS * 1000};
+            ::setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+            ::setsockopt(client, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+            answer(client, render);
+            ::close(client);
+        }
+    }
+
+    // Serve on a background thread
+    bool start(Renderer render) {
+        if (listen_socket < 0) {
+            return false;
+        }
+        running.store(true);
+        thread = std::thread(&MetricsServer::run, this, std::move(render));
+        return true;
+    }
+
+    void stop() {
+        running.store(false);
+        if (thread.joinable()) {
+            thread.join();
+        }
+        if (listen_socket >= 0) {
+            ::close(listen_socket);
+            listen_socket = -1;
+        }
+    }
+
+    Stats stats() const {
+        return Stats{scrapes.load(std::memory_order_relaxed), errors.load(std::memory_order_relaxed),
+                     overflows.load(std::memory_order_relaxed)};
+    }
+
+private:
+    const std::size_t body_capacity;
+    std::unique_ptr<char[]> body;
+    int listen_socket = -1;
+    std::thread thread;
+    std::atomic<bool> running{false};
+
+    std::atomic<std::uint64_t> scrapes{0};
+    std::atomic<std::uint64_t> errors{0};
+    std::atomic<std::uint64_t> overflows{0};
+
+    void run(Renderer render) {
+        pollfd entry{listen_socket, POLLIN, 0};
+        while (running.load()) {
+            // The timeout only bounds how long stop() waits
+            if (::poll(&entry, 1, 200) > 0) {
+                serve(render);
+            }
+        }
+    }
+
+    // Request line up to the end of the headers (or as much as fits)
+    static bool read_request(int client, char* request, std::size_t capacity, std::size_t& length) {
+        length = 0;
+        while (length < capacity) {
+            ssize_t got = ::recv(client, request + length, capacity - length, 0);
+            if (got < 0 && errno == EINTR) {
+                continue;
+            }
+            if (got <= 0) {
+                return false;
+            }
+            length += static_cast<std::size_t>(got);
+            if (std::string_view(request, length).find("\r\n\r\n") != std::string_view::npos) {
+                return true;
+            }
+        }
+        return true;    // headers longer than the buffer: the request line is in
+    }
+
+    void answer(int client, const Renderer& render) {
+        char request[1024];
+        std::size_t length = 0;
+        if (!read_request(client, request, sizeof(request), length)) {
+            errors.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        const std::string_view line(request, length);
+        const bool metrics = line.starts_with("GET /metrics ") || line.starts_with("GET /metrics?");
+        if (!metrics) {
+            errors.fetch_add(1, std::memory_order_relaxed);
+            respond(client, "404 Not Found", "not found, try /metrics\n");
+            return;
+        }
+
+        MetricsWriter writer(body.get(), body_capacity);
+        render(writer);
+        const Stats served = stats();
+        writer.family("kart_metrics_scrapes_total", "counter", "Scrapes answered, including this one");
+        writer.sample("kart_metrics_scrapes_total", "", served.scrapes + 1);
+        writer.family("kart_metrics_errors_total", "counter", "Requests for other paths, malformed or timed out");
+        writer.sample("kart_metrics_errors_total", "", served.errors);
+        if (writer.overflow()) {
+            overflows.fetch_add(1, std::memory_order_relaxed);
+            respond(client, "500 Internal Server Error", "metrics exceed the response buffer\n");
+            return;
+        }
+        scrapes.fetch_add(1, std::memory_order_relaxed);
+        respond(client, "200 OK", writer.text());
+    }
+
+    static void respond(int client, const char* status, std::string_view content) {
+        char header[192];
+        const int header_length = std::snprintf(header, sizeof(header),
+                                                "HTTP/1.1 %s\r\n"
+                                                "Content-Type: text/plain; version=0.0.4; charset=utf-8\r\n"
+                                                "Content-Length: %zu\r\n"
+                                                "Connection: close\r\n\r\n",
+                                                status, content.size());
+        iovec parts[2] = {{header, static_cast<std::size_t>(header_length)},
+                          {const_cast<char*>(content.data()), content.size()}};
+        msghdr message{};
+        message.msg_iov = parts;
+        message.msg_iovlen = 2;
+        while (message.msg_iovlen > 0) {
+            ssize_t sent = ::sendmsg(client, &message, MSG_NOSIGNAL);
+            if (sent < 0 && errno == EINTR) {
+                continue;
+            }
+            if (sent <= 0) {
+                return;     // client gone or stalled past the timeout
+            }
+            // Skip what went out; partial sends continue mid-part
+            std::size_t done = static_cast<std::size_t>(sent);
+            while (message.msg_iovlen > 0 && done >= message.msg_iov[0].iov_len) {
+                done -= message.msg_iov[0].iov_len;
+                ++message.msg_iov;
+                --message.msg_iovlen;
+            }
+            if (message.msg_iovlen > 0) {
+                message.msg_iov[0].iov_base = static_cast<char*>(message.msg_iov[0].iov_base) + done;
+                message.msg_iov[0].iov_len -= done;
+            }
+        }
+    }
+};
+
+#endif // KART_METRICS_H
@@ -0,0 +1,90 @@
+/*
+ * Per-motor speed state published by the control loop
+ * ===================================================
+ *
+ * The control thread owns the current and target speed of every motor:
+ * commands reach it through the command rings (kart_command.h) and it is
+ * the only writer. Once per cycle it publishes each motor's speeds into a
+ * seqlock slot of its own cache line. Readers (status, sim checks) copy a
+ * slot and retry if the sequence was odd or changed meanwhile, so a reader
+ * never blocks the control loop and sees current and target of one motor
+ * from the same cycle. Different motors may come from adjacent cycles.
+ */
+
+#ifndef KART_MOTOR_STATE_H
+#define KART_MOTOR_STATE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+struct MotorSpeeds {
+    double current = 0.0;
+    double target = 0.0;
+};
+
+class MotorStateBoard {
+public:
+    explicit MotorStateBoard(std::size_t motors)
+        : count(motors), slots(std::make_unique<Slot[]>(motors)) {}
+
+    MotorStateBoard(const MotorStateBoard&) = delete;
+    MotorStateBoard& operator=(const MotorStateBoard&) = delete;
+
+    std::size_t size() const {
+        return count;
+    }
+
+    // Single writer (control thread); never blocks
+    void publish(std::size_t motor, double current, double target) {
+        Slot& slot = slots[motor];
+        const std::uint32_t sequence = slot.sequence.load(std::memory_order_relaxed);
+        if (slot.current.load(std::memory_order_relaxed) == current &&
+            slot.target.load(std::memory_order_relaxed) == target) {
+            return;     // idle motors cost readers no retries
+        }
+        slot.sequence.store(sequence + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        slot.current.store(current, std::memory_order_relaxed);
+        slot.target.store(target, std::memory_order_relaxed);
+        slot.sequence.store(sequence + 2, std::memory_order_release);
+    }
+
+    // Consistent copy of one motor; spins only while a publish is in flight
+    MotorSpeeds read(std::size_t motor) const {
+        const Slot& slot = slots[motor];
+        MotorSpeeds speeds;
+        for (;;) {
+            const std::uint32_t before = slot.sequence.load(std::memory_order_acquire);
+            if (before & 1) {
+                continue;
+            }
+            speeds.current = slot.current.load(std::memory_order_relaxed);
+            speeds.target = slot.target.load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (slot.sequence.load(std::memory_order_relaxed) == before) {
+                return speeds;
+            }
+        }
+    }
+
+    // Sequence counter, two per publish that changed the slot (tests)
+    std::uint32_t sequence(std::size_t motor) const {
+        return slots[motor].sequence.load(std::memory_order_acquire);
+    }
+
+private:
+    struct alignas(64) Slot {
+        std::atomic<std::uint32_t> sequence{0};
+        std::atomic<double> current{0.0};
+        std::atomic<double> target{0.0};
+    };
+
+    static_assert(std::atomic<double>::is_always_lock_free, "seqlock fields must be lock-free");
+
+    const std::size_t count;
+    std::unique_ptr<Slot[]> slots;
+};
+
+#endif // KART_MOTOR_STATE_H
@@ -0,0 +1,721 @@
+/*
+ * CPython extension around the C++ ESCController
+ * ==============================================
+ *
+ * kart.py drives the C++ controller through this module. The control
+ * loop, the emergency stop path and the watchdog run on native threads,
+ * and every method releases the GIL before it touches the controller:
+ * Python threads never delay a control cycle, and a slow native call
+ * never blocks the interpreter.
+ *
+ * The Makefile builds it twice from this file: _kart_native against
+ * wiringPi, and _kart_native_sim with TEST_MODE (simulated GPIO plus the
+ * sim_* functions that drive inputs and read outputs, for test_kart.py).
+ *
+ * Telemetry objects map the controller's shared-memory segment
+ * (kart_telemetry.h) and export its live data through the buffer
+ * protocol, so Python reads the speeds without copying them. Readers
+ * that need one consistent cycle compare `sequence` before and after
+ * (even and unchanged) or call read(), which copies under the seqlock.
+ *
+ * Plain C API rather than pybind11, so that building needs nothing but
+ * the Python headers.
+ */
+
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+
+#include <cstddef>
+#include <memory>
+#include <signal.h>
+#include <string>
+#include "kart_controller.h"
+#ifdef TEST_MODE
+#include "kart_sim.h"
+#endif
+
+#ifndef KART_NATIVE_MODULE
+#define KART_NATIVE_MODULE _kart_native
+#endif
+#define KART_NATIVE_STRING2(name) #name
+#define KART_NATIVE_STRING(name) KART_NATIVE_STRING2(name)
+#define KART_NATIVE_INIT2(name) PyInit_##name
+#define KART_NATIVE_INIT(name) KART_NATIVE_INIT2(name)
+
+// The interpreter owns the console; the C++ log goes to its files only
+static Logger::Options native_log_options() {
+    Logger::Options options = Logger::default_options();
+    options.console_output = false;
+    return options;
+}
+
+Logger g_logger(native_log_options());
+
+// Calibration waits for the control loop to pick the request up this long
+// before it counts as refused
+static constexpr std::chrono::seconds CALIBRATION_START_TIMEOUT{1};
+static constexpr std::chrono::milliseconds CALIBRATION_POLL{20};
+
+// ---------------------------------------------------------------- Telemetry
+
+struct TelemetryObject {
+    PyObject_HEAD
+    TelemetryReader* reader;
+    Py_ssize_t exports;         // buffers handed out; the mapping stays while > 0
+};
+
+static int telemetry_init(TelemetryObject* self, PyObject* args, PyObject* kwargs) {
+    static const char* keywords[] = {"shm_name", nullptr};
+    const char* shm_name = nullptr;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "s", const_cast<char**>(keywords), &shm_name)) {
+        return -1;
+    }
+    if (self->exports > 0) {
+        PyErr_SetString(PyExc_BufferError, "telemetry views still exported");
+        return -1;
+    }
+    if (self->reader == nullptr) {
+        self->reader = new TelemetryReader();
+    }
+    TelemetryReader::Status status;
+    Py_BEGIN_ALLOW_THREADS
+    status = self->reader->open(shm_name);
+    Py_END_ALLOW_THREADS
+    if (status == TelemetryReader::NOT_FOUND) {
+        PyErr_Format(PyExc_FileNotFoundError, "no telemetry segment %s", shm_name);
+        return -1;
+    }
+    if (status != TelemetryReader::OK) {
+        PyErr_Format(PyExc_ValueError, "incompatible telemetry segment %s", shm_name);
+        return -1;
+    }
+    return 0;
+}
+
+static void telemetry_dealloc(TelemetryObject* self) {
+    delete self->reader;
+    PyTypeObject* type = Py_TYPE(self);
+    type->tp_free(reinterpret_cast<PyObject*>(self));
+    Py_DECREF(type);
+}
+
+static bool telemetry_open(TelemetryObject* self) {
+    if (self->reader == nullptr || !self->reader->is_open()) {
+        PyErr_SetString(PyExc_ValueError, "telemetry is closed");
+        return false;
+    }
+    return true;
+}
+
+static int telemetry_getbuffer(TelemetryObject* self, Py_buffer* view, int flags) {
+    if (!telemetry_open(self)) {
+        view->obj = nullptr;
+        return -1;
+    }
+    if (PyBuffer_FillInfo(view, reinterpret_cast<PyObject*>(self), const_cast<void*>(self->reader->live_data()),
+                          sizeof(TelemetryData), 1, flags) != 0) {
+        return -1;
+    }
+    ++self->exports;
+    return 0;
+}
+
+static void telemetry_releasebuffer(TelemetryObject* self, Py_buffer*) {
+    --self->exports;
+}
+
+// Live doubles of one per-motor array, viewing the mapping through self
+static PyObject* telemetry_speed_view(TelemetryObject* self, std::size_t offset) {
+    if (!telemetry_open(self)) {
+        return nullptr;
+    }
+    const Py_ssize_t motors = static_cast<Py_ssize_t>(self->reader->header().motor_count);
+    PyObject* bytes = PyMemoryView_FromObject(reinterpret_cast<PyObject*>(self));
+    if (bytes == nullptr) {
+        return nullptr;
+    }
+    PyObject* start = PyLong_FromSsize_t(static_cast<Py_ssize_t>(offset));
+    PyObject* stop = PyLong_FromSsize_t(static_cast<Py_ssize_t>(offset) + motors * 8);
+    PyObject* slice = start != nullptr && stop != nullptr ? PySlice_New(start, stop, nullptr) : nullptr;
+    Py_XDECREF(start);
+    Py_XDECREF(stop);
+    PyObject* part = slice != nullptr ? PyObject_GetItem(bytes, slice) : nullptr;
+    PyObject* view = part != nullptr ? PyObject_CallMethod(part, "cast", "s", "d") : nullptr;
+    Py_XDECREF(part);
+    Py_XDECREF(slice);
+    Py_DECREF(bytes);
+    return view;
+}
+
+static PyObject* telemetry_current_speed(TelemetryObject* self, void*) {
+    return telemetry_speed_view(self, offsetof(TelemetryData, current_speed));
+}
+
+static PyObject* telemetry_target_speed(TelemetryObject* self, void*) {
+    return telemetry_speed_view(self, offsetof(TelemetryData, target_speed));
+}
+
+static PyObject* telemetry_sequence(TelemetryObject* self, void*) {
+    if (!telemetry_open(self)) {
+        return nullptr;
+    }
+    return PyLong_FromUnsignedLong(self->reader->sequence());
+}
+
+static PyObject* telemetry_motor_names(TelemetryObject* self, void*) {
+    if (!telemetry_open(self)) {
+        return nullptr;
+    }
+    const TelemetryHeader& header = self->reader->header();
+    PyObject* names = PyList_New(header.motor_count);
+    for (std::uint32_t i = 0; names != nullptr && i < header.motor_count; ++i) {
+        const std::string name(header.motor_names[i], strnlen(header.motor_names[i], TELEMETRY_NAME_BYTES));
+        PyList_SET_ITEM(names, i, PyUnicode_FromString(name.c_str()));
+    }
+    return names;
+}
+
+static PyObject* telemetry_control_frequency(TelemetryObject* self, void*) {
+    if (!telemetry_open(self)) {
+        return nullptr;
+    }
+    return PyLong_FromUnsignedLong(self->reader->header().control_frequency);
+}
+
+static PyObject* speed_list(const double* speeds, std::uint32_t motors) {
+    PyObject* list = PyList_New(motors);
+    for (std::uint32_t i = 0; list != nullptr && i < motors; ++i) {
+        PyList_SET_ITEM(list, i, PyFloat_FromDouble(speeds[i]));
+    }
+    return list;
+}
+
+// Consistent copy of one cycle as a dict
+static PyObject* telemetry_read(TelemetryObject* self, PyObject*) {
+    if (!telemetry_open(self)) {
+        return nullptr;
+    }
+    TelemetryData data;
+    TelemetryReader::Status status;
+    Py_BEGIN_ALLOW_THREADS
+    status = self->reader->read(data);
+    Py_END_ALLOW_THREADS
+    if (status != TelemetryReader::OK) {
+        PyErr_SetString(PyExc_BlockingIOError, "telemetry writer kept overlapping the read");
+        return nullptr;
+    }
+    const std::uint32_t motors = self->reader->header().motor_count;
+    return Py_BuildValue("{s:K,s:K,s:O,s:O,s:K,s:K,s:K,s:K,s:K,s:K,s:K,s:K,s:K,s:K,s:N,s:N}",
+                         "timestamp_ns", static_cast<unsigned long long>(data.timestamp_ns),
+                         "publishes", static_cast<unsigned long long>(data.publishes),
+                         "running", data.running ? Py_True : Py_False,
+                         "emergency_stop", data.emergency_stop ? Py_True : Py_False,
+                         "cycles", static_cast<unsigned long long>(data.cycles),
+                         "overruns", static_cast<unsigned long long>(data.overruns),
+                         "missed", static_cast<unsigned long long>(data.missed),
+                         "late", static_cast<unsigned long long>(data.late),
+                         "wakeup_p99_ns", static_cast<unsigned long long>(data.wakeup_p99_ns),
+                         "wakeup_max_ns", static_cast<unsigned long long>(data.wakeup_max_ns),
+                         "execution_p99_ns", static_cast<unsigned long long>(data.execution_p99_ns),
+                         "execution_max_ns", static_cast<unsigned long long>(data.execution_max_ns),
+                         "estop_count", static_cast<unsigned long long>(data.estop_count),
+                         "estop_latency_max_ns", static_cast<unsigned long long>(data.estop_latency_max_ns),
+                         "current_speed", speed_list(data.current_speed, motors),
+                         "target_speed", speed_list(data.target_speed, motors));
+}
+
+static PyObject* telemetry_close(TelemetryObject* self, PyObject*) {
+    if (self->exports > 0) {
+        PyErr_SetString(PyExc_BufferError, "telemetry views still exported");
+        return nullptr;
+    }
+    if (self->reader != nullptr) {
+        self->reader->close();
+    }
+    Py_RETURN_NONE;
+}
+
+static PyMethodDef telemetry_methods[] = {
+    {"read", reinterpret_cast<PyCFunction>(telemetry_read), METH_NOARGS,
+     "Consistent copy of the latest cycle as a dict"},
+    {"close", reinterpret_cast<PyCFunction>(telemetry_close), METH_NOARGS,
+     "Unmap the segment (BufferError while views are exported)"},
+    {nullptr, nullptr, 0, nullptr}
+};
+
+static PyGetSetDef telemetry_getset[] = {
+    {"current_speed", reinterpret_cast<getter>(telemetry_current_speed), nullptr,
+     "Live current speeds (memoryview of doubles, no copy)", nullptr},
+    {"target_speed", reinterpret_cast<getter>(telemetry_target_speed), nullptr,
+     "Live target speeds (memoryview of doubles, no copy)", nullptr},
+    {"sequence", reinterpret_cast<getter>(telemetry_sequence), nullptr,
+     "Seqlock counter: odd while the control loop writes", nullptr},
+    {"motor_names", reinterpret_cast<getter>(telemetry_motor_names), nullptr, "Motor names by index", nullptr},
+    {"control_frequency", reinterpret_cast<getter>(telemetry_control_frequency), nullptr,
+     "Control loop frequency in Hz", nullptr},
+    {nullptr, nullptr, nullptr, nullptr, nullptr}
+};
+
+static PyType_Slot telemetry_slots[] = {
+    {Py_tp_doc, const_cast<char*>("Telemetry(shm_name): zero-copy view of a controller's shared-memory telemetry")},
+    {Py_tp_new, reinterpret_cast<void*>(PyType_GenericNew)},
+    {Py_tp_init, reinterpret_cast<void*>(telemetry_init)},
+    {Py_tp_dealloc, reinterpret_cast<void*>(telemetry_dealloc)},
+    {Py_tp_methods, telemetry_methods},
+    {Py_tp_getset, telemetry_getset},
+    {Py_bf_getbuffer, reinterpret_cast<void*>(telemetry_getbuffer)},
+    {Py_bf_releasebuffer, reinterpret_cast<void*>(telemetry_releasebuffer)},
+    {0, nullptr}
+};
+
+static PyType_Spec telemetry_spec = {
+    KART_NATIVE_STRING(KART_NATIVE_MODULE) ".Telemetry",
+    sizeof(TelemetryObject), 0, Py_TPFLAGS_DEFAULT, telemetry_slots
+};
+
+// Created at module init
+static PyObject* telemetry_type = nullptr;
+
+// --------------------------------------------------------------- Controller
+
+struct ControllerObject {
+    PyObject_HEAD
+    ESCController* controller;
+    KartConfig* config;
+};
+
+// (pin, name, min_pulse_width, max_pulse_width, neutral_pulse_width, frequency)
+static bool parse_motors(PyObject* sequence, std::vector<MotorConfig>& motors) {
+    PyObject* items = PySequence_Fast(sequence, "motors must be a sequence");
+    if (items == nullptr) {
+        return false;
+    }
+    bool ok = true;
+    for (Py_ssize_t i = 0; ok && i < PySequence_Fast_GET_SIZE(items); ++i) {
+        PyObject* item = PySequence_Fast_GET_ITEM(items, i);
+        int pin = 0;
+        int frequency = 0;
+        const char* name = nullptr;
+        double min_pw = 0.0;
+        double max_pw = 0.0;
+        double neutral_pw = 0.0;
+        ok = PyTuple_Check(item) &&
+             PyArg_ParseTuple(item, "isdddi;motor: (pin, name, min, max, neutral, frequency)",
+                              &pin, &name, &min_pw, &max_pw, &neutral_pw, &frequency);
+        if (ok) {
+            motors.emplace_back(pin, name, min_pw, max_pw, neutral_pw, frequency);
+        } else if (!PyErr_Occurred()) {
+            PyErr_SetString(PyExc_TypeError, "motor: (pin, name, min, max, neutral, frequency)");
+        }
+    }
+    Py_DECREF(items);
+    if (ok && motors.empty()) {
+        PyErr_SetString(PyExc_ValueError, "no motors");
+        ok = false;
+    }
+    return ok;
+}
+
+static int controller_init(ControllerObject* self, PyObject* args, PyObject* kwargs) {
+    static const char* keywords[] = {"motors", "safety_limits", "config_file", "telemetry_shm", nullptr};
+    PyObject* motor_list = nullptr;
+    SafetyLimits limits;
+    const char* config_file = nullptr;
+    const char* telemetry_shm = nullptr;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O(dddd)|$zz", const_cast<char**>(keywords), &motor_list,
+                                     &limits.max_acceleration_rate, &limits.max_speed,
+                                     &limits.emergency_stop_timeout, &limits.watchdog_timeout,
+                                     &config_file, &telemetry_shm)) {
+        return -1;
+    }
+    if (self->controller != nullptr) {
+        PyErr_SetString(PyExc_RuntimeError, "controller already initialised");
+        return -1;
+    }
+
+    // Everything but the motors and limits comes from kart_config.ini when given
+    auto config = std::make_unique<KartConfig>();
+    std::string error;
+    if (config_file != nullptr && !load_kart_config(config_file, *config, error)) {
+        PyErr_SetString(PyExc_ValueError, error.c_str());
+        return -1;
+    }
+    config->motors.clear();
+    if (!parse_motors(motor_list, config->motors)) {
+        return -1;
+    }
+    config->safety_limits = limits;
+    compute_pulse_params(*config);
+    if (telemetry_shm != nullptr) {
+        config->telemetry_shm = telemetry_shm;
+    }
+#ifdef TEST_MODE
+    // Simulated GPIO needs no real-time setup; telemetry stays for the tests
+    const std::string shm = config->telemetry_shm;
+    *config = simulation_config(*config);
+    config->telemetry_shm = shm;
+#endif
+
+    // The controller installs its own SIGINT/SIGTERM handlers; the
+    // interpreter keeps its own (KeyboardInterrupt, kart.py's handler)
+    Py_BEGIN_ALLOW_THREADS
+    struct sigaction interrupt_action;
+    struct sigaction terminate_action;
+    sigaction(SIGINT, nullptr, &interrupt_action);
+    sigaction(SIGTERM, nullptr, &terminate_action);
+    self->controller = new ESCController(*config);
+    sigaction(SIGINT, &interrupt_action, nullptr);
+    sigaction(SIGTERM, &terminate_action, nullptr);
+    Py_END_ALLOW_THREADS
+
+    self->config = config.release();
+    return 0;
+}
+
+static void controller_dealloc(ControllerObject* self) {
+    ESCController* controller = self->controller;
+    if (controller != nullptr) {
+        Py_BEGIN_ALLOW_THREADS
+        controller->stop();
+        if (ESCController::instance == controller) {
+            ESCController::instance = nullptr;
+        }
+        delete controller;
+        Py_END_ALLOW_THREADS
+    }
+    delete self->config;
+    PyTypeObject* type = Py_TYPE(self);
+    type->tp_free(reinterpret_cast<PyObject*>(self));
+    Py_DECREF(type);
+}
+
+static ESCController* controller_of(ControllerObject* self) {
+    if (self->controller == nullptr) {
+        PyErr_SetString(PyExc_RuntimeError, "controller not initialised");
+    }
+    return self->controller;
+}
+
+static PyObject* controller_start(ControllerObject* self, PyObject*) {
+    ESCController* controller = controller_of(self);
+    if (controller == nullptr) {
+        return nullptr;
+    }
+    // The controller started last takes the emergency stop interrupt
+    ESCController::instance = controller;
+    bool ok;
+    Py_BEGIN_ALLOW_THREADS
+    ok = controller->start();
+    Py_END_ALLOW_THREADS
+    return PyBool_FromLong(ok);
+}
+
+static PyObject* controller_stop(ControllerObject* self, PyObject*) {
+    ESCController* controller = controller_of(self);
+    if (controller == nullptr) {
+        return nullptr;
+    }
+    Py_BEGIN_ALLOW_THREADS
+    controller->stop();
+    Py_END_ALLOW_THREADS
+    Py_RETURN_NONE;
+}
+
+static PyObject* controller_set_motor_speed(ControllerObject* self, PyObject* args, PyObject* kwargs) {
+    static const char* keywords[] = {"motor_name", "speed", "immediate", nullptr};
+    const char* name = nullptr;
+    double speed = 0.0;
+    int immediate = 0;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "sd|p", const_cast<char**>(keywords), &name, &speed, &immediate)) {
+        return nullptr;
+    }
+    ESCController* controller = controller_of(self);
+    if (controller == nullptr) {
+        return nullptr;
+    }
+    const std::string motor_name(name);
+    bool ok;
+    Py_BEGIN_ALLOW_THREADS
+    ok = controller->set_motor_speed(motor_name, speed, immediate != 0);
+    Py_END_ALLOW_THREADS
+    return PyBool_FromLong(ok);
+}
+
+static PyObject* controller_set_all_motors_speed(ControllerObject* self, PyObject* args, PyObject* kwargs) {
+    static const char* keywords[] = {"speed", "immediate", nullptr};
+    double speed = 0.0;
+    int immediate = 0;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "d|p", const_cast<char**>(keywords), &speed, &immediate)) {
+        return nullptr;
+    }
+    ESCController* controller = controller_of(self);
+    if (controller == nullptr) {
+        return nullptr;
+    }
+    bool ok;
+    Py_BEGIN_ALLOW_THREADS
+    ok = controller->set_all_motors_speed(speed, immediate != 0);
+    Py_END_ALLOW_THREADS
+    return PyBool_FromLong(ok);
+}
+
+static PyObject* controller_emergency_stop_all(ControllerObject* self, PyObject*) {
+    ESCController* controller = controller_of(self);
+    if (controller == nullptr) {
+        return nullptr;
+    }
+    Py_BEGIN_ALLOW_THREADS
+    controller->emergency_stop_all();
+    Py_END_ALLOW_THREADS
+    Py_RETURN_NONE;
+}
+
+static PyObject* controller_reset_emergency_stop(ControllerObject* self, PyObject*) {
+    ESCController* controller = controller_of(self);
+    if (controller == nullptr) {
+        return nullptr;
+    }
+    bool ok;
+    Py_BEGIN_ALLOW_THREADS
+    ok = controller->reset_emergency_stop();
+    Py_END_ALLOW_THREADS
+    return PyBool_FromLong(ok);
+}
+
+// Queue the calibration of all ESCs and wait until the control loop has
+// finished it; False if it refused (moving motors, emergency stop)
+static PyObject* controller_calibrate_escs(ControllerObject* self, PyObject*) {
+    ESCController* controller = controller_of(self);
+    if (controller == nullptr) {
+        return nullptr;
+    }
+    bool ok;
+    Py_BEGIN_ALLOW_THREADS
+    ok = controller->calibrate_escs();
+    const auto deadline = std::chrono::steady_clock::now() + CALIBRATION_START_TIMEOUT;
+    while (ok && !controller->calibration_active()) {
+        ok = controller->running() && std::chrono::steady_clock::now() < deadline;
+        std::this_thread::sleep_for(CALIBRATION_POLL);
+    }
+    while (ok && controller->calibration_active()) {
+        std::this_thread::sleep_for(CALIBRATION_POLL);
+    }
+    ok = ok && !controller->emergency_stop_active();
+    Py_END_ALLOW_THREADS
+    return PyBool_FromLong(ok);
+}
+
+static PyObject* controller_motor_speeds(ControllerObject* self, PyObject* args) {
+    const char* name = nullptr;
+    if (!PyArg_ParseTuple(args, "s", &name)) {
+        return nullptr;
+    }
+    ESCController* controller = controller_of(self);
+    if (controller == nullptr) {
+        return nullptr;
+    }
+    const std::string motor_name(name);
+    MotorHandle handle;
+    MotorSpeeds speeds;
+    Py_BEGIN_ALLOW_THREADS
+    handle = controller->motor_handle(motor_name);
+    speeds = controller->motor_speeds(handle);
+    Py_END_ALLOW_THREADS
+    if (handle == INVALID_MOTOR) {
+        PyErr_Format(PyExc_KeyError, "unknown motor %s", name);
+        return nullptr;
+    }
+    return Py_BuildValue("(dd)", speeds.current, speeds.target);
+}
+
+static PyObject* controller_flag(ControllerObject* self, bool (ESCController::*flag)() const) {
+    ESCController* controller = controller_of(self);
+    if (controller == nullptr) {
+        return nullptr;
+    }
+    bool value;
+    Py_BEGIN_ALLOW_THREADS
+    value = (controller->*flag)();
+    Py_END_ALLOW_THREADS
+    return PyBool_FromLong(value);
+}
+
+static PyObject* controller_running(ControllerObject* self, PyObject*) {
+    return controller_flag(self, &ESCController::running);
+}
+
+static PyObject* controller_emergency_stop_active(ControllerObject* self, PyObject*) {
+    return controller_flag(self, &ESCController::emergency_stop_active);
+}
+
+static PyObject* controller_calibration_active(ControllerObject* self, PyObject*) {
+    return controller_flag(self, &ESCController::calibration_active);
+}
+
+static PyObject* controller_text(ControllerObject* self, std::string (ESCController::*text)() const) {
+    ESCController* controller = controller_of(self);
+    if (controller == nullptr) {
+        return nullptr;
+    }
+    std::string value;
+    Py_BEGIN_ALLOW_THREADS
+    value = (controller->*text)();
+    Py_END_ALLOW_THREADS
+    return PyUnicode_FromStringAndSize(value.data(), static_cast<Py_ssize_t>(value.size()));
+}
+
+static PyObject* controller_status(ControllerObject* self, PyObject*) {
+    return controller_text(self, &ESCController::get_status);
+}
+
+static PyObject* controller_timing_report(ControllerObject* self, PyObject*) {
+    return controller_text(self, &ESCController::timing_report);
+}
+
+// Telemetry of this controller (started with it; [telemetry] shm_name)
+static PyObject* controller_telemetry(ControllerObject* self, PyObject*) {
+    if (controller_of(self) == nullptr) {
+        return nullptr;
+    }
+    if (self->config->telemetry_shm.empty()) {
+        PyErr_SetString(PyExc_ValueError, "telemetry disabled");
+        return nullptr;
+    }
+    return PyObject_CallFunction(telemetry_type, "s",
+                                 self->config->telemetry_shm.c_str());
+}
+
+// METH_KEYWORDS functions take a third argument; the table stores PyCFunction
+template <typename Function>
+static PyCFunction keyword_method(Function function) {
+    return reinterpret_cast<PyCFunction>(reinterpret_cast<void (*)()>(function));
+}
+
+static PyMethodDef controller_methods[] = {
+    {"start", reinterpret_cast<PyCFunction>(controller_start), METH_NOARGS,
+     "Set up the outputs and start the control loop"},
+    {"stop", reinterpret_cast<PyCFunction>(controller_stop), METH_NOARGS,
+     "Neutral on all outputs, stop the threads and release the outputs"},
+    {"set_motor_speed", keyword_method(controller_set_motor_speed), METH_VARARGS | METH_KEYWORDS,
+     "Queue a target speed for one motor"},
+    {"set_all_motors_speed", keyword_method(controller_set_all_motors_speed), METH_VARARGS | METH_KEYWORDS,
+     "Queue one target speed for all motors as a batch"},
+    {"emergency_stop_all", reinterpret_cast<PyCFunction>(controller_emergency_stop_all), METH_NOARGS,
+     "Neutral on all outputs before returning"},
+    {"reset_emergency_stop", reinterpret_cast<PyCFunction>(controller_reset_emergency_stop), METH_NOARGS,
+     "Clear the emergency stop unless the switch is still pressed"},
+    {"calibrate_escs", reinterpret_cast<PyCFunction>(controller_calibrate_escs), METH_NOARGS,
+     "Calibrate all ESCs and wait for the end"},
+    {"motor_speeds", reinterpret_cast<PyCFunction>(controller_motor_speeds), METH_VARARGS,
+     "(current, target) of one motor from the same cycle"},
+    {"running", reinterpret_cast<PyCFunction>(controller_running), METH_NOARGS, "Control loop running"},
+    {"emergency_stop_active", reinterpret_cast<PyCFunction>(controller_emergency_stop_active), METH_NOARGS,
+     "Emergency stop engaged"},
+    {"calibration_active", reinterpret_cast<PyCFunction>(controller_calibration_active), METH_NOARGS,
+     "Calibration in progress"},
+    {"status", reinterpret_cast<PyCFunction>(controller_status), METH_NOARGS, "Status line of the controller"},
+    {"timing_report", reinterpret_cast<PyCFunction>(controller_timing_report), METH_NOARGS,
+     "Control loop timing histograms"},
+    {"telemetry", reinterpret_cast<PyCFunction>(controller_telemetry), METH_NOARGS,
+     "Telemetry view of this controller's shared-memory segment"},
+    {nullptr, nullptr, 0, nullptr}
+};
+
+static PyType_Slot controller_slots[] = {
+    {Py_tp_doc, const_cast<char*>("Controller(motors, safety_limits, *, config_file=None, telemetry_shm=None)")},
+    {Py_tp_new, reinterpret_cast<void*>(PyType_GenericNew)},
+    {Py_tp_init, reinterpret_cast<void*>(controller_init)},
+    {Py_tp_dealloc, reinterpret_cast<void*>(controller_dealloc)},
+    {Py_tp_methods, controller_methods},
+    {0, nullptr}
+};
+
+static PyType_Spec controller_spec = {
+    KART_NATIVE_STRING(KART_NATIVE_MODULE) ".Controller",
+    sizeof(ControllerObject), 0, Py_TPFLAGS_DEFAULT, controller_slots
+};
+
+// --------------------------------------------------------------- Simulation
+
+#ifdef TEST_MODE
+static PyObject* sim_drive(PyObject*, PyObject* args) {
+    int pin = 0;
+    int level = 0;
+    if (!PyArg_ParseTuple(args, "ii", &pin, &level)) {
+        return nullptr;
+    }
+    Py_BEGIN_ALLOW_THREADS
+    SimGpio::board().drive(pin, level);     // may run the interrupt handler
+    Py_END_ALLOW_THREADS
+    Py_RETURN_NONE;
+}
+
+static PyObject* sim_release(PyObject*, PyObject* args) {
+    int pin = 0;
+    int level = 0;
+    if (!PyArg_ParseTuple(args, "ii", &pin, &level)) {
+        return nullptr;
+    }
+    SimGpio::board().release(pin, level ? HIGH : LOW);
+    Py_RETURN_NONE;
+}
+
+static PyObject* sim_read(PyObject*, PyObject* args) {
+    int pin = 0;
+    if (!PyArg_ParseTuple(args, "i", &pin)) {
+        return nullptr;
+    }
+    return PyLong_FromLong(SimGpio::board().read(pin));
+}
+
+static PyObject* sim_soft_pwm(PyObject*, PyObject* args) {
+    int pin = 0;
+    if (!PyArg_ParseTuple(args, "i", &pin)) {
+        return nullptr;
+    }
+    return PyLong_FromLong(SimGpio::board().soft_pwm_value(pin));
+}
+#endif
+
+static PyMethodDef module_methods[] = {
+#ifdef TEST_MODE
+    {"sim_drive", sim_drive, METH_VARARGS, "Drive a simulated input to a level (fires its interrupt)"},
+    {"sim_release", sim_release, METH_VARARGS, "Stop driving a simulated input; it returns to the level given"},
+    {"sim_read", sim_read, METH_VARARGS, "Level of a simulated pin"},
+    {"sim_soft_pwm", sim_soft_pwm, METH_VARARGS, "Software PWM value of a simulated pin (100 us units)"},
+#endif
+    {nullptr, nullptr, 0, nullptr}
+};
+
+static PyModuleDef native_module = {
+    PyModuleDef_HEAD_INIT,
+    KART_NATIVE_STRING(KART_NATIVE_MODULE),
+    "C++ ESC controller core for kart.py",
+    -1,
+    module_methods,
+    nullptr, nullptr, nullptr, nullptr
+};
+
+PyMODINIT_FUNC KART_NATIVE_INIT(KART_NATIVE_MODULE)() {
+    PyObject* module = PyModule_Create(&native_module);
+    if (module == nullptr) {
+        return nullptr;
+    }
+    telemetry_type = PyType_FromSpec(&telemetry_spec);
+    PyObject* controller_type = PyType_FromSpec(&controller_spec);
+#ifdef TEST_MODE
+    const bool simulated = true;
+#else
+    const bool simulated = false;
+#endif
+    if (telemetry_type == nullptr || controller_type == nullptr ||
+        PyModule_AddObjectRef(module, "Telemetry", telemetry_type) < 0 ||
+        PyModule_AddObjectRef(module, "Controller", controller_type) < 0 ||
+        PyModule_AddObjectRef(module, "SIMULATED", simulated ? Py_True : Py_False) < 0) {
+        Py_XDECREF(controller_type);
+        Py_DECREF(module);
+        return nullptr;
+    }
+    Py_DECREF(controller_type);
+    return module;
+}
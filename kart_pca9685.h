@@ -0,0 +1,422 @@
+/*
+ * PCA9685 I2C PWM backend for many ESCs per controller
+ * ====================================================
+ *
+ * Each PCA9685 board drives 16 channels with 12-bit resolution per period;
+ * up to four boards on consecutive I2C addresses give 64 outputs. A motor's
+ * pin is board * 16 + channel. All channels of a board share one PWM
+ * frequency.
+ *
+ * write() only stores the channel value (lock-free, also from the stop
+ * path). flush() sends every channel that changed since the previous flush
+ * as one I2C_RDWR transaction: per board, one auto-increment message for
+ * each run of adjacent changed channels, all boards back to back with
+ * repeated starts. Unchanged channels cost no bus time. A flush that finds
+ * another one in progress leaves its channels to it, so neither the
+ * control loop nor the stop path ever waits.
+ *
+ * The bus is the I2cBus interface: LinuxI2cBus talks to /dev/i2c-N,
+ * FakeI2cBus is the register model of the boards for tests.
+ */
+
+#ifndef KART_PCA9685_H
+#define KART_PCA9685_H
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <linux/i2c.h>
+#include <linux/i2c-dev.h>
+#include <sys/ioctl.h>
+#include <time.h>
+#include <unistd.h>
+#include "kart_pwm.h"
+
+// One write message of a combined transfer: data[0] is the register
+struct I2cMessage {
+    std::uint16_t address;
+    std::uint16_t length;
+    const std::uint8_t* data;
+};
+
+class I2cBus {
+public:
+    virtual ~I2cBus() = default;
+
+    // All messages in one transaction (repeated start between them);
+    // false if any was not acknowledged
+    virtual bool transfer(const I2cMessage* messages, std::size_t count) = 0;
+};
+
+// /dev/i2c-N through the I2C_RDWR ioctl
+class LinuxI2cBus : public I2cBus {
+private:
+    int fd = -1;
+
+public:
+    explicit LinuxI2cBus(const std::string& device) {
+        fd = ::open(device.c_str(), O_RDWR | O_CLOEXEC);
+    }
+
+    ~LinuxI2cBus() override {
+        if (fd >= 0) {
+            ::close(fd);
+        }
+    }
+
+    LinuxI2cBus(const LinuxI2cBus&) = delete;
+    LinuxI2cBus& operator=(const LinuxI2cBus&) = delete;
+
+    bool is_open() const {
+        return fd >= 0;
+    }
+
+    bool transfer(const I2cMessage* messages, std::size_t count) override {
+        if (fd < 0 || count == 0 || count > I2C_RDWR_IOCTL_MAX_MSGS) {
+            return false;
+        }
+        i2c_msg msgs[I2C_RDWR_IOCTL_MAX_MSGS];
+        for (std::size_t i = 0; i < count; ++i) {
+            msgs[i].addr = messages[i].address;
+            msgs[i].flags = 0;
+            msgs[i].len = messages[i].length;
+            msgs[i].buf = const_cast<std::uint8_t*>(messages[i].data);
+        }
+        i2c_rdwr_ioctl_data request{msgs, static_cast<std::uint32_t>(count)};
+        return ::ioctl(fd, I2C_RDWR, &request) == static_cast<int>(count);
+    }
+};
+
+class Pca9685Backend : public PwmBackend {
+public:
+    static constexpr int CHANNELS = 16;
+    static constexpr int MAX_BOARDS = MAX_GPIO_PIN / CHANNELS;
+    static constexpr std::uint32_t OSCILLATOR_HZ = 25000000;
+
+    // Registers and MODE1/MODE2 bits
+    static constexpr std::uint8_t MODE1 = 0x00;
+    static constexpr std::uint8_t MODE2 = 0x01;
+    static constexpr std::uint8_t LED0_ON_L = 0x06;
+    static constexpr std::uint8_t PRE_SCALE = 0xFE;
+    static constexpr std::uint8_t MODE1_AI = 0x20;
+    static constexpr std::uint8_t MODE1_SLEEP = 0x10;
+    static constexpr std::uint8_t MODE1_ALLCALL = 0x01;
+    static constexpr std::uint8_t MODE2_OUTDRV = 0x04;
+    static constexpr std::uint16_t FULL_OFF = 0x1000;    // bit 4 of LEDn_OFF_H
+
+    struct Stats {
+        std::uint64_t bursts = 0;          // transactions sent by flush()
+        std::uint64_t channels = 0;        // channel values in them
+        std::uint64_t skipped = 0;         // flushes with nothing changed
+        std::uint64_t errors = 0;          // transactions not acknowledged
+        std::uint64_t last_bus_ns = 0;
+        std::uint64_t max_bus_ns = 0;
+        std::uint64_t total_bus_ns = 0;
+    };
+
+    Pca9685Backend(std::unique_ptr<I2cBus> i2c, int first_address = 0x40)
+        : bus(std::move(i2c)), base_address(first_address) {
+        for (int i = 0; i < MAX_GPIO_PIN; ++i) {
+            desired[i].store(FULL_OFF, std::memory_order_relaxed);
+            sent[i] = FULL_OFF;
+        }
+    }
+
+    Pca9685Backend(const Pca9685Backend&) = delete;
+    Pca9685Backend& operator=(const Pca9685Backend&) = delete;
+
+    const char* name() const override {
+        return "pca9685";
+    }
+
+    // Prescaler for a PWM period, clamped to the chip's 3..255
+    static std::uint8_t prescale_for(std::uint32_t period_ns) {
+        const double value = std::round(static_cast<double>(OSCILLATOR_HZ) * (period_ns / 1e9) / 4096.0) - 1.0;
+        return static_cast<std::uint8_t>(std::clamp(value, 3.0, 255.0));
+    }
+
+    // Period the oscillator actually produces with a prescaler
+    static std::uint32_t period_for(std::uint8_t prescale) {
+        return static_cast<std::uint32_t>((prescale + 1ull) * 4096ull * 1000000000ull / OSCILLATOR_HZ);
+    }
+
+    // The first channel of a board sets its frequency; later channels must
+    // ask for the same prescaler
+    bool setup(int pin, std::uint32_t period_ns) override {
+        if (pin < 0 || pin >= MAX_GPIO_PIN || !bus) {
+            return false;
+        }
+        const int board = pin / CHANNELS;
+        const std::uint8_t prescale = prescale_for(period_ns);
+        if (board_periods[board] == 0) {
+            if (!init_board(board, prescale)) {
+                return false;
+            }
+            board_periods[board] = period_for(prescale);
+        } else if (period_for(prescale) != board_periods[board]) {
+            return false;
+        }
+        used[pin] = true;
+        return true;
+    }
+
+    void write(int pin, std::uint32_t pulse_ns) override {
+        if (pin < 0 || pin >= MAX_GPIO_PIN || !used[pin]) {
+            return;
+        }
+        const std::uint64_t period = board_periods[pin / CHANNELS];
+        std::uint64_t counts = (static_cast<std::uint64_t>(pulse_ns) * 4096 + period / 2) / period;
+        desired[pin].store(static_cast<std::uint16_t>(std::min<std::uint64_t>(counts, 4095)),
+                           std::memory_order_release);
+    }
+
+    void flush() override {
+        // Single flusher: a flush that finds another one running leaves its
+        // request behind, and the running one goes again
+        flush_again.store(true);
+        while (flush_again.load() && !flushing.test_and_set()) {
+            flush_again.store(false);
+            send_changes();
+            flushing.clear();
+        }
+    }
+
+    // Full off: the ESC sees no pulses at all
+    void release(int pin) override {
+        if (pin < 0 || pin >= MAX_GPIO_PIN || !used[pin]) {
+            return;
+        }
+        used[pin] = false;
+        desired[pin].store(FULL_OFF, std::memory_order_release);
+        flush();
+    }
+
+    Stats stats() const {
+        Stats s;
+        s.bursts = bursts.load(std::memory_order_relaxed);
+        s.channels = channels_sent.load(std::memory_order_relaxed);
+        s.skipped = skipped.load(std::memory_order_relaxed);
+        s.errors = errors.load(std::memory_order_relaxed);
+        s.last_bus_ns = last_bus_ns.load(std::memory_order_relaxed);
+        s.max_bus_ns = max_bus_ns.load(std::memory_order_relaxed);
+        s.total_bus_ns = total_bus_ns.load(std::memory_order_relaxed);
+        return s;
+    }
+
+    // Bus time per burst (one per control cycle with changes)
+    std::string summary() const override {
+        const Stats s = stats();
+        char buf[192];
+        std::snprintf(buf, sizeof(buf),
+                      "I2c(bursts:%llu channels:%llu unchanged:%llu errors:%llu bus_us_last:%.1f "
+                      "bus_us_avg:%.1f bus_us_max:%.1f)",
+                      static_cast<unsigned long long>(s.bursts), static_cast<unsigned long long>(s.channels),
+                      static_cast<unsigned long long>(s.skipped), static_cast<unsigned long long>(s.errors),
+                      s.last_bus_ns / 1000.0, s.bursts ? s.total_bus_ns / 1000.0 / s.bursts : 0.0,
+                      s.max_bus_ns / 1000.0);
+        return buf;
+    }
+
+private:
+    // One message per run of adjacent changed channels; runs never cross boards
+    static constexpr std::size_t MAX_MESSAGES = MAX_BOARDS * CHANNELS / 2;
+
+    std::unique_ptr<I2cBus> bus;
+    const int base_address;
+    std::uint32_t board_periods[MAX_BOARDS] = {};
+    bool used[MAX_GPIO_PIN] = {};
+
+    std::atomic<std::uint16_t> desired[MAX_GPIO_PIN];
+    std::uint16_t sent[MAX_GPIO_PIN];          // owned by the flusher
+    std::atomic_flag flushing = ATOMIC_FLAG_INIT;
+    std::atomic<bool> flush_again{false};
+
+    std::uint8_t buffer[MAX_GPIO_PIN * 4 + MAX_MESSAGES];
+    I2cMessage messages[MAX_MESSAGES];
+
+    std::atomic<std::uint64_t> bursts{0};
+    std::atomic<std::uint64_t> channels_sent{0};
+    std::atomic<std::uint64_t> skipped{0};
+    std::atomic<std::uint64_t> errors{0};
+    std::atomic<std::uint64_t> last_bus_ns{0};
+    std::atomic<std::uint64_t> max_bus_ns{0};
+    std::atomic<std::uint64_t> total_bus_ns{0};
+
+    static std::int64_t now_ns() {
+        timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return static_cast<std::int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+    }
+
+    bool write_register(int board, std::uint8_t reg, std::uint8_t value) {
+        const std::uint8_t data[2] = {reg, value};
+        const I2cMessage message{static_cast<std::uint16_t>(base_address + board), 2, data};
+        return bus->transfer(&message, 1);
+    }
+
+    // The prescaler is only writable in sleep mode; the oscillator needs
+    // 500 us after waking up
+    bool init_board(int board, std::uint8_t prescale) {
+        bool ok = write_register(board, MODE1, MODE1_SLEEP | MODE1_AI | MODE1_ALLCALL) &&
+                  write_register(board, PRE_SCALE, prescale) &&
+                  write_register(board, MODE2, MODE2_OUTDRV) &&
+                  write_register(board, MODE1, MODE1_AI | MODE1_ALLCALL);
+        std::this_thread::sleep_for(std::chrono::microseconds(500));
+        return ok;
+    }
+
+    void send_changes() {
+        std::uint16_t values[MAX_GPIO_PIN];
+        std::size_t count = 0;
+        std::size_t bytes = 0;
+        std::size_t changed = 0;
+        for (int board = 0; board < MAX_BOARDS; ++board) {
+            if (board_periods[board] == 0) {
+                continue;
+            }
+            int run_start = -1;
+            for (int channel = 0; channel <= CHANNELS; ++channel) {
+                const int pin = board * CHANNELS + channel;
+                const bool dirty = channel < CHANNELS &&
+                    (values[pin] = desired[pin].load(std::memory_order_acquire)) != sent[pin];
+                if (dirty && run_start < 0) {
+                    run_start = channel;
+                    messages[count] = I2cMessage{static_cast<std::uint16_t>(base_address + board), 1, buffer + bytes};
+                    buffer[bytes++] = static_cast<std::uint8_t>(LED0_ON_L + 4 * channel);
+                }
+                if (dirty) {
+                    // ON at 0, OFF after the pulse (full off in bit 12)
+                    buffer[bytes++] = 0;
+                    buffer[bytes++] = 0;
+                    buffer[bytes++] = static_cast<std::uint8_t>(values[pin] & 0xFF);
+                    buffer[bytes++] = static_cast<std::uint8_t>(values[pin] >> 8);
+                    messages[count].length += 4;
+                    ++changed;
+                } else if (run_start >= 0) {
+                    run_start = -1;
+                    ++count;
+                }
+            }
+        }
+        if (count == 0) {
+            skipped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+
+        const std::int64_t start = now_ns();
+        const bool ok = bus->transfer(messages, count);
+        const std::uint64_t elapsed = static_cast<std::uint64_t>(now_ns() - start);
+        if (!ok) {
+            // Sent values stay stale: the next flush retries them
+            errors.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        for (std::size_t m = 0; m < count; ++m) {
+            const int pin = (messages[m].address - base_address) * CHANNELS + (messages[m].data[0] - LED0_ON_L) / 4;
+            for (int i = 0; i < (messages[m].length - 1) / 4; ++i) {
+                sent[pin + i] = values[pin + i];
+            }
+        }
+        bursts.fetch_add(1, std::memory_order_relaxed);
+        channels_sent.fetch_add(changed, std::memory_order_relaxed);
+        last_bus_ns.store(elapsed, std::memory_order_relaxed);
+        total_bus_ns.fetch_add(elapsed, std::memory_order_relaxed);
+        if (elapsed > max_bus_ns.load(std::memory_order_relaxed)) {
+            max_bus_ns.store(elapsed, std::memory_order_relaxed);
+        }
+    }
+};
+
+// Register model of PCA9685 boards on a bus: auto-increment, sleep and
+// prescaler rules, and a log of transactions for tests
+class FakeI2cBus : public I2cBus {
+public:
+    struct Transaction {
+        std::size_t messages;
+        std::size_t bytes;
+    };
+
+    void add_device(std::uint16_t address) {
+        std::lock_guard<std::mutex> lock(mutex);
+        devices[address].fill(0);
+        devices[address][Pca9685Backend::MODE1] = Pca9685Backend::MODE1_SLEEP | Pca9685Backend::MODE1_ALLCALL;
+        devices[address][Pca9685Backend::PRE_SCALE] = 0x1E;
+    }
+
+    // Refuse (NACK) every following transaction
+    void set_failing(bool fail) {
+        std::lock_guard<std::mutex> lock(mutex);
+        failing = fail;
+    }
+
+    bool transfer(const I2cMessage* messages, std::size_t count) override {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (failing) {
+            return false;
+        }
+        for (std::size_t i = 0; i < count; ++i) {
+            if (devices.find(messages[i].address) == devices.end() || messages[i].length == 0) {
+                return false;
+            }
+        }
+        std::size_t bytes = 0;
+        for (std::size_t i = 0; i < count; ++i) {
+            auto& regs = devices[messages[i].address];
+            std::uint8_t reg = messages[i].data[0];
+            for (std::size_t b = 1; b < messages[i].length; ++b) {
+                // The prescaler ignores writes while the oscillator runs
+                if (reg != Pca9685Backend::PRE_SCALE || (regs[Pca9685Backend::MODE1] & Pca9685Backend::MODE1_SLEEP)) {
+                    regs[reg] = messages[i].data[b];
+                }
+                if (regs[Pca9685Backend::MODE1] & Pca9685Backend::MODE1_AI) {
+                    reg = static_cast<std::uint8_t>(reg + 1);
+                }
+            }
+            bytes += messages[i].length;
+        }
+        log.push_back(Transaction{count, bytes});
+        return true;
+    }
+
+    std::uint8_t reg(std::uint16_t address, std::uint8_t reg) const {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = devices.find(address);
+        return it == devices.end() ? 0 : it->second[reg];
+    }
+
+    // LEDn_OFF as written (12-bit count, 0x1000 full off)
+    std::uint16_t off_count(std::uint16_t address, int channel) const {
+        const std::uint8_t base = static_cast<std::uint8_t>(Pca9685Backend::LED0_ON_L + 4 * channel);
+        return static_cast<std::uint16_t>(reg(address, base + 2) | (reg(address, base + 3) << 8));
+    }
+
+    std::vector<Transaction> transactions() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return log;
+    }
+
+    void clear_transactions() {
+        std::lock_guard<std::mutex> lock(mutex);
+        log.clear();
+    }
+
+private:
+    mutable std::mutex mutex;
+    std::map<std::uint16_t, std::array<std::uint8_t, 256>> devices;
+    std::vector<Transaction> log;
+    bool failing = false;
+};
+
+#endif // KART_PCA9685_H
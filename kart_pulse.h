@@ -0,0 +1,211 @@
+/*
+ * Speed to pulse width conversion for ESC outputs
+ * ===============================================
+ *
+ * The speed -> pulse mapping of a motor is linear on each side of neutral.
+ * PulseParams holds it in fixed point, computed once per motor when the
+ * configuration is loaded, so the per-cycle conversion is one float to int
+ * conversion, a multiply and a shift:
+ *
+ *   pulse_ns = neutral_ns + (speed_cp * slope_q16) >> 16
+ *
+ * where speed_cp is the speed in 0.01 % steps (-10000..10000, clamped) and
+ * slope_q16 the forward or reverse slope in ns per step, scaled by 2^16.
+ *
+ * Everything is constexpr, so ESC profiles that are known at compile time
+ * (EscProfile, FixedEsc<>) fold into constants.
+ *
+ * DShot motors use the same parameters for the digital throttle: the
+ * output value is then the 16-bit DShot frame (throttle, telemetry bit and
+ * checksum) instead of a pulse width, in 3D (bidirectional) mode:
+ *
+ *   0 stop, 48..1047 reverse (slow..fast), 1048..2047 forward (slow..fast)
+ *
+ * The waveform of a frame is made by kart_dshot.h.
+ */
+
+#ifndef KART_PULSE_H
+#define KART_PULSE_H
+
+#include <algorithm>
+#include <cstdint>
+#include <string_view>
+
+// Speed resolution: 0.01 % per step
+static constexpr std::int32_t SPEED_STEPS_PER_PERCENT = 100;
+static constexpr std::int32_t SPEED_STEPS_FULL = 100 * SPEED_STEPS_PER_PERCENT;
+
+// Signal an ESC understands; set per motor ([motor_*] protocol)
+enum class EscProtocol : std::uint8_t { PWM, ONESHOT125, ONESHOT42, MULTISHOT, DSHOT150, DSHOT300, DSHOT600 };
+
+constexpr bool is_dshot(EscProtocol protocol) {
+    return protocol >= EscProtocol::DSHOT150;
+}
+
+constexpr const char* esc_protocol_name(EscProtocol protocol) {
+    switch (protocol) {
+        case EscProtocol::PWM: return "pwm";
+        case EscProtocol::ONESHOT125: return "oneshot125";
+        case EscProtocol::ONESHOT42: return "oneshot42";
+        case EscProtocol::MULTISHOT: return "multishot";
+        case EscProtocol::DSHOT150: return "dshot150";
+        case EscProtocol::DSHOT300: return "dshot300";
+        case EscProtocol::DSHOT600: return "dshot600";
+    }
+    return "unknown";
+}
+
+constexpr bool parse_esc_protocol(std::string_view name, EscProtocol& protocol) {
+    for (std::uint8_t p = 0; p <= static_cast<std::uint8_t>(EscProtocol::DSHOT600); ++p) {
+        if (name == esc_protocol_name(static_cast<EscProtocol>(p))) {
+            protocol = static_cast<EscProtocol>(p);
+            return true;
+        }
+    }
+    return false;
+}
+
+struct PulseParams {
+    std::uint32_t neutral_ns;         // DShot: stop frame
+    std::uint32_t period_ns;          // DShot: frame length
+    std::int32_t forward_slope_q16;   // ns per speed step << 16 (speed > 0); DShot: throttle steps
+    std::int32_t reverse_slope_q16;   // ns per speed step << 16 (speed < 0)
+    EscProtocol protocol = EscProtocol::PWM;
+};
+
+// Pulse widths of an ESC protocol, all in nanoseconds
+struct EscProfile {
+    std::uint32_t min_ns;
+    std::uint32_t neutral_ns;
+    std::uint32_t max_ns;
+    std::uint32_t period_ns;
+};
+
+// Common analog ESC protocols (bidirectional: neutral in the middle)
+static constexpr EscProfile ESC_STANDARD_PWM{1000000, 1500000, 2000000, 20000000};   // 50 Hz servo PWM
+static constexpr EscProfile ESC_ONESHOT125{125000, 187500, 250000, 500000};         // up to 2 kHz
+static constexpr EscProfile ESC_ONESHOT42{42000, 63000, 84000, 125000};             // up to 8 kHz
+static constexpr EscProfile ESC_MULTISHOT{5000, 15000, 25000, 40000};               // up to 25 kHz
+
+// Pulse widths of an analog protocol (DShot motors have none)
+constexpr EscProfile esc_profile(EscProtocol protocol) {
+    switch (protocol) {
+        case EscProtocol::ONESHOT125: return ESC_ONESHOT125;
+        case EscProtocol::ONESHOT42: return ESC_ONESHOT42;
+        case EscProtocol::MULTISHOT: return ESC_MULTISHOT;
+        default: return ESC_STANDARD_PWM;
+    }
+}
+
+// DShot 3D throttle values and frame layout: 11-bit value, telemetry
+// request bit, 4-bit checksum of the 12 bits before it
+static constexpr std::uint16_t DSHOT_STOP = 0;
+static constexpr std::uint16_t DSHOT_REVERSE_MIN = 48;
+static constexpr std::uint16_t DSHOT_FORWARD_MIN = 1048;
+static constexpr std::uint16_t DSHOT_THROTTLE_SPAN = 999;    // slowest to fastest of a direction
+static constexpr int DSHOT_FRAME_BITS = 16;
+
+constexpr std::uint32_t dshot_bitrate(EscProtocol protocol) {
+    switch (protocol) {
+        case EscProtocol::DSHOT150: return 150000;
+        case EscProtocol::DSHOT300: return 300000;
+        case EscProtocol::DSHOT600: return 600000;
+        default: return 0;
+    }
+}
+
+constexpr std::uint16_t dshot_checksum(std::uint16_t packet) {
+    return static_cast<std::uint16_t>((packet ^ (packet >> 4) ^ (packet >> 8)) & 0x0F);
+}
+
+constexpr std::uint16_t dshot_frame(std::uint16_t value, bool telemetry = false) {
+    const std::uint16_t packet = static_cast<std::uint16_t>((value << 1) | (telemetry ? 1 : 0));
+    return static_cast<std::uint16_t>((packet << 4) | dshot_checksum(packet));
+}
+
+constexpr bool dshot_frame_valid(std::uint16_t frame) {
+    return dshot_checksum(static_cast<std::uint16_t>(frame >> 4)) == (frame & 0x0F);
+}
+
+constexpr std::uint16_t dshot_frame_value(std::uint16_t frame) {
+    return static_cast<std::uint16_t>(frame >> 5);
+}
+
+constexpr std::int32_t pulse_slope_q16(std::uint32_t from_ns, std::uint32_t to_ns) {
+    const std::int64_t span = static_cast<std::int64_t>(to_ns) - static_cast<std::int64_t>(from_ns);
+    const std::int64_t scaled = span * 65536;
+    // Round to nearest (span is never negative here)
+    return static_cast<std::int32_t>((scaled + SPEED_STEPS_FULL / 2) / SPEED_STEPS_FULL);
+}
+
+constexpr PulseParams make_pulse_params(const EscProfile& profile) {
+    return PulseParams{profile.neutral_ns, profile.period_ns,
+                       pulse_slope_q16(profile.neutral_ns, profile.max_ns),
+                       pulse_slope_q16(profile.min_ns, profile.neutral_ns)};
+}
+
+// Pulse widths given in milliseconds (MotorConfig) and a frequency in Hz
+constexpr PulseParams make_pulse_params(double min_ms, double neutral_ms, double max_ms, int frequency) {
+    auto to_ns = [](double ms) { return static_cast<std::uint32_t>(ms * 1e6 + 0.5); };
+    return make_pulse_params(EscProfile{to_ns(min_ms), to_ns(neutral_ms), to_ns(max_ms),
+                                        1000000000u / static_cast<std::uint32_t>(std::max(frequency, 1))});
+}
+
+constexpr PulseParams make_dshot_params(EscProtocol protocol) {
+    const std::int32_t slope = pulse_slope_q16(0, DSHOT_THROTTLE_SPAN);
+    return PulseParams{dshot_frame(DSHOT_STOP), 1000000000u / dshot_bitrate(protocol) * DSHOT_FRAME_BITS,
+                       slope, slope, protocol};
+}
+
+// Speed percentage to fixed-point speed steps (truncated, clamped to +-100 %)
+constexpr std::int32_t speed_to_steps(double speed) {
+    const double steps = speed * SPEED_STEPS_PER_PERCENT;
+    const double clamped = steps > SPEED_STEPS_FULL ? SPEED_STEPS_FULL : (steps < -SPEED_STEPS_FULL ? -SPEED_STEPS_FULL : steps);
+    return static_cast<std::int32_t>(clamped);
+}
+
+// DShot frame for a speed; any non-zero speed is at least the slowest throttle
+constexpr std::uint32_t dshot_output(const PulseParams& params, std::int32_t steps) {
+    if (steps == 0) {
+        return params.neutral_ns;
+    }
+    const std::int32_t magnitude = steps > 0 ? steps : -steps;
+    const std::int32_t slope = steps > 0 ? params.forward_slope_q16 : params.reverse_slope_q16;
+    const std::int64_t offset = (static_cast<std::int64_t>(magnitude) * slope + (1 << 15)) >> 16;
+    const std::int64_t base = steps > 0 ? DSHOT_FORWARD_MIN : DSHOT_REVERSE_MIN;
+    return dshot_frame(static_cast<std::uint16_t>(base + offset));
+}
+
+// Output value of a motor: pulse width in ns, or the DShot frame
+constexpr std::uint32_t pulse_ns(const PulseParams& params, std::int32_t steps) {
+    if (is_dshot(params.protocol)) {
+        return dshot_output(params, steps);
+    }
+    const std::int32_t slope = steps >= 0 ? params.forward_slope_q16 : params.reverse_slope_q16;
+    const std::int64_t offset = (static_cast<std::int64_t>(steps) * slope + (1 << 15)) >> 16;
+    return static_cast<std::uint32_t>(static_cast<std::int64_t>(params.neutral_ns) + offset);
+}
+
+constexpr std::uint32_t pulse_ns(const PulseParams& params, double speed) {
+    return pulse_ns(params, speed_to_steps(speed));
+}
+
+// Compile-time ESC profile: FixedEsc<ESC_ONESHOT125>::pulse(speed)
+template <EscProfile Profile>
+struct FixedEsc {
+    static constexpr PulseParams params = make_pulse_params(Profile);
+
+    static constexpr std::uint32_t pulse(double speed) {
+        return pulse_ns(params, speed);
+    }
+};
+
+static_assert(FixedEsc<ESC_STANDARD_PWM>::pulse(0.0) == 1500000, "neutral");
+static_assert(FixedEsc<ESC_STANDARD_PWM>::pulse(100.0) == 2000000, "full forward");
+static_assert(FixedEsc<ESC_STANDARD_PWM>::pulse(-100.0) == 1000000, "full reverse");
+static_assert(FixedEsc<ESC_ONESHOT125>::pulse(50.0) == 218750, "half forward");
+static_assert(dshot_frame(1046) == 0x82C6, "DShot checksum");
+static_assert(pulse_ns(make_dshot_params(EscProtocol::DSHOT600), 100.0) == dshot_frame(2047), "DShot full forward");
+static_assert(pulse_ns(make_dshot_params(EscProtocol::DSHOT600), -100.0) == dshot_frame(1047), "DShot full reverse");
+
+#endif // KART_PULSE_H
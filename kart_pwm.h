@@ -0,0 +1,220 @@
+/*
+ * PWM output backends for ESC signals
+ * ===================================
+ *
+ * ESCController drives its outputs through the PwmBackend interface with
+ * pulse widths in nanoseconds. Backends:
+ *
+ * - SysfsPwmBackend: hardware PWM peripheral via /sys/class/pwm
+ *   (nanosecond period/duty, no CPU load, jitter-free pulses).
+ *   The sysfs root is configurable so that it can run against a fake tree.
+ * - SoftPwmBackend (kart_controller.h): wiringPi softPwm fallback for pins
+ *   without a hardware PWM channel of their own (100 us resolution).
+ *
+ * - Pca9685Backend (kart_pca9685.h): PCA9685 boards on I2C, 16 channels
+ *   each, written in one burst per cycle.
+ * - DshotBackend (kart_dshot.h): DShot frames as hardware-clocked bit
+ *   streams, other pins through a wrapped analog backend.
+ *
+ * Pins prepared with setup_dshot() take the 16-bit DShot frame in write()
+ * instead of a pulse width (see pulse_ns() in kart_pulse.h).
+ *
+ * write() is called from the control thread once per motor and cycle and
+ * must not block, allocate or take locks. Backends that batch send the
+ * writes on flush(), which follows every group of writes (control cycle,
+ * emergency stop); it may run on two threads at once.
+ */
+
+#ifndef KART_PWM_H
+#define KART_PWM_H
+
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "kart_pulse.h"
+
+// Highest BCM GPIO number a backend has to handle
+static constexpr int MAX_GPIO_PIN = 64;
+
+class PwmBackend {
+public:
+    virtual ~PwmBackend() = default;
+
+    virtual const char* name() const = 0;
+
+    // Prepare pin for pulses with the given period; returns false on failure
+    virtual bool setup(int pin, std::uint32_t period_ns) = 0;
+
+    // Prepare pin for DShot frames; only waveform backends can send them
+    virtual bool setup_dshot(int pin, EscProtocol protocol) {
+        (void)pin;
+        (void)protocol;
+        return false;
+    }
+
+    // Set the pulse width of a pin prepared with setup() (the frame for
+    // setup_dshot())
+    virtual void write(int pin, std::uint32_t pulse_ns) = 0;
+
+    // Send writes buffered since the previous flush
+    virtual void flush() {}
+
+    // Stop driving the pin
+    virtual void release(int pin) {
+        (void)pin;
+    }
+
+    // One-line statistics for status output, empty if none
+    virtual std::string summary() const {
+        return std::string();
+    }
+};
+
+// Hardware PWM through the Linux sysfs PWM interface
+class SysfsPwmBackend : public PwmBackend {
+private:
+    static constexpr int CHANNELS = 2;
+
+    std::string chip_path;
+    int duty_fds[MAX_GPIO_PIN];
+    int channels[MAX_GPIO_PIN];
+    int owners[CHANNELS];       // pin set up on each channel, -1 if free
+
+    static bool write_file(const std::string& path, unsigned long value) {
+        int fd = ::open(path.c_str(), O_WRONLY | O_CLOEXEC);
+        if (fd < 0) {
+            return false;
+        }
+        char buf[24];
+        int len = std::snprintf(buf, sizeof(buf), "%lu\n", value);
+        bool ok = ::write(fd, buf, static_cast<std::size_t>(len)) == len;
+        ::close(fd);
+        return ok;
+    }
+
+    static bool exists(const std::string& path) {
+        struct stat st;
+        return ::stat(path.c_str(), &st) == 0;
+    }
+
+    std::string channel_path(int channel) const {
+        return chip_path + "/pwm" + std::to_string(channel);
+    }
+
+public:
+    explicit SysfsPwmBackend(const std::string& sysfs_root = "/sys/class/pwm", int chip = 0)
+        : chip_path(sysfs_root + "/pwmchip" + std::to_string(chip)) {
+        for (int pin = 0; pin < MAX_GPIO_PIN; ++pin) {
+            duty_fds[pin] = -1;
+            channels[pin] = -1;
+        }
+        for (int channel = 0; channel < CHANNELS; ++channel) {
+            owners[channel] = -1;
+        }
+    }
+
+    ~SysfsPwmBackend() override {
+        for (int fd : duty_fds) {
+            if (fd >= 0) {
+                ::close(fd);
+            }
+        }
+    }
+
+    SysfsPwmBackend(const SysfsPwmBackend&) = delete;
+    SysfsPwmBackend& operator=(const SysfsPwmBackend&) = delete;
+
+    const char* name() const override {
+        return "sysfs-pwm";
+    }
+
+    // PWM channel of the BCM283x/BCM2711 PWM peripheral routed to a GPIO
+    static int channel_for_pin(int pin) {
+        switch (pin) {
+            case 12: case 18: case 40:
+                return 0;
+            case 13: case 19: case 41: case 45:
+                return 1;
+            default:
+                return -1;
+        }
+    }
+
+    // True if the PWM chip is present (overlay loaded)
+    bool available() const {
+        return exists(chip_path + "/export");
+    }
+
+    bool setup(int pin, std::uint32_t period_ns) override {
+        int channel = channel_for_pin(pin);
+        if (pin < 0 || pin >= MAX_GPIO_PIN || channel < 0) {
+            return false;
+        }
+        // One duty cycle per channel: a second pin would take over the first
+        if (owners[channel] >= 0 && owners[channel] != pin) {
+            return false;
+        }
+
+        std::string path = channel_path(channel);
+        if (!exists(path)) {
+            if (!write_file(chip_path + "/export", static_cast<unsigned long>(channel))) {
+                return false;
+            }
+            // udev creates the channel directory asynchronously
+            for (int i = 0; i < 50 && !exists(path + "/period"); ++i) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            }
+        }
+
+        // A period below the current duty cycle is rejected, so clear duty first
+        write_file(path + "/duty_cycle", 0);
+        if (!write_file(path + "/period", period_ns) || !write_file(path + "/enable", 1)) {
+            return false;
+        }
+
+        if (duty_fds[pin] >= 0) {
+            ::close(duty_fds[pin]);
+        }
+        duty_fds[pin] = ::open((path + "/duty_cycle").c_str(), O_WRONLY | O_CLOEXEC);
+        channels[pin] = channel;
+        owners[channel] = pin;
+        return duty_fds[pin] >= 0;
+    }
+
+    void write(int pin, std::uint32_t pulse_ns) override {
+        if (pin < 0 || pin >= MAX_GPIO_PIN || duty_fds[pin] < 0) {
+            return;
+        }
+        // Format without locale or allocation: decimal digits plus newline
+        char buf[12];
+        int pos = sizeof(buf);
+        buf[--pos] = '\n';
+        do {
+            buf[--pos] = static_cast<char>('0' + pulse_ns % 10);
+            pulse_ns /= 10;
+        } while (pulse_ns != 0);
+        ssize_t ignored = ::pwrite(duty_fds[pin], buf + pos, sizeof(buf) - static_cast<std::size_t>(pos), 0);
+        (void)ignored;
+    }
+
+    void release(int pin) override {
+        if (pin < 0 || pin >= MAX_GPIO_PIN || channels[pin] < 0) {
+            return;
+        }
+        write_file(channel_path(channels[pin]) + "/enable", 0);
+        if (duty_fds[pin] >= 0) {
+            ::close(duty_fds[pin]);
+            duty_fds[pin] = -1;
+        }
+        owners[channels[pin]] = -1;
+        channels[pin] = -1;
+    }
+};
+
+#endif // KART_PWM_H
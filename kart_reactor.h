@@ -0,0 +1,239 @@
+/*
+ * Single-threaded event loop for the kart controller (--reactor)
+ * ==============================================================
+ *
+ * Multiplexes everything that is not hard real-time on one thread with
+ * epoll: file descriptors (stdin, inotify, command sockets, the emergency
+ * stop eventfd), timers (timerfd) and signals (signalfd). Handlers run on
+ * the reactor thread one at a time, so they need no locking among
+ * themselves, and the thread only wakes up when something happens.
+ *
+ * Signals passed to add_signals() are blocked for the calling thread and
+ * every thread it creates afterwards, so call it from main() before any
+ * other thread is started. They then arrive as ordinary events and the
+ * handler may do anything, including shutting down.
+ *
+ * stop() may be called from any thread or signal handler.
+ */
+
+#ifndef KART_REACTOR_H
+#define KART_REACTOR_H
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <map>
+#include <memory>
+#include <pthread.h>
+#include <signal.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/signalfd.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+class Reactor {
+public:
+    using Handler = std::function<void(std::uint32_t events)>;
+
+    struct Stats {
+        std::uint64_t wakeups = 0;
+        std::uint64_t events = 0;
+    };
+
+    Reactor() {
+        epoll_fd = ::epoll_create1(EPOLL_CLOEXEC);
+        stop_fd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (epoll_fd >= 0 && stop_fd >= 0) {
+            add(stop_fd, EPOLLIN, [this](std::uint32_t) {
+                std::uint64_t value;
+                ssize_t ignored = ::read(stop_fd, &value, sizeof(value));
+                (void)ignored;
+            });
+        }
+    }
+
+    ~Reactor() {
+        for (const auto& [fd, entry] : entries) {
+            if (entry->owned) {
+                ::close(fd);
+            }
+        }
+        if (stop_fd >= 0) {
+            ::close(stop_fd);
+        }
+        if (epoll_fd >= 0) {
+            ::close(epoll_fd);
+        }
+    }
+
+    Reactor(const Reactor&) = delete;
+    Reactor& operator=(const Reactor&) = delete;
+
+    bool valid() const {
+        return epoll_fd >= 0 && stop_fd >= 0;
+    }
+
+    // Watch a descriptor owned by the caller (EPOLLIN, EPOLLOUT, ...)
+    bool add(int fd, std::uint32_t events, Handler handler) {
+        return add_entry(fd, events, std::move(handler), false);
+    }
+
+    // Stop watching; safe from inside a handler
+    void remove(int fd) {
+        auto it = entries.find(fd);
+        if (it == entries.end()) {
+            return;
+        }
+        ::epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, nullptr);
+        if (it->second->owned) {
+            ::close(fd);
+        }
+        entries.erase(it);
+    }
+
+    // Periodic timer, disarmed while interval is zero. Returns a timer id
+    // for set_timer()/remove(), or -1.
+    int add_timer(std::chrono::nanoseconds interval, std::function<void()> on_expire) {
+        int fd = ::timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+        if (fd < 0) {
+            return -1;
+        }
+        auto handler = [fd, on_expire = std::move(on_expire)](std::uint32_t) {
+            std::uint64_t expirations;
+            if (::read(fd, &expirations, sizeof(expirations)) == sizeof(expirations)) {
+                on_expire();
+            }
+        };
+        if (!add_entry(fd, EPOLLIN, std::move(handler), true)) {
+            ::close(fd);
+            return -1;
+        }
+        set_timer(fd, interval);
+        return fd;
+    }
+
+    // One-shot timer that removes itself after firing
+    int add_timeout(std::chrono::nanoseconds delay, std::function<void()> on_expire) {
+        auto shared = std::make_shared<int>(-1);
+        int fd = add_timer(std::chrono::nanoseconds::zero(), [this, shared, on_expire = std::move(on_expire)] {
+            remove(*shared);
+            on_expire();
+        });
+        if (fd < 0) {
+            return -1;
+        }
+        *shared = fd;
+        itimerspec spec{};
+        spec.it_value = to_timespec(delay > std::chrono::nanoseconds::zero() ? delay : std::chrono::nanoseconds(1));
+        ::timerfd_settime(fd, 0, &spec, nullptr);
+        return fd;
+    }
+
+    // Re-arm a periodic timer; zero disarms it
+    bool set_timer(int timer, std::chrono::nanoseconds interval) {
+        itimerspec spec{};
+        spec.it_value = to_timespec(interval);
+        spec.it_interval = spec.it_value;
+        return ::timerfd_settime(timer, 0, &spec, nullptr) == 0;
+    }
+
+    // Block the signals for this thread (and threads created from now on)
+    // and deliver them to on_signal through a signalfd
+    bool add_signals(std::initializer_list<int> signals, std::function<void(int)> on_signal) {
+        sigset_t mask;
+        sigemptyset(&mask);
+        for (int signo : signals) {
+            sigaddset(&mask, signo);
+        }
+        if (pthread_sigmask(SIG_BLOCK, &mask, nullptr) != 0) {
+            return false;
+        }
+        int fd = ::signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+        if (fd < 0) {
+            return false;
+        }
+        auto handler = [fd, on_signal = std::move(on_signal)](std::uint32_t) {
+            signalfd_siginfo info;
+            while (::read(fd, &info, sizeof(info)) == sizeof(info)) {
+                on_signal(static_cast<int>(info.ssi_signo));
+            }
+        };
+        if (!add_entry(fd, EPOLLIN, std::move(handler), true)) {
+            ::close(fd);
+            return false;
+        }
+        return true;
+    }
+
+    // Dispatch events until stop()
+    void run() {
+        epoll_event events[MAX_EVENTS];
+        while (!stopping.load()) {
+            int count = ::epoll_wait(epoll_fd, events, MAX_EVENTS, -1);
+            if (count < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                break;
+            }
+            ++stats.wakeups;
+            for (int i = 0; i < count && !stopping.load(); ++i) {
+                // A handler may have removed this entry already
+                auto it = entries.find(events[i].data.fd);
+                if (it == entries.end()) {
+                    continue;
+                }
+                std::shared_ptr<Entry> entry = it->second;
+                ++stats.events;
+                entry->handler(events[i].events);
+            }
+        }
+    }
+
+    void stop() {
+        stopping.store(true);
+        const std::uint64_t one = 1;
+        ssize_t ignored = ::write(stop_fd, &one, sizeof(one));
+        (void)ignored;
+    }
+
+    Stats statistics() const {
+        return stats;
+    }
+
+private:
+    static constexpr int MAX_EVENTS = 16;
+
+    struct Entry {
+        Handler handler;
+        bool owned;
+    };
+
+    int epoll_fd = -1;
+    int stop_fd = -1;
+    std::atomic<bool> stopping{false};
+    std::map<int, std::shared_ptr<Entry>> entries;
+    Stats stats;
+
+    bool add_entry(int fd, std::uint32_t events, Handler handler, bool owned) {
+        epoll_event event{};
+        event.events = events;
+        event.data.fd = fd;
+        if (::epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &event) != 0) {
+            return false;
+        }
+        entries[fd] = std::make_shared<Entry>(Entry{std::move(handler), owned});
+        return true;
+    }
+
+    static timespec to_timespec(std::chrono::nanoseconds duration) {
+        return timespec{static_cast<time_t>(duration.count() / 1000000000),
+                        static_cast<long>(duration.count() % 1000000000)};
+    }
+};
+
+#endif // KART_REACTOR_H
@@ -0,0 +1,386 @@
+/*
+ * Binary remote command interface for the kart controller
+ * =======================================================
+ *
+ * Remote clients (pit-lane tablet, autonomous stack) drive the controller
+ * with small datagrams over a Unix domain socket and/or UDP. Every packet
+ * is one complete command in a fixed little-endian layout:
+ *
+ *   offset  size  field
+ *        0     2  magic 0x4b52 ("KR")
+ *        2     1  version (REMOTE_PROTOCOL_VERSION)
+ *        3     1  flags (RemoteCommand::IMMEDIATE, EMERGENCY_STOP)
+ *        4     4  session: random per client start
+ *        8     4  sequence: +1 per packet of the session
+ *       12     4  motor mask: bit i set = a target for motor i follows
+ *       16   2*n  targets in 0.01 % units (-10000..10000), ascending motor
+ *                 order, one per set mask bit
+ *
+ * A packet with an empty mask is a heartbeat: like every accepted packet it
+ * keeps the watchdog from stopping the kart, but changes no target.
+ *
+ * Packets are parsed on the stack, without allocation. Per session only
+ * packets with a higher sequence than the last accepted one get through, so
+ * late or reordered datagrams never override a newer target. Emergency stop
+ * packets are applied even when stale: stopping late is still stopping.
+ */
+
+#ifndef KART_REMOTE_H
+#define KART_REMOTE_H
+
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <thread>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+static constexpr std::uint16_t REMOTE_MAGIC = 0x4b52;   // "KR"
+static constexpr std::uint8_t REMOTE_PROTOCOL_VERSION = 1;
+static constexpr std::size_t REMOTE_HEADER_BYTES = 16;
+static constexpr std::size_t REMOTE_MAX_MOTORS = 32;
+static constexpr std::size_t REMOTE_MAX_PACKET = REMOTE_HEADER_BYTES + 2 * REMOTE_MAX_MOTORS;
+static constexpr std::int16_t REMOTE_SPEED_SCALE = 100;   // targets are speed * 100
+
+// One decoded packet
+struct RemoteCommand {
+    enum Flags : std::uint8_t { IMMEDIATE = 1, EMERGENCY_STOP = 2 };
+
+    std::uint8_t flags = 0;
+    std::uint32_t session = 0;
+    std::uint32_t sequence = 0;
+    std::uint32_t motor_mask = 0;
+    std::int16_t targets[REMOTE_MAX_MOTORS] = {};   // indexed by motor, valid where the mask is set
+
+    bool immediate() const {
+        return flags & IMMEDIATE;
+    }
+
+    bool emergency_stop() const {
+        return flags & EMERGENCY_STOP;
+    }
+
+    bool heartbeat() const {
+        return motor_mask == 0 && !emergency_stop();
+    }
+
+    // Target of a motor in percent
+    double speed(std::size_t motor) const {
+        return static_cast<double>(targets[motor]) / REMOTE_SPEED_SCALE;
+    }
+};
+
+namespace remote_detail {
+
+inline std::uint16_t load_le16(const std::uint8_t* p) {
+    return static_cast<std::uint16_t>(p[0] | (p[1] << 8));
+}
+
+inline std::uint32_t load_le32(const std::uint8_t* p) {
+    return static_cast<std::uint32_t>(p[0]) | (static_cast<std::uint32_t>(p[1]) << 8) |
+           (static_cast<std::uint32_t>(p[2]) << 16) | (static_cast<std::uint32_t>(p[3]) << 24);
+}
+
+inline void store_le16(std::uint8_t* p, std::uint16_t value) {
+    p[0] = static_cast<std::uint8_t>(value);
+    p[1] = static_cast<std::uint8_t>(value >> 8);
+}
+
+inline void store_le32(std::uint8_t* p, std::uint32_t value) {
+    for (int i = 0; i < 4; ++i) {
+        p[i] = static_cast<std::uint8_t>(value >> (8 * i));
+    }
+}
+
+} // namespace remote_detail
+
+enum class RemoteParse { OK, TOO_SHORT, BAD_MAGIC, BAD_VERSION, BAD_LENGTH, BAD_TARGET };
+
+// Decode one datagram into `command`
+inline RemoteParse parse_remote_command(const std::uint8_t* data, std::size_t length, RemoteCommand& command) {
+    using namespace remote_detail;
+    if (length < REMOTE_HEADER_BYTES) {
+        return RemoteParse::TOO_SHORT;
+    }
+    if (load_le16(data) != REMOTE_MAGIC) {
+        return RemoteParse::BAD_MAGIC;
+    }
+    if (data[2] != REMOTE_PROTOCOL_VERSION) {
+        return RemoteParse::BAD_VERSION;
+    }
+    command.flags = data[3];
+    command.session = load_le32(data + 4);
+    command.sequence = load_le32(data + 8);
+    command.motor_mask = load_le32(data + 12);
+    if (length != REMOTE_HEADER_BYTES + 2 * static_cast<std::size_t>(__builtin_popcount(command.motor_mask))) {
+        return RemoteParse::BAD_LENGTH;
+    }
+    const std::uint8_t* target = data + REMOTE_HEADER_BYTES;
+    for (std::uint32_t mask = command.motor_mask; mask != 0; mask &= mask - 1, target += 2) {
+        const auto value = static_cast<std::int16_t>(load_le16(target));
+        if (value < -100 * REMOTE_SPEED_SCALE || value > 100 * REMOTE_SPEED_SCALE) {
+            return RemoteParse::BAD_TARGET;
+        }
+        command.targets[__builtin_ctz(mask)] = value;
+    }
+    return RemoteParse::OK;
+}
+
+// Client side: encode a command into `buffer` (REMOTE_MAX_PACKET bytes);
+// returns the packet length
+inline std::size_t encode_remote_command(const RemoteCommand& command, std::uint8_t* buffer) {
+    using namespace remote_detail;
+    store_le16(buffer, REMOTE_MAGIC);
+    buffer[2] = REMOTE_PROTOCOL_VERSION;
+    buffer[3] = command.flags;
+    store_le32(buffer + 4, command.session);
+    store_le32(buffer + 8, command.sequence);
+    store_le32(buffer + 12, command.motor_mask);
+    std::size_t length = REMOTE_HEADER_BYTES;
+    for (std::uint32_t mask = command.motor_mask; mask != 0; mask &= mask - 1, length += 2) {
+        store_le16(buffer + length, static_cast<std::uint16_t>(command.targets[__builtin_ctz(mask)]));
+    }
+    return length;
+}
+
+// Highest accepted sequence per session; the least recently used session
+// is forgotten when a new one shows up and all slots are taken
+class SequenceFilter {
+public:
+    static constexpr std::size_t MAX_SESSIONS = 8;
+
+    // True if the packet is newer than everything accepted for its session
+    bool accept(std::uint32_t session, std::uint32_t sequence) {
+        ++clock;
+        Slot* oldest = &slots[0];
+        for (Slot& slot : slots) {
+            if (slot.used && slot.session == session) {
+                // Serial number arithmetic: survives the 32-bit wrap
+                if (static_cast<std::int32_t>(sequence - slot.sequence) <= 0) {
+                    return false;
+                }
+                slot.sequence = sequence;
+                slot.last_used = clock;
+                return true;
+            }
+            if (!slot.used || (oldest->used && slot.last_used < oldest->last_used)) {
+                oldest = &slot;
+            }
+        }
+        *oldest = Slot{true, session, sequence, clock};
+        return true;
+    }
+
+private:
+    struct Slot {
+        bool used = false;
+        std::uint32_t session = 0;
+        std::uint32_t sequence = 0;
+        std::uint64_t last_used = 0;
+    };
+
+    Slot slots[MAX_SESSIONS];
+    std::uint64_t clock = 0;
+};
+
+// Unix domain and UDP datagram sockets feeding one handler. Either poll
+// unix_fd()/udp_fd() in an event loop and call receive(), or let start()
+// run a receive thread.
+class CommandSocket {
+public:
+    // Returns false if the command was rejected (emergency stop active,
+    // unknown motor, queue full)
+    using Handler = std::function<bool(const RemoteCommand&)>;
+
+    struct Stats {
+        std::uint64_t received;    // datagrams read
+        std::uint64_t accepted;    // handed to the handler and taken
+        std::uint64_t malformed;   // failed to parse
+        std::uint64_t stale;       // dropped by the sequence filter
+        std::uint64_t rejected;    // refused by the handler
+    };
+
+    CommandSocket() = default;
+
+    ~CommandSocket() {
+        stop();
+    }
+
+    CommandSocket(const CommandSocket&) = delete;
+    CommandSocket& operator=(const CommandSocket&) = delete;
+
+    // Bind a datagram socket at `path`, replacing a stale one. Only the
+    // owner may send (mode 0600, set before bind so that the socket is
+    // never reachable with the umask's mode); a missing directory is
+    // created private (0700).
+    bool open_unix(const std::string& path) {
+        sockaddr_un address{};
+        if (path.empty() || path.size() >= sizeof(address.sun_path)) {
+            return false;
+        }
+        address.sun_family = AF_UNIX;
+        std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+        const std::size_t slash = path.rfind('/');
+        if (slash != std::string::npos && slash > 0 && ::mkdir(path.substr(0, slash).c_str(), 0700) != 0 &&
+            errno != EEXIST) {
+            return false;
+        }
+        int fd = ::socket(AF_UNIX, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (fd < 0) {
+            return false;
+        }
+        ::unlink(path.c_str());
+        if (::fchmod(fd, 0600) != 0 || ::bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+            ::close(fd);
+            return false;
+        }
+        unix_socket = fd;
+        unix_path = path;
+        return true;
+    }
+
+    // Bind UDP on an IPv4 address; port 0 picks a free port (see udp_port())
+    bool open_udp(const std::string& ip, int port) {
+        sockaddr_in address{};
+        address.sin_family = AF_INET;
+        address.sin_port = htons(static_cast<std::uint16_t>(port));
+        if (::inet_pton(AF_INET, ip.c_str(), &address.sin_addr) != 1) {
+            return false;
+        }
+        int fd = ::socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (fd < 0) {
+            return false;
+        }
+        if (::bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+            ::close(fd);
+            return false;
+        }
+        udp_socket = fd;
+        return true;
+    }
+
+    int unix_fd() const {
+        return unix_socket;
+    }
+
+    int udp_fd() const {
+        return udp_socket;
+    }
+
+    int udp_port() const {
+        sockaddr_in address{};
+        socklen_t length = sizeof(address);
+        if (udp_socket < 0 || ::getsockname(udp_socket, reinterpret_cast<sockaddr*>(&address), &length) != 0) {
+            return -1;
+        }
+        return ntohs(address.sin_port);
+    }
+
+    // Read every pending datagram from fd; returns the number read. The
+    // sequence filter is not locked, so one thread receives at a time.
+    std::size_t receive(int fd, const Handler& handler) {
+        std::size_t count = 0;
+        std::uint8_t buffer[REMOTE_MAX_PACKET];
+        for (;;) {
+            // MSG_TRUNC reports the real size of an oversized datagram
+            ssize_t length = ::recv(fd, buffer, sizeof(buffer), MSG_TRUNC);
+            if (length < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                return count;
+            }
+            ++count;
+            received.fetch_add(1, std::memory_order_relaxed);
+
+            RemoteCommand command;
+            if (static_cast<std::size_t>(length) > sizeof(buffer) ||
+                parse_remote_command(buffer, static_cast<std::size_t>(length), command) != RemoteParse::OK) {
+                malformed.fetch_add(1, std::memory_order_relaxed);
+                continue;
+            }
+            if (!sequences.accept(command.session, command.sequence) && !command.emergency_stop()) {
+                stale.fetch_add(1, std::memory_order_relaxed);
+                continue;
+            }
+            if (handler(command)) {
+                accepted.fetch_add(1, std::memory_order_relaxed);
+            } else {
+                rejected.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // Receive on a background thread
+    bool start(Handler handler) {
+        if (unix_socket < 0 && udp_socket < 0) {
+            return false;
+        }
+        running.store(true);
+        thread = std::thread(&CommandSocket::run, this, std::move(handler));
+        return true;
+    }
+
+    // Join the thread (if any), close the sockets and remove the Unix socket file
+    void stop() {
+        running.store(false);
+        if (thread.joinable()) {
+            thread.join();
+        }
+        if (unix_socket >= 0) {
+            ::close(unix_socket);
+            ::unlink(unix_path.c_str());
+            unix_socket = -1;
+        }
+        if (udp_socket >= 0) {
+            ::close(udp_socket);
+            udp_socket = -1;
+        }
+    }
+
+    Stats stats() const {
+        return Stats{received.load(std::memory_order_relaxed), accepted.load(std::memory_order_relaxed),
+                     malformed.load(std::memory_order_relaxed), stale.load(std::memory_order_relaxed),
+                     rejected.load(std::memory_order_relaxed)};
+    }
+
+private:
+    int unix_socket = -1;
+    int udp_socket = -1;
+    std::string unix_path;
+    SequenceFilter sequences;
+    std::thread thread;
+    std::atomic<bool> running{false};
+
+    std::atomic<std::uint64_t> received{0};
+    std::atomic<std::uint64_t> accepted{0};
+    std::atomic<std::uint64_t> malformed{0};
+    std::atomic<std::uint64_t> stale{0};
+    std::atomic<std::uint64_t> rejected{0};
+
+    void run(Handler handler) {
+        pollfd fds[2] = {{unix_socket, POLLIN, 0}, {udp_socket, POLLIN, 0}};
+        while (running.load()) {
+            // Negative descriptors are ignored by poll(); the timeout only
+            // bounds how long stop() waits
+            if (::poll(fds, 2, 200) <= 0) {
+                continue;
+            }
+            for (const pollfd& entry : fds) {
+                if (entry.fd >= 0 && (entry.revents & POLLIN)) {
+                    receive(entry.fd, handler);
+                }
+            }
+        }
+    }
+};
+
+#endif // KART_REMOTE_H
@@ -0,0 +1,129 @@
+/*
+ * Replay a control loop trace through the controller
+ * ===================================================
+ *
+ * Reads a trace written by kart_control ([trace] in kart_config.ini) or
+ * kart_sim --trace, feeds its commands and emergency stops back through
+ * ESCController on the traced cycle times, as fast as possible, and reports
+ * every cycle whose speeds or pulses differ from the recording. Exits with
+ * 1 on differences, so a trace from the track becomes a regression test.
+ *
+ * Usage: kart_replay [--config FILE] [--dump] TRACE
+ *   --config FILE  configuration the trace was recorded with
+ *                  (default: built-in defaults)
+ *   --dump         print the records as text instead of replaying
+ *
+ * Compile with: g++ -std=c++20 -pthread -DTEST_MODE -o kart_replay kart_replay.cpp -lrt
+ */
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include "kart_sim.h"
+
+static Logger::Options replay_log_options() {
+    Logger::Options options = Logger::default_options();
+    options.text_path = "/tmp/kart_replay.log";
+    options.binary_path.clear();
+    options.console_output = false;
+    options.min_level = Logger::WARNING;
+    return options;
+}
+
+Logger g_logger(replay_log_options());
+
+static void dump(const TraceReader& reader) {
+    const TraceReader::Info& info = reader.header();
+    std::printf("# %llu records (capacity %llu%s), %u motors at %u Hz\n",
+                static_cast<unsigned long long>(reader.records().size()),
+                static_cast<unsigned long long>(info.capacity), reader.wrapped() ? ", wrapped" : "",
+                info.motor_count, info.control_frequency);
+    for (const TraceRecord& rec : reader.records()) {
+        std::printf("%lld.%09lld %10u %-7s", static_cast<long long>(rec.timestamp_ns / 1000000000),
+                    static_cast<long long>(rec.timestamp_ns % 1000000000), rec.cycle,
+                    TraceReader::type_name(rec.type));
+        switch (rec.type) {
+            case TraceRecord::COMMAND:
+                std::printf(" type %u motor %u speed %.4f%s", rec.code, rec.motor, rec.speed,
+                            (rec.flags & TraceRecord::IMMEDIATE) ? " immediate" : "");
+                break;
+            case TraceRecord::MOTOR:
+                std::printf(" motor %u speed %.4f pulse %u ns", rec.motor, rec.speed, rec.pulse_ns);
+                break;
+            case TraceRecord::ESTOP:
+                std::printf(" %s", EmergencyStop::source_name(static_cast<EmergencyStop::Source>(rec.code)));
+                break;
+        }
+        std::printf("\n");
+    }
+}
+
+int main(int argc, char** argv) {
+    std::string config_path;
+    std::string trace_path;
+    bool dump_only = false;
+
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--config") == 0 && i + 1 < argc) {
+            config_path = argv[++i];
+        } else if (std::strcmp(argv[i], "--dump") == 0) {
+            dump_only = true;
+        } else if (argv[i][0] != '-' && trace_path.empty()) {
+            trace_path = argv[i];
+        } else {
+            trace_path.clear();
+            break;
+        }
+    }
+    if (trace_path.empty()) {
+        std::fprintf(stderr, "Usage: %s [--config FILE] [--dump] TRACE\n", argv[0]);
+        return 2;
+    }
+
+    TraceReader reader;
+    switch (reader.open(trace_path)) {
+        case TraceReader::OK:
+            break;
+        case TraceReader::INCOMPATIBLE:
+            std::fprintf(stderr, "kart_replay: %s is not a trace (version %u expected)\n", trace_path.c_str(),
+                         TRACE_VERSION);
+            return 2;
+        default:
+            std::fprintf(stderr, "kart_replay: cannot open %s\n", trace_path.c_str());
+            return 2;
+    }
+    if (dump_only) {
+        dump(reader);
+        return 0;
+    }
+
+    KartConfig config = create_default_config();
+    if (!config_path.empty()) {
+        std::string error;
+        if (!load_kart_config(config_path, config, error)) {
+            std::fprintf(stderr, "kart_replay: invalid configuration: %s\n", error.c_str());
+            return 2;
+        }
+    }
+
+    TraceReplay replay(config, reader);
+    ReplayResult result = replay.run();
+    if (!result.error.empty()) {
+        std::fprintf(stderr, "kart_replay: %s\n", result.error.c_str());
+        return 2;
+    }
+
+    if (result.skipped > 0) {
+        std::printf("trace wrapped: skipped %llu cycles up to the first rest point\n",
+                    static_cast<unsigned long long>(result.skipped));
+    }
+    std::printf("replayed %llu cycles (%.1f s) in %.3f s (%.0fx): %llu commands, %llu emergency stops\n",
+                static_cast<unsigned long long>(result.cycles), result.recorded_ns / 1e9, result.real_seconds,
+                result.speedup(), static_cast<unsigned long long>(result.commands),
+                static_cast<unsigned long long>(result.stops));
+    for (const std::string& message : result.messages) {
+        std::printf("  %s\n", message.c_str());
+    }
+    std::printf("%llu differences\n", static_cast<unsigned long long>(result.differences));
+    return result.passed() ? 0 : 1;
+}
@@ -0,0 +1,182 @@
+/*
+ * Lock-free ring buffer for the kart control path
+ * ===============================================
+ *
+ * Bounded single-producer/single-consumer ring used to hand data to the
+ * real-time control thread without locks, allocations or wakeups.
+ *
+ * - Capacity is a compile-time power of two (index masking, no modulo)
+ * - Producer and consumer indices live on separate cache lines
+ * - Each side caches the other side's index to avoid cache-line ping-pong
+ *
+ * ProducerRegistry hands each calling thread its own ring slot so that a set
+ * of SPSC rings can serve several client threads.
+ */
+
+#ifndef KART_RING_H
+#define KART_RING_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+
+// Cache line size of the Raspberry Pi (Cortex-A53/A72) and of x86
+static constexpr std::size_t CACHE_LINE_SIZE = 64;
+
+template <typename T, std::size_t Capacity>
+class SpscRing {
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0,
+                  "SpscRing capacity must be a power of two");
+
+private:
+    static constexpr std::size_t MASK = Capacity - 1;
+
+    // Consumer side
+    alignas(CACHE_LINE_SIZE) std::atomic<std::size_t> head{0};
+    std::size_t cached_tail = 0;
+
+    // Producer side
+    alignas(CACHE_LINE_SIZE) std::atomic<std::size_t> tail{0};
+    std::size_t cached_head = 0;
+
+    alignas(CACHE_LINE_SIZE) T slots[Capacity];
+
+public:
+    static constexpr std::size_t capacity() {
+        return Capacity;
+    }
+
+    // Producer only. Returns false if the ring is full.
+    bool try_push(const T& item) {
+        const std::size_t t = tail.load(std::memory_order_relaxed);
+        if (t - cached_head >= Capacity) {
+            cached_head = head.load(std::memory_order_acquire);
+            if (t - cached_head >= Capacity) {
+                return false;
+            }
+        }
+        slots[t & MASK] = item;
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Producer only. Publishes all n items with a single store, or none of
+    // them if they do not fit.
+    bool try_push_n(const T* items, std::size_t n) {
+        const std::size_t t = tail.load(std::memory_order_relaxed);
+        if (t - cached_head + n > Capacity) {
+            cached_head = head.load(std::memory_order_acquire);
+            if (t - cached_head + n > Capacity) {
+                return false;
+            }
+        }
+        for (std::size_t i = 0; i < n; ++i) {
+            slots[(t + i) & MASK] = items[i];
+        }
+        tail.store(t + n, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer only. Returns false if the ring is empty.
+    bool try_pop(T& out) {
+        const std::size_t h = head.load(std::memory_order_relaxed);
+        if (h == cached_tail) {
+            cached_tail = tail.load(std::memory_order_acquire);
+            if (h == cached_tail) {
+                return false;
+            }
+        }
+        out = slots[h & MASK];
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer only. Hands every element published so far to fn and releases
+    // the slots in one store. Returns the number of elements consumed.
+    template <typename Fn>
+    std::size_t drain(Fn&& fn) {
+        const std::size_t h = head.load(std::memory_order_relaxed);
+        cached_tail = tail.load(std::memory_order_acquire);
+        for (std::size_t i = h; i != cached_tail; ++i) {
+            fn(slots[i & MASK]);
+        }
+        head.store(cached_tail, std::memory_order_release);
+        return cached_tail - h;
+    }
+
+    // Approximate number of queued elements (exact from either owning thread)
+    std::size_t size() const {
+        return tail.load(std::memory_order_acquire) - head.load(std::memory_order_acquire);
+    }
+};
+
+// Assigns producer slots to threads. Every thread gets its own slot on first
+// use; once MaxProducers - 1 slots are taken, later threads share the last
+// one and must serialize through lock_shared()/unlock_shared().
+template <int MaxProducers>
+class ProducerRegistry {
+    static_assert(MaxProducers >= 2, "ProducerRegistry needs at least one shared slot");
+
+private:
+    const std::uint64_t owner_id;
+    std::atomic<int> next{0};
+    std::atomic_flag shared_lock = ATOMIC_FLAG_INIT;
+
+    static std::uint64_t next_owner_id() {
+        static std::atomic<std::uint64_t> counter{0};
+        return counter.fetch_add(1, std::memory_order_relaxed) + 1;
+    }
+
+public:
+    static constexpr int SHARED_SLOT = MaxProducers - 1;
+
+    ProducerRegistry() : owner_id(next_owner_id()) {}
+
+    ProducerRegistry(const ProducerRegistry&) = delete;
+    ProducerRegistry& operator=(const ProducerRegistry&) = delete;
+
+    // Slot of the calling thread. A thread typically produces into a handful
+    // of registries (command queue, logger), so the lookup is a short scan of
+    // a per-thread cache; only a cache miss touches shared state.
+    int slot() {
+        struct Entry {
+            std::uint64_t owner;
+            int slot;
+        };
+        static constexpr int CACHE_ENTRIES = 8;
+        thread_local Entry cache[CACHE_ENTRIES] = {};
+        thread_local int victim = 0;
+
+        for (const Entry& entry : cache) {
+            if (entry.owner == owner_id) {
+                return entry.slot;
+            }
+        }
+
+        int claimed = next.fetch_add(1, std::memory_order_relaxed);
+        Entry& entry = cache[victim];
+        victim = (victim + 1) % CACHE_ENTRIES;
+        entry.owner = owner_id;
+        entry.slot = claimed < SHARED_SLOT ? claimed : SHARED_SLOT;
+        return entry.slot;
+    }
+
+    // Number of slots that may hold data (consumer side)
+    int active() const {
+        int claimed = next.load(std::memory_order_acquire);
+        return claimed < MaxProducers ? claimed : MaxProducers;
+    }
+
+    void lock_shared() {
+        while (shared_lock.test_and_set(std::memory_order_acquire)) {
+            std::this_thread::yield();
+        }
+    }
+
+    void unlock_shared() {
+        shared_lock.clear(std::memory_order_release);
+    }
+};
+
+#endif // KART_RING_H
@@ -0,0 +1,251 @@
+/*
+ * Real-time process setup for the kart controller
+ * ===============================================
+ *
+ * Removes the usual sources of multi-millisecond latency spikes before the
+ * control loop starts:
+ *
+ * - page faults: mlockall(), a prefaulted heap reserve that malloc keeps
+ *   (no trimming, no mmap'ed chunks) and a prefaulted control thread stack
+ * - migrations and cache pollution: the control thread is pinned to its own
+ *   CPU (isolate it with isolcpus=/nohz_full=), all other threads to the
+ *   remaining CPUs
+ * - scheduling: SCHED_FIFO with a fixed priority or SCHED_DEADLINE with a
+ *   runtime budget per control period
+ *
+ * Every step reports what it applied (or why it failed) into a text report
+ * that the controller logs at startup. Failures are not fatal: the
+ * controller still runs, just without the guarantee.
+ */
+
+#ifndef KART_RT_H
+#define KART_RT_H
+
+#include <alloca.h>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <malloc.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#ifndef SCHED_DEADLINE
+#define SCHED_DEADLINE 6
+#endif
+
+struct RtSettings {
+    enum Scheduler { OTHER, FIFO, DEADLINE };
+
+    bool lock_memory = true;
+    std::size_t stack_prefault_bytes = 256 * 1024;
+    std::size_t heap_reserve_bytes = 4 * 1024 * 1024;
+    Scheduler scheduler = FIFO;
+    int priority = 80;                                  // SCHED_FIFO priority (1-99)
+    std::chrono::microseconds deadline_runtime{2000};   // SCHED_DEADLINE budget per period
+    int control_cpu = -1;                               // -1: do not pin the control thread
+    std::string worker_cpus;                            // e.g. "0-2"; empty: do not pin
+
+    // "fifo", "deadline" or "other"; returns false for unknown names
+    static bool parse_scheduler(const std::string& name, Scheduler& scheduler) {
+        if (name == "fifo") {
+            scheduler = FIFO;
+        } else if (name == "deadline") {
+            scheduler = DEADLINE;
+        } else if (name == "other") {
+            scheduler = OTHER;
+        } else {
+            return false;
+        }
+        return true;
+    }
+};
+
+// Parse a CPU list like "0-2,5" into a cpu_set_t
+inline bool parse_cpu_list(const std::string& list, cpu_set_t& set) {
+    CPU_ZERO(&set);
+    const char* p = list.c_str();
+    bool any = false;
+    while (*p != '\0') {
+        char* end = nullptr;
+        long first = std::strtol(p, &end, 10);
+        if (end == p || first < 0 || first >= CPU_SETSIZE) {
+            return false;
+        }
+        long last = first;
+        p = end;
+        if (*p == '-') {
+            last = std::strtol(p + 1, &end, 10);
+            if (end == p + 1 || last < first || last >= CPU_SETSIZE) {
+                return false;
+            }
+            p = end;
+        }
+        for (long cpu = first; cpu <= last; ++cpu) {
+            CPU_SET(static_cast<int>(cpu), &set);
+        }
+        any = true;
+        if (*p == ',') {
+            ++p;
+        } else if (*p != '\0') {
+            return false;
+        }
+    }
+    return any;
+}
+
+namespace rt_detail {
+
+inline void append(std::string& report, const std::string& item) {
+    if (!report.empty()) {
+        report += ", ";
+    }
+    report += item;
+}
+
+inline std::string failed(const char* what, int error) {
+    return std::string(what) + " failed (" + std::strerror(error) + ")";
+}
+
+// Layout of struct sched_attr (not exported by glibc)
+struct SchedAttr {
+    std::uint32_t size;
+    std::uint32_t sched_policy;
+    std::uint64_t sched_flags;
+    std::int32_t sched_nice;
+    std::uint32_t sched_priority;
+    std::uint64_t sched_runtime;
+    std::uint64_t sched_deadline;
+    std::uint64_t sched_period;
+};
+
+// Touch every page of a fresh stack area so later calls never fault
+__attribute__((noinline)) inline void prefault_stack(std::size_t bytes) {
+    volatile char* stack = static_cast<volatile char*>(alloca(bytes));
+    const long page = sysconf(_SC_PAGESIZE);
+    for (std::size_t offset = 0; offset < bytes; offset += static_cast<std::size_t>(page)) {
+        stack[offset] = 0;
+    }
+}
+
+} // namespace rt_detail
+
+// Process-wide setup, run once before the worker threads start
+inline bool rt_prepare_process(const RtSettings& settings, std::string& report) {
+    bool ok = true;
+
+    if (settings.lock_memory) {
+        if (mlockall(MCL_CURRENT | MCL_FUTURE) == 0) {
+            rt_detail::append(report, "mlockall");
+        } else {
+            rt_detail::append(report, rt_detail::failed("mlockall", errno));
+            ok = false;
+        }
+    }
+
+    if (settings.heap_reserve_bytes > 0) {
+        // Keep freed memory in the heap instead of returning it to the kernel
+        mallopt(M_TRIM_THRESHOLD, -1);
+        mallopt(M_MMAP_MAX, 0);
+        char* reserve = static_cast<char*>(std::malloc(settings.heap_reserve_bytes));
+        if (reserve != nullptr) {
+            const long page = sysconf(_SC_PAGESIZE);
+            for (std::size_t offset = 0; offset < settings.heap_reserve_bytes; offset += static_cast<std::size_t>(page)) {
+                reserve[offset] = 0;
+            }
+            std::free(reserve);
+            rt_detail::append(report, "heap reserve " + std::to_string(settings.heap_reserve_bytes / 1024) + " KiB");
+        } else {
+            rt_detail::append(report, "heap reserve failed");
+            ok = false;
+        }
+    }
+
+    return ok;
+}
+
+// Pin a thread to a CPU list; an empty list leaves the affinity alone
+inline bool rt_pin_thread(pthread_t thread, const char* name, const std::string& cpus, std::string& report) {
+    if (cpus.empty()) {
+        return true;
+    }
+    cpu_set_t set;
+    if (!parse_cpu_list(cpus, set)) {
+        rt_detail::append(report, std::string(name) + " affinity: invalid CPU list '" + cpus + "'");
+        return false;
+    }
+    int error = pthread_setaffinity_np(thread, sizeof(set), &set);
+    if (error != 0) {
+        rt_detail::append(report, rt_detail::failed((std::string(name) + " affinity").c_str(), error));
+        return false;
+    }
+    rt_detail::append(report, std::string(name) + " on CPU " + cpus);
+    return true;
+}
+
+// Setup of the calling thread as the periodic control thread. Must run on
+// that thread: SCHED_DEADLINE can only be set through sched_setattr(0, ...).
+inline bool rt_prepare_control_thread(const RtSettings& settings, std::chrono::nanoseconds period,
+                                      std::string& report) {
+    bool ok = true;
+
+    if (settings.stack_prefault_bytes > 0) {
+        rt_detail::prefault_stack(settings.stack_prefault_bytes);
+        rt_detail::append(report, "stack prefault " + std::to_string(settings.stack_prefault_bytes / 1024) + " KiB");
+    }
+
+    // SCHED_DEADLINE tasks must be allowed on their whole root domain, so
+    // restrict them with an exclusive cpuset instead of affinity
+    if (settings.control_cpu >= 0 && settings.scheduler != RtSettings::DEADLINE) {
+        ok = rt_pin_thread(pthread_self(), "control", std::to_string(settings.control_cpu), report) && ok;
+    }
+
+    switch (settings.scheduler) {
+        case RtSettings::FIFO: {
+            sched_param param{};
+            param.sched_priority = settings.priority;
+            int error = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+            if (error == 0) {
+                rt_detail::append(report, "SCHED_FIFO priority " + std::to_string(settings.priority));
+            } else {
+                rt_detail::append(report, rt_detail::failed("SCHED_FIFO", error));
+                ok = false;
+            }
+            break;
+        }
+        case RtSettings::DEADLINE: {
+            auto runtime = std::chrono::duration_cast<std::chrono::nanoseconds>(settings.deadline_runtime);
+            if (runtime <= std::chrono::nanoseconds::zero() || runtime > period) {
+                rt_detail::append(report, "SCHED_DEADLINE runtime must be within the control period");
+                ok = false;
+                break;
+            }
+            rt_detail::SchedAttr attr{};
+            attr.size = sizeof(attr);
+            attr.sched_policy = SCHED_DEADLINE;
+            attr.sched_runtime = static_cast<std::uint64_t>(runtime.count());
+            attr.sched_deadline = static_cast<std::uint64_t>(period.count());
+            attr.sched_period = static_cast<std::uint64_t>(period.count());
+            if (syscall(SYS_sched_setattr, 0, &attr, 0) == 0) {
+                rt_detail::append(report, "SCHED_DEADLINE runtime " + std::to_string(runtime.count() / 1000) +
+                                          " us period " + std::to_string(period.count() / 1000) + " us");
+            } else {
+                rt_detail::append(report, rt_detail::failed("SCHED_DEADLINE", errno));
+                ok = false;
+            }
+            break;
+        }
+        case RtSettings::OTHER:
+            rt_detail::append(report, "SCHED_OTHER");
+            break;
+    }
+
+    return ok;
+}
+
+#endif // KART_RT_H
@@ -0,0 +1,141 @@
+/*
+ * Kart simulator: scenario replay and soak runs without hardware
+ * ==============================================================
+ *
+ * Runs the real controller against the plant model of kart_sim.h on a
+ * virtual clock and checks acceleration limiting, watchdog and emergency
+ * stop timing every control cycle. Exits with 1 on any violation, so it can
+ * gate CI.
+ *
+ * Usage: kart_sim [--config FILE] [--scenarios FILE] [--hours H] [--seed N]
+ *                 [--realtime-factor X] [--log-level LEVEL] [--trace PREFIX]
+ *   --config FILE        kart_config.ini to simulate (default: built-in defaults)
+ *   --scenarios FILE     scripted scenarios (default kart_sim_scenarios.txt
+ *                        unless --hours is given)
+ *   --hours H            random driving for H virtual hours
+ *   --seed N             seed of the random drive (default 1)
+ *   --realtime-factor X  at most X times faster than real time (default: unlimited)
+ *   --log-level LEVEL    0 DEBUG .. 3 ERROR (default 2) to /tmp/kart_sim.log
+ *   --trace PREFIX       trace each scenario to PREFIX<name>.bin (kart_replay)
+ *
+ * Compile with: g++ -std=c++20 -pthread -DTEST_MODE -o kart_sim kart_sim.cpp -lrt
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+#include "kart_sim.h"
+
+// Quiet by default: a soak run triggers thousands of emergency stops
+static Logger::Options sim_log_options() {
+    Logger::Options options = Logger::default_options();
+    options.text_path = "/tmp/kart_sim.log";
+    options.binary_path.clear();
+    options.console_output = false;
+    options.min_level = Logger::WARNING;
+    return options;
+}
+
+Logger g_logger(sim_log_options());
+
+static void print_result(const std::string& name, const SimResult& result) {
+    std::printf("%s %-34s %10.1f s virtual %10llu cycles %8.2f s real %9.0fx  max %.1f km/h\n",
+                result.passed() ? "PASS" : "FAIL", name.c_str(), result.virtual_ns / 1e9,
+                static_cast<unsigned long long>(result.cycles), result.real_seconds, result.speedup(),
+                result.max_vehicle_kmh);
+    for (const std::string& message : result.messages) {
+        std::printf("     %s\n", message.c_str());
+    }
+    if (result.violations > result.messages.size()) {
+        std::printf("     ... %llu violations in total\n", static_cast<unsigned long long>(result.violations));
+    }
+    std::fflush(stdout);
+}
+
+int main(int argc, char** argv) {
+    std::string config_path;
+    std::string scenario_path;
+    double hours = 0.0;
+    std::uint32_t seed = 1;
+    double realtime_factor = 0.0;
+    int log_level = Logger::WARNING;
+    std::string trace_prefix;
+
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--config") == 0 && i + 1 < argc) {
+            config_path = argv[++i];
+        } else if (std::strcmp(argv[i], "--scenarios") == 0 && i + 1 < argc) {
+            scenario_path = argv[++i];
+        } else if (std::strcmp(argv[i], "--hours") == 0 && i + 1 < argc) {
+            hours = std::atof(argv[++i]);
+        } else if (std::strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            seed = static_cast<std::uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+        } else if (std::strcmp(argv[i], "--realtime-factor") == 0 && i + 1 < argc) {
+            realtime_factor = std::atof(argv[++i]);
+        } else if (std::strcmp(argv[i], "--log-level") == 0 && i + 1 < argc) {
+            log_level = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--trace") == 0 && i + 1 < argc) {
+            trace_prefix = argv[++i];
+        } else {
+            std::fprintf(stderr,
+                         "Usage: %s [--config FILE] [--scenarios FILE] [--hours H] [--seed N]"
+                         " [--realtime-factor X] [--log-level LEVEL] [--trace PREFIX]\n",
+                         argv[0]);
+            return 2;
+        }
+    }
+    if (hours < 0.0 || realtime_factor < 0.0 || log_level < Logger::DEBUG || log_level > Logger::ERROR) {
+        std::fprintf(stderr, "kart_sim: --hours, --realtime-factor and --log-level out of range\n");
+        return 2;
+    }
+    if (scenario_path.empty() && hours == 0.0) {
+        scenario_path = "kart_sim_scenarios.txt";
+    }
+    g_logger.set_level(static_cast<Logger::Level>(log_level));
+
+    KartConfig config = create_default_config();
+    if (!config_path.empty()) {
+        std::string error;
+        if (!load_kart_config(config_path, config, error)) {
+            std::fprintf(stderr, "kart_sim: invalid configuration: %s\n", error.c_str());
+            return 2;
+        }
+    }
+
+    std::vector<SimScenario> scenarios;
+    if (!scenario_path.empty()) {
+        std::ifstream file(scenario_path);
+        std::string error;
+        if (!file) {
+            std::fprintf(stderr, "kart_sim: cannot open %s\n", scenario_path.c_str());
+            return 2;
+        }
+        if (!parse_sim_scenarios(file, scenarios, error)) {
+            std::fprintf(stderr, "kart_sim: %s: %s\n", scenario_path.c_str(), error.c_str());
+            return 2;
+        }
+    }
+
+    SimRunner runner(config);
+    runner.set_realtime_factor(realtime_factor);
+    runner.set_trace_prefix(trace_prefix);
+
+    std::size_t failed = 0;
+    for (const SimScenario& scenario : scenarios) {
+        SimResult result = runner.run(scenario);
+        print_result(scenario.name, result);
+        failed += result.passed() ? 0 : 1;
+    }
+    if (hours > 0.0) {
+        SimResult result = runner.soak(hours, seed);
+        print_result("soak (seed " + std::to_string(seed) + ")", result);
+        failed += result.passed() ? 0 : 1;
+    }
+
+    std::printf("%zu of %zu runs passed\n", scenarios.size() + (hours > 0.0 ? 1 : 0) - failed,
+                scenarios.size() + (hours > 0.0 ? 1 : 0));
+    return failed == 0 ? 0 : 1;
+}
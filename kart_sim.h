@@ -0,0 +1,1022 @@
+/*
+ * Kart plant simulation on a virtual clock
+ * ========================================
+ *
+ * Runs the real ESCController (TEST_MODE build, simulated GPIO from
+ * kart_gpio_sim.h) against a model of the hardware, faster than real time:
+ *
+ * - SimClock: virtual time for the control loop. sleep_until() jumps to the
+ *   deadline instead of sleeping and then runs the harness tick on the
+ *   control thread, so every cycle sees a consistent world.
+ * - SimPwmBackend: PWM sink that records the last pulse of every pin with
+ *   its virtual timestamp.
+ * - KartPlant: ESC deadband, first-order motor response and vehicle speed
+ *   with aerodynamic drag and rolling resistance.
+ * - SimRunner: replays a scripted scenario (or a random soak drive) and
+ *   checks after every cycle that acceleration limiting holds, the watchdog
+ *   fires within one period of its timeout (and not earlier) and an
+ *   emergency stop puts every output to neutral at the same virtual instant.
+ * - TraceReplay: feeds a recorded trace (kart_trace.h) back through the
+ *   controller and diffs the outputs cycle by cycle (kart_replay).
+ *
+ * Scenario files (kart_sim_scenarios.txt): "scenario <name>" starts a
+ * scenario, then one step per line, "<seconds> <verb> [args]":
+ *   speed P | motor NAME P | estop | stop_pin | release_pin | reset |
+ *   calibrate [NAME] | cancel | expect_speed P [TOL] | expect_pulse US [TOL] |
+ *   expect_estop on|off | expect_vehicle MIN_KMH MAX_KMH | end
+ * Expectations see the state after the cycle before their time. '#' starts
+ * a comment.
+ *
+ * Only the control loop runs on virtual time; the monitor and logger threads
+ * keep real time and only log.
+ */
+
+#ifndef KART_SIM_H
+#define KART_SIM_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <istream>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "kart_controller.h"
+
+// Virtual time; the owner sets the tick before the control loop starts
+class SimClock : public ControlClock {
+public:
+    using Tick = std::function<void(std::int64_t now_ns)>;
+
+    explicit SimClock(std::int64_t start_ns = 1000000000) : virtual_ns(start_ns), start(start_ns) {}
+
+    std::int64_t now_ns() override {
+        return virtual_ns.load(std::memory_order_acquire);
+    }
+
+    void sleep_until(std::int64_t deadline_ns) override {
+        if (halted.load(std::memory_order_acquire)) {
+            // Controller is shutting down: keep the loop from spinning
+            std::this_thread::sleep_for(HALTED_SLEEP);
+        } else if (realtime_factor > 0.0) {
+            const auto real = std::chrono::nanoseconds(
+                static_cast<std::int64_t>(static_cast<double>(deadline_ns - start) / realtime_factor));
+            std::this_thread::sleep_until(real_start + real);
+        }
+        virtual_ns.store(std::max(deadline_ns, now_ns()), std::memory_order_release);
+        if (tick && !halted.load(std::memory_order_acquire)) {
+            tick(deadline_ns);
+        }
+    }
+
+    void set_tick(Tick fn) {
+        tick = std::move(fn);
+    }
+
+    // Run at most factor times faster than real time (0: as fast as possible)
+    void set_realtime_factor(double factor) {
+        realtime_factor = factor;
+        real_start = std::chrono::steady_clock::now();
+    }
+
+    // No more ticks; virtual time keeps moving so the controller can stop
+    void halt() {
+        halted.store(true, std::memory_order_release);
+    }
+
+    std::int64_t start_ns() const {
+        return start;
+    }
+
+private:
+    static constexpr std::chrono::microseconds HALTED_SLEEP{500};
+
+    std::atomic<std::int64_t> virtual_ns;
+    const std::int64_t start;
+    std::atomic<bool> halted{false};
+    Tick tick;
+    double realtime_factor = 0.0;
+    std::chrono::steady_clock::time_point real_start = std::chrono::steady_clock::now();
+};
+
+// PWM sink: the last pulse per pin and when it was written (virtual time)
+class SimPwmBackend : public PwmBackend {
+public:
+    explicit SimPwmBackend(ControlClock& control_clock) : clock(control_clock) {}
+
+    const char* name() const override {
+        return "sim";
+    }
+
+    bool setup(int pin, std::uint32_t period_ns) override {
+        if (pin < 0 || pin >= MAX_GPIO_PIN) {
+            return false;
+        }
+        outputs[pin].period_ns.store(period_ns, std::memory_order_relaxed);
+        return true;
+    }
+
+    void write(int pin, std::uint32_t pulse_ns) override {
+        if (pin < 0 || pin >= MAX_GPIO_PIN) {
+            return;
+        }
+        Output& out = outputs[pin];
+        out.pulse_ns.store(pulse_ns, std::memory_order_relaxed);
+        out.written_ns.store(clock.now_ns(), std::memory_order_relaxed);
+        out.writes.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    std::uint32_t pulse(int pin) const {
+        return valid(pin) ? outputs[pin].pulse_ns.load(std::memory_order_relaxed) : 0;
+    }
+
+    std::int64_t written_at(int pin) const {
+        return valid(pin) ? outputs[pin].written_ns.load(std::memory_order_relaxed) : 0;
+    }
+
+    std::uint64_t writes(int pin) const {
+        return valid(pin) ? outputs[pin].writes.load(std::memory_order_relaxed) : 0;
+    }
+
+private:
+    struct Output {
+        std::atomic<std::uint32_t> pulse_ns{0};
+        std::atomic<std::uint32_t> period_ns{0};
+        std::atomic<std::int64_t> written_ns{0};
+        std::atomic<std::uint64_t> writes{0};
+    };
+
+    ControlClock& clock;
+    Output outputs[MAX_GPIO_PIN];
+
+    static bool valid(int pin) {
+        return pin >= 0 && pin < MAX_GPIO_PIN;
+    }
+};
+
+struct PlantParams {
+    double mass_kg = 150.0;              // kart and driver
+    double max_force_n = 300.0;          // per motor at full throttle
+    double motor_time_constant_s = 0.15;
+    double deadband = 0.03;              // throttle fraction the ESC ignores around neutral
+    double drag_area_m2 = 0.5;           // drag coefficient times frontal area
+    double rolling_resistance = 0.015;
+};
+
+// ESCs, motors and the kart as one rigid body on flat ground
+class KartPlant {
+public:
+    static constexpr double AIR_DENSITY = 1.2;   // kg/m^3
+    static constexpr double GRAVITY = 9.81;      // m/s^2
+
+    KartPlant(const PlantParams& plant, const std::vector<EscProfile>& escs)
+        : params(plant), profiles(escs), outputs(escs.size(), 0.0) {}
+
+    // Throttle (-1..1) an ESC makes of a pulse, 0 inside the deadband
+    static double throttle(const EscProfile& esc, std::uint32_t pulse_ns, double deadband) {
+        const double offset = static_cast<double>(pulse_ns) - static_cast<double>(esc.neutral_ns);
+        const double range = offset >= 0.0 ? static_cast<double>(esc.max_ns - esc.neutral_ns)
+                                           : static_cast<double>(esc.neutral_ns - esc.min_ns);
+        if (range <= 0.0) {
+            return 0.0;
+        }
+        const double value = std::clamp(offset / range, -1.0, 1.0);
+        if (std::abs(value) <= deadband) {
+            return 0.0;
+        }
+        // Full range above the deadband
+        return (value - std::copysign(deadband, value)) / (1.0 - deadband);
+    }
+
+    // Advance by dt seconds with the given pulse per motor
+    void step(const std::vector<std::uint32_t>& pulses, double dt) {
+        const double alpha = 1.0 - std::exp(-dt / params.motor_time_constant_s);
+        double force = 0.0;
+        for (std::size_t i = 0; i < outputs.size() && i < pulses.size(); ++i) {
+            outputs[i] += (throttle(profiles[i], pulses[i], params.deadband) - outputs[i]) * alpha;
+            force += outputs[i] * params.max_force_n;
+        }
+
+        const double rolling = params.rolling_resistance * params.mass_kg * GRAVITY;
+        if (velocity == 0.0 && std::abs(force) <= rolling) {
+            return;    // static friction holds the kart
+        }
+        const double direction = velocity != 0.0 ? std::copysign(1.0, velocity) : std::copysign(1.0, force);
+        const double drag = 0.5 * AIR_DENSITY * params.drag_area_m2 * velocity * std::abs(velocity);
+        const double next = velocity + (force - drag - direction * rolling) / params.mass_kg * dt;
+        // Resistance stops the kart, it does not push it backwards
+        velocity = (velocity != 0.0 && std::signbit(next) != std::signbit(velocity)) ? 0.0 : next;
+        distance += velocity * dt;
+    }
+
+    double speed_mps() const {
+        return velocity;
+    }
+
+    double speed_kmh() const {
+        return velocity * 3.6;
+    }
+
+    double distance_m() const {
+        return distance;
+    }
+
+    double motor_output(std::size_t motor) const {
+        return motor < outputs.size() ? outputs[motor] : 0.0;
+    }
+
+private:
+    PlantParams params;
+    std::vector<EscProfile> profiles;
+    std::vector<double> outputs;      // motor force fraction (-1..1)
+    double velocity = 0.0;            // m/s
+    double distance = 0.0;            // m
+};
+
+struct SimStep {
+    std::int64_t at_ns;
+    std::string verb;
+    std::vector<std::string> args;
+    int line;
+};
+
+struct SimScenario {
+    std::string name;
+    std::vector<SimStep> steps;      // sorted by time
+    std::int64_t end_ns = 0;
+};
+
+namespace sim_detail {
+
+struct VerbSpec {
+    const char* verb;
+    std::size_t min_args;
+    std::size_t max_args;
+};
+
+inline const VerbSpec* find_verb(const std::string& verb) {
+    static const VerbSpec specs[] = {
+        {"speed", 1, 1},        {"motor", 2, 2},         {"estop", 0, 0},          {"stop_pin", 0, 0},
+        {"release_pin", 0, 0},  {"reset", 0, 0},         {"calibrate", 0, 1},      {"cancel", 0, 0},
+        {"expect_speed", 1, 2}, {"expect_pulse", 1, 2},  {"expect_estop", 1, 1},   {"expect_vehicle", 2, 2},
+        {"end", 0, 0},
+    };
+    for (const VerbSpec& spec : specs) {
+        if (verb == spec.verb) {
+            return &spec;
+        }
+    }
+    return nullptr;
+}
+
+inline bool is_number(const std::string& text) {
+    char* end = nullptr;
+    std::strtod(text.c_str(), &end);
+    return !text.empty() && *end == '\0';
+}
+
+}  // namespace sim_detail
+
+// Parse a scenario file; on failure error names the first bad line
+inline bool parse_sim_scenarios(std::istream& in, std::vector<SimScenario>& scenarios, std::string& error) {
+    std::string line;
+    int number = 0;
+    while (std::getline(in, line)) {
+        ++number;
+        line = line.substr(0, line.find('#'));
+        std::istringstream words(line);
+        std::string first;
+        if (!(words >> first)) {
+            continue;
+        }
+        const std::string where = "line " + std::to_string(number) + ": ";
+
+        if (first == "scenario") {
+            SimScenario scenario;
+            if (!(words >> scenario.name)) {
+                error = where + "scenario needs a name";
+                return false;
+            }
+            scenarios.push_back(std::move(scenario));
+            continue;
+        }
+        if (scenarios.empty()) {
+            error = where + "step before the first 'scenario'";
+            return false;
+        }
+        if (!sim_detail::is_number(first) || std::strtod(first.c_str(), nullptr) < 0.0) {
+            error = where + "expected a time in seconds, got '" + first + "'";
+            return false;
+        }
+
+        SimStep step;
+        step.at_ns = std::llround(std::strtod(first.c_str(), nullptr) * 1e9);
+        step.line = number;
+        if (!(words >> step.verb)) {
+            error = where + "missing verb";
+            return false;
+        }
+        for (std::string arg; words >> arg;) {
+            step.args.push_back(arg);
+        }
+        const sim_detail::VerbSpec* spec = sim_detail::find_verb(step.verb);
+        if (spec == nullptr) {
+            error = where + "unknown verb '" + step.verb + "'";
+            return false;
+        }
+        if (step.args.size() < spec->min_args || step.args.size() > spec->max_args) {
+            error = where + "wrong number of arguments for '" + step.verb + "'";
+            return false;
+        }
+        for (std::size_t i = 0; i < step.args.size(); ++i) {
+            const bool text = (step.verb == "motor" && i == 0) || step.verb == "calibrate" ||
+                              step.verb == "expect_estop";
+            if (!text && !sim_detail::is_number(step.args[i])) {
+                error = where + "'" + step.args[i] + "' is not a number";
+                return false;
+            }
+        }
+        if (step.verb == "expect_estop" && step.args[0] != "on" && step.args[0] != "off") {
+            error = where + "expect_estop takes 'on' or 'off'";
+            return false;
+        }
+
+        SimScenario& scenario = scenarios.back();
+        if (!scenario.steps.empty() && step.at_ns < scenario.steps.back().at_ns) {
+            error = where + "steps must be in time order";
+            return false;
+        }
+        scenario.end_ns = std::max(scenario.end_ns, step.at_ns);
+        scenario.steps.push_back(std::move(step));
+    }
+    return true;
+}
+
+// Nothing outside the process: no real-time setup, shared memory, trace
+// file or sockets
+inline KartConfig simulation_config(KartConfig cfg) {
+    cfg.rt = RtSettings();
+    cfg.rt.lock_memory = false;
+    cfg.rt.stack_prefault_bytes = 0;
+    cfg.rt.heap_reserve_bytes = 0;
+    cfg.rt.scheduler = RtSettings::OTHER;
+    cfg.telemetry_shm.clear();
+    cfg.trace_file.clear();
+    cfg.remote_unix_socket.clear();
+    cfg.remote_udp_port = 0;
+    cfg.metrics_port = 0;
+    cfg.auto_calibrate = false;
+    return cfg;
+}
+
+struct SimResult {
+    std::uint64_t cycles = 0;
+    std::int64_t virtual_ns = 0;
+    double real_seconds = 0.0;
+    std::uint64_t violations = 0;
+    std::vector<std::string> messages;    // first violations, with virtual time
+    double max_vehicle_kmh = 0.0;
+
+    bool passed() const {
+        return violations == 0;
+    }
+
+    // Virtual time per real time
+    double speedup() const {
+        return real_seconds > 0.0 ? static_cast<double>(virtual_ns) / 1e9 / real_seconds : 0.0;
+    }
+};
+
+class SimRunner {
+public:
+    static constexpr std::size_t MAX_MESSAGES = 10;
+
+    explicit SimRunner(const KartConfig& kart_config, const PlantParams& plant = PlantParams())
+        : config(simulation_config(kart_config)), plant_params(plant) {}
+
+    void set_realtime_factor(double factor) {
+        realtime_factor = factor;
+    }
+
+    // Trace scripted runs (kart_trace.h) to <prefix><scenario>.bin; soak
+    // runs are not traced
+    void set_trace_prefix(const std::string& prefix) {
+        trace_prefix = prefix;
+    }
+
+    const KartConfig& kart_config() const {
+        return config;
+    }
+
+    SimResult run(const SimScenario& scenario) {
+        KartConfig cfg = config;
+        if (!trace_prefix.empty()) {
+            cfg.trace_file = trace_prefix + scenario.name + ".bin";
+        }
+        Run state(*this, cfg, scenario);
+        return state.execute();
+    }
+
+    // Random driving for the given virtual time: speed changes, emergency
+    // stops from the pin and the console, heartbeat losses; every hour is
+    // one scenario on a fresh controller
+    SimResult soak(double hours, std::uint32_t seed) {
+        std::mt19937 random(seed);
+        SimResult total;
+        const auto real_start = std::chrono::steady_clock::now();
+        for (double done = 0.0; done < hours; done += 1.0) {
+            const SimScenario scenario = random_drive(random, std::min(1.0, hours - done) * 3600.0);
+            Run state(*this, config, scenario);
+            SimResult part = state.execute();
+            total.cycles += part.cycles;
+            total.virtual_ns += part.virtual_ns;
+            total.violations += part.violations;
+            total.max_vehicle_kmh = std::max(total.max_vehicle_kmh, part.max_vehicle_kmh);
+            for (const std::string& message : part.messages) {
+                if (total.messages.size() < MAX_MESSAGES) {
+                    total.messages.push_back(scenario.name + ": " + message);
+                }
+            }
+        }
+        total.real_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - real_start).count();
+        return total;
+    }
+
+private:
+    KartConfig config;
+    PlantParams plant_params;
+    double realtime_factor = 0.0;
+    std::string trace_prefix;
+
+    SimScenario random_drive(std::mt19937& random, double seconds) const {
+        SimScenario scenario;
+        scenario.name = "soak-" + std::to_string(random());
+        const double timeout = config.safety_limits.watchdog_timeout;
+        const double max_speed = config.safety_limits.max_speed;
+        auto uniform = [&random](double low, double high) {
+            return std::uniform_real_distribution<double>(low, high)(random);
+        };
+        auto add = [&scenario](double at, const std::string& verb, std::vector<std::string> args = {}) {
+            scenario.steps.push_back(SimStep{std::llround(at * 1e9), verb, std::move(args), 0});
+        };
+
+        double t = 0.0;
+        while (t < seconds) {
+            const double event = uniform(0.0, 1.0);
+            if (event < 0.80) {
+                add(t, "speed", {std::to_string(uniform(-max_speed, max_speed))});
+                t += uniform(0.1, 0.9 * timeout);
+            } else if (event < 0.88) {
+                add(t, "stop_pin");
+                t += uniform(0.05, 1.0);
+                add(t, "expect_estop", {"on"});
+                add(t, "release_pin");
+                t += 0.1;
+                add(t, "reset");
+                add(t, "speed", {"0"});
+            } else if (event < 0.94) {
+                add(t, "estop");
+                t += uniform(0.05, 1.0);
+                add(t, "reset");
+                add(t, "speed", {"0"});
+            } else {
+                // No commands: the watchdog has to stop the kart
+                t += timeout + uniform(0.1, 2.0);
+                add(t, "expect_estop", {"on"});
+                add(t, "reset");
+                add(t, "speed", {"0"});
+            }
+        }
+        add(seconds, "end");
+        scenario.end_ns = std::llround(seconds * 1e9);
+        return scenario;
+    }
+
+    // One scenario on a fresh controller; tick() runs on the control thread
+    class Run {
+    public:
+        Run(SimRunner& runner, const KartConfig& run_config, const SimScenario& script)
+            : cfg(run_config), scenario(script), clock(), motors(cfg.motors.size()),
+              period_ns(1000000000 / std::max(cfg.control_frequency, 1)),
+              timeout_ns(std::llround(cfg.safety_limits.watchdog_timeout * 1e9)),
+              max_change(cfg.safety_limits.max_acceleration_rate * 100.0 * static_cast<double>(period_ns) / 20e6),
+              previous(motors, 0.0), pulses(motors, 0), plant(runner.plant_params, esc_profiles(cfg)) {
+            clock.set_realtime_factor(runner.realtime_factor);
+        }
+
+        SimResult execute() {
+            SimGpio::board().release(cfg.emergency_pin, HIGH);
+            auto sink = std::make_unique<SimPwmBackend>(clock);
+            outputs = sink.get();
+            ESCController controller(cfg, std::move(sink), &clock);
+            kart = &controller;
+            ESCController::instance = &controller;
+            clock.set_tick([this](std::int64_t now) { tick(now); });
+
+            const auto real_start = std::chrono::steady_clock::now();
+            if (controller.start()) {
+                std::unique_lock<std::mutex> lock(done_mutex);
+                done_cv.wait(lock, [this] { return done; });
+            } else {
+                violation(0, "controller did not start");
+            }
+            clock.halt();
+            controller.stop();
+            ESCController::instance = nullptr;
+
+            result.real_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - real_start).count();
+            return result;
+        }
+
+    private:
+        const KartConfig cfg;
+        const SimScenario& scenario;
+        SimClock clock;
+        SimPwmBackend* outputs = nullptr;
+        ESCController* kart = nullptr;
+        const std::size_t motors;
+        const std::int64_t period_ns;
+        const std::int64_t timeout_ns;
+        const double max_change;
+
+        std::vector<double> previous;
+        std::vector<std::uint32_t> pulses;
+        KartPlant plant;
+        std::size_t next_step = 0;
+        std::int64_t last_beat_ns = 0;      // scenario time of the last accepted heartbeat
+        bool was_stopped = false;
+        bool stop_expected = false;         // scenario stopped the kart itself
+        bool finished = false;
+        SimResult result;
+
+        std::mutex done_mutex;
+        std::condition_variable done_cv;
+        bool done = false;
+
+        static std::vector<EscProfile> esc_profiles(const KartConfig& cfg) {
+            std::vector<EscProfile> profiles;
+            for (const MotorConfig& m : cfg.motors) {
+                profiles.push_back(EscProfile{ms_to_ns(m.min_pulse_width), ms_to_ns(m.neutral_pulse_width),
+                                              ms_to_ns(m.max_pulse_width), ms_to_ns(1000.0 / m.frequency)});
+            }
+            return profiles;
+        }
+
+        static std::uint32_t ms_to_ns(double ms) {
+            return static_cast<std::uint32_t>(std::llround(ms * 1e6));
+        }
+
+        // Called once per control period, right before the next cycle
+        void tick(std::int64_t now) {
+            if (finished) {
+                return;
+            }
+            const std::int64_t t = now - clock.start_ns();
+            ++result.cycles;
+            result.virtual_ns = t;
+
+            check_cycle(t);
+
+            while (next_step < scenario.steps.size() && scenario.steps[next_step].at_ns <= t) {
+                perform(scenario.steps[next_step++], now, t);
+            }
+
+            for (std::size_t i = 0; i < motors; ++i) {
+                pulses[i] = outputs->pulse(cfg.motors[i].pin);
+            }
+            plant.step(pulses, static_cast<double>(period_ns) / 1e9);
+            result.max_vehicle_kmh = std::max(result.max_vehicle_kmh, std::abs(plant.speed_kmh()));
+
+            if (t >= scenario.end_ns) {
+                // Halt here, not in execute(): until that thread wakes up
+                // the loop would run on at full speed
+                clock.halt();
+                finished = true;
+                std::lock_guard<std::mutex> lock(done_mutex);
+                done = true;
+                done_cv.notify_one();
+            }
+        }
+
+        // Invariants of the cycle that just ran (at t - period)
+        void check_cycle(std::int64_t t) {
+            const std::int64_t cycle_t = t - period_ns;
+            const bool stopped = kart->emergency_stop_active();
+            const bool calibrating = kart->calibration_active();
+
+            if (calibrating) {
+                // The watchdog exempts only the calibrating motors: it
+                // restarts while the others rest, a timeout stops them
+                bool others_moving = false;
+                for (std::size_t i = 0; i < motors; ++i) {
+                    const MotorHandle motor = static_cast<MotorHandle>(i);
+                    const MotorSpeeds speeds = kart->motor_speeds(motor);
+                    others_moving = others_moving ||
+                                    (!kart->calibrating(motor) && (speeds.current != 0.0 || speeds.target != 0.0));
+                }
+                if (!others_moving) {
+                    last_beat_ns = cycle_t;
+                }
+            }
+
+            for (std::size_t i = 0; i < motors; ++i) {
+                const double speed = kart->current_speed(static_cast<MotorHandle>(i));
+                if (!stopped && !calibrating && std::abs(speed - previous[i]) > max_change + 1e-9) {
+                    violation(t, cfg.motors[i].name + " changed by " + format(speed - previous[i]) +
+                                     " % in one cycle (limit " + format(max_change) + " %)");
+                }
+                if (std::abs(speed) > cfg.safety_limits.max_speed + 1e-9) {
+                    violation(t, cfg.motors[i].name + " at " + format(speed) + " % above max_speed");
+                }
+                if (stopped && outputs->pulse(cfg.motors[i].pin) != cfg.pulses[i].neutral_ns) {
+                    violation(t, cfg.motors[i].name + " not at neutral during an emergency stop");
+                }
+                previous[i] = speed;
+            }
+
+            if (!stopped && cycle_t - last_beat_ns > timeout_ns) {
+                violation(t, "watchdog did not fire " + format((cycle_t - last_beat_ns) / 1e9) +
+                                 " s after the last heartbeat");
+                // Report once; the late stop itself is not another violation
+                last_beat_ns = cycle_t;
+                stop_expected = true;
+            }
+            if (stopped && !was_stopped && !stop_expected && cycle_t - last_beat_ns <= timeout_ns) {
+                violation(t, "emergency stop without a cause " + format((cycle_t - last_beat_ns) / 1e9) +
+                                 " s after the last heartbeat");
+            }
+            was_stopped = stopped;
+            if (!stopped) {
+                stop_expected = false;
+            }
+        }
+
+        void perform(const SimStep& step, std::int64_t now, std::int64_t t) {
+            const std::vector<std::string>& args = step.args;
+            if (step.verb == "speed") {
+                if (kart->set_all_motors_speed(number(args[0]))) {
+                    last_beat_ns = t;
+                }
+            } else if (step.verb == "motor") {
+                if (kart->motor_handle(args[0]) == INVALID_MOTOR) {
+                    violation(t, "unknown motor " + args[0], step.line);
+                } else if (kart->set_motor_speed(args[0], number(args[1]))) {
+                    last_beat_ns = t;
+                }
+            } else if (step.verb == "estop") {
+                stop_expected = true;
+                kart->emergency_stop_all();
+                check_neutral_at(now, t, "console emergency stop");
+            } else if (step.verb == "stop_pin") {
+                stop_expected = true;
+                SimGpio::board().drive(cfg.emergency_pin, LOW);
+                check_neutral_at(now, t, "emergency stop pin");
+            } else if (step.verb == "release_pin") {
+                SimGpio::board().release(cfg.emergency_pin, HIGH);
+            } else if (step.verb == "reset") {
+                if (kart->reset_emergency_stop()) {
+                    last_beat_ns = t;
+                    was_stopped = false;
+                }
+            } else if (step.verb == "calibrate") {
+                if (args.empty()) {
+                    kart->calibrate_escs();
+                } else if (!kart->calibrate_esc(kart->motor_handle(args[0]))) {
+                    violation(t, "cannot calibrate " + args[0], step.line);
+                }
+            } else if (step.verb == "cancel") {
+                kart->cancel_calibration();
+            } else if (step.verb == "expect_speed") {
+                const double tolerance = args.size() > 1 ? number(args[1]) : 0.01;
+                for (std::size_t i = 0; i < motors; ++i) {
+                    const double speed = kart->current_speed(static_cast<MotorHandle>(i));
+                    if (std::abs(speed - number(args[0])) > tolerance) {
+                        violation(t, cfg.motors[i].name + " at " + format(speed) + " %, expected " + args[0],
+                                  step.line);
+                    }
+                }
+            } else if (step.verb == "expect_pulse") {
+                const double tolerance = args.size() > 1 ? number(args[1]) : 0.5;
+                for (std::size_t i = 0; i < motors; ++i) {
+                    const double pulse_us = outputs->pulse(cfg.motors[i].pin) / 1000.0;
+                    if (std::abs(pulse_us - number(args[0])) > tolerance) {
+                        violation(t, cfg.motors[i].name + " pulse " + format(pulse_us) + " us, expected " + args[0],
+                                  step.line);
+                    }
+                }
+            } else if (step.verb == "expect_estop") {
+                if (kart->emergency_stop_active() != (args[0] == "on")) {
+                    violation(t, std::string("emergency stop ") + (args[0] == "on" ? "not active" : "active"),
+                              step.line);
+                }
+            } else if (step.verb == "expect_vehicle") {
+                const double kmh = plant.speed_kmh();
+                if (kmh < number(args[0]) || kmh > number(args[1])) {
+                    violation(t, "vehicle at " + format(kmh) + " km/h, expected " + args[0] + ".." + args[1],
+                              step.line);
+                }
+            }
+        }
+
+        // The stop path writes neutral before returning, at the same virtual time
+        void check_neutral_at(std::int64_t now, std::int64_t t, const std::string& source) {
+            for (std::size_t i = 0; i < motors; ++i) {
+                const int pin = cfg.motors[i].pin;
+                if (outputs->pulse(pin) != cfg.pulses[i].neutral_ns || outputs->written_at(pin) != now) {
+                    violation(t, cfg.motors[i].name + " not at neutral right after the " + source);
+                }
+            }
+        }
+
+        void violation(std::int64_t t, const std::string& message, int line = 0) {
+            ++result.violations;
+            if (result.messages.size() < MAX_MESSAGES) {
+                std::string where = "t=" + format(t / 1e9) + " s";
+                if (line > 0) {
+                    where += " (line " + std::to_string(line) + ")";
+                }
+                result.messages.push_back(where + ": " + message);
+            }
+        }
+
+        static double number(const std::string& text) {
+            return std::strtod(text.c_str(), nullptr);
+        }
+
+        static std::string format(double value) {
+            char buf[32];
+            std::snprintf(buf, sizeof(buf), "%.3f", value);
+            return buf;
+        }
+    };
+};
+
+struct ReplayResult {
+    std::string error;                  // trace unusable with this configuration
+    std::uint64_t cycles = 0;           // cycles replayed and compared
+    std::uint64_t skipped = 0;          // cycles before the first rest point of a wrapped trace
+    std::uint64_t commands = 0;
+    std::uint64_t stops = 0;
+    std::int64_t recorded_ns = 0;       // control time replayed
+    double real_seconds = 0.0;
+    std::uint64_t differences = 0;
+    std::vector<std::string> messages;  // first differences
+
+    bool passed() const {
+        return error.empty() && differences == 0;
+    }
+
+    double speedup() const {
+        return real_seconds > 0.0 ? static_cast<double>(recorded_ns) / 1e9 / real_seconds : 0.0;
+    }
+};
+
+// Control clock that steps through a list of cycle times, one per
+// sleep_until(), then halts
+class TraceClock : public ControlClock {
+public:
+    using Tick = std::function<void(std::size_t step)>;
+
+    explicit TraceClock(std::vector<std::int64_t> cycle_times) : times(std::move(cycle_times)) {}
+
+    std::int64_t now_ns() override {
+        return times[index.load(std::memory_order_acquire)];
+    }
+
+    void sleep_until(std::int64_t) override {
+        const std::size_t next = index.load(std::memory_order_relaxed) + 1;
+        if (next >= times.size()) {
+            // Out of trace: keep the loop from spinning until it is stopped
+            std::this_thread::sleep_for(std::chrono::microseconds(500));
+            return;
+        }
+        index.store(next, std::memory_order_release);
+        if (tick) {
+            tick(next);
+        }
+    }
+
+    void set_tick(Tick fn) {
+        tick = std::move(fn);
+    }
+
+private:
+    std::vector<std::int64_t> times;
+    std::atomic<std::size_t> index{0};
+    Tick tick;
+};
+
+// Feed the inputs of a trace (commands, emergency stops and resets at the
+// cycle that saw them, cycle times) to a fresh controller at full speed and
+// compare every cycle's speeds and pulses with the recorded ones. Heartbeat
+// times are not traced, so the replayed watchdog is off and watchdog stops
+// come from the trace like all others. Reloaded configurations are not
+// traced: replay with the configuration that was active.
+class TraceReplay {
+public:
+    static constexpr std::size_t MAX_MESSAGES = 10;
+
+    TraceReplay(const KartConfig& kart_config, const TraceReader& reader)
+        : cfg(replay_config(kart_config)), motors(std::min(cfg.motors.size(), static_cast<std::size_t>(MAX_MOTORS))) {
+        if (reader.header().motor_count != motors ||
+            reader.header().control_frequency != static_cast<std::uint32_t>(cfg.control_frequency)) {
+            result.error = "trace has " + std::to_string(reader.header().motor_count) + " motors at " +
+                           std::to_string(reader.header().control_frequency) + " Hz, configuration " +
+                           std::to_string(motors) + " at " + std::to_string(cfg.control_frequency) + " Hz";
+            return;
+        }
+        group(reader.records());
+        if (reader.wrapped()) {
+            start_at_rest();
+        }
+        if (cycles.empty()) {
+            result.error = "no complete control cycle to replay";
+        }
+    }
+
+    ReplayResult run() {
+        if (!result.error.empty()) {
+            return result;
+        }
+        // A priming cycle before the first traced one, then one step per
+        // traced cycle plus one to compare the last
+        const std::int64_t period = 1000000000 / std::max(cfg.control_frequency, 1);
+        std::vector<std::int64_t> times{cycles.front().time_ns - period};
+        for (const Cycle& c : cycles) {
+            times.push_back(c.time_ns);
+        }
+        times.push_back(cycles.back().time_ns + period);
+        TraceClock clock(std::move(times));
+
+        SimGpio::board().release(cfg.emergency_pin, HIGH);
+        auto sink = std::make_unique<SimPwmBackend>(clock);
+        outputs = sink.get();
+        ESCController controller(cfg, std::move(sink), &clock);
+        kart = &controller;
+        ESCController::instance = &controller;
+        clock.set_tick([this](std::size_t step) { tick(step); });
+
+        const auto real_start = std::chrono::steady_clock::now();
+        if (controller.start()) {
+            std::unique_lock<std::mutex> lock(done_mutex);
+            done_cv.wait(lock, [this] { return done; });
+        } else {
+            result.error = "controller did not start";
+        }
+        controller.stop();
+        ESCController::instance = nullptr;
+
+        result.real_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - real_start).count();
+        result.recorded_ns = cycles.back().time_ns - cycles.front().time_ns + period;
+        return result;
+    }
+
+private:
+    struct Cycle {
+        std::int64_t time_ns;
+        std::uint32_t number;
+        std::vector<Command> commands;
+        int stop = 0;                      // 1: stop seen by this cycle, -1: reset
+        std::vector<TraceRecord> motors;
+    };
+
+    const KartConfig cfg;
+    const std::size_t motors;
+    std::vector<Cycle> cycles;
+    ReplayResult result;
+    SimPwmBackend* outputs = nullptr;
+    ESCController* kart = nullptr;
+
+    std::mutex done_mutex;
+    std::condition_variable done_cv;
+    bool done = false;
+
+    static KartConfig replay_config(const KartConfig& kart_config) {
+        KartConfig replay = simulation_config(kart_config);
+        replay.safety_limits.watchdog_timeout = 1e9;
+        return replay;
+    }
+
+    void group(const std::vector<TraceRecord>& records) {
+        for (const TraceRecord& rec : records) {
+            if (rec.type == TraceRecord::CYCLE) {
+                if (!cycles.empty() && cycles.back().motors.size() != motors) {
+                    cycles.pop_back();     // cut off by the ring
+                }
+                cycles.push_back(Cycle{rec.timestamp_ns, rec.cycle, {}, 0, {}});
+            } else if (cycles.empty() || rec.cycle != cycles.back().number) {
+                continue;                  // belongs to a cycle the ring lost
+            } else if (rec.type == TraceRecord::COMMAND) {
+                if (rec.code != Command::SHUTDOWN) {
+                    cycles.back().commands.emplace_back(static_cast<Command::Type>(rec.code), rec.motor, rec.speed,
+                                                        (rec.flags & TraceRecord::IMMEDIATE) != 0);
+                }
+            } else if (rec.type == TraceRecord::ESTOP) {
+                cycles.back().stop = 1;
+            } else if (rec.type == TraceRecord::ESTOP_RESET) {
+                cycles.back().stop = -1;
+            } else if (rec.type == TraceRecord::MOTOR) {
+                cycles.back().motors.push_back(rec);
+            }
+        }
+        // The last cycle may still have been running
+        if (!cycles.empty() && cycles.back().motors.size() != motors) {
+            cycles.pop_back();
+        }
+    }
+
+    // A wrapped trace starts mid-drive: replay from the first cycle after
+    // the state of a fresh controller, every motor at neutral for two
+    // cycles (a reversal passes zero for one) and no emergency stop. Stops
+    // are traced on change only: a reset before any stop means the trace
+    // began inside one
+    void start_at_rest() {
+        bool stopped = false;
+        for (const Cycle& c : cycles) {
+            if (c.stop != 0) {
+                stopped = c.stop < 0;
+                break;
+            }
+        }
+        bool previous_rest = false;
+        for (std::size_t i = 0; i < cycles.size(); ++i) {
+            bool rest = true;
+            for (std::size_t m = 0; m < motors; ++m) {
+                const TraceRecord& rec = cycles[i].motors[m];
+                rest = rest && rec.speed == 0.0 && rec.pulse_ns == cfg.pulses[m].neutral_ns;
+            }
+            if (cycles[i].stop != 0) {
+                stopped = cycles[i].stop > 0;
+            }
+            if (rest && previous_rest && !stopped) {
+                result.skipped = i + 1;
+                cycles.erase(cycles.begin(), cycles.begin() + static_cast<std::ptrdiff_t>(i + 1));
+                return;
+            }
+            previous_rest = rest;
+        }
+        result.skipped = cycles.size();
+        cycles.clear();
+    }
+
+    // Step k runs before cycle k - 1 of the trace (step 1: the first one)
+    void tick(std::size_t step) {
+        if (step >= 2) {
+            compare(cycles[step - 2]);
+        }
+        if (step - 1 < cycles.size()) {
+            inject(cycles[step - 1]);
+        } else {
+            std::lock_guard<std::mutex> lock(done_mutex);
+            done = true;
+            done_cv.notify_one();
+        }
+    }
+
+    // Commands were queued before a stop the cycle saw (later ones are
+    // refused) and after a reset it saw
+    void inject(const Cycle& c) {
+        if (c.stop < 0) {
+            kart->reset_emergency_stop();
+        }
+        for (const Command& cmd : c.commands) {
+            kart->replay_command(cmd);
+        }
+        result.commands += c.commands.size();
+        if (c.stop > 0) {
+            kart->emergency_stop_all();
+            ++result.stops;
+        }
+    }
+
+    void compare(const Cycle& c) {
+        ++result.cycles;
+        for (std::size_t m = 0; m < motors; ++m) {
+            const double speed = kart->current_speed(static_cast<MotorHandle>(m));
+            const std::uint32_t pulse = outputs->pulse(cfg.motors[m].pin);
+            const TraceRecord& rec = c.motors[m];
+            if (speed == rec.speed && pulse == rec.pulse_ns) {
+                continue;
+            }
+            ++result.differences;
+            if (result.messages.size() < MAX_MESSAGES) {
+                char buf[160];
+                std::snprintf(buf, sizeof(buf), "cycle %u (+%.3f s) %s: speed %.4f pulse %u ns, recorded %.4f / %u ns",
+                              c.number, (c.time_ns - cycles.front().time_ns) / 1e9, cfg.motors[m].name.c_str(),
+                              speed, pulse, rec.speed, rec.pulse_ns);
+                result.messages.push_back(buf);
+            }
+        }
+    }
+};
+
+#endif // KART_SIM_H
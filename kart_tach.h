@@ -0,0 +1,455 @@
+/*
+ * Tachometer inputs: per-motor RPM from GPIO edge events
+ * ======================================================
+ *
+ * A tachometer (hall sensor, optical fork, or the RPM output of the ESC)
+ * gives a number of rising edges per revolution on a GPIO. Edges are read
+ * in batches: TachSource::read() waits for one wakeup and returns every
+ * edge that arrived meanwhile, with kernel timestamps, into a buffer the
+ * caller reuses. GpiodTachSource does that with libgpiod v2 edge events
+ * (built with KART_HAVE_GPIOD, see the Makefile); SyntheticTachSource
+ * generates edges for given speeds, for tests and benches.
+ *
+ * The Tachometer thread feeds each motor's edges into an RpmWindow: the
+ * timestamps of the last window_ms (at least two edges), kept in a ring
+ * with running head and tail, so an edge costs a store and a compare. After
+ * every read it publishes edge count, span and newest edge of each window
+ * and the time of the read into a per-motor seqlock slot. rpm() reads a
+ * slot without blocking the tachometer thread:
+ *
+ *   rpm = (edges - 1) / span / pulses_per_rev * 60 s
+ *
+ * capped by what the silence between the newest edge and the read still
+ * allows, so a motor that stops reads as slowing down and then 0 instead
+ * of its last speed. Timestamps are CLOCK_MONOTONIC nanoseconds.
+ */
+
+#ifndef KART_TACH_H
+#define KART_TACH_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <time.h>
+#ifdef KART_HAVE_GPIOD
+#include <gpiod.h>
+#endif
+
+struct TachEdge {
+    std::uint32_t motor;          // index into the controller's motors
+    std::uint64_t timestamp_ns;   // CLOCK_MONOTONIC
+};
+
+inline std::uint64_t tach_now_ns() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<std::uint64_t>(ts.tv_sec) * 1000000000u + static_cast<std::uint64_t>(ts.tv_nsec);
+}
+
+class TachSource {
+public:
+    virtual ~TachSource() = default;
+
+    virtual const char* name() const = 0;
+
+    // Wait up to timeout for edges and return up to max of them (0 on
+    // timeout); edges of one motor come in time order
+    virtual std::size_t read(TachEdge* edges, std::size_t max, std::chrono::milliseconds timeout) = 0;
+};
+
+// Edge timestamps of one motor over a moving window (single writer)
+class RpmWindow {
+public:
+    static constexpr std::size_t CAPACITY = 4096;   // edges; more than that shortens the window
+
+    struct Snapshot {
+        std::uint32_t edges = 0;        // edges in the window
+        std::uint64_t span_ns = 0;      // oldest to newest edge
+        std::uint64_t newest_ns = 0;
+    };
+
+    explicit RpmWindow(std::uint64_t window_ns = 50000000) : window(window_ns) {}
+
+    void add(std::uint64_t timestamp_ns) {
+        times[head % CAPACITY] = timestamp_ns;
+        ++head;
+        if (head - tail > CAPACITY) {
+            tail = head - CAPACITY;
+        }
+        while (head - tail > 2 && timestamp_ns - times[tail % CAPACITY] > window) {
+            ++tail;
+        }
+    }
+
+    Snapshot snapshot() const {
+        Snapshot s;
+        s.edges = static_cast<std::uint32_t>(head - tail);
+        if (s.edges > 0) {
+            s.newest_ns = times[(head - 1) % CAPACITY];
+            s.span_ns = s.newest_ns - times[tail % CAPACITY];
+        }
+        return s;
+    }
+
+    // Revolutions per minute from a snapshot, edges known up to now_ns
+    static double rpm(const Snapshot& s, double pulses_per_rev, std::uint64_t now_ns) {
+        if (s.edges < 2 || s.span_ns == 0 || pulses_per_rev <= 0.0) {
+            return 0.0;
+        }
+        const double per_edge_ns = static_cast<double>(s.span_ns) / (s.edges - 1);
+        // No edge for longer than an interval: at most this fast any more
+        const double since_ns = now_ns > s.newest_ns ? static_cast<double>(now_ns - s.newest_ns) : 0.0;
+        return 60e9 / (std::max(per_edge_ns, since_ns) * pulses_per_rev);
+    }
+
+private:
+    std::uint64_t window;
+    std::uint64_t times[CAPACITY] = {};
+    std::uint64_t head = 0;     // next slot
+    std::uint64_t tail = 0;     // oldest edge in the window
+};
+
+class Tachometer {
+public:
+    static constexpr std::size_t BATCH = 1024;     // edges per read
+    // Longest silence before a stopped motor's speed is published again
+    static constexpr std::chrono::milliseconds READ_TIMEOUT{10};
+
+    struct Stats {
+        std::uint64_t batches = 0;     // reads that returned edges
+        std::uint64_t edges = 0;
+        std::uint64_t max_batch = 0;
+    };
+
+    // pulses_per_rev per motor; 0 for motors without a tachometer
+    Tachometer(std::vector<double> pulses_per_rev, std::chrono::milliseconds window)
+        : pulses(std::move(pulses_per_rev)),
+          windows(pulses.size(), RpmWindow(static_cast<std::uint64_t>(window.count()) * 1000000u)),
+          slots(std::make_unique<Slot[]>(pulses.size())) {}
+
+    ~Tachometer() {
+        stop();
+    }
+
+    Tachometer(const Tachometer&) = delete;
+    Tachometer& operator=(const Tachometer&) = delete;
+
+    bool start(std::unique_ptr<TachSource> edge_source) {
+        if (!edge_source || thread.joinable()) {
+            return false;
+        }
+        source = std::move(edge_source);
+        running.store(true);
+        thread = std::thread(&Tachometer::run, this);
+        return true;
+    }
+
+    void stop() {
+        running.store(false);
+        if (thread.joinable()) {
+            thread.join();
+        }
+    }
+
+    std::thread::native_handle_type native_handle() {
+        return thread.native_handle();
+    }
+
+    bool active() const {
+        return running.load(std::memory_order_relaxed);
+    }
+
+    std::size_t size() const {
+        return pulses.size();
+    }
+
+    bool has_sensor(std::size_t motor) const {
+        return motor < pulses.size() && pulses[motor] > 0.0;
+    }
+
+    // Lock-free; any thread
+    double rpm(std::size_t motor) const {
+        if (!has_sensor(motor)) {
+            return 0.0;
+        }
+        std::uint64_t read_ns;
+        const RpmWindow::Snapshot s = read(motor, read_ns);
+        return RpmWindow::rpm(s, pulses[motor], read_ns);
+    }
+
+    // Feed one read as the thread does: edges up to read_ns (tests, replay
+    // of recorded edges)
+    void process(const TachEdge* edges, std::size_t count, std::uint64_t read_ns) {
+        for (std::size_t i = 0; i < count; ++i) {
+            const std::uint32_t motor = edges[i].motor;
+            if (motor < windows.size()) {
+                windows[motor].add(edges[i].timestamp_ns);
+            }
+        }
+        for (std::size_t motor = 0; motor < windows.size(); ++motor) {
+            if (pulses[motor] > 0.0) {
+                publish(motor, windows[motor].snapshot(), read_ns);
+            }
+        }
+        if (count > 0) {
+            batches.fetch_add(1, std::memory_order_relaxed);
+            edges_seen.fetch_add(count, std::memory_order_relaxed);
+            if (count > max_batch.load(std::memory_order_relaxed)) {
+                max_batch.store(count, std::memory_order_relaxed);
+            }
+        }
+    }
+
+    Stats stats() const {
+        return Stats{batches.load(std::memory_order_relaxed), edges_seen.load(std::memory_order_relaxed),
+                     max_batch.load(std::memory_order_relaxed)};
+    }
+
+    std::string summary() const {
+        const Stats s = stats();
+        char buf[128];
+        std::snprintf(buf, sizeof(buf), "Tach(%s edges:%llu batches:%llu max_batch:%llu)",
+                      source ? source->name() : "none", static_cast<unsigned long long>(s.edges),
+                      static_cast<unsigned long long>(s.batches), static_cast<unsigned long long>(s.max_batch));
+        return buf;
+    }
+
+private:
+    // Seqlock slot as in kart_motor_state.h
+    struct alignas(64) Slot {
+        std::atomic<std::uint32_t> sequence{0};
+        std::atomic<std::uint32_t> edges{0};
+        std::atomic<std::uint64_t> span_ns{0};
+        std::atomic<std::uint64_t> newest_ns{0};
+        std::atomic<std::uint64_t> read_ns{0};
+    };
+
+    const std::vector<double> pulses;
+    std::vector<RpmWindow> windows;              // tachometer thread only
+    std::unique_ptr<Slot[]> slots;
+    std::unique_ptr<TachSource> source;
+    TachEdge buffer[BATCH];                      // reused by every read
+    std::thread thread;
+    std::atomic<bool> running{false};
+
+    std::atomic<std::uint64_t> batches{0};
+    std::atomic<std::uint64_t> edges_seen{0};
+    std::atomic<std::uint64_t> max_batch{0};
+
+    void run() {
+        while (running.load(std::memory_order_relaxed)) {
+            // Reads without edges still publish the silence of stopped motors
+            const std::size_t count = source->read(buffer, BATCH, READ_TIMEOUT);
+            process(buffer, count, tach_now_ns());
+        }
+    }
+
+    void publish(std::size_t motor, const RpmWindow::Snapshot& s, std::uint64_t read_ns) {
+        Slot& slot = slots[motor];
+        const std::uint32_t sequence = slot.sequence.load(std::memory_order_relaxed);
+        slot.sequence.store(sequence + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        slot.edges.store(s.edges, std::memory_order_relaxed);
+        slot.span_ns.store(s.span_ns, std::memory_order_relaxed);
+        slot.newest_ns.store(s.newest_ns, std::memory_order_relaxed);
+        slot.read_ns.store(read_ns, std::memory_order_relaxed);
+        slot.sequence.store(sequence + 2, std::memory_order_release);
+    }
+
+    RpmWindow::Snapshot read(std::size_t motor, std::uint64_t& read_ns) const {
+        const Slot& slot = slots[motor];
+        RpmWindow::Snapshot s;
+        for (;;) {
+            const std::uint32_t before = slot.sequence.load(std::memory_order_acquire);
+            if (before & 1) {
+                continue;
+            }
+            s.edges = slot.edges.load(std::memory_order_relaxed);
+            s.span_ns = slot.span_ns.load(std::memory_order_relaxed);
+            s.newest_ns = slot.newest_ns.load(std::memory_order_relaxed);
+            read_ns = slot.read_ns.load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (slot.sequence.load(std::memory_order_relaxed) == before) {
+                return s;
+            }
+        }
+    }
+};
+
+// Edges of motors turning at set speeds, on CLOCK_MONOTONIC. A read waits
+// for the next edge (at least the batch interval) and returns every edge
+// due by then, like a kernel event queue filled between wakeups.
+class SyntheticTachSource : public TachSource {
+public:
+    static constexpr std::size_t MAX_MOTORS = 64;
+
+    explicit SyntheticTachSource(std::chrono::microseconds batch_interval = std::chrono::microseconds(1000))
+        : interval_ns(static_cast<std::uint64_t>(batch_interval.count()) * 1000u) {
+        for (std::size_t m = 0; m < MAX_MOTORS; ++m) {
+            period_ns[m].store(0, std::memory_order_relaxed);
+            next_ns[m] = 0;
+        }
+    }
+
+    const char* name() const override {
+        return "synthetic";
+    }
+
+    // Any thread; 0 stops the edges
+    void set_rpm(std::size_t motor, double rpm, double pulses_per_rev) {
+        if (motor >= MAX_MOTORS) {
+            return;
+        }
+        const double edges_per_second = rpm / 60.0 * pulses_per_rev;
+        period_ns[motor].store(edges_per_second > 0.0 ? static_cast<std::uint64_t>(1e9 / edges_per_second) : 0,
+                               std::memory_order_relaxed);
+    }
+
+    std::uint64_t generated() const {
+        return total.load(std::memory_order_relaxed);
+    }
+
+    std::size_t read(TachEdge* edges, std::size_t max, std::chrono::milliseconds timeout) override {
+        const std::uint64_t start = tach_now_ns();
+        const std::uint64_t deadline = start + static_cast<std::uint64_t>(timeout.count()) * 1000000u;
+        std::uint64_t first = UINT64_MAX;
+        for (std::size_t m = 0; m < MAX_MOTORS; ++m) {
+            if (period_ns[m].load(std::memory_order_relaxed) != 0) {
+                first = std::min(first, next_edge(m, start));
+            }
+        }
+        sleep_until(std::min(deadline, std::max(start + interval_ns, first == UINT64_MAX ? 0 : first)));
+
+        const std::uint64_t now = tach_now_ns();
+        std::size_t count = 0;
+        for (std::size_t m = 0; m < MAX_MOTORS && count < max; ++m) {
+            const std::uint64_t period = period_ns[m].load(std::memory_order_relaxed);
+            if (period == 0) {
+                next_ns[m] = 0;
+                continue;
+            }
+            for (std::uint64_t t = next_edge(m, now); t <= now && count < max; t += period) {
+                edges[count++] = TachEdge{static_cast<std::uint32_t>(m), t};
+                next_ns[m] = t + period;
+            }
+        }
+        total.fetch_add(count, std::memory_order_relaxed);
+        return count;
+    }
+
+private:
+    const std::uint64_t interval_ns;
+    std::atomic<std::uint64_t> period_ns[MAX_MOTORS];
+    std::uint64_t next_ns[MAX_MOTORS];           // reader thread only
+    std::atomic<std::uint64_t> total{0};
+
+    // A motor that just started turning has its first edge one period on
+    std::uint64_t next_edge(std::size_t motor, std::uint64_t now) {
+        if (next_ns[motor] == 0) {
+            next_ns[motor] = now + period_ns[motor].load(std::memory_order_relaxed);
+        }
+        return next_ns[motor];
+    }
+
+    static void sleep_until(std::uint64_t ns) {
+        timespec ts;
+        ts.tv_sec = static_cast<time_t>(ns / 1000000000u);
+        ts.tv_nsec = static_cast<long>(ns % 1000000000u);
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, nullptr) != 0) {
+        }
+    }
+};
+
+#ifdef KART_HAVE_GPIOD
+// Rising edges of the tachometer lines through the libgpiod v2 line request;
+// one wait and one read per batch into a reused event buffer
+class GpiodTachSource : public TachSource {
+public:
+    // lines[motor]: GPIO line offset, -1 for motors without a tachometer
+    GpiodTachSource(const std::string& chip_path, const std::vector<int>& lines) {
+        for (std::size_t motor = 0; motor < lines.size(); ++motor) {
+            if (lines[motor] >= 0) {
+                offsets.push_back(static_cast<unsigned int>(lines[motor]));
+                motors.push_back(static_cast<std::uint32_t>(motor));
+            }
+        }
+        chip = gpiod_chip_open(chip_path.c_str());
+        if (chip == nullptr || offsets.empty()) {
+            return;
+        }
+        gpiod_line_settings* settings = gpiod_line_settings_new();
+        gpiod_line_config* line_config = gpiod_line_config_new();
+        gpiod_request_config* request_config = gpiod_request_config_new();
+        if (settings != nullptr && line_config != nullptr && request_config != nullptr &&
+            gpiod_line_settings_set_direction(settings, GPIOD_LINE_DIRECTION_INPUT) == 0 &&
+            gpiod_line_settings_set_edge_detection(settings, GPIOD_LINE_EDGE_RISING) == 0 &&
+            gpiod_line_settings_set_event_clock(settings, GPIOD_LINE_CLOCK_MONOTONIC) == 0 &&
+            gpiod_line_config_add_line_settings(line_config, offsets.data(), offsets.size(), settings) == 0) {
+            gpiod_request_config_set_consumer(request_config, "kart_tach");
+            gpiod_request_config_set_event_buffer_size(request_config, Tachometer::BATCH * 4);
+            request = gpiod_chip_request_lines(chip, request_config, line_config);
+        }
+        gpiod_request_config_free(request_config);
+        gpiod_line_config_free(line_config);
+        gpiod_line_settings_free(settings);
+        events = gpiod_edge_event_buffer_new(Tachometer::BATCH);
+    }
+
+    ~GpiodTachSource() override {
+        if (events != nullptr) {
+            gpiod_edge_event_buffer_free(events);
+        }
+        if (request != nullptr) {
+            gpiod_line_request_release(request);
+        }
+        if (chip != nullptr) {
+            gpiod_chip_close(chip);
+        }
+    }
+
+    GpiodTachSource(const GpiodTachSource&) = delete;
+    GpiodTachSource& operator=(const GpiodTachSource&) = delete;
+
+    const char* name() const override {
+        return "gpiod";
+    }
+
+    bool ok() const {
+        return request != nullptr && events != nullptr;
+    }
+
+    std::size_t read(TachEdge* edges, std::size_t max, std::chrono::milliseconds timeout) override {
+        if (!ok() || gpiod_line_request_wait_edge_events(request, timeout.count() * 1000000) <= 0) {
+            return 0;
+        }
+        const int got = gpiod_line_request_read_edge_events(request, events, std::min(max, Tachometer::BATCH));
+        std::size_t count = 0;
+        for (int i = 0; i < got; ++i) {
+            gpiod_edge_event* event = gpiod_edge_event_buffer_get_event(events, static_cast<unsigned long>(i));
+            const unsigned int offset = gpiod_edge_event_get_line_offset(event);
+            for (std::size_t k = 0; k < offsets.size(); ++k) {
+                if (offsets[k] == offset) {
+                    edges[count++] = TachEdge{motors[k], gpiod_edge_event_get_timestamp_ns(event)};
+                    break;
+                }
+            }
+        }
+        return count;
+    }
+
+private:
+    std::vector<unsigned int> offsets;
+    std::vector<std::uint32_t> motors;
+    gpiod_chip* chip = nullptr;
+    gpiod_line_request* request = nullptr;
+    gpiod_edge_event_buffer* events = nullptr;
+};
+#endif // KART_HAVE_GPIOD
+
+#endif // KART_TACH_H
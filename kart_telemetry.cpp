@@ -0,0 +1,119 @@
+/*
+ * Telemetry dump for a running kart controller
+ * ============================================
+ *
+ * Reads the shared-memory telemetry segment (kart_telemetry.h) without
+ * disturbing the controller and prints it as text or one JSON object per
+ * line.
+ *
+ * Usage: kart_telemetry [-n NAME] [-w MS] [-c COUNT] [-j]
+ *   -n NAME   segment name (default /kart_telemetry)
+ *   -w MS     keep printing every MS milliseconds
+ *   -c COUNT  stop after COUNT dumps (with -w)
+ *   -j        JSON lines instead of text
+ *
+ * Compile with: g++ -std=c++20 -o kart_telemetry kart_telemetry.cpp
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include "kart_telemetry.h"
+
+static void print_text(const TelemetryHeader& header, const TelemetryData& data) {
+    std::printf("publish %llu  running %u  emergency_stop %u  control %u Hz\n",
+                static_cast<unsigned long long>(data.publishes), data.running, data.emergency_stop,
+                header.control_frequency);
+    std::printf("cycles %llu  overruns %llu  missed %llu  late %llu\n",
+                static_cast<unsigned long long>(data.cycles), static_cast<unsigned long long>(data.overruns),
+                static_cast<unsigned long long>(data.missed), static_cast<unsigned long long>(data.late));
+    std::printf("wake-up p99 %.1f us max %.1f us  execution p99 %.1f us max %.1f us\n", data.wakeup_p99_ns / 1000.0,
+                data.wakeup_max_ns / 1000.0, data.execution_p99_ns / 1000.0, data.execution_max_ns / 1000.0);
+    std::printf("emergency stops %llu  latency max %.1f us\n", static_cast<unsigned long long>(data.estop_count),
+                data.estop_latency_max_ns / 1000.0);
+    for (std::uint32_t i = 0; i < header.motor_count && i < TELEMETRY_MAX_MOTORS; ++i) {
+        std::printf("  %-*.*s pin %2d  current %7.2f %%  target %7.2f %%\n", static_cast<int>(TELEMETRY_NAME_BYTES),
+                    static_cast<int>(TELEMETRY_NAME_BYTES), header.motor_names[i], header.motor_pins[i],
+                    data.current_speed[i], data.target_speed[i]);
+    }
+}
+
+static void print_json(const TelemetryHeader& header, const TelemetryData& data) {
+    std::printf("{\"timestamp_ns\":%llu,\"publishes\":%llu,\"running\":%u,\"emergency_stop\":%u,"
+                "\"cycles\":%llu,\"overruns\":%llu,\"missed\":%llu,\"late\":%llu,"
+                "\"wakeup_p99_ns\":%llu,\"wakeup_max_ns\":%llu,\"execution_p99_ns\":%llu,\"execution_max_ns\":%llu,"
+                "\"estop_count\":%llu,\"estop_latency_max_ns\":%llu,\"motors\":[",
+                static_cast<unsigned long long>(data.timestamp_ns), static_cast<unsigned long long>(data.publishes),
+                data.running, data.emergency_stop, static_cast<unsigned long long>(data.cycles),
+                static_cast<unsigned long long>(data.overruns), static_cast<unsigned long long>(data.missed),
+                static_cast<unsigned long long>(data.late), static_cast<unsigned long long>(data.wakeup_p99_ns),
+                static_cast<unsigned long long>(data.wakeup_max_ns),
+                static_cast<unsigned long long>(data.execution_p99_ns),
+                static_cast<unsigned long long>(data.execution_max_ns),
+                static_cast<unsigned long long>(data.estop_count),
+                static_cast<unsigned long long>(data.estop_latency_max_ns));
+    for (std::uint32_t i = 0; i < header.motor_count && i < TELEMETRY_MAX_MOTORS; ++i) {
+        // Names come from kart_config.ini: plain identifiers, no escaping needed
+        std::printf("%s{\"name\":\"%.*s\",\"pin\":%d,\"current\":%.4f,\"target\":%.4f}", i ? "," : "",
+                    static_cast<int>(TELEMETRY_NAME_BYTES), header.motor_names[i], header.motor_pins[i],
+                    data.current_speed[i], data.target_speed[i]);
+    }
+    std::printf("]}\n");
+}
+
+int main(int argc, char** argv) {
+    const char* name = "/kart_telemetry";
+    long interval_ms = 0;
+    long count = 0;
+    bool json = false;
+
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            name = argv[++i];
+        } else if (std::strcmp(argv[i], "-w") == 0 && i + 1 < argc) {
+            interval_ms = std::atol(argv[++i]);
+        } else if (std::strcmp(argv[i], "-c") == 0 && i + 1 < argc) {
+            count = std::atol(argv[++i]);
+        } else if (std::strcmp(argv[i], "-j") == 0) {
+            json = true;
+        } else {
+            std::fprintf(stderr, "Usage: %s [-n NAME] [-w MS] [-c COUNT] [-j]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    TelemetryReader reader;
+    switch (reader.open(name)) {
+        case TelemetryReader::OK:
+            break;
+        case TelemetryReader::INCOMPATIBLE:
+            std::fprintf(stderr, "kart_telemetry: %s has an unsupported layout (version %u expected)\n", name,
+                         TELEMETRY_VERSION);
+            return 1;
+        default:
+            std::fprintf(stderr, "kart_telemetry: %s not found - is kart_control running?\n", name);
+            return 1;
+    }
+
+    for (long dumps = 1;; ++dumps) {
+        TelemetryData data;
+        if (reader.read(data) != TelemetryReader::OK) {
+            std::fprintf(stderr, "kart_telemetry: no consistent snapshot\n");
+            return 1;
+        }
+        if (json) {
+            print_json(reader.header(), data);
+        } else {
+            print_text(reader.header(), data);
+        }
+        std::fflush(stdout);
+
+        if (interval_ms <= 0 || (count > 0 && dumps >= count) || (data.publishes > 0 && !data.running)) {
+            break;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(interval_ms));
+    }
+    return 0;
+}
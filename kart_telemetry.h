@@ -0,0 +1,285 @@
+/*
+ * Shared-memory telemetry for the kart controller
+ * ===============================================
+ *
+ * The control loop publishes its state once per cycle into a POSIX shared
+ * memory segment (default /kart_telemetry). Any number of processes can
+ * read it (dashboard, data logger, kart_telemetry CLI) without ever
+ * touching the controller's locks or slowing the loop down.
+ *
+ * The segment is guarded by a seqlock: the writer makes the sequence odd,
+ * writes the data and makes it even again; a reader copies the data and
+ * retries if the sequence was odd or changed meanwhile. Data is copied in
+ * 32-bit relaxed atomic words, which are lock-free on every Pi, so torn
+ * reads are only ever detected, never undefined.
+ *
+ * Segment layout (all little-endian, native alignment):
+ *
+ *   TelemetryHeader   magic, version, sizes, motor names and pins (static)
+ *   sequence          seqlock counter
+ *   TelemetryData     everything that changes per cycle
+ *
+ * Bump TELEMETRY_VERSION whenever the layout changes.
+ */
+
+#ifndef KART_TELEMETRY_H
+#define KART_TELEMETRY_H
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <string>
+#include <type_traits>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static constexpr std::uint32_t TELEMETRY_MAGIC = 0x4b54454c;   // "KTEL"
+static constexpr std::uint32_t TELEMETRY_VERSION = 1;
+static constexpr std::size_t TELEMETRY_MAX_MOTORS = 32;
+static constexpr std::size_t TELEMETRY_NAME_BYTES = 24;
+
+// Written once when the segment is created
+struct TelemetryHeader {
+    std::uint32_t magic;
+    std::uint32_t version;
+    std::uint32_t header_size;
+    std::uint32_t data_size;
+    std::uint32_t motor_count;
+    std::uint32_t control_frequency;
+    std::int32_t writer_pid;
+    std::int32_t motor_pins[TELEMETRY_MAX_MOTORS];
+    char motor_names[TELEMETRY_MAX_MOTORS][TELEMETRY_NAME_BYTES];
+};
+
+// Published every control cycle
+struct TelemetryData {
+    std::uint64_t timestamp_ns;           // CLOCK_MONOTONIC of the publish
+    std::uint64_t publishes;
+    std::uint32_t running;
+    std::uint32_t emergency_stop;
+    std::uint64_t cycles;
+    std::uint64_t overruns;
+    std::uint64_t missed;
+    std::uint64_t late;
+    std::uint64_t wakeup_p99_ns;
+    std::uint64_t wakeup_max_ns;
+    std::uint64_t execution_p99_ns;
+    std::uint64_t execution_max_ns;
+    std::uint64_t estop_count;
+    std::uint64_t estop_latency_max_ns;
+    double current_speed[TELEMETRY_MAX_MOTORS];
+    double target_speed[TELEMETRY_MAX_MOTORS];
+};
+
+static_assert(std::is_trivially_copyable_v<TelemetryData> && sizeof(TelemetryData) % 4 == 0,
+              "TelemetryData is copied in 32-bit words");
+
+namespace telemetry_detail {
+
+struct Segment {
+    TelemetryHeader header;
+    alignas(64) std::atomic<std::uint32_t> sequence;
+    alignas(64) std::uint32_t data[sizeof(TelemetryData) / 4];
+};
+
+static_assert(std::atomic<std::uint32_t>::is_always_lock_free, "seqlock needs lock-free 32-bit atomics");
+
+inline void store_words(std::uint32_t* to, const TelemetryData& from) {
+    std::uint32_t words[sizeof(TelemetryData) / 4];
+    std::memcpy(words, &from, sizeof(words));
+    for (std::size_t i = 0; i < sizeof(words) / 4; ++i) {
+        std::atomic_ref<std::uint32_t>(to[i]).store(words[i], std::memory_order_relaxed);
+    }
+}
+
+inline void load_words(TelemetryData& to, std::uint32_t* from) {
+    std::uint32_t words[sizeof(TelemetryData) / 4];
+    for (std::size_t i = 0; i < sizeof(words) / 4; ++i) {
+        words[i] = std::atomic_ref<std::uint32_t>(from[i]).load(std::memory_order_relaxed);
+    }
+    std::memcpy(&to, words, sizeof(words));
+}
+
+} // namespace telemetry_detail
+
+// Control loop side: one writer per segment
+class TelemetryWriter {
+public:
+    TelemetryWriter() = default;
+
+    ~TelemetryWriter() {
+        close();
+    }
+
+    TelemetryWriter(const TelemetryWriter&) = delete;
+    TelemetryWriter& operator=(const TelemetryWriter&) = delete;
+
+    // Create the segment and fill in the static header (motor_count,
+    // control_frequency, pins and names; the rest is set here). A segment
+    // left over from an earlier run is replaced: readers that still map
+    // it keep the old copy until they reopen.
+    bool create(const std::string& shm_name, const TelemetryHeader& static_info) {
+        close();
+        ::shm_unlink(shm_name.c_str());
+        int fd = ::shm_open(shm_name.c_str(), O_CREAT | O_EXCL | O_RDWR | O_CLOEXEC, 0644);
+        if (fd < 0) {
+            return false;
+        }
+        if (::ftruncate(fd, sizeof(telemetry_detail::Segment)) != 0) {
+            ::close(fd);
+            ::shm_unlink(shm_name.c_str());
+            return false;
+        }
+        void* memory = ::mmap(nullptr, sizeof(telemetry_detail::Segment), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (memory == MAP_FAILED) {
+            ::shm_unlink(shm_name.c_str());
+            return false;
+        }
+        segment = static_cast<telemetry_detail::Segment*>(memory);
+        name = shm_name;
+
+        new (&segment->sequence) std::atomic<std::uint32_t>(0);
+        TelemetryHeader header = static_info;
+        header.magic = 0;
+        header.version = TELEMETRY_VERSION;
+        header.header_size = sizeof(TelemetryHeader);
+        header.data_size = sizeof(TelemetryData);
+        header.writer_pid = static_cast<std::int32_t>(::getpid());
+        std::memcpy(&segment->header, &header, sizeof(header));
+        TelemetryData empty{};
+        telemetry_detail::store_words(segment->data, empty);
+        // Readers accept the segment once the magic is there
+        std::atomic_ref<std::uint32_t>(segment->header.magic).store(TELEMETRY_MAGIC, std::memory_order_release);
+        return true;
+    }
+
+    bool is_open() const {
+        return segment != nullptr;
+    }
+
+    // Seqlock write; never blocks, never allocates
+    void publish(const TelemetryData& data) {
+        if (segment == nullptr) {
+            return;
+        }
+        const std::uint32_t sequence = segment->sequence.load(std::memory_order_relaxed);
+        segment->sequence.store(sequence + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        telemetry_detail::store_words(segment->data, data);
+        segment->sequence.store(sequence + 2, std::memory_order_release);
+    }
+
+    // Unmap and remove the segment (publish running = 0 first so that
+    // readers holding it see the controller stop)
+    void close() {
+        if (segment == nullptr) {
+            return;
+        }
+        ::munmap(segment, sizeof(telemetry_detail::Segment));
+        ::shm_unlink(name.c_str());
+        segment = nullptr;
+    }
+
+private:
+    telemetry_detail::Segment* segment = nullptr;
+    std::string name;
+};
+
+// Reader side (reader library): any number of readers, any process
+class TelemetryReader {
+public:
+    enum Status { OK, NOT_FOUND, INCOMPATIBLE, BUSY };
+
+    TelemetryReader() = default;
+
+    ~TelemetryReader() {
+        close();
+    }
+
+    TelemetryReader(const TelemetryReader&) = delete;
+    TelemetryReader& operator=(const TelemetryReader&) = delete;
+
+    Status open(const std::string& shm_name) {
+        close();
+        int fd = ::shm_open(shm_name.c_str(), O_RDONLY | O_CLOEXEC, 0);
+        if (fd < 0) {
+            return NOT_FOUND;
+        }
+        struct stat info;
+        if (::fstat(fd, &info) != 0 || static_cast<std::size_t>(info.st_size) < sizeof(telemetry_detail::Segment)) {
+            ::close(fd);
+            return INCOMPATIBLE;
+        }
+        // Read-only is enough: 32-bit atomic loads are plain loads
+        void* memory = ::mmap(nullptr, sizeof(telemetry_detail::Segment), PROT_READ, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (memory == MAP_FAILED) {
+            return NOT_FOUND;
+        }
+        segment = static_cast<telemetry_detail::Segment*>(memory);
+        std::uint32_t magic = std::atomic_ref<std::uint32_t>(segment->header.magic).load(std::memory_order_acquire);
+        if (magic != TELEMETRY_MAGIC || segment->header.version != TELEMETRY_VERSION ||
+            segment->header.header_size != sizeof(TelemetryHeader) ||
+            segment->header.data_size != sizeof(TelemetryData)) {
+            close();
+            return INCOMPATIBLE;
+        }
+        std::memcpy(&static_info, &segment->header, sizeof(static_info));
+        return OK;
+    }
+
+    bool is_open() const {
+        return segment != nullptr;
+    }
+
+    const TelemetryHeader& header() const {
+        return static_info;
+    }
+
+    // Consistent copy of the latest data; BUSY if the writer kept
+    // overlapping every attempt
+    Status read(TelemetryData& data, int max_attempts = 1000) const {
+        if (segment == nullptr) {
+            return NOT_FOUND;
+        }
+        for (int attempt = 0; attempt < max_attempts; ++attempt) {
+            const std::uint32_t before = segment->sequence.load(std::memory_order_acquire);
+            if (before & 1) {
+                continue;
+            }
+            telemetry_detail::load_words(data, segment->data);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (segment->sequence.load(std::memory_order_relaxed) == before) {
+                return OK;
+            }
+        }
+        return BUSY;
+    }
+
+    // Live data words in the mapping, for zero-copy readers that check
+    // sequence() before and after (even and unchanged: consistent)
+    const void* live_data() const {
+        return segment != nullptr ? segment->data : nullptr;
+    }
+
+    std::uint32_t sequence() const {
+        return segment != nullptr ? segment->sequence.load(std::memory_order_acquire) : 0;
+    }
+
+    void close() {
+        if (segment != nullptr) {
+            ::munmap(segment, sizeof(telemetry_detail::Segment));
+            segment = nullptr;
+        }
+    }
+
+private:
+    telemetry_detail::Segment* segment = nullptr;
+    TelemetryHeader static_info{};
+};
+
+#endif // KART_TELEMETRY_H
@@ -0,0 +1,265 @@
+/*
+ * Control loop timing for the kart controller
+ * ===========================================
+ *
+ * CycleTimer runs a periodic loop on absolute CLOCK_MONOTONIC deadlines
+ * (clock_nanosleep with TIMER_ABSTIME), so wake-up latency never adds up to
+ * drift. Every cycle records:
+ *
+ * - wake-up error: actual cycle start minus its deadline
+ * - execution time: cycle start to the next wait()
+ * - overruns: the work finished after the next deadline
+ * - missed cycles: whole periods skipped to get back on the time grid
+ * - late cycles: wake-up error above the late threshold
+ *
+ * Statistics are written by the loop thread only and can be read from any
+ * thread at any time (relaxed atomics, no locks).
+ *
+ * The loop normally runs on CLOCK_MONOTONIC; set_clock() substitutes a
+ * ControlClock, e.g. the virtual time of the simulator (kart_sim.h).
+ */
+
+#ifndef KART_TIMING_H
+#define KART_TIMING_H
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <time.h>
+
+// Log2 histogram of durations in nanoseconds. Bucket 0 holds 0 ns, bucket
+// k holds [2^(k-1), 2^k) ns, the last bucket everything above.
+class LatencyHistogram {
+public:
+    static constexpr int BUCKETS = 32;
+
+    struct Snapshot {
+        std::uint64_t count = 0;
+        std::uint64_t sum_ns = 0;
+        std::uint64_t max_ns = 0;
+        std::uint64_t buckets[BUCKETS] = {};
+
+        std::uint64_t mean_ns() const {
+            return count ? sum_ns / count : 0;
+        }
+
+        // Upper bound of the bucket containing the given percentile (0-100)
+        std::uint64_t percentile_ns(double percentile) const {
+            if (count == 0) {
+                return 0;
+            }
+            std::uint64_t rank = static_cast<std::uint64_t>(static_cast<double>(count) * percentile / 100.0);
+            std::uint64_t seen = 0;
+            for (int k = 0; k < BUCKETS; ++k) {
+                seen += buckets[k];
+                if (seen > rank || seen == count) {
+                    return k == BUCKETS - 1 ? max_ns : std::min(bucket_limit_ns(k), max_ns);
+                }
+            }
+            return max_ns;
+        }
+    };
+
+    static int bucket_for(std::uint64_t ns) {
+        int bucket = ns == 0 ? 0 : 64 - __builtin_clzll(ns);
+        return bucket < BUCKETS ? bucket : BUCKETS - 1;
+    }
+
+    // Exclusive upper bound of a bucket
+    static std::uint64_t bucket_limit_ns(int bucket) {
+        return bucket == 0 ? 1 : std::uint64_t{1} << bucket;
+    }
+
+    // Single writer only
+    void record(std::uint64_t ns) {
+        bump(buckets[bucket_for(ns)], 1);
+        bump(sum_ns, ns);
+        if (ns > max_ns.load(std::memory_order_relaxed)) {
+            max_ns.store(ns, std::memory_order_relaxed);
+        }
+        // Count last so that a reader never sees more samples than buckets
+        bump(count, 1);
+    }
+
+    Snapshot snapshot() const {
+        Snapshot snap;
+        snap.count = count.load(std::memory_order_relaxed);
+        snap.sum_ns = sum_ns.load(std::memory_order_relaxed);
+        snap.max_ns = max_ns.load(std::memory_order_relaxed);
+        for (int k = 0; k < BUCKETS; ++k) {
+            snap.buckets[k] = buckets[k].load(std::memory_order_relaxed);
+        }
+        return snap;
+    }
+
+private:
+    std::atomic<std::uint64_t> count{0};
+    std::atomic<std::uint64_t> sum_ns{0};
+    std::atomic<std::uint64_t> max_ns{0};
+    std::atomic<std::uint64_t> buckets[BUCKETS] = {};
+
+    // Plain load/store instead of an atomic RMW: there is only one writer
+    static void bump(std::atomic<std::uint64_t>& counter, std::uint64_t amount) {
+        counter.store(counter.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+    }
+};
+
+// Time source of the control loop
+class ControlClock {
+public:
+    virtual ~ControlClock() = default;
+
+    virtual std::int64_t now_ns() = 0;
+
+    // Return once now_ns() has reached deadline_ns. Called once per cycle,
+    // also with a deadline that has passed: simulated clocks step here.
+    virtual void sleep_until(std::int64_t deadline_ns) = 0;
+};
+
+struct LoopTimingStats {
+    std::atomic<std::uint64_t> cycles{0};
+    std::atomic<std::uint64_t> overruns{0};
+    std::atomic<std::uint64_t> missed{0};
+    std::atomic<std::uint64_t> late{0};
+    LatencyHistogram wakeup;
+    LatencyHistogram execution;
+};
+
+class CycleTimer {
+public:
+    // Supported control frequencies
+    static constexpr int MIN_FREQUENCY_HZ = 1;
+    static constexpr int MAX_FREQUENCY_HZ = 1000;
+
+    explicit CycleTimer(std::chrono::nanoseconds period)
+        : period_ns(period.count()), late_threshold_ns(period.count() / 10) {}
+
+    // Not thread-safe: only change the period while the loop is not running
+    void set_period(std::chrono::nanoseconds period) {
+        period_ns = period.count();
+        late_threshold_ns = period_ns / 10;
+    }
+
+    // Not thread-safe either; nullptr means CLOCK_MONOTONIC
+    void set_clock(ControlClock* control_clock) {
+        clock = control_clock;
+    }
+
+    void set_late_threshold(std::chrono::nanoseconds threshold) {
+        late_threshold_ns = threshold.count();
+    }
+
+    std::chrono::nanoseconds period() const {
+        return std::chrono::nanoseconds(period_ns);
+    }
+
+    // Begin the first cycle now
+    void start() {
+        cycle_start_ns = now_ns();
+        deadline_ns = cycle_start_ns + period_ns;
+    }
+
+    // End the current cycle and sleep until the start of the next one
+    void wait() {
+        std::int64_t end = now_ns();
+        stats.execution.record(static_cast<std::uint64_t>(std::max<std::int64_t>(end - cycle_start_ns, 0)));
+
+        const bool late = end >= deadline_ns;
+        if (late) {
+            // Run the next cycle right away, drop deadlines that already passed
+            std::int64_t skipped = (end - deadline_ns) / period_ns;
+            deadline_ns += skipped * period_ns;
+            stats.overruns.store(stats.overruns.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            stats.missed.store(stats.missed.load(std::memory_order_relaxed) + static_cast<std::uint64_t>(skipped),
+                               std::memory_order_relaxed);
+        }
+        if (clock != nullptr) {
+            clock->sleep_until(deadline_ns);
+        } else if (!late) {
+            timespec deadline{static_cast<time_t>(deadline_ns / 1000000000),
+                              static_cast<long>(deadline_ns % 1000000000)};
+            while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, nullptr) == EINTR) {
+            }
+        }
+
+        cycle_start_ns = now_ns();
+        std::int64_t wakeup_error = std::max<std::int64_t>(cycle_start_ns - deadline_ns, 0);
+        stats.wakeup.record(static_cast<std::uint64_t>(wakeup_error));
+        if (wakeup_error > late_threshold_ns) {
+            stats.late.store(stats.late.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        }
+        stats.cycles.store(stats.cycles.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+
+        deadline_ns += period_ns;
+    }
+
+    const LoopTimingStats& timing() const {
+        return stats;
+    }
+
+    // One-line summary for status output
+    std::string summary() const {
+        LatencyHistogram::Snapshot wakeup = stats.wakeup.snapshot();
+        LatencyHistogram::Snapshot execution = stats.execution.snapshot();
+        char buf[256];
+        std::snprintf(buf, sizeof(buf),
+                      "Timing(period_us:%lld cycles:%llu overruns:%llu missed:%llu late:%llu "
+                      "wake_p99_us:%.1f wake_max_us:%.1f exec_max_us:%.1f)",
+                      static_cast<long long>(period_ns / 1000),
+                      static_cast<unsigned long long>(stats.cycles.load(std::memory_order_relaxed)),
+                      static_cast<unsigned long long>(stats.overruns.load(std::memory_order_relaxed)),
+                      static_cast<unsigned long long>(stats.missed.load(std::memory_order_relaxed)),
+                      static_cast<unsigned long long>(stats.late.load(std::memory_order_relaxed)),
+                      wakeup.percentile_ns(99.0) / 1000.0, wakeup.max_ns / 1000.0, execution.max_ns / 1000.0);
+        return buf;
+    }
+
+    // Multi-line histogram dump of wake-up error and execution time
+    std::string report() const {
+        std::string out = summary() + "\n";
+        append_histogram(out, "Wake-up error", stats.wakeup.snapshot());
+        append_histogram(out, "Execution time", stats.execution.snapshot());
+        return out;
+    }
+
+private:
+    std::int64_t period_ns;
+    std::int64_t late_threshold_ns;
+    std::int64_t cycle_start_ns = 0;
+    std::int64_t deadline_ns = 0;
+    LoopTimingStats stats;
+    ControlClock* clock = nullptr;
+
+    std::int64_t now_ns() const {
+        if (clock != nullptr) {
+            return clock->now_ns();
+        }
+        timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return static_cast<std::int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+    }
+
+    static void append_histogram(std::string& out, const char* title, const LatencyHistogram::Snapshot& snap) {
+        char line[128];
+        std::snprintf(line, sizeof(line), "%s: samples %llu, mean %.1f us, p50 %.1f us, p99 %.1f us, max %.1f us\n",
+                      title, static_cast<unsigned long long>(snap.count), snap.mean_ns() / 1000.0,
+                      snap.percentile_ns(50.0) / 1000.0, snap.percentile_ns(99.0) / 1000.0, snap.max_ns / 1000.0);
+        out += line;
+        for (int k = 0; k < LatencyHistogram::BUCKETS; ++k) {
+            if (snap.buckets[k] == 0) {
+                continue;
+            }
+            bool overflow = k == LatencyHistogram::BUCKETS - 1;
+            std::snprintf(line, sizeof(line), "  %s %10.1f us: %llu\n", overflow ? ">=" : "< ",
+                          LatencyHistogram::bucket_limit_ns(overflow ? k - 1 : k) / 1000.0,
+                          static_cast<unsigned long long>(snap.buckets[k]));
+            out += line;
+        }
+    }
+};
+
+#endif // KART_TIMING_H
@@ -0,0 +1,242 @@
+/*
+ * Binary trace of the control loop in a memory-mapped rolling file
+ * ================================================================
+ *
+ * The control loop appends fixed-size records: one CYCLE per control
+ * cycle, every COMMAND it accepted, one MOTOR per motor (speed and the
+ * pulse written) and ESTOP / ESTOP_RESET whenever the emergency stop state
+ * changes. All timestamps are the control clock (CLOCK_MONOTONIC).
+ *
+ * The file is a header followed by a ring of records, mapped MAP_SHARED
+ * and prefaulted at startup: appending is a 32-byte store plus one release
+ * store of the head counter, no system call, lock or page fault. The kernel
+ * writes the pages back on its own, so the trace survives a crash of the
+ * controller. Single writer (the control thread); TraceReader copies the
+ * records out oldest first, and kart_replay feeds them back through the
+ * controller (kart_sim.h).
+ */
+
+#ifndef KART_TRACE_H
+#define KART_TRACE_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static constexpr std::uint32_t TRACE_MAGIC = 0x4352544b;   // "KTRC"
+static constexpr std::uint16_t TRACE_VERSION = 1;
+
+struct TraceRecord {
+    // MOTOR rather than OUTPUT, which wiringPi defines as a macro
+    enum Type : std::uint8_t { CYCLE, COMMAND, MOTOR, ESTOP, ESTOP_RESET };
+
+    std::int64_t timestamp_ns;   // cycle start; COMMAND: when the command was queued
+    std::uint32_t cycle;         // control cycle number
+    std::uint8_t type;
+    std::uint8_t code;           // COMMAND: Command::Type, ESTOP: EmergencyStop::Source
+    std::uint16_t motor;         // COMMAND, MOTOR: motor index
+    double speed;                // COMMAND: target, MOTOR: current speed (%)
+    std::uint32_t pulse_ns;      // MOTOR: pulse width written
+    std::uint32_t flags;         // COMMAND: IMMEDIATE
+
+    static constexpr std::uint32_t IMMEDIATE = 1;
+};
+
+static_assert(sizeof(TraceRecord) == 32, "trace record layout");
+
+struct TraceHeader {
+    std::uint32_t magic;
+    std::uint16_t version;
+    std::uint16_t record_size;
+    std::uint64_t capacity;                 // records in the ring
+    std::atomic<std::uint64_t> head;        // records written so far
+    std::uint32_t control_frequency;        // Hz
+    std::uint32_t motor_count;
+    std::int64_t created_ns;
+    std::uint8_t reserved[24];
+};
+
+static_assert(sizeof(TraceHeader) == 64, "trace header layout");
+static_assert(std::atomic<std::uint64_t>::is_always_lock_free, "trace head must be lock-free");
+
+class TraceWriter {
+public:
+    TraceWriter() = default;
+    TraceWriter(const TraceWriter&) = delete;
+    TraceWriter& operator=(const TraceWriter&) = delete;
+
+    ~TraceWriter() {
+        close();
+    }
+
+    // Create (or truncate) the file with room for capacity records
+    bool create(const std::string& path, std::uint64_t capacity, std::uint32_t control_frequency,
+                std::uint32_t motor_count, std::int64_t created_ns) {
+        close();
+        if (capacity == 0) {
+            return false;
+        }
+        const std::size_t bytes = sizeof(TraceHeader) + capacity * sizeof(TraceRecord);
+        int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (fd < 0) {
+            return false;
+        }
+        void* map = MAP_FAILED;
+        if (::ftruncate(fd, static_cast<off_t>(bytes)) == 0) {
+            map = ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, 0);
+        }
+        ::close(fd);
+        if (map == MAP_FAILED) {
+            return false;
+        }
+
+        mapping = map;
+        mapping_bytes = bytes;
+        header = static_cast<TraceHeader*>(map);
+        records = reinterpret_cast<TraceRecord*>(static_cast<char*>(map) + sizeof(TraceHeader));
+        ring_capacity = capacity;
+        slot = 0;
+        written = 0;
+
+        header->version = TRACE_VERSION;
+        header->record_size = sizeof(TraceRecord);
+        header->capacity = capacity;
+        header->head.store(0, std::memory_order_relaxed);
+        header->control_frequency = control_frequency;
+        header->motor_count = motor_count;
+        header->created_ns = created_ns;
+        // Magic last: a reader never sees a half-written header as valid
+        std::atomic_thread_fence(std::memory_order_release);
+        header->magic = TRACE_MAGIC;
+        return true;
+    }
+
+    bool is_open() const {
+        return records != nullptr;
+    }
+
+    void append(const TraceRecord& record) {
+        if (records == nullptr) {
+            return;
+        }
+        records[slot] = record;
+        if (++slot == ring_capacity) {
+            slot = 0;
+        }
+        header->head.store(++written, std::memory_order_release);
+    }
+
+    std::uint64_t records_written() const {
+        return written;
+    }
+
+    void close() {
+        if (mapping != nullptr) {
+            ::munmap(mapping, mapping_bytes);
+        }
+        mapping = nullptr;
+        header = nullptr;
+        records = nullptr;
+    }
+
+private:
+    void* mapping = nullptr;
+    std::size_t mapping_bytes = 0;
+    TraceHeader* header = nullptr;
+    TraceRecord* records = nullptr;
+    std::uint64_t ring_capacity = 0;
+    std::uint64_t slot = 0;
+    std::uint64_t written = 0;
+};
+
+class TraceReader {
+public:
+    enum Status { OK, NOT_FOUND, INCOMPATIBLE };
+
+    Status open(const std::string& path) {
+        int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            return NOT_FOUND;
+        }
+        struct stat st;
+        bool ok = ::fstat(fd, &st) == 0 && static_cast<std::size_t>(st.st_size) >= sizeof(TraceHeader);
+        void* map = ok ? ::mmap(nullptr, static_cast<std::size_t>(st.st_size), PROT_READ, MAP_SHARED, fd, 0)
+                       : MAP_FAILED;
+        ::close(fd);
+        if (map == MAP_FAILED) {
+            return INCOMPATIBLE;
+        }
+
+        const TraceHeader* file = static_cast<const TraceHeader*>(map);
+        const std::size_t size = static_cast<std::size_t>(st.st_size);
+        Status status = OK;
+        if (file->magic != TRACE_MAGIC || file->version != TRACE_VERSION ||
+            file->record_size != sizeof(TraceRecord) || file->capacity == 0 ||
+            file->capacity > (size - sizeof(TraceHeader)) / sizeof(TraceRecord)) {
+            status = INCOMPATIBLE;
+        } else {
+            info.capacity = file->capacity;
+            info.head = file->head.load(std::memory_order_acquire);
+            info.control_frequency = file->control_frequency;
+            info.motor_count = file->motor_count;
+            info.created_ns = file->created_ns;
+
+            const TraceRecord* ring =
+                reinterpret_cast<const TraceRecord*>(static_cast<const char*>(map) + sizeof(TraceHeader));
+            const std::uint64_t count = std::min(info.head, info.capacity);
+            const std::uint64_t first = info.head - count;
+            entries.resize(count);
+            for (std::uint64_t i = 0; i < count; ++i) {
+                std::memcpy(&entries[i], &ring[(first + i) % info.capacity], sizeof(TraceRecord));
+            }
+        }
+        ::munmap(map, size);
+        return status;
+    }
+
+    struct Info {
+        std::uint64_t capacity = 0;
+        std::uint64_t head = 0;
+        std::uint32_t control_frequency = 0;
+        std::uint32_t motor_count = 0;
+        std::int64_t created_ns = 0;
+    };
+
+    const Info& header() const {
+        return info;
+    }
+
+    // Older records were overwritten
+    bool wrapped() const {
+        return info.head > info.capacity;
+    }
+
+    // Oldest first
+    const std::vector<TraceRecord>& records() const {
+        return entries;
+    }
+
+    static const char* type_name(std::uint8_t type) {
+        switch (type) {
+            case TraceRecord::CYCLE: return "cycle";
+            case TraceRecord::COMMAND: return "command";
+            case TraceRecord::MOTOR: return "motor";
+            case TraceRecord::ESTOP: return "estop";
+            case TraceRecord::ESTOP_RESET: return "reset";
+        }
+        return "unknown";
+    }
+
+private:
+    Info info;
+    std::vector<TraceRecord> entries;
+};
+
+#endif // KART_TRACE_H
@@ -5,9 +5,12 @@ Test script for Kart ESC Motor Control System
 
 This script tests the core functionality of the ESC controller
 without requiring actual hardware. It uses mock GPIO operations
-to verify the code logic and safety features.
+to verify the code logic and safety features of the Python
+implementation, and drives the C++ core through the simulated-GPIO
+build of the extension (_kart_native_sim, built by 'make test').
 """
 
+import os
 import sys
 import time
 import threading
@@ -18,8 +21,20 @@ import logging
 sys.modules['RPi.GPIO'] = Mock()
 sys.modules['RPi'] = Mock()
 
+# Native core on simulated GPIO when built
+try:
+    import _kart_native_sim as native_sim
+    os.environ['KART_CORE'] = 'sim'
+except ImportError:
+    native_sim = None
+    os.environ['KART_CORE'] = 'python'
+
 # Import our kart module after mocking GPIO
-from kart import ESCController, MotorConfig, SafetyLimits, create_default_config
+import kart
+from kart import PythonESCController as ESCController, MotorConfig, SafetyLimits, create_default_config
+
+TELEMETRY_SHM = f"/kart_test_{os.getpid()}"
+EMERGENCY_PIN = 21
 
 # Configure test logging
 logging.basicConfig(level=logging.INFO, format='%(levelname)s: %(message)s')
@@ -204,6 +219,145 @@ class KartControllerTest:
         assert "running" in status["system"], "Status should include running state"
         assert "emergency_stop" in status["system"], "Status should include emergency stop state"
     
+    def start_native(self, motors=None, safety_limits=None):
+        """Native controller on simulated GPIO, emergency switch released"""
+        default_motors, default_limits = create_default_config()
+        controller = kart.ESCController(motors or default_motors, safety_limits or default_limits,
+                                        telemetry_shm=TELEMETRY_SHM)
+        native_sim.sim_release(EMERGENCY_PIN, 1)
+        assert controller.start(), "Native controller should start"
+        return controller
+    
+    def test_native_wrapper(self):
+        """Test that kart.ESCController is the native core with the same API"""
+        assert kart.ESCController is kart.NativeESCController, "ESCController should use the native core"
+        motors, safety_limits = create_default_config()
+        controller = kart.ESCController(motors, safety_limits, telemetry_shm=TELEMETRY_SHM)
+        
+        assert controller.motors == motors, "Motors should be set correctly"
+        assert not controller.is_running, "Controller should not be running initially"
+        assert not controller.emergency_stop, "Emergency stop should be false initially"
+        assert controller.current_speeds == {"main_motor": 0.0}, "Speed tracking per motor"
+        
+        status = controller.get_motor_status()
+        assert status["motors"]["main_motor"]["pin"] == 18, "Status should include the motor pin"
+        assert "running" in status["system"], "Status should include running state"
+        assert "last_heartbeat" in status["system"], "Status should include the heartbeat"
+    
+    def test_native_drive(self):
+        """Test that the C++ control loop ramps and clamps the speed"""
+        controller = self.start_native()
+        try:
+            assert controller.is_running, "Control loop should run"
+            assert native_sim.sim_soft_pwm(18) == 15, "Neutral pulse (1.5 ms) after start"
+            
+            assert controller.set_motor_speed("main_motor", 50), "Command should be accepted"
+            assert not controller.set_motor_speed("no_motor", 50), "Unknown motor should be rejected"
+            time.sleep(0.05)
+            assert controller.current_speeds["main_motor"] < 50, "Speed should increase gradually"
+            time.sleep(0.5)
+            status = controller.get_motor_status()["motors"]["main_motor"]
+            assert status["current_speed"] == 50.0, f"Speed should reach 50%, got {status['current_speed']}"
+            assert native_sim.sim_soft_pwm(18) == 18, "1.75 ms pulse at 50%"
+            
+            assert controller.set_all_motors_speed(150, immediate=True), "Command should be accepted"
+            time.sleep(0.1)
+            assert controller.target_speeds["main_motor"] == 80.0, "Speed should be clamped to max_speed"
+        finally:
+            controller.stop()
+        assert not controller.is_running, "Control loop should stop"
+    
+    def test_native_emergency_stop(self):
+        """Test the hardware emergency stop through the C++ interrupt path"""
+        controller = self.start_native()
+        try:
+            controller.set_motor_speed("main_motor", 40, immediate=True)
+            time.sleep(0.1)
+            assert native_sim.sim_soft_pwm(18) > 15, "Motor should be running"
+            
+            native_sim.sim_drive(EMERGENCY_PIN, 0)
+            assert controller.emergency_stop, "Switch should engage the emergency stop"
+            assert native_sim.sim_soft_pwm(18) == 15, "Neutral before the interrupt returns"
+            assert not controller.set_motor_speed("main_motor", 20), "Commands rejected during emergency stop"
+            assert not controller.reset_emergency_stop(), "Reset blocked while the switch is pressed"
+            
+            native_sim.sim_release(EMERGENCY_PIN, 1)
+            assert controller.reset_emergency_stop(), "Reset after the switch is released"
+            assert controller.set_motor_speed("main_motor", 20), "Commands accepted after reset"
+            
+            controller.emergency_stop_all()
+            assert controller.emergency_stop, "Console emergency stop"
+            time.sleep(0.1)
+            assert controller.current_speeds["main_motor"] == 0.0, "Control loop zeroes the speeds"
+        finally:
+            controller.stop()
+    
+    def test_native_telemetry(self):
+        """Test that telemetry views read the live segment without copies"""
+        controller = self.start_native()
+        try:
+            telemetry = controller.telemetry()
+            assert telemetry.motor_names == ["main_motor"], "Motor names from the segment header"
+            current = telemetry.current_speed
+            assert current.readonly and current.format == "d" and len(current) == 1, "Read-only doubles"
+            
+            controller.set_motor_speed("main_motor", 30, immediate=True)
+            time.sleep(0.1)
+            assert current[0] == 30.0, f"The same view should follow the loop, got {current[0]}"
+            assert telemetry.target_speed[0] == 30.0, "Target speed view"
+            
+            before = telemetry.sequence
+            time.sleep(0.1)
+            after = telemetry.sequence
+            assert after > before, "Control loop should publish every cycle"
+            data = telemetry.read()
+            assert data["running"] and data["current_speed"] == [30.0], "Consistent copy"
+            assert data["cycles"] > 0, "Loop timing in the copy"
+            
+            try:
+                telemetry.close()
+                raise AssertionError("Close should be refused while a view is exported")
+            except BufferError:
+                pass
+            current.release()
+            telemetry.close()
+        finally:
+            controller.stop()
+    
+    def test_native_timing_without_gil(self):
+        """Test that busy Python threads do not hold up the C++ control loop"""
+        controller = self.start_native()
+        telemetry = controller.telemetry()
+        stop = threading.Event()
+        
+        def busy():
+            n = 0
+            while not stop.is_set():
+                n += 1
+        
+        threads = [threading.Thread(target=busy) for _ in range(2)]
+        try:
+            cycles_before = telemetry.read()["cycles"]
+            for thread in threads:
+                thread.start()
+            started = time.monotonic()
+            for _ in range(20):
+                controller.set_motor_speed("main_motor", 10)
+                time.sleep(0.05)
+            elapsed = time.monotonic() - started
+            data = telemetry.read()
+        finally:
+            stop.set()
+            for thread in threads:
+                thread.join()
+            controller.stop()
+            telemetry.close()
+        
+        expected = elapsed * 50
+        cycles = data["cycles"] - cycles_before
+        assert cycles >= expected * 0.9, f"{cycles} cycles in {elapsed:.2f} s at 50 Hz"
+        assert data["execution_p99_ns"] < 2000000, f"Execution p99 {data['execution_p99_ns']} ns"
+    
     def run_all_tests(self):
         """Run all tests and report results"""
         logger.info("Starting Kart ESC Controller Tests")
@@ -221,6 +375,16 @@ class KartControllerTest:
             ("Acceleration Limiting", self.test_acceleration_limiting),
             ("Status Reporting", self.test_status_reporting),
         ]
+        if native_sim is not None:
+            tests += [
+                ("Native Wrapper", self.test_native_wrapper),
+                ("Native Drive", self.test_native_drive),
+                ("Native Emergency Stop", self.test_native_emergency_stop),
+                ("Native Telemetry", self.test_native_telemetry),
+                ("Native Timing Without GIL", self.test_native_timing_without_gil),
+            ]
+        else:
+            logger.warning("_kart_native_sim not built - native core tests skipped")
         
         # Run all tests
         for test_name, test_func in tests:
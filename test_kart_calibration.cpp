@@ -0,0 +1,222 @@
+/*
+ * Tests for the ESC calibration state machine (CalibrationSequencer)
+ * ==================================================================
+ *
+ * Time is passed in explicitly, so every test steps through the phases
+ * without sleeping. The watchdog test runs the controller with simulated
+ * GPIO: a calibration exempts only its own motor from the watchdog.
+ *
+ * Compile with: g++ -std=c++20 -pthread -DTEST_MODE -o test_kart_calibration test_kart_calibration.cpp -lrt
+ */
+
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "kart_calibration.h"
+#include "kart_sim.h"
+
+static Logger::Options test_log_options() {
+    Logger::Options options = Logger::default_options();
+    options.text_path.clear();
+    options.binary_path.clear();
+    options.console_output = false;
+    return options;
+}
+
+Logger g_logger(test_log_options());
+
+static void check(bool condition, const std::string& message) {
+    if (!condition) {
+        throw std::runtime_error(message);
+    }
+}
+
+using namespace std::chrono_literals;
+using Clock = CalibrationSequencer::Clock;
+
+// Transitions as reported to the callback
+struct Recorder {
+    std::vector<std::pair<std::size_t, CalibrationSequencer::Transition>> seen;
+
+    auto callback() {
+        return [this](std::size_t motor, CalibrationSequencer::Transition t) { seen.emplace_back(motor, t); };
+    }
+};
+
+static void test_full_sequence() {
+    CalibrationSequencer calibration;
+    Recorder recorder;
+    const Clock::time_point t0{};
+
+    check(!calibration.active(), "idle at first");
+    check(calibration.start(0, t0, 3s), "start");
+    check(!calibration.start(0, t0, 3s), "no second start while calibrating");
+    check(calibration.phase(0) == CalibrationSequencer::MAX_PULSE, "maximum pulse first");
+    check(calibration.override_speed(0) == 100.0, "full forward");
+
+    calibration.advance(t0 + 2999ms, 3s, recorder.callback());
+    check(calibration.phase(0) == CalibrationSequencer::MAX_PULSE && recorder.seen.empty(), "still maximum");
+
+    calibration.advance(t0 + 3s, 3s, recorder.callback());
+    check(calibration.phase(0) == CalibrationSequencer::MIN_PULSE, "minimum pulse after calibration_time");
+    check(calibration.override_speed(0) == -100.0, "full reverse");
+
+    calibration.advance(t0 + 5s, 3s, recorder.callback());
+    check(calibration.calibrating(0), "minimum held for a full step");
+    calibration.advance(t0 + 6s, 3s, recorder.callback());
+    check(!calibration.calibrating(0) && !calibration.active(), "done after two steps");
+
+    check(recorder.seen.size() == 2, "two transitions");
+    check(recorder.seen[0].second == CalibrationSequencer::MIN_PULSE_STARTED, "min reported");
+    check(recorder.seen[1].second == CalibrationSequencer::COMPLETED, "completion reported");
+}
+
+static void test_motors_independent() {
+    CalibrationSequencer calibration;
+    Recorder recorder;
+    const Clock::time_point t0{};
+
+    calibration.start(1, t0, 1s);
+    calibration.start(4, t0 + 500ms, 1s);
+    check(calibration.active_mask() == 0b10010, "two motors calibrating");
+    check(!calibration.calibrating(0), "others untouched");
+
+    calibration.advance(t0 + 1s, 1s, recorder.callback());
+    check(calibration.phase(1) == CalibrationSequencer::MIN_PULSE, "first motor moved on");
+    check(calibration.phase(4) == CalibrationSequencer::MAX_PULSE, "second motor still on its first step");
+
+    calibration.advance(t0 + 2s, 1s, recorder.callback());
+    check(!calibration.calibrating(1) && calibration.phase(4) == CalibrationSequencer::MIN_PULSE, "staggered");
+    calibration.advance(t0 + 3s, 1s, recorder.callback());
+    check(!calibration.active(), "both done");
+}
+
+static void test_cancel() {
+    CalibrationSequencer calibration;
+    Recorder recorder;
+    const Clock::time_point t0{};
+
+    calibration.start(0, t0, 3s);
+    calibration.start(2, t0, 3s);
+    check(calibration.cancel(2, recorder.callback()), "cancel a running calibration");
+    check(!calibration.cancel(2, recorder.callback()), "nothing left to cancel");
+    check(!calibration.cancel(1, recorder.callback()), "idle motor");
+    check(calibration.active_mask() == 0b1, "other motor keeps calibrating");
+    check(recorder.seen.size() == 1 && recorder.seen[0] == std::make_pair(std::size_t{2}, CalibrationSequencer::CANCELLED),
+          "cancellation reported");
+}
+
+static void test_abort_all() {
+    CalibrationSequencer calibration;
+    Recorder recorder;
+    const Clock::time_point t0{};
+
+    calibration.start(0, t0, 3s);
+    calibration.start(31, t0, 3s);
+    calibration.advance(t0 + 3s, 3s, recorder.callback());
+    recorder.seen.clear();
+
+    calibration.abort_all(recorder.callback());
+    check(!calibration.active(), "emergency stop ends every calibration");
+    check(recorder.seen.size() == 2 && recorder.seen[0].second == CalibrationSequencer::ABORTED &&
+              recorder.seen[1].first == 31,
+          "each abort reported");
+    check(calibration.start(0, t0 + 4s, 3s), "can calibrate again afterwards");
+}
+
+static void test_step_time_change() {
+    CalibrationSequencer calibration;
+    Recorder recorder;
+    const Clock::time_point t0{};
+
+    // calibration_time reloaded from 3 s to 1 s during the first step
+    calibration.start(0, t0, 3s);
+    calibration.advance(t0 + 1s, 1s, recorder.callback());
+    check(calibration.phase(0) == CalibrationSequencer::MAX_PULSE, "running step keeps its deadline");
+    calibration.advance(t0 + 3s, 1s, recorder.callback());
+    calibration.advance(t0 + 4s, 1s, recorder.callback());
+    check(!calibration.active(), "next step uses the new time");
+    check(!calibration.start(CalibrationSequencer::MAX_MOTORS, t0, 1s), "motor out of range");
+}
+
+// Waits up to limit (real time) for a controller state
+template <typename Condition>
+static bool eventually(Condition condition, std::chrono::milliseconds limit = 1s) {
+    const auto deadline = std::chrono::steady_clock::now() + limit;
+    while (!condition() && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(5ms);
+    }
+    return condition();
+}
+
+// Operator link lost while motor 0 calibrates and motor 1 drives: the
+// watchdog stops motor 1, the calibration carries on, and the emergency
+// stop follows once the calibration has ended
+static void test_watchdog_during_calibration() {
+    KartConfig config = simulation_config(create_default_config());
+    config.motors.push_back(MotorConfig(19, "second_motor", 1.0, 2.0, 1.5, 50));
+    config.control_frequency = 200;
+    config.calibration_time = 1;
+    config.safety_limits.watchdog_timeout = 0.3;
+    compute_pulse_params(config);
+
+    SimGpio::board().release(config.emergency_pin, HIGH);
+    ESCController controller(config);
+    check(controller.start(), "controller started");
+    const MotorHandle calibrated = controller.motor_handle("main_motor");
+    const MotorHandle driven = controller.motor_handle("second_motor");
+
+    check(controller.calibrate_esc(calibrated), "calibration queued");
+    check(eventually([&] { return controller.calibrating(calibrated); }), "motor 0 calibrating");
+    check(controller.set_motor_speed(driven, 30.0), "motor 1 driven");
+    check(eventually([&] { return controller.current_speed(driven) > 0.0; }), "motor 1 moving");
+
+    // No more heartbeats
+    std::this_thread::sleep_for(600ms);
+    const MotorSpeeds speeds = controller.motor_speeds(driven);
+    const bool still_calibrating = controller.calibrating(calibrated);
+    const bool stopped = controller.emergency_stop_active();
+    const bool estop_after = eventually([&] { return !controller.calibration_active(); }, 3s) &&
+                             eventually([&] { return controller.emergency_stop_active(); }, 1s);
+    controller.stop();
+
+    check(speeds.current == 0.0 && speeds.target == 0.0,
+          "watchdog stopped motor 1: current " + std::to_string(speeds.current) + ", target " +
+              std::to_string(speeds.target));
+    check(still_calibrating && !stopped, "motor 0 kept calibrating, no emergency stop");
+    check(estop_after, "emergency stop after the calibration");
+}
+
+int main() {
+    std::cout << "Kart ESC Calibration - Test Suite" << std::endl;
+    std::cout << "=================================" << std::endl;
+
+    std::vector<std::pair<const char*, std::function<void()>>> tests = {
+        {"Full Sequence", test_full_sequence},
+        {"Motors Independent", test_motors_independent},
+        {"Cancel", test_cancel},
+        {"Abort All", test_abort_all},
+        {"Step Time Change", test_step_time_change},
+        {"Watchdog During Calibration", test_watchdog_during_calibration},
+    };
+
+    int failed = 0;
+    for (const auto& [name, test] : tests) {
+        try {
+            test();
+            std::cout << "✓ " << name << " PASSED" << std::endl;
+        } catch (const std::exception& e) {
+            std::cout << "✗ " << name << " FAILED: " << e.what() << std::endl;
+            ++failed;
+        }
+    }
+
+    std::cout << "Tests Passed: " << tests.size() - failed << std::endl;
+    std::cout << "Tests Failed: " << failed << std::endl;
+    return failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,211 @@
+/*
+ * Tests for the command path (kart_command.h)
+ * ===========================================
+ *
+ * Focus on batched commands: a batch must reach the control loop as one
+ * unit, through the ring as well as through the overflow slot.
+ *
+ * Compile with: g++ -std=c++20 -pthread -o test_kart_command test_kart_command.cpp
+ */
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "kart_command.h"
+
+static void check(bool condition, const std::string& message) {
+    if (!condition) {
+        throw std::runtime_error(message);
+    }
+}
+
+static constexpr int BATCH_MOTORS = 4;
+
+static bool push_generation(CommandQueue& queue, int generation) {
+    Command batch[BATCH_MOTORS];
+    for (int motor = 0; motor < BATCH_MOTORS; ++motor) {
+        batch[motor] = Command(Command::SET_SPEED, static_cast<std::uint16_t>(motor), generation);
+    }
+    return queue.push(std::span<const Command>(batch));
+}
+
+// Latest target per motor as the control loop would apply it
+struct Targets {
+    double speed[BATCH_MOTORS] = {};
+
+    std::size_t drain(CommandQueue& queue) {
+        return queue.drain([this](const Command& cmd) {
+            if (cmd.type == Command::SET_SPEED && cmd.motor < BATCH_MOTORS) {
+                speed[cmd.motor] = cmd.speed;
+            }
+        });
+    }
+
+    bool consistent() const {
+        for (int motor = 1; motor < BATCH_MOTORS; ++motor) {
+            if (speed[motor] != speed[0]) {
+                return false;
+            }
+        }
+        return true;
+    }
+};
+
+static void test_batch_visible_as_unit() {
+    CommandQueue queue;
+    std::atomic<bool> done{false};
+
+    std::thread producer([&] {
+        for (int generation = 1; generation <= 20000; ++generation) {
+            push_generation(queue, generation);
+        }
+        done.store(true);
+    });
+
+    Targets targets;
+    double last = 0.0;
+    for (;;) {
+        const bool finished = done.load();
+        const std::size_t count = targets.drain(queue);
+        check(targets.consistent(), "a drain must never split a batch");
+        check(targets.speed[0] >= last, "batches arrive in order");
+        last = targets.speed[0];
+        if (finished && count == 0) {
+            break;
+        }
+    }
+    producer.join();
+    check(targets.speed[0] == 20000.0, "last batch delivered");
+}
+
+static void test_batch_through_overflow_slot() {
+    CommandQueue queue;
+
+    // 100 batches of 4 do not fit into the ring: the rest is coalesced
+    for (int generation = 1; generation <= 100; ++generation) {
+        check(push_generation(queue, generation), "coalescing never rejects");
+    }
+    CommandQueue::Stats stats = queue.stats();
+    check(stats.coalesced > 0, "overflow slot used");
+    check(stats.pushed % BATCH_MOTORS == 0, "ring holds whole batches only");
+    check(stats.batches == 100, "batches counted");
+
+    Targets targets;
+    targets.drain(queue);
+    check(targets.consistent(), "overflow slot keeps batches whole");
+    check(targets.speed[0] == 100.0, "latest batch wins");
+}
+
+static void test_rejected_batch_queues_nothing() {
+    CommandQueue queue(CommandQueue::REJECT);
+
+    Command single(Command::SET_SPEED, 0, 1.0);
+    for (std::size_t i = 0; i < CommandQueue::RING_CAPACITY - 2; ++i) {
+        check(queue.push(single), "ring has room");
+    }
+    check(!push_generation(queue, 7), "batch larger than the free space is rejected");
+    check(queue.stats().dropped == BATCH_MOTORS, "whole batch counted as dropped");
+
+    std::size_t count = queue.drain([](const Command&) {});
+    check(count == CommandQueue::RING_CAPACITY - 2, "no part of the batch was queued");
+}
+
+static void test_batch_size_limits() {
+    CommandQueue queue;
+    check(!queue.push(std::span<const Command>()), "empty batch rejected");
+
+    std::vector<Command> too_many(CommandQueue::MAX_BATCH + 1);
+    check(!queue.push(std::span<const Command>(too_many)), "oversized batch rejected");
+    check(queue.drain([](const Command&) {}) == 0, "nothing queued");
+}
+
+static void test_calibration_through_overflow_slot() {
+    CommandQueue queue;
+    Command single(Command::SET_SPEED, 0, 1.0);
+    for (std::size_t i = 0; i < CommandQueue::RING_CAPACITY; ++i) {
+        check(queue.push(single), "ring has room");
+    }
+
+    // Ring full: these are coalesced, the later of calibrate/cancel wins
+    queue.push(Command(Command::CALIBRATE, 1));
+    queue.push(Command(Command::CALIBRATE, 2));
+    queue.push(Command(Command::CANCEL_CALIBRATION, 2));
+    queue.push(Command(Command::CANCEL_CALIBRATION, 3));
+    queue.push(Command(Command::CALIBRATE, 3));
+
+    std::uint32_t calibrate = 0;
+    std::uint32_t cancel = 0;
+    queue.drain([&](const Command& cmd) {
+        if (cmd.type == Command::CALIBRATE) {
+            calibrate |= 1u << cmd.motor;
+        } else if (cmd.type == Command::CANCEL_CALIBRATION) {
+            cancel |= 1u << cmd.motor;
+        }
+    });
+    check(calibrate == 0b1010 && cancel == 0b0100, "per-motor calibrate and cancel survive coalescing");
+
+    for (std::size_t i = 0; i < CommandQueue::RING_CAPACITY; ++i) {
+        queue.push(single);
+    }
+    queue.push(Command(Command::CALIBRATE, Command::ALL_MOTORS));
+    bool all = false;
+    queue.drain([&](const Command& cmd) {
+        all = all || (cmd.type == Command::CALIBRATE && cmd.motor == Command::ALL_MOTORS);
+    });
+    check(all, "calibrate all stays one command");
+}
+
+static void test_motor_out_of_range_rejected() {
+    CommandQueue queue;
+    Command single(Command::SET_SPEED, 0, 1.0);
+    for (std::size_t i = 0; i < CommandQueue::RING_CAPACITY; ++i) {
+        check(queue.push(single), "ring has room");
+    }
+
+    // Ring full: the overflow slot has no bit for these motors
+    const Command batch[] = {Command(Command::SET_SPEED, 1, 50.0), Command(Command::SET_SPEED, MAX_MOTORS, 50.0)};
+    check(!queue.push(std::span<const Command>(batch)), "batch with motor MAX_MOTORS rejected");
+    check(!queue.push(Command(Command::CALIBRATE, MAX_MOTORS + 1)), "calibrate beyond MAX_MOTORS rejected");
+    const CommandQueue::Stats stats = queue.stats();
+    check(stats.dropped == 3 && stats.coalesced == 0, "rejected commands counted as dropped");
+
+    std::size_t count = queue.drain([](const Command&) {});
+    check(count == CommandQueue::RING_CAPACITY, "nothing of the rejected commands queued");
+    check(!queue.push(Command(Command::SET_SPEED, 0xfffe, 1.0)), "rejected with an empty ring as well");
+}
+
+int main() {
+    std::cout << "Kart Command Queue - Test Suite" << std::endl;
+    std::cout << "===============================" << std::endl;
+
+    std::vector<std::pair<const char*, std::function<void()>>> tests = {
+        {"Batch Visible As Unit", test_batch_visible_as_unit},
+        {"Batch Through Overflow Slot", test_batch_through_overflow_slot},
+        {"Rejected Batch Queues Nothing", test_rejected_batch_queues_nothing},
+        {"Batch Size Limits", test_batch_size_limits},
+        {"Calibration Through Overflow Slot", test_calibration_through_overflow_slot},
+        {"Motor Out Of Range Rejected", test_motor_out_of_range_rejected},
+    };
+
+    int failed = 0;
+    for (const auto& [name, test] : tests) {
+        try {
+            test();
+            std::cout << "✓ " << name << " PASSED" << std::endl;
+        } catch (const std::exception& e) {
+            std::cout << "✗ " << name << " FAILED: " << e.what() << std::endl;
+            ++failed;
+        }
+    }
+
+    std::cout << "Tests Passed: " << tests.size() - failed << std::endl;
+    std::cout << "Tests Failed: " << failed << std::endl;
+    return failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,339 @@
+/*
+ * Tests for the configuration subsystem (kart_config.h)
+ * =====================================================
+ *
+ * Covers parsing and validation of kart_config.ini, the reload rules, the
+ * RCU-style ConfigStore and the inotify file watcher.
+ *
+ * Compile with: g++ -std=c++20 -pthread -o test_kart_config test_kart_config.cpp
+ */
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "kart_config.h"
+
+static void check(bool condition, const std::string& message) {
+    if (!condition) {
+        throw std::runtime_error(message);
+    }
+}
+
+// Temporary directory for generated config files
+class TempDir {
+public:
+    std::string path;
+
+    TempDir() {
+        char dir[] = "/tmp/kart_config_test.XXXXXX";
+        check(mkdtemp(dir) != nullptr, "mkdtemp failed");
+        path = dir;
+    }
+
+    ~TempDir() {
+        std::string command = "rm -rf '" + path + "'";
+        if (std::system(command.c_str()) != 0) {
+            std::cerr << "could not remove " << path << std::endl;
+        }
+    }
+
+    std::string write(const std::string& name, const std::string& content) const {
+        std::string file_path = path + "/" + name;
+        std::ofstream file(file_path);
+        file << content;
+        return file_path;
+    }
+};
+
+static const char* const VALID_CONFIG =
+    "[motor_left]\n"
+    "pin = 18\n"
+    "name = left\n"
+    "[motor_right]\n"
+    "pin = 19\n"
+    "name = right\n"
+    "max_pulse_width = 1.9\n"
+    "[safety_limits]\n"
+    "max_speed = 60.0\n"
+    "[logging]\n"
+    "log_level = WARNING\n";
+
+static bool parse(const TempDir& dir, const std::string& content, KartConfig& config, std::string& error) {
+    return load_kart_config(dir.write("kart.ini", content), config, error);
+}
+
+static void test_shipped_config() {
+    KartConfig config;
+    std::string error;
+    check(load_kart_config("kart_config.ini", config, error), "kart_config.ini must be valid: " + error);
+    check(config.motors.size() == 1, "secondary motor is disabled");
+    check(config.motors[0].name == "main_motor" && config.motors[0].pin == 18, "main motor on GPIO 18");
+    check(config.safety_limits.max_speed == 80.0, "max_speed");
+    check(config.safety_limits.watchdog_timeout == 2.0, "watchdog_timeout");
+    check(config.emergency_pin == 21 && config.status_led_pin == 20, "GPIO pins");
+    check(config.log_level == 1, "log level INFO");
+    check(config.control_frequency == 50, "control frequency");
+    check(config.rt.control_cpu == 3 && config.rt.worker_cpus == "0-2", "CPU layout");
+    check(config.remote_unix_socket == "/run/kart/kart_control.sock" && config.remote_udp_port == 0, "remote commands");
+    check(config.trace_file == "/tmp/kart_trace.bin" && config.trace_capacity_mb == 16, "trace file");
+    check(!config.pca9685_enabled && config.pca9685_address == 0x40, "PCA9685 off");
+    check(config.metrics_address == "127.0.0.1" && config.metrics_port == 9101, "metrics on localhost");
+}
+
+static void test_motor_sections() {
+    TempDir dir;
+    KartConfig config;
+    std::string error;
+    check(parse(dir, VALID_CONFIG, config, error), "valid config rejected: " + error);
+    check(config.motors.size() == 2, "two motors");
+    check(config.motors[0].name == "left" && config.motors[1].name == "right", "file order kept");
+    check(config.motors[1].max_pulse_width == 1.9, "per-motor value");
+    check(config.motors[0].neutral_pulse_width == 1.5, "defaults for missing keys");
+    check(config.safety_limits.max_speed == 60.0, "safety value");
+    check(config.log_level == 2, "log level WARNING");
+
+    // PCA9685 channels may reuse the numbers of the stop and LED GPIOs
+    check(parse(dir, "[motor_a]\npin = 21\n[motor_b]\npin = 31\n[pca9685]\nenabled = true\naddress = 0x41\n",
+                config, error), "PCA9685 config rejected: " + error);
+    check(config.pca9685_enabled && config.pca9685_address == 0x41, "PCA9685 address in hex");
+
+    // The protocol gives the pulse widths and frequency unless set
+    check(parse(dir, "[motor_a]\npin = 18\nprotocol = oneshot125\n[motor_b]\npin = 10\nprotocol = dshot600\n"
+                "[motor_c]\npin = 19\nprotocol = multishot\nfrequency = 10000\n", config, error),
+          "ESC protocols rejected: " + error);
+    check(config.motors[0].protocol == EscProtocol::ONESHOT125 && config.motors[0].frequency == 2000 &&
+          config.motors[0].max_pulse_width == 0.25, "OneShot125 defaults");
+    check(config.motors[1].protocol == EscProtocol::DSHOT600 && config.pulses[1].protocol == EscProtocol::DSHOT600,
+          "DShot motor");
+    check(config.motors[2].frequency == 10000 && config.pulses[2].period_ns == 100000, "Multishot at 10 kHz");
+
+    check(parse(dir, "[motor_a]\npin = 18\ntach_pin = 17\npulses_per_rev = 7\nmax_rpm = 9000\n"
+                "[tachometer]\nclosed_loop = true\nwindow_ms = 20\n", config, error),
+          "tachometer rejected: " + error);
+    check(config.motors[0].tach_pin == 17 && config.motors[0].pulses_per_rev == 7.0 &&
+          config.motors[0].max_rpm == 9000.0, "tachometer of the motor");
+    check(config.closed_loop && config.tach_window_ms == 20 && config.tach_chip == "/dev/gpiochip0",
+          "[tachometer] section");
+}
+
+static void test_invalid_configs_rejected() {
+    TempDir dir;
+    const std::vector<std::pair<std::string, std::string>> cases = {
+        {"[motor_a]\npin = 18\nmin_pulse_width = 2.5\n", "neutral_pulse_width"},
+        {"[motor_a]\npin = 18\n[motor_b]\npin = 18\n", "used twice"},
+        {"[motor_a]\npin = 18\n[safety_limits]\nmax_speed = 150\n", "max_speed"},
+        {"[motor_a]\npin = 18\n[safety_limits]\nwatchdog_timeout = soon\n", "not a number"},
+        {"[motor_a]\npin = 18\n[performance]\nscheduler = rr\n", "scheduler"},
+        {"[motor_a]\npin = 18\n[logging]\nlog_level = LOUD\n", "log_level"},
+        {"[motor_a]\npin = 21\n", "also a motor pin"},
+        {"[safety_limits]\nmax_speed = 50\n", "motor_"},
+        {"[motor_a]\npin = 18\n[remote]\nudp_address = localhost\n", "udp_address"},
+        {"[motor_a]\npin = 18\n[trace]\ncapacity_mb = 0\n", "capacity_mb"},
+        {"[motor_a]\npin = 63\n[pca9685]\nenabled = true\naddress = 0x7e\n", "address"},
+        {"[motor_a]\npin = 18\n[pca9685]\naddress = board\n", "address"},
+        {"[motor_a]\npin = 18\n[metrics]\naddress = localhost\n", "address"},
+        {"[motor_a]\npin = 18\n[metrics]\nport = 70000\n", "port"},
+        {"[motor_a]\npin = 18\nprotocol = dshot1200\n", "protocol"},
+        {"[motor_a]\npin = 18\nprotocol = dshot300\n", "SPI MOSI"},
+        {"[motor_a]\npin = 18\nprotocol = oneshot42\nfrequency = 50000\n", "frequency"},
+        {"[motor_a]\npin = 18\nprotocol = oneshot125\nfrequency = 5000\n", "PWM period"},
+        {"[motor_a]\npin = 18\nprotocol = oneshot125\n[motor_b]\npin = 12\n", "share PWM channel 0"},
+        {"[motor_a]\npin = 10\nprotocol = dshot600\n[pca9685]\nenabled = true\n", "DShot"},
+        {"[motor_a]\npin = 18\ntach_pin = 18\n", "tachometer GPIO"},
+        {"[motor_a]\npin = 18\ntach_pin = 21\n", "tachometer pin"},
+        {"[motor_a]\npin = 18\ntach_pin = 17\n[motor_b]\npin = 19\ntach_pin = 17\n", "tach_pin"},
+        {"[motor_a]\npin = 18\ntach_pin = 17\n[tachometer]\nclosed_loop = true\n", "max_rpm"},
+        {"[motor_a]\npin = 18\n[tachometer]\nwindow_ms = 1\n", "window_ms"},
+    };
+    for (const auto& [content, reason] : cases) {
+        KartConfig config;
+        std::string error;
+        check(!parse(dir, content, config, error), "accepted invalid config:\n" + content);
+        check(error.find(reason) != std::string::npos, "error '" + error + "' should mention " + reason);
+    }
+}
+
+static void test_reload_rules() {
+    TempDir dir;
+    KartConfig running;
+    std::string error;
+    check(parse(dir, VALID_CONFIG, running, error), "valid config rejected");
+
+    KartConfig next = running;
+    next.safety_limits.max_speed = 30.0;
+    next.motors[0].max_pulse_width = 1.8;
+    next.log_level = 0;
+    check(config_reloadable(running, next, error), "limits, pulse widths and log level are reloadable");
+
+    next = running;
+    next.motors[1].pin = 13;
+    check(!config_reloadable(running, next, error), "pin change needs a restart");
+
+    next = running;
+    next.motors.pop_back();
+    check(!config_reloadable(running, next, error), "motor count change needs a restart");
+
+    next = running;
+    next.control_frequency = 100;
+    check(!config_reloadable(running, next, error), "frequency change needs a restart");
+
+    next = running;
+    next.remote_udp_port = 4000;
+    check(!config_reloadable(running, next, error), "remote socket change needs a restart");
+
+    next = running;
+    next.trace_capacity_mb = 64;
+    check(!config_reloadable(running, next, error), "trace size change needs a restart");
+
+    next = running;
+    next.pca9685_enabled = true;
+    check(!config_reloadable(running, next, error), "PWM output change needs a restart");
+
+    next = running;
+    next.motors[0].protocol = EscProtocol::ONESHOT125;
+    check(!config_reloadable(running, next, error), "protocol change needs a restart");
+
+    next = running;
+    next.metrics_port = 9200;
+    check(!config_reloadable(running, next, error), "metrics listener change needs a restart");
+
+    next = running;
+    next.closed_loop = true;
+    next.speed_kp = 1.0;
+    next.motors[0].max_rpm = 5000.0;
+    check(config_reloadable(running, next, error), "closed loop settings are reloadable");
+
+    next = running;
+    next.motors[0].tach_pin = 17;
+    check(!config_reloadable(running, next, error), "tachometer pin change needs a restart");
+
+    next = running;
+    next.tach_window_ms = 100;
+    check(!config_reloadable(running, next, error), "tachometer window change needs a restart");
+}
+
+static void test_store_retires_until_quiescent() {
+    auto first = std::make_shared<KartConfig>();
+    std::weak_ptr<KartConfig> first_alive = first;
+    ConfigStore store(std::move(first));
+
+    store.reader_enter();
+    const KartConfig* seen = store.read();
+
+    auto second = std::make_shared<KartConfig>();
+    second->control_frequency = 100;
+    store.publish(second);
+
+    check(!first_alive.expired(), "snapshot in use by the reader must stay alive");
+    check(seen->control_frequency == 50, "reader keeps its snapshot for the cycle");
+    check(store.reclaim() == 1, "still retired before the quiescent state");
+
+    store.quiescent();
+    check(store.reclaim() == 0, "freed after the quiescent state");
+    check(first_alive.expired(), "old snapshot freed");
+    check(store.read()->control_frequency == 100, "next cycle sees the new snapshot");
+    check(store.snapshot()->control_frequency == 100, "other threads see the new snapshot");
+    store.reader_exit();
+
+    auto third = std::make_shared<KartConfig>();
+    std::weak_ptr<KartConfig> second_alive = second;
+    second.reset();
+    store.publish(std::move(third));
+    check(second_alive.expired(), "without an active reader snapshots are freed right away");
+}
+
+static void test_store_concurrent_reload() {
+    auto make = [](int generation) {
+        auto config = std::make_shared<KartConfig>();
+        config->motors.emplace_back(18, "main_motor");
+        config->safety_limits.max_speed = generation % 100;
+        config->motors[0].max_pulse_width = 1.0 + (generation % 100) / 100.0;
+        return config;
+    };
+    ConfigStore store(make(0));
+
+    std::atomic<bool> stop{false};
+    std::atomic<bool> torn{false};
+    std::thread reader([&] {
+        store.reader_enter();
+        while (!stop.load()) {
+            const KartConfig& config = *store.read();
+            double expected = 1.0 + config.safety_limits.max_speed / 100.0;
+            if (config.motors.size() != 1 || config.motors[0].max_pulse_width != expected) {
+                torn.store(true);
+            }
+            store.quiescent();
+        }
+        store.reader_exit();
+    });
+
+    for (int generation = 1; generation <= 2000; ++generation) {
+        store.publish(make(generation));
+        store.reclaim();
+    }
+    stop.store(true);
+    reader.join();
+
+    check(!torn.load(), "reader must only see complete snapshots");
+    check(store.reclaim() == 0, "all retired snapshots freed");
+}
+
+static void test_watcher_sees_replaced_file() {
+    TempDir dir;
+    std::string path = dir.write("kart.ini", VALID_CONFIG);
+
+    std::atomic<int> changes{0};
+    ConfigWatcher watcher;
+    check(watcher.start(path, [&] { changes.fetch_add(1); }), "watcher should start");
+
+    // Editors write a temporary file and rename it over the original
+    dir.write("kart.ini.tmp", VALID_CONFIG);
+    check(std::rename((path + ".tmp").c_str(), path.c_str()) == 0, "rename failed");
+    dir.write("other.ini", VALID_CONFIG);
+
+    for (int i = 0; i < 100 && changes.load() == 0; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    }
+    watcher.stop();
+    check(changes.load() == 1, "exactly one change for the watched file");
+}
+
+int main() {
+    std::cout << "Kart Configuration - Test Suite" << std::endl;
+    std::cout << "===============================" << std::endl;
+
+    std::vector<std::pair<const char*, std::function<void()>>> tests = {
+        {"Shipped Config", test_shipped_config},
+        {"Motor Sections", test_motor_sections},
+        {"Invalid Configs Rejected", test_invalid_configs_rejected},
+        {"Reload Rules", test_reload_rules},
+        {"Store Retires Until Quiescent", test_store_retires_until_quiescent},
+        {"Store Concurrent Reload", test_store_concurrent_reload},
+        {"Watcher Sees Replaced File", test_watcher_sees_replaced_file},
+    };
+
+    int failed = 0;
+    for (const auto& [name, test] : tests) {
+        try {
+            test();
+            std::cout << "✓ " << name << " PASSED" << std::endl;
+        } catch (const std::exception& e) {
+            std::cout << "✗ " << name << " FAILED: " << e.what() << std::endl;
+            ++failed;
+        }
+    }
+
+    std::cout << "Tests Passed: " << tests.size() - failed << std::endl;
+    std::cout << "Tests Failed: " << failed << std::endl;
+    return failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,194 @@
+/*
+ * Tests for the DShot waveform output (kart_dshot.h)
+ * ==================================================
+ *
+ * Encodes frames into bit streams and decodes them back through
+ * WaveformCapture, checking the bit timing of every DShot variant and the
+ * checksums, then runs DshotBackend on its own and under the controller
+ * with simulated GPIO.
+ *
+ * Compile with: g++ -std=c++20 -pthread -DTEST_MODE -o test_kart_dshot test_kart_dshot.cpp -lrt
+ */
+
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "kart_dshot.h"
+#include "kart_sim.h"
+
+static Logger::Options test_log_options() {
+    Logger::Options options = Logger::default_options();
+    options.text_path.clear();
+    options.binary_path.clear();
+    options.console_output = false;
+    return options;
+}
+
+Logger g_logger(test_log_options());
+
+static void check(bool condition, const std::string& message) {
+    if (!condition) {
+        throw std::runtime_error(message);
+    }
+}
+
+static bool near(double value, double expected, double tolerance) {
+    return std::abs(value - expected) <= tolerance;
+}
+
+static WaveformCapture::Decoded round_trip(std::uint16_t frame, EscProtocol protocol) {
+    std::uint8_t samples[DshotEncoder::WAVEFORM_BYTES];
+    DshotEncoder::encode(frame, samples);
+    return WaveformCapture::decode(samples, sizeof(samples), DshotEncoder::sample_rate(protocol));
+}
+
+static void test_bit_timing() {
+    for (EscProtocol protocol : {EscProtocol::DSHOT150, EscProtocol::DSHOT300, EscProtocol::DSHOT600}) {
+        const std::string name = esc_protocol_name(protocol);
+        const double bit_ns = 1e9 / dshot_bitrate(protocol);
+        // 0xAAAA alternates ones and zeros, so both high times are measured
+        const WaveformCapture::Decoded decoded = round_trip(0xAAAA, protocol);
+        check(decoded.bits == 16 && decoded.frame == 0xAAAA, name + " frame");
+        check(near(decoded.bit_ns, bit_ns, 1.0), name + " bit time " + std::to_string(decoded.bit_ns));
+        check(near(decoded.one_high_ns, 0.75 * bit_ns, 1.0) && near(decoded.one_high_min_ns, 0.75 * bit_ns, 1.0),
+              name + " T1H " + std::to_string(decoded.one_high_ns));
+        check(near(decoded.zero_high_ns, 0.375 * bit_ns, 1.0) && near(decoded.zero_high_min_ns, 0.375 * bit_ns, 1.0),
+              name + " T0H " + std::to_string(decoded.zero_high_ns));
+    }
+    check(near(round_trip(0xAAAA, EscProtocol::DSHOT600).bit_ns, 1666.67, 0.01), "DShot600 is 1.67 us per bit");
+}
+
+static void test_every_frame_round_trips() {
+    for (std::uint16_t value = 0; value < 2048; ++value) {
+        for (bool telemetry : {false, true}) {
+            const std::uint16_t frame = dshot_frame(value, telemetry);
+            const WaveformCapture::Decoded decoded = round_trip(frame, EscProtocol::DSHOT300);
+            check(decoded.frame == frame && decoded.value == value && decoded.telemetry == telemetry &&
+                  decoded.checksum_ok, "frame " + std::to_string(frame));
+        }
+    }
+}
+
+static void test_corruption_detected() {
+    std::uint8_t samples[DshotEncoder::WAVEFORM_BYTES];
+    DshotEncoder::encode(dshot_frame(1046), samples);
+    samples[3] = samples[3] == DshotEncoder::ONE ? DshotEncoder::ZERO : DshotEncoder::ONE;
+    WaveformCapture::Decoded decoded = WaveformCapture::decode(samples, sizeof(samples), 4800000);
+    check(decoded.bits == 16 && !decoded.checksum_ok, "flipped bit fails the checksum");
+
+    DshotEncoder::encode(dshot_frame(1046), samples);
+    samples[15] = 0;
+    decoded = WaveformCapture::decode(samples, sizeof(samples), 4800000);
+    check(decoded.bits == 15, "missing bit");
+}
+
+static void test_backend() {
+    SimClock stamps;
+    auto capture_sink = std::make_unique<WaveformCapture>();
+    WaveformCapture* capture = capture_sink.get();
+    auto analog_sink = std::make_unique<SimPwmBackend>(stamps);
+    SimPwmBackend* analog = analog_sink.get();
+    DshotBackend backend(std::move(capture_sink), std::move(analog_sink));
+
+    check(backend.setup_dshot(10, EscProtocol::DSHOT600), "DShot pin");
+    check(!backend.setup_dshot(11, EscProtocol::ONESHOT125), "analog protocol refused");
+    check(!backend.setup(10, 500000), "DShot pin is not analog");
+    check(backend.setup(18, 500000), "analog pin");
+
+    backend.write(10, dshot_frame(1500));
+    backend.write(18, 187500);
+    backend.flush();
+    check(capture->decode(10).value == 1500 && capture->decode(10).checksum_ok, "frame sent");
+    check(analog->pulse(18) == 187500, "analog pin reaches its backend");
+
+    backend.flush();
+    check(capture->sends(10) == 2, "frames repeat every flush");
+    DshotBackend::Stats stats = backend.stats();
+    check(stats.flushes == 2 && stats.frames == 2 && stats.errors == 0, "statistics");
+
+    capture->set_failing(true);
+    backend.flush();
+    check(backend.stats().errors == 1, "refused frame counted");
+    capture->set_failing(false);
+
+    backend.release(10);
+    check(!capture->is_open(10), "released pin closed");
+    backend.write(10, dshot_frame(1600));
+    backend.flush();
+    check(capture->sends(10) == 2, "released pin sends nothing");
+    check(backend.summary().find("DShot(capture flushes:") == 0, "summary");
+}
+
+static void test_controller() {
+    KartConfig config = simulation_config(create_default_config());
+    config.motors.clear();
+    config.motors.emplace_back(10, "left", 1.0, 2.0, 1.5, 50, EscProtocol::DSHOT600);
+    config.motors.emplace_back(18, "right", 0.125, 0.25, 0.1875, 2000, EscProtocol::ONESHOT125);
+    config.control_frequency = 200;
+    config.safety_limits.watchdog_timeout = 3600.0;
+    compute_pulse_params(config);
+
+    SimClock stamps;
+    auto capture_sink = std::make_unique<WaveformCapture>();
+    WaveformCapture* capture = capture_sink.get();
+    auto analog_sink = std::make_unique<SimPwmBackend>(stamps);
+    SimPwmBackend* analog = analog_sink.get();
+    SimGpio::board().release(config.emergency_pin, HIGH);
+    ESCController controller(config, std::make_unique<DshotBackend>(std::move(capture_sink), std::move(analog_sink)));
+    check(controller.start(), "controller started");
+    check(capture->decode(10).bits == 16 && capture->decode(10).value == DSHOT_STOP, "stop frame after start");
+    check(analog->pulse(18) == 187500, "OneShot125 neutral");
+
+    controller.calibrate_esc(controller.motor_handle("left"));
+    controller.set_motor_speed("left", 50.0);
+    controller.set_motor_speed("right", -50.0);
+    std::this_thread::sleep_for(std::chrono::milliseconds(500));
+    const WaveformCapture::Decoded decoded = capture->decode(10);
+    check(decoded.checksum_ok && decoded.frame == pulse_ns(config.pulses[0], 50.0), "DShot frame for 50 %");
+    check(decoded.value == DSHOT_FORWARD_MIN + 499, "half of 999 forward steps: " + std::to_string(decoded.value));
+    check(analog->pulse(18) == 156250, "OneShot125 half reverse");
+    check(!controller.calibration_active(), "DShot motor refused calibration");
+    const std::uint64_t sends = capture->sends(10);
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    check(capture->sends(10) > sends + 5, "frames keep coming while the speed holds");
+
+    controller.emergency_stop_all();
+    check(capture->decode(10).value == DSHOT_STOP, "emergency stop sends the stop frame at once");
+    check(controller.get_status().find("DShot(capture") != std::string::npos, "status reports the output");
+    controller.stop();
+}
+
+int main() {
+    std::cout << "Kart DShot Output - Test Suite" << std::endl;
+    std::cout << "==============================" << std::endl;
+
+    std::vector<std::pair<const char*, std::function<void()>>> tests = {
+        {"Bit Timing", test_bit_timing},
+        {"Every Frame Round Trips", test_every_frame_round_trips},
+        {"Corruption Detected", test_corruption_detected},
+        {"Backend", test_backend},
+        {"Controller", test_controller},
+    };
+
+    int failed = 0;
+    for (const auto& [name, test] : tests) {
+        try {
+            test();
+            std::cout << "✓ " << name << " PASSED" << std::endl;
+        } catch (const std::exception& e) {
+            std::cout << "✗ " << name << " FAILED: " << e.what() << std::endl;
+            ++failed;
+        }
+    }
+
+    std::cout << "Tests Passed: " << tests.size() - failed << std::endl;
+    std::cout << "Tests Failed: " << failed << std::endl;
+    return failed == 0 ? 0 : 1;
+}
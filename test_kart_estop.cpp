@@ -0,0 +1,189 @@
+/*
+ * Tests for the emergency stop path (EmergencyStop)
+ * =================================================
+ *
+ * Uses a recording PWM backend; no hardware required.
+ *
+ * Compile with: g++ -std=c++20 -pthread -o test_kart_estop test_kart_estop.cpp
+ */
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "kart_estop.h"
+
+static void check(bool condition, const std::string& message) {
+    if (!condition) {
+        throw std::runtime_error(message);
+    }
+}
+
+// Remembers the last pulse per pin
+class RecordingBackend : public PwmBackend {
+public:
+    std::atomic<std::uint32_t> pulses[MAX_GPIO_PIN] = {};
+    std::atomic<int> writes{0};
+
+    const char* name() const override {
+        return "recording";
+    }
+
+    bool setup(int, std::uint32_t) override {
+        return true;
+    }
+
+    void write(int pin, std::uint32_t pulse_ns) override {
+        pulses[pin].store(pulse_ns);
+        writes.fetch_add(1);
+    }
+
+    void release(int) override {}
+};
+
+static void test_trigger_writes_neutral() {
+    RecordingBackend pwm;
+    EmergencyStop estop;
+    estop.attach(&pwm);
+    check(estop.add_output(18, 1500000), "add output 18");
+    check(estop.add_output(19, 1520000), "add output 19");
+    pwm.write(18, 2000000);
+    pwm.write(19, 1000000);
+
+    check(!estop.active(), "not active before trigger");
+    estop.trigger(EmergencyStop::CONSOLE);
+    check(estop.active(), "active after trigger");
+    check(pwm.pulses[18] == 1500000, "output 18 neutral");
+    check(pwm.pulses[19] == 1520000, "output 19 neutral");
+
+    estop.reset();
+    check(!estop.active(), "reset clears the flag");
+}
+
+static void test_neutral_follows_reload() {
+    RecordingBackend pwm;
+    EmergencyStop estop;
+    estop.attach(&pwm);
+    estop.add_output(18, 1500000);
+    estop.set_neutral(0, 1480000);
+    estop.set_neutral(5, 1);   // unknown output, ignored
+    estop.trigger(EmergencyStop::COMMAND);
+    check(pwm.pulses[18] == 1480000, "reloaded neutral is used");
+}
+
+static void test_output_capacity() {
+    EmergencyStop estop;
+    for (std::size_t i = 0; i < EmergencyStop::MAX_OUTPUTS; ++i) {
+        check(estop.add_output(static_cast<int>(i), 1500000), "output within capacity");
+    }
+    check(!estop.add_output(40, 1500000), "output beyond capacity is rejected");
+    // No backend attached: still sets the flag
+    estop.trigger(EmergencyStop::CONSOLE);
+    check(estop.active(), "flag set without backend");
+}
+
+static void test_deferred_event() {
+    RecordingBackend pwm;
+    EmergencyStop estop;
+    estop.attach(&pwm);
+    estop.add_output(18, 1500000);
+
+    EmergencyStop::Event event;
+    check(!estop.take_event(event), "no event before a trigger");
+    check(!estop.wait_event(std::chrono::milliseconds(10)), "wait times out without a trigger");
+
+    std::thread trigger([&estop] {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        estop.trigger(EmergencyStop::HARDWARE);
+    });
+    check(estop.wait_event(std::chrono::seconds(5)), "trigger wakes the waiter");
+    trigger.join();
+    check(estop.take_event(event), "event after a trigger");
+    check(event.source == EmergencyStop::HARDWARE, "event source");
+    check(event.triggers == 1, "one trigger");
+    check(!estop.take_event(event), "event is taken once");
+
+    // Triggers before the handler runs are reported together
+    estop.trigger(EmergencyStop::WATCHDOG, EmergencyStop::now_ns() - 5000);
+    estop.trigger(EmergencyStop::CONSOLE);
+    check(estop.take_event(event), "coalesced event");
+    check(event.triggers == 2, "two triggers reported");
+    check(event.source == EmergencyStop::CONSOLE, "latest source reported");
+    check(!estop.wait_event(std::chrono::milliseconds(1)), "wake-ups drained with the event");
+}
+
+static void test_latency_recorded() {
+    RecordingBackend pwm;
+    EmergencyStop estop;
+    estop.attach(&pwm);
+    estop.add_output(18, 1500000);
+
+    std::uint64_t latency = estop.trigger(EmergencyStop::BENCHMARK, EmergencyStop::now_ns() - 100000);
+    check(latency >= 100000, "latency counts from the given trigger time");
+    LatencyHistogram::Snapshot snap = estop.latency().snapshot();
+    check(snap.count == 1, "one latency sample");
+    check(snap.max_ns == latency, "sample is the returned latency");
+}
+
+static void test_concurrent_triggers() {
+    RecordingBackend pwm;
+    EmergencyStop estop;
+    estop.attach(&pwm);
+    estop.add_output(18, 1500000);
+    estop.add_output(19, 1500000);
+
+    constexpr int THREADS = 4;
+    constexpr int TRIGGERS = 1000;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < THREADS; ++t) {
+        threads.emplace_back([&estop] {
+            for (int i = 0; i < TRIGGERS; ++i) {
+                estop.trigger(EmergencyStop::COMMAND);
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    check(pwm.writes == THREADS * TRIGGERS * 2, "every trigger writes every output");
+    EmergencyStop::Event event;
+    check(estop.take_event(event), "event after concurrent triggers");
+    check(event.triggers == THREADS * TRIGGERS, "all triggers counted");
+    check(estop.latency().snapshot().count <= static_cast<std::uint64_t>(THREADS * TRIGGERS),
+          "histogram never records more than the triggers");
+}
+
+int main() {
+    std::cout << "Kart Emergency Stop - Test Suite" << std::endl;
+    std::cout << "================================" << std::endl;
+
+    std::vector<std::pair<const char*, std::function<void()>>> tests = {
+        {"Trigger Writes Neutral", test_trigger_writes_neutral},
+        {"Neutral Follows Reload", test_neutral_follows_reload},
+        {"Output Capacity", test_output_capacity},
+        {"Deferred Event", test_deferred_event},
+        {"Latency Recorded", test_latency_recorded},
+        {"Concurrent Triggers", test_concurrent_triggers},
+    };
+
+    int failed = 0;
+    for (const auto& [name, test] : tests) {
+        try {
+            test();
+            std::cout << "✓ " << name << " PASSED" << std::endl;
+        } catch (const std::exception& e) {
+            std::cout << "✗ " << name << " FAILED: " << e.what() << std::endl;
+            ++failed;
+        }
+    }
+
+    std::cout << "Tests Passed: " << tests.size() - failed << std::endl;
+    std::cout << "Tests Failed: " << failed << std::endl;
+    return failed == 0 ? 0 : 1;
+}
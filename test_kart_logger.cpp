@@ -0,0 +1,285 @@
+/*
+ * Tests for the asynchronous binary logger (kart_logger.h)
+ * ========================================================
+ *
+ * Every test runs its own Logger on files in a temporary directory and
+ * reads them back once the logger is destroyed (which writes everything
+ * still queued). The last test decodes a binary log with kart_logdecode,
+ * which has to be built first (make kart_logdecode).
+ *
+ * Compile with: g++ -std=c++20 -pthread -o test_kart_logger test_kart_logger.cpp
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include <sys/stat.h>
+#include "kart_logger.h"
+
+static void check(bool condition, const std::string& message) {
+    if (!condition) {
+        throw std::runtime_error(message);
+    }
+}
+
+// Temporary directory for the log files
+class TempDir {
+public:
+    std::string path;
+
+    TempDir() {
+        char dir[] = "/tmp/kart_logger_test.XXXXXX";
+        check(mkdtemp(dir) != nullptr, "mkdtemp failed");
+        path = dir;
+    }
+
+    ~TempDir() {
+        std::string command = "rm -rf '" + path + "'";
+        if (std::system(command.c_str()) != 0) {
+            std::cerr << "could not remove " << path << std::endl;
+        }
+    }
+};
+
+static Logger::Options file_options(const TempDir& dir) {
+    Logger::Options options = Logger::default_options();
+    options.text_path = dir.path + "/kart.log";
+    options.binary_path = dir.path + "/kart.bin";
+    options.console_output = false;
+    options.flush_interval = std::chrono::milliseconds(1);
+    return options;
+}
+
+static bool exists(const std::string& path) {
+    struct stat st;
+    return ::stat(path.c_str(), &st) == 0;
+}
+
+static std::size_t file_size(const std::string& path) {
+    struct stat st;
+    check(::stat(path.c_str(), &st) == 0, "missing " + path);
+    return static_cast<std::size_t>(st.st_size);
+}
+
+// Records of a binary log after checking its header
+static std::vector<LogRecord> read_records(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    LogFileHeader header{};
+    check(file.read(reinterpret_cast<char*>(&header), sizeof(header)) && std::memcmp(header.magic, "KLOG", 4) == 0,
+          path + " has no binary log header");
+    check(header.version == LOG_FILE_VERSION && header.record_size == sizeof(LogRecord), "header of " + path);
+    std::vector<LogRecord> records;
+    LogRecord record;
+    while (file.read(reinterpret_cast<char*>(&record), sizeof(record))) {
+        records.push_back(record);
+    }
+    check(file.gcount() == 0, path + " ends within a record");
+    return records;
+}
+
+static std::vector<std::string> read_lines(const std::string& path) {
+    std::ifstream file(path);
+    std::vector<std::string> lines;
+    for (std::string line; std::getline(file, line);) {
+        lines.push_back(line);
+    }
+    return lines;
+}
+
+static bool ends_with(const std::string& text, const std::string& tail) {
+    return text.size() >= tail.size() && text.compare(text.size() - tail.size(), tail.size(), tail) == 0;
+}
+
+static void test_threads_in_order() {
+    TempDir dir;
+    constexpr int THREADS = 4;
+    constexpr int MESSAGES = 400;
+    {
+        Logger logger(file_options(dir));
+        std::vector<std::thread> threads;
+        for (int t = 0; t < THREADS; ++t) {
+            threads.emplace_back([&logger, t] {
+                for (int i = 0; i < MESSAGES; ++i) {
+                    logger.log(Logger::INFO, LogMsg::ESTOP_LATENCY, "test", i, t);
+                }
+            });
+        }
+        for (std::thread& thread : threads) {
+            thread.join();
+        }
+        check(logger.dropped_messages() == 0, "nothing dropped");
+    }
+
+    const std::vector<LogRecord> records = read_records(dir.path + "/kart.bin");
+    check(records.size() == THREADS * MESSAGES, "every message written: " + std::to_string(records.size()));
+    int next[THREADS] = {};
+    int slot[THREADS] = {-1, -1, -1, -1};
+    for (const LogRecord& record : records) {
+        const int t = static_cast<int>(record.args[1].i);
+        check(record.msg == static_cast<std::uint16_t>(LogMsg::ESTOP_LATENCY) && t >= 0 && t < THREADS,
+              "message id and thread argument");
+        check(record.args[0].i == next[t]++, "messages of thread " + std::to_string(t) + " in order");
+        check(slot[t] < 0 || slot[t] == record.thread, "one slot per thread");
+        slot[t] = record.thread;
+    }
+    for (int a = 0; a < THREADS; ++a) {
+        for (int b = 0; b < a; ++b) {
+            check(slot[a] != slot[b], "threads log into their own rings");
+        }
+    }
+    check(read_lines(dir.path + "/kart.log").size() == THREADS * MESSAGES, "every message in the text log");
+}
+
+static void test_continuation_records() {
+    TempDir dir;
+    std::string text;
+    for (int i = 0; i < 100; ++i) {
+        text += static_cast<char>('a' + i % 26);
+    }
+    std::string huge(1000, 'x');
+    {
+        Logger logger(file_options(dir));
+        logger.log(Logger::INFO, LogMsg::STATUS, text);
+        logger.log(Logger::WARNING, LogMsg::STATUS, huge);
+    }
+
+    // 47 characters per record: 47 + 47 + 6 for the first message
+    const std::vector<LogRecord> records = read_records(dir.path + "/kart.bin");
+    const std::size_t capped = LOG_MAX_RECORDS_PER_MESSAGE;
+    check(records.size() == 3 + capped, "records: " + std::to_string(records.size()));
+    check((records[0].flags & LOG_FLAG_CONTINUED) && (records[1].flags & LOG_FLAG_CONTINUED) &&
+              !(records[2].flags & LOG_FLAG_CONTINUED),
+          "continuation flags on all but the last record");
+    check(records[1].msg == records[0].msg && records[2].timestamp_ns == records[0].timestamp_ns,
+          "continuations repeat the head");
+    check(std::string(records[2].text) == text.substr(94), "last chunk");
+    check(!(records[3 + capped - 1].flags & LOG_FLAG_CONTINUED), "capped message ends its records");
+
+    const std::vector<std::string> lines = read_lines(dir.path + "/kart.log");
+    check(lines.size() == 2, "two lines");
+    check(ends_with(lines[0], " - INFO - Status: " + text), "text joined again: " + lines[0]);
+    check(ends_with(lines[1], " - WARNING - Status: " + huge.substr(0, capped * (LOG_TEXT_BYTES - 1))),
+          "long text cut at " + std::to_string(capped) + " records");
+}
+
+static void test_drops_counted() {
+    TempDir dir;
+    constexpr int MESSAGES = static_cast<int>(Logger::RING_CAPACITY) + 88;
+    Logger::Options options = file_options(dir);
+    // The writer drains only when it is destroyed
+    options.flush_interval = std::chrono::milliseconds(60000);
+    std::uint64_t dropped = 0;
+    {
+        Logger logger(options);
+        for (int i = 0; i < MESSAGES; ++i) {
+            logger.log(Logger::INFO, LogMsg::MOTOR_INITIALIZED, "main_motor", i);
+        }
+        dropped = logger.dropped_messages();
+    }
+    check(dropped == 88, "full ring drops the rest: " + std::to_string(dropped));
+
+    const std::vector<LogRecord> records = read_records(dir.path + "/kart.bin");
+    check(records.size() == Logger::RING_CAPACITY + 1, "kept messages and the drop note");
+    check(records[Logger::RING_CAPACITY - 1].args[0].i == static_cast<std::int64_t>(Logger::RING_CAPACITY) - 1,
+          "the oldest messages are kept");
+    const LogRecord& note = records.back();
+    check(note.msg == static_cast<std::uint16_t>(LogMsg::LOG_RECORDS_DROPPED) && note.args[0].i == 88,
+          "drop note with the count");
+    check(ends_with(read_lines(dir.path + "/kart.log").back(), " - WARNING - 88 log records dropped (buffer full)"),
+          "drop note in the text log");
+}
+
+static void test_rotation_and_size_cap() {
+    TempDir dir;
+    Logger::Options options = file_options(dir);
+    options.max_file_bytes = 4096;
+    options.max_files = 3;
+    constexpr int MESSAGES = 300;
+    {
+        Logger logger(options);
+        for (int i = 0; i < MESSAGES; ++i) {
+            logger.log(Logger::INFO, LogMsg::MOTOR_INITIALIZED, "main_motor", i);
+        }
+    }
+
+    for (const std::string& name : {options.binary_path, options.text_path}) {
+        check(exists(name) && exists(name + ".1") && exists(name + ".2"), "rotated files of " + name);
+        check(!exists(name + ".3"), "at most max_files files of " + name);
+        for (const std::string& file : {name, name + ".1", name + ".2"}) {
+            check(file_size(file) <= options.max_file_bytes, file + " above max_file_bytes");
+        }
+    }
+
+    // Every binary file is readable on its own; the newest ends with the last message
+    std::vector<LogRecord> newest = read_records(options.binary_path);
+    check(!newest.empty() && newest.back().args[0].i == MESSAGES - 1, "newest file holds the last message");
+    std::vector<LogRecord> older = read_records(options.binary_path + ".1");
+    check(!older.empty() && older.back().args[0].i + 1 == newest.front().args[0].i, "files continue each other");
+    check(ends_with(read_lines(options.text_path).back(), "Initialized motor main_motor on pin " +
+                                                          std::to_string(MESSAGES - 1)),
+          "newest text file ends with the last message");
+}
+
+static void test_logdecode_round_trip() {
+    TempDir dir;
+    {
+        Logger logger(file_options(dir));
+        logger.log(Logger::INFO, LogMsg::MOTOR_INITIALIZED, "main_motor", 18);
+        logger.log(Logger::DEBUG, LogMsg::CONTROL_LOOP_FREQUENCY, 200.5);
+        logger.log(Logger::ERROR, LogMsg::CONTROL_LOOP_ERROR, std::string(60, 'e'));
+    }
+
+    const std::string command = "./kart_logdecode " + dir.path + "/kart.bin";
+    std::unique_ptr<std::FILE, int (*)(std::FILE*)> pipe(::popen(command.c_str(), "r"), ::pclose);
+    check(pipe != nullptr, "cannot run kart_logdecode");
+    std::vector<std::string> decoded;
+    char line[1024];
+    while (std::fgets(line, sizeof(line), pipe.get()) != nullptr) {
+        decoded.emplace_back(line, strcspn(line, "\n"));
+    }
+    check(::pclose(pipe.release()) == 0, "kart_logdecode failed (built with make kart_logdecode?)");
+
+    check(decoded == read_lines(dir.path + "/kart.log"), "decoder prints the lines of the text log");
+    check(decoded.size() == 3, "three messages decoded");
+    check(ends_with(decoded[0], " - INFO - Initialized motor main_motor on pin 18"), decoded[0]);
+    check(ends_with(decoded[1], " - DEBUG - Control loop running at 200.5 Hz"), decoded[1]);
+    check(ends_with(decoded[2], " - ERROR - Error in control loop: " + std::string(60, 'e')), decoded[2]);
+}
+
+int main() {
+    std::cout << "Kart Logger - Test Suite" << std::endl;
+    std::cout << "========================" << std::endl;
+
+    std::vector<std::pair<const char*, std::function<void()>>> tests = {
+        {"Threads In Order", test_threads_in_order},
+        {"Continuation Records", test_continuation_records},
+        {"Drops Counted", test_drops_counted},
+        {"Rotation And Size Cap", test_rotation_and_size_cap},
+        {"Logdecode Round Trip", test_logdecode_round_trip},
+    };
+
+    int failed = 0;
+    for (const auto& [name, test] : tests) {
+        try {
+            test();
+            std::cout << "✓ " << name << " PASSED" << std::endl;
+        } catch (const std::exception& e) {
+            std::cout << "✗ " << name << " FAILED: " << e.what() << std::endl;
+            ++failed;
+        }
+    }
+
+    std::cout << "Tests Passed: " << tests.size() - failed << std::endl;
+    std::cout << "Tests Failed: " << failed << std::endl;
+    return failed == 0 ? 0 : 1;
+}
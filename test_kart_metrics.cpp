@@ -0,0 +1,223 @@
+/*
+ * Tests for the Prometheus metrics endpoint (kart_metrics.h)
+ * ==========================================================
+ *
+ * The text format on its own, the HTTP listener over a real TCP socket on
+ * localhost, and a scrape of the controller with simulated GPIO.
+ *
+ * Compile with: g++ -std=c++20 -pthread -DTEST_MODE -o test_kart_metrics test_kart_metrics.cpp -lrt
+ */
+
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include "kart_metrics.h"
+#include "kart_sim.h"
+
+static Logger::Options test_log_options() {
+    Logger::Options options = Logger::default_options();
+    options.text_path.clear();
+    options.binary_path.clear();
+    options.console_output = false;
+    return options;
+}
+
+Logger g_logger(test_log_options());
+
+static void check(bool condition, const std::string& message) {
+    if (!condition) {
+        throw std::runtime_error(message);
+    }
+}
+
+static bool contains(const std::string& text, const std::string& line) {
+    return text.find(line) != std::string::npos;
+}
+
+// Whole response of one HTTP request to 127.0.0.1:port
+static std::string http_get(int port, const std::string& path) {
+    int fd = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    check(fd >= 0, "client socket");
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(static_cast<std::uint16_t>(port));
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (::connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+        ::close(fd);
+        throw std::runtime_error("connect to port " + std::to_string(port));
+    }
+    const std::string request = "GET " + path + " HTTP/1.1\r\nHost: localhost\r\n\r\n";
+    check(::send(fd, request.data(), request.size(), MSG_NOSIGNAL) == static_cast<ssize_t>(request.size()),
+          "request sent");
+    std::string response;
+    char chunk[4096];
+    ssize_t got;
+    while ((got = ::recv(fd, chunk, sizeof(chunk), 0)) > 0) {
+        response.append(chunk, static_cast<std::size_t>(got));
+    }
+    ::close(fd);
+    return response;
+}
+
+static void test_text_format() {
+    char buffer[8192];
+    MetricsWriter out(buffer, sizeof(buffer));
+    out.family("kart_test_total", "counter", "Test counter");
+    out.sample("kart_test_total", "", std::uint64_t{42});
+    out.sample("kart_test_total", metrics_label("motor", "left \"A\""), 1.5);
+    check(!out.overflow(), "fits");
+    const std::string text(out.text());
+    check(contains(text, "# HELP kart_test_total Test counter\n# TYPE kart_test_total counter\n"), "family lines");
+    check(contains(text, "kart_test_total 42\n"), "unlabelled sample");
+    check(contains(text, "kart_test_total{motor=\"left \\\"A\\\"\"} 1.5\n"), "escaped label value");
+}
+
+static void test_histogram_buckets() {
+    LatencyHistogram histogram;
+    histogram.record(500);          // bucket le=512 ns
+    histogram.record(3000);         // le=4096 ns
+    histogram.record(3000);
+    histogram.record(1ull << 40);   // beyond the last finite bucket
+
+    char buffer[8192];
+    MetricsWriter out(buffer, sizeof(buffer));
+    out.histogram("kart_test_seconds", "motor=\"a\"", histogram.snapshot());
+    const std::string text(out.text());
+    check(contains(text, "kart_test_seconds_bucket{motor=\"a\",le=\"2.56e-07\"} 0\n"), "empty bucket");
+    check(contains(text, "kart_test_seconds_bucket{motor=\"a\",le=\"5.12e-07\"} 1\n"), "first sample");
+    check(contains(text, "kart_test_seconds_bucket{motor=\"a\",le=\"4.096e-06\"} 3\n"), "buckets are cumulative");
+    check(contains(text, "kart_test_seconds_bucket{motor=\"a\",le=\"1.073741824\"} 3\n"), "last finite bucket");
+    check(contains(text, "kart_test_seconds_bucket{motor=\"a\",le=\"+Inf\"} 4\n"), "+Inf holds everything");
+    check(contains(text, "kart_test_seconds_count{motor=\"a\"} 4\n"), "count");
+    check(contains(text, "kart_test_seconds_sum{motor=\"a\"} 1099.5116"), "sum in seconds");
+}
+
+static void test_overflow() {
+    char buffer[64];
+    MetricsWriter out(buffer, sizeof(buffer));
+    out.family("kart_test_total", "counter", "A help text that does not fit into sixty-four bytes");
+    check(out.overflow(), "overflow flagged");
+    check(out.text().size() <= sizeof(buffer), "never writes past the buffer");
+
+    MetricsServer server(128);
+    check(server.open("127.0.0.1", 0) && server.port() > 0, "listening on a free port");
+    check(server.start([](MetricsWriter& w) { w.family("kart_a", "gauge", std::string(200, 'x')); }), "started");
+    check(contains(http_get(server.port(), "/metrics"), "HTTP/1.1 500 "), "oversized response is a 500");
+    check(server.stats().overflows == 1 && server.stats().scrapes == 0, "overflow counted");
+    server.stop();
+}
+
+static void test_http_endpoint() {
+    MetricsServer server;
+    check(server.open("127.0.0.1", 0), "listening");
+    check(!server.open("localhost", 0), "IPv4 addresses only");
+    check(server.start([](MetricsWriter& out) {
+        out.family("kart_answer", "gauge", "The answer");
+        out.sample("kart_answer", "", std::uint64_t{42});
+    }), "started");
+
+    std::string response = http_get(server.port(), "/metrics");
+    check(response.starts_with("HTTP/1.1 200 OK\r\n"), "status line: " + response.substr(0, 40));
+    check(contains(response, "Content-Type: text/plain; version=0.0.4"), "exposition content type");
+    const std::size_t body = response.find("\r\n\r\n") + 4;
+    check(contains(response, "Content-Length: " + std::to_string(response.size() - body) + "\r\n"),
+          "content length matches the body");
+    check(contains(response, "\nkart_answer 42\n"), "rendered sample");
+    check(contains(response, "\nkart_metrics_scrapes_total 1\n"), "scrape counter");
+
+    check(contains(http_get(server.port(), "/"), "HTTP/1.1 404 "), "other paths");
+    response = http_get(server.port(), "/metrics");
+    check(contains(response, "\nkart_metrics_scrapes_total 2\n") && contains(response, "\nkart_metrics_errors_total 1\n"),
+          "server counters");
+    server.stop();
+    check(server.fd() < 0, "listener closed");
+}
+
+static void test_controller_scrape() {
+    // Borrow a free port for the configured endpoint
+    int port;
+    {
+        MetricsServer probe;
+        check(probe.open("127.0.0.1", 0), "probe port");
+        port = probe.port();
+    }
+
+    KartConfig config = simulation_config(create_default_config());
+    config.motors.emplace_back(19, "second_motor");
+    config.control_frequency = 200;
+    config.safety_limits.watchdog_timeout = 3600.0;
+    config.metrics_port = port;
+    compute_pulse_params(config);
+
+    SimGpio::board().release(config.emergency_pin, HIGH);
+    ESCController controller(config);
+    check(controller.start(), "controller started");
+    controller.set_motor_speed("main_motor", 20.0);
+    check(!controller.set_motor_speed("no_such_motor", 20.0), "unknown motor refused");
+    std::this_thread::sleep_for(std::chrono::milliseconds(400));
+
+    controller.emergency_stop_all();
+    check(!controller.set_motor_speed("main_motor", 10.0), "refused during the emergency stop");
+    check(!controller.set_motor_speed("main_motor", 10.0), "refused again");
+
+    // The control loop republishes the stopped motor at its next cycle
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(2);
+    while (controller.current_speed(0) != 0.0 && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    const std::string response = http_get(port, "/metrics");
+    controller.stop();
+
+    check(response.starts_with("HTTP/1.1 200 OK\r\n"), "scraped the controller");
+    check(contains(response, "\nkart_running 1\n"), "running");
+    check(contains(response, "\nkart_emergency_stop_active 1\n"), "emergency stop engaged");
+    check(contains(response, "\nkart_commands_rejected_total{reason=\"emergency_stop\"} 2\n"), "rejected by the stop");
+    check(contains(response, "\nkart_commands_rejected_total{reason=\"invalid_motor\"} 1\n"), "unknown motor");
+    check(contains(response, "\nkart_commands_applied_total 1\n"), "one command applied");
+    check(contains(response, "\nkart_emergency_stops_total{source=\"console\"} 1\n"), "stop by source");
+    check(contains(response, "\nkart_watchdog_trips_total 0\n"), "no watchdog trip");
+    check(contains(response, "\nkart_emergency_stop_latency_seconds_count 1\n"), "stop latency recorded");
+    check(contains(response, "\nkart_motor_target_speed_percent{motor=\"second_motor\"} 0\n"), "per-motor target");
+    check(contains(response, "\nkart_motor_current_speed_percent{motor=\"main_motor\"} 0\n"), "stopped motor");
+    check(contains(response, "kart_control_execution_seconds_bucket{le=\"+Inf\"}"), "loop histograms");
+    check(contains(response, "kart_pwm_write_seconds_count "), "PWM write time");
+    check(!contains(response, "kart_pwm_write_seconds_count 0\n"), "PWM writes measured");
+}
+
+int main() {
+    std::cout << "Kart Metrics - Test Suite" << std::endl;
+    std::cout << "=========================" << std::endl;
+
+    std::vector<std::pair<const char*, std::function<void()>>> tests = {
+        {"Text Format", test_text_format},
+        {"Histogram Buckets", test_histogram_buckets},
+        {"Overflow", test_overflow},
+        {"HTTP Endpoint", test_http_endpoint},
+        {"Controller Scrape", test_controller_scrape},
+    };
+
+    int failed = 0;
+    for (const auto& [name, test] : tests) {
+        try {
+            test();
+            std::cout << "✓ " << name << " PASSED" << std::endl;
+        } catch (const std::exception& e) {
+            std::cout << "✗ " << name << " FAILED: " << e.what() << std::endl;
+            ++failed;
+        }
+    }
+
+    std::cout << "Tests Passed: " << tests.size() - failed << std::endl;
+    std::cout << "Tests Failed: " << failed << std::endl;
+    return failed == 0 ? 0 : 1;
+}
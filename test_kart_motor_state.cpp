@@ -0,0 +1,216 @@
+/*
+ * Tests for the published motor speed state (kart_motor_state.h)
+ * ==============================================================
+ *
+ * The seqlock on its own, then a contention stress test: many threads
+ * hammer set_motor_speed() and get_status() while the control loop runs at
+ * 1 kHz. The test checks that the control loop kept publishing in every
+ * window of the run, which holds however loaded the machine is. With
+ * KART_TIMING_TESTS=1 it also checks the cycle count and execution time,
+ * which only make sense on an otherwise idle machine. The hammering
+ * threads run at nice 19 so that those numbers show lock contention
+ * rather than CPU time taken away on small machines.
+ *
+ * Compile with: g++ -std=c++20 -pthread -DTEST_MODE -o test_kart_motor_state test_kart_motor_state.cpp -lrt
+ */
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include "kart_motor_state.h"
+#include "kart_sim.h"
+
+static Logger::Options test_log_options() {
+    Logger::Options options = Logger::default_options();
+    options.text_path.clear();
+    options.binary_path.clear();
+    options.console_output = false;
+    return options;
+}
+
+Logger g_logger(test_log_options());
+
+static void check(bool condition, const std::string& message) {
+    if (!condition) {
+        throw std::runtime_error(message);
+    }
+}
+
+static void test_publish_and_read() {
+    MotorStateBoard board(3);
+    check(board.size() == 3, "size");
+    MotorSpeeds speeds = board.read(1);
+    check(speeds.current == 0.0 && speeds.target == 0.0, "starts at rest");
+
+    board.publish(1, 12.5, 40.0);
+    speeds = board.read(1);
+    check(speeds.current == 12.5 && speeds.target == 40.0, "published speeds");
+    check(board.read(0).current == 0.0 && board.read(2).target == 0.0, "other motors untouched");
+    check(board.sequence(1) == 2, "one publish");
+
+    board.publish(1, 12.5, 40.0);
+    check(board.sequence(1) == 2, "unchanged speeds are not republished");
+}
+
+// Readers never see the current speed of one publish with the target of another
+static void test_readers_see_consistent_pairs() {
+    MotorStateBoard board(2);
+    std::atomic<bool> done{false};
+    std::atomic<int> torn{0};
+    std::atomic<long> reads{0};
+
+    std::vector<std::thread> readers;
+    for (int r = 0; r < 3; ++r) {
+        readers.emplace_back([&] {
+            while (!done.load(std::memory_order_relaxed)) {
+                for (std::size_t m = 0; m < 2; ++m) {
+                    MotorSpeeds speeds = board.read(m);
+                    if (speeds.target != -speeds.current) {
+                        torn.fetch_add(1);
+                    }
+                }
+                reads.fetch_add(1, std::memory_order_relaxed);
+            }
+        });
+    }
+    for (int i = 1; i <= 200000; ++i) {
+        board.publish(static_cast<std::size_t>(i % 2), i, -i);
+    }
+    while (reads.load() < 1000) {
+        std::this_thread::yield();
+    }
+    done.store(true);
+    for (std::thread& reader : readers) {
+        reader.join();
+    }
+    check(torn.load() == 0, std::to_string(torn.load()) + " torn reads");
+    check(board.sequence(0) == 200000 && board.sequence(1) == 200000, "every publish counted");
+}
+
+static void test_contention_stress() {
+    KartConfig config = simulation_config(create_default_config());
+    config.motors.emplace_back(19, "second_motor");
+    config.control_frequency = 1000;
+    config.safety_limits.watchdog_timeout = 3600.0;
+    compute_pulse_params(config);
+
+    // Real time; the sink's clock only stamps the writes
+    SimClock stamps;
+    SimGpio::board().release(config.emergency_pin, HIGH);
+    ESCController controller(config, std::make_unique<SimPwmBackend>(stamps));
+    check(controller.start(), "controller started");
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+    const LoopTimingStats& timing = controller.loop_timing();
+    const std::uint64_t cycles_before = timing.cycles.load();
+    const std::uint64_t missed_before = timing.missed.load();
+    const LatencyHistogram::Snapshot execution_before = timing.execution.snapshot();
+
+    std::atomic<bool> done{false};
+    std::atomic<long> commands{0};
+    std::atomic<long> statuses{0};
+    std::atomic<int> bad_status{0};
+    std::vector<std::thread> hammers;
+    for (int t = 0; t < 8; ++t) {
+        hammers.emplace_back([&, t] {
+            setpriority(PRIO_PROCESS, static_cast<id_t>(syscall(SYS_gettid)), 19);
+            long n = 0;
+            while (!done.load(std::memory_order_relaxed)) {
+                if (t % 2 == 0) {
+                    controller.set_motor_speed(static_cast<MotorHandle>(n % 2), static_cast<double>(n % 160) - 80.0);
+                    commands.fetch_add(1, std::memory_order_relaxed);
+                } else {
+                    const std::string status = controller.get_status();
+                    if (status.find("main_motor(current:") == std::string::npos) {
+                        bad_status.fetch_add(1);
+                    }
+                    statuses.fetch_add(1, std::memory_order_relaxed);
+                }
+                ++n;
+            }
+        });
+    }
+    // The loop must publish in every window while the readers hammer: a
+    // reader holding up the writer would stall it for a whole window
+    constexpr int WINDOWS = 4;
+    int stalled_windows = 0;
+    std::uint64_t window_start = timing.cycles.load();
+    for (int w = 0; w < WINDOWS; ++w) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(250));
+        const std::uint64_t now = timing.cycles.load();
+        if (now == window_start) {
+            ++stalled_windows;
+        }
+        window_start = now;
+    }
+    done.store(true);
+    for (std::thread& hammer : hammers) {
+        hammer.join();
+    }
+
+    const std::uint64_t cycles = timing.cycles.load() - cycles_before;
+    const std::uint64_t missed = timing.missed.load() - missed_before;
+    const LatencyHistogram::Snapshot execution = timing.execution.snapshot();
+    const std::uint64_t contended = execution.count - execution_before.count;
+
+    // Settles on the last command once the hammering stopped
+    controller.set_all_motors_speed(10.0);
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+    const double settled = controller.current_speed(0);
+    controller.stop();
+
+    check(bad_status.load() == 0, "status always lists the motors");
+    check(commands.load() > 0 && statuses.load() > 0, "threads were hammering");
+    check(stalled_windows == 0 && contended > 0,
+          "control loop kept publishing: " + std::to_string(stalled_windows) + " of " + std::to_string(WINDOWS) +
+          " windows without a cycle");
+    check(settled == 10.0, "last command applied");
+
+    // Absolute numbers depend on the machine's load: opt-in
+    const char* timing_tests = std::getenv("KART_TIMING_TESTS");
+    if (timing_tests != nullptr && std::strcmp(timing_tests, "1") == 0) {
+        // Missed cycles on a single CPU are the scheduler's; the execution
+        // time from wake-up to the last write is what a lock would stretch
+        check(cycles > 700 && contended > 700, "control loop kept cycling: " + std::to_string(cycles) +
+              " cycles, " + std::to_string(missed) + " missed");
+        check(execution.percentile_ns(99.0) < 100000,
+              "execution p99 " + std::to_string(execution.percentile_ns(99.0) / 1000.0) + " us");
+    }
+}
+
+int main() {
+    std::cout << "Kart Motor State - Test Suite" << std::endl;
+    std::cout << "=============================" << std::endl;
+
+    std::vector<std::pair<const char*, std::function<void()>>> tests = {
+        {"Publish And Read", test_publish_and_read},
+        {"Readers See Consistent Pairs", test_readers_see_consistent_pairs},
+        {"Contention Stress", test_contention_stress},
+    };
+
+    int failed = 0;
+    for (const auto& [name, test] : tests) {
+        try {
+            test();
+            std::cout << "✓ " << name << " PASSED" << std::endl;
+        } catch (const std::exception& e) {
+            std::cout << "✗ " << name << " FAILED: " << e.what() << std::endl;
+            ++failed;
+        }
+    }
+
+    std::cout << "Tests Passed: " << tests.size() - failed << std::endl;
+    std::cout << "Tests Failed: " << failed << std::endl;
+    return failed == 0 ? 0 : 1;
+}
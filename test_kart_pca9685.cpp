@@ -0,0 +1,249 @@
+/*
+ * Tests for the PCA9685 I2C PWM backend (kart_pca9685.h)
+ * ======================================================
+ *
+ * Runs Pca9685Backend against FakeI2cBus, the register model of the
+ * boards, on its own and under the controller with simulated GPIO.
+ *
+ * Compile with: g++ -std=c++20 -pthread -DTEST_MODE -o test_kart_pca9685 test_kart_pca9685.cpp -lrt
+ */
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "kart_pca9685.h"
+#include "kart_sim.h"
+
+static Logger::Options test_log_options() {
+    Logger::Options options = Logger::default_options();
+    options.text_path.clear();
+    options.binary_path.clear();
+    options.console_output = false;
+    return options;
+}
+
+Logger g_logger(test_log_options());
+
+static void check(bool condition, const std::string& message) {
+    if (!condition) {
+        throw std::runtime_error(message);
+    }
+}
+
+static constexpr std::uint32_t PERIOD_50HZ = 20000000;
+
+// Backend on a fake bus with the given boards; the bus stays reachable
+struct Rig {
+    FakeI2cBus* bus;
+    std::unique_ptr<Pca9685Backend> pwm;
+
+    explicit Rig(int boards) {
+        auto fake = std::make_unique<FakeI2cBus>();
+        for (int board = 0; board < boards; ++board) {
+            fake->add_device(static_cast<std::uint16_t>(0x40 + board));
+        }
+        bus = fake.get();
+        pwm = std::make_unique<Pca9685Backend>(std::move(fake), 0x40);
+    }
+};
+
+static std::uint16_t counts(std::uint32_t pulse_ns) {
+    const std::uint64_t period = Pca9685Backend::period_for(Pca9685Backend::prescale_for(PERIOD_50HZ));
+    return static_cast<std::uint16_t>((pulse_ns * 4096ull + period / 2) / period);
+}
+
+static void test_prescaler() {
+    check(Pca9685Backend::prescale_for(PERIOD_50HZ) == 121, "50 Hz prescaler");
+    check(Pca9685Backend::period_for(121) == 19988480, "50 Hz actual period");
+    check(Pca9685Backend::prescale_for(2500000) == 14, "400 Hz prescaler");
+    check(Pca9685Backend::prescale_for(100000) == 3, "clamped to the fastest");
+    check(Pca9685Backend::prescale_for(1000000000) == 255, "clamped to the slowest");
+    check(counts(1500000) == 307, "1.5 ms in 12-bit counts");
+}
+
+static void test_board_setup() {
+    Rig rig(1);
+    check(rig.pwm->setup(0, PERIOD_50HZ) && rig.pwm->setup(5, PERIOD_50HZ), "setup");
+    check(rig.bus->reg(0x40, Pca9685Backend::PRE_SCALE) == 121, "prescaler written while asleep");
+    check(rig.bus->reg(0x40, Pca9685Backend::MODE1) == (Pca9685Backend::MODE1_AI | Pca9685Backend::MODE1_ALLCALL),
+          "awake with auto-increment");
+    check(rig.bus->reg(0x40, Pca9685Backend::MODE2) == Pca9685Backend::MODE2_OUTDRV, "totem-pole outputs");
+    check(rig.bus->transactions().size() == 4, "board initialised once");
+
+    check(!rig.pwm->setup(6, 2500000), "second frequency on one board");
+    check(!rig.pwm->setup(16, PERIOD_50HZ), "board 1 does not answer");
+    check(!rig.pwm->setup(MAX_GPIO_PIN, PERIOD_50HZ), "pin out of range");
+}
+
+static void test_burst_skips_unchanged() {
+    Rig rig(1);
+    for (int pin : {0, 1, 3}) {
+        check(rig.pwm->setup(pin, PERIOD_50HZ), "setup");
+    }
+    rig.bus->clear_transactions();
+
+    rig.pwm->write(0, 1500000);
+    rig.pwm->write(1, 1500000);
+    rig.pwm->write(3, 2000000);
+    rig.pwm->flush();
+    std::vector<FakeI2cBus::Transaction> log = rig.bus->transactions();
+    check(log.size() == 1, "one transaction per flush");
+    check(log[0].messages == 2 && log[0].bytes == 9 + 5, "one message per run of channels");
+    check(rig.bus->off_count(0x40, 0) == 307 && rig.bus->off_count(0x40, 1) == 307, "channels 0 and 1");
+    check(rig.bus->off_count(0x40, 3) == counts(2000000), "channel 3");
+    check(rig.bus->reg(0x40, Pca9685Backend::LED0_ON_L + 8) == 0, "channel 2 untouched");
+
+    rig.pwm->flush();
+    rig.pwm->write(0, 1500000);
+    rig.pwm->flush();
+    check(rig.bus->transactions().size() == 1, "unchanged values cost no bus time");
+
+    rig.pwm->write(1, 1600000);
+    rig.pwm->flush();
+    log = rig.bus->transactions();
+    check(log.size() == 2 && log[1].messages == 1 && log[1].bytes == 5, "only the changed channel");
+
+    Pca9685Backend::Stats stats = rig.pwm->stats();
+    check(stats.bursts == 2 && stats.channels == 4 && stats.skipped == 2 && stats.errors == 0, "statistics");
+    check(rig.pwm->summary().find("bus_us_avg:") != std::string::npos, "summary reports bus time");
+}
+
+static void test_boards_in_one_transaction() {
+    Rig rig(2);
+    for (int pin : {0, 15, 16, 17, 31}) {
+        check(rig.pwm->setup(pin, PERIOD_50HZ), "setup");
+    }
+    rig.bus->clear_transactions();
+    for (int pin : {0, 15, 16, 17, 31}) {
+        rig.pwm->write(pin, 1000000 + 10000 * static_cast<std::uint32_t>(pin));
+    }
+    rig.pwm->flush();
+
+    std::vector<FakeI2cBus::Transaction> log = rig.bus->transactions();
+    check(log.size() == 1 && log[0].messages == 4, "runs never cross a board");
+    check(rig.bus->off_count(0x40, 15) == counts(1150000), "board 0 channel 15");
+    check(rig.bus->off_count(0x41, 0) == counts(1160000), "board 1 channel 0");
+    check(rig.bus->off_count(0x41, 1) == counts(1170000), "board 1 channel 1");
+    check(rig.bus->off_count(0x41, 15) == counts(1310000), "board 1 channel 15");
+}
+
+static void test_bus_error_retries() {
+    Rig rig(1);
+    check(rig.pwm->setup(2, PERIOD_50HZ), "setup");
+    rig.bus->clear_transactions();
+    rig.bus->set_failing(true);
+    rig.pwm->write(2, 1500000);
+    rig.pwm->flush();
+    check(rig.pwm->stats().errors == 1 && rig.bus->off_count(0x40, 2) == 0, "not acknowledged");
+
+    rig.bus->set_failing(false);
+    rig.pwm->flush();
+    check(rig.bus->off_count(0x40, 2) == 307, "resent by the next flush");
+
+    rig.pwm->release(2);
+    check(rig.bus->off_count(0x40, 2) == Pca9685Backend::FULL_OFF, "released channel is full off");
+    rig.pwm->write(2, 1500000);
+    rig.pwm->flush();
+    check(rig.bus->off_count(0x40, 2) == Pca9685Backend::FULL_OFF, "released channel ignores writes");
+}
+
+// The stop path flushes while the control loop does: the last values
+// always reach the bus, whichever thread sends them
+static void test_concurrent_flush() {
+    Rig rig(1);
+    for (int pin = 0; pin < 8; ++pin) {
+        check(rig.pwm->setup(pin, PERIOD_50HZ), "setup");
+    }
+    std::atomic<bool> stop{false};
+    std::thread stopper([&] {
+        while (!stop.load()) {
+            for (int pin = 0; pin < 8; ++pin) {
+                rig.pwm->write(pin, 1500000);
+            }
+            rig.pwm->flush();
+        }
+    });
+    for (int i = 0; i < 20000; ++i) {
+        for (int pin = 0; pin < 8; ++pin) {
+            rig.pwm->write(pin, 1000000 + static_cast<std::uint32_t>(i % 100) * 10000);
+        }
+        rig.pwm->flush();
+    }
+    stop.store(true);
+    stopper.join();
+
+    for (int pin = 0; pin < 8; ++pin) {
+        rig.pwm->write(pin, 1700000);
+    }
+    rig.pwm->flush();
+    for (int pin = 0; pin < 8; ++pin) {
+        check(rig.bus->off_count(0x40, pin) == counts(1700000), "final value on the bus");
+    }
+}
+
+static void test_controller() {
+    KartConfig config = simulation_config(create_default_config());
+    config.motors.clear();
+    for (int pin = 0; pin < 3; ++pin) {
+        config.motors.emplace_back(pin, "esc" + std::to_string(pin));
+    }
+    config.pca9685_enabled = true;
+    config.control_frequency = 100;
+    compute_pulse_params(config);
+
+    Rig rig(1);
+    FakeI2cBus* bus = rig.bus;
+    const Pca9685Backend* pwm = rig.pwm.get();
+    SimGpio::board().release(config.emergency_pin, HIGH);
+    ESCController controller(config, std::move(rig.pwm));
+    check(controller.start(), "controller started");
+    check(bus->off_count(0x40, 2) == 307, "neutral after initialisation");
+
+    controller.set_motor_speed(controller.motor_handle("esc1"), 50);
+    std::this_thread::sleep_for(std::chrono::milliseconds(500));
+    check(bus->off_count(0x40, 1) == counts(1750000), "motor reached its speed");
+    check(bus->off_count(0x40, 0) == 307, "other motors stay at neutral");
+    check(pwm->stats().skipped > 0, "idle cycles send nothing");
+    check(controller.get_status().find("I2c(bursts:") != std::string::npos, "status reports the bus");
+
+    controller.emergency_stop_all();
+    check(bus->off_count(0x40, 1) == 307, "emergency stop reaches the bus at once");
+    controller.stop();
+}
+
+int main() {
+    std::cout << "Kart PCA9685 Backend - Test Suite" << std::endl;
+    std::cout << "=================================" << std::endl;
+
+    std::vector<std::pair<const char*, std::function<void()>>> tests = {
+        {"Prescaler", test_prescaler},
+        {"Board Setup", test_board_setup},
+        {"Burst Skips Unchanged", test_burst_skips_unchanged},
+        {"Boards In One Transaction", test_boards_in_one_transaction},
+        {"Bus Error Retries", test_bus_error_retries},
+        {"Concurrent Flush", test_concurrent_flush},
+        {"Controller", test_controller},
+    };
+
+    int failed = 0;
+    for (const auto& [name, test] : tests) {
+        try {
+            test();
+            std::cout << "✓ " << name << " PASSED" << std::endl;
+        } catch (const std::exception& e) {
+            std::cout << "✗ " << name << " FAILED: " << e.what() << std::endl;
+            ++failed;
+        }
+    }
+
+    std::cout << "Tests Passed: " << tests.size() - failed << std::endl;
+    std::cout << "Tests Failed: " << failed << std::endl;
+    return failed == 0 ? 0 : 1;
+}
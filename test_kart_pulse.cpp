@@ -0,0 +1,138 @@
+/*
+ * Tests for the fixed-point pulse width conversion (kart_pulse.h)
+ * ===============================================================
+ *
+ * Compares the fixed-point path against the floating-point formula it
+ * replaces and checks the precomputed parameters of the shipped config.
+ *
+ * Compile with: g++ -std=c++20 -pthread -o test_kart_pulse test_kart_pulse.cpp
+ */
+
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+#include "kart_config.h"
+#include "kart_pulse.h"
+
+static void check(bool condition, const std::string& message) {
+    if (!condition) {
+        throw std::runtime_error(message);
+    }
+}
+
+// Floating-point reference (the former ESCController::speed_to_duty_cycle)
+static double reference_ns(double min_ms, double neutral_ms, double max_ms, double speed) {
+    double pulse_width = speed >= 0 ? neutral_ms + (speed / 100.0) * (max_ms - neutral_ms)
+                                    : neutral_ms + (speed / 100.0) * (neutral_ms - min_ms);
+    return pulse_width * 1e6;
+}
+
+static void test_matches_float_reference() {
+    const PulseParams params = make_pulse_params(1.0, 1.5, 2.0, 50);
+    check(params.period_ns == 20000000, "period of 50 Hz is 20 ms");
+    for (int steps = -SPEED_STEPS_FULL; steps <= SPEED_STEPS_FULL; ++steps) {
+        double speed = static_cast<double>(steps) / SPEED_STEPS_PER_PERCENT;
+        double expected = reference_ns(1.0, 1.5, 2.0, speed);
+        double actual = pulse_ns(params, steps);
+        check(std::fabs(actual - expected) <= 1.0, "step " + std::to_string(steps) + " off by more than 1 ns");
+    }
+}
+
+static void test_asymmetric_ranges() {
+    // Reverse range narrower than forward range
+    const PulseParams params = make_pulse_params(1.2, 1.5, 2.0, 400);
+    check(params.period_ns == 2500000, "period of 400 Hz is 2.5 ms");
+    for (double speed : {-100.0, -37.5, -0.01, 0.0, 0.01, 12.34, 99.99, 100.0}) {
+        double expected = reference_ns(1.2, 1.5, 2.0, speed);
+        check(std::fabs(pulse_ns(params, speed) - expected) <= 1.0, "speed " + std::to_string(speed));
+    }
+}
+
+static void test_resolution_and_clamping() {
+    const PulseParams params = make_pulse_params(ESC_STANDARD_PWM);
+    // Below one step (0.01 %) the pulse stays at neutral
+    check(pulse_ns(params, 0.005) == 1500000, "sub-step speed is neutral");
+    check(pulse_ns(params, 0.01) == 1500050, "one step is 50 ns");
+    check(pulse_ns(params, 250.0) == 2000000, "speed is clamped to +100 %");
+    check(pulse_ns(params, -250.0) == 1000000, "speed is clamped to -100 %");
+    check(speed_to_steps(-33.333) == -3333, "steps are truncated toward zero");
+}
+
+static void test_profiles() {
+    check(FixedEsc<ESC_ONESHOT125>::pulse(100.0) == 250000, "OneShot125 full forward");
+    check(FixedEsc<ESC_ONESHOT125>::pulse(-100.0) == 125000, "OneShot125 full reverse");
+    check(FixedEsc<ESC_ONESHOT42>::pulse(0.0) == 63000, "OneShot42 neutral");
+    check(FixedEsc<ESC_MULTISHOT>::pulse(100.0) == 25000, "Multishot full forward");
+    check(FixedEsc<ESC_MULTISHOT>::pulse(-50.0) == 10000, "Multishot half reverse");
+
+    // Runtime and compile-time paths agree
+    const PulseParams params = make_pulse_params(ESC_ONESHOT42);
+    for (double speed = -100.0; speed <= 100.0; speed += 0.25) {
+        check(pulse_ns(params, speed) == FixedEsc<ESC_ONESHOT42>::pulse(speed), "OneShot42 runtime path");
+    }
+}
+
+static void test_dshot_throttle() {
+    check(dshot_frame(1046) == 0x82C6 && dshot_frame(1046, true) == 0x82D7, "frame layout and checksum");
+    check(dshot_frame_valid(dshot_frame(2047)) && !dshot_frame_valid(dshot_frame(2047) ^ 0x0100), "checksum check");
+
+    const PulseParams params = make_dshot_params(EscProtocol::DSHOT300);
+    check(pulse_ns(params, 0.0) == dshot_frame(DSHOT_STOP), "stop");
+    check(pulse_ns(params, 0.01) == dshot_frame(1048), "slowest forward");
+    check(pulse_ns(params, 100.0) == dshot_frame(2047), "fastest forward");
+    check(pulse_ns(params, -0.01) == dshot_frame(48), "slowest reverse");
+    check(pulse_ns(params, -250.0) == dshot_frame(1047), "reverse is clamped");
+    std::uint16_t previous = 1047;
+    for (double speed = 0.01; speed <= 100.0; speed += 0.37) {
+        const std::uint16_t value = dshot_frame_value(static_cast<std::uint16_t>(pulse_ns(params, speed)));
+        check(value >= previous && value <= 2047, "forward throttle rises with the speed");
+        previous = value;
+    }
+}
+
+static void test_config_precomputes_params() {
+    KartConfig config;
+    std::string error;
+    check(load_kart_config("kart_config.ini", config, error), error);
+    check(config.pulses.size() == config.motors.size(), "one PulseParams per motor");
+    for (std::size_t i = 0; i < config.motors.size(); ++i) {
+        const MotorConfig& m = config.motors[i];
+        check(config.pulses[i].neutral_ns == static_cast<std::uint32_t>(std::lround(m.neutral_pulse_width * 1e6)),
+              m.name + " neutral");
+        check(config.pulses[i].period_ns == 1000000000u / static_cast<unsigned>(m.frequency), m.name + " period");
+    }
+}
+
+int main() {
+    std::cout << "Kart Pulse Conversion - Test Suite" << std::endl;
+    std::cout << "==================================" << std::endl;
+
+    std::vector<std::pair<const char*, std::function<void()>>> tests = {
+        {"Matches Float Reference", test_matches_float_reference},
+        {"Asymmetric Ranges", test_asymmetric_ranges},
+        {"Resolution And Clamping", test_resolution_and_clamping},
+        {"ESC Profiles", test_profiles},
+        {"DShot Throttle", test_dshot_throttle},
+        {"Config Precomputes Params", test_config_precomputes_params},
+    };
+
+    int failed = 0;
+    for (const auto& [name, test] : tests) {
+        try {
+            test();
+            std::cout << "✓ " << name << " PASSED" << std::endl;
+        } catch (const std::exception& e) {
+            std::cout << "✗ " << name << " FAILED: " << e.what() << std::endl;
+            ++failed;
+        }
+    }
+
+    std::cout << "Tests Passed: " << tests.size() - failed << std::endl;
+    std::cout << "Tests Failed: " << failed << std::endl;
+    return failed == 0 ? 0 : 1;
+}
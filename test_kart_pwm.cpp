@@ -0,0 +1,163 @@
+/*
+ * Tests for the sysfs hardware PWM backend
+ * ========================================
+ *
+ * Runs SysfsPwmBackend against a fake /sys/class/pwm tree in a temporary
+ * directory, so it needs neither a Raspberry Pi nor root privileges.
+ *
+ * Compile with: g++ -std=c++17 -pthread -o test_kart_pwm test_kart_pwm.cpp
+ */
+
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+#include <sys/stat.h>
+#include "kart_pwm.h"
+
+static void check(bool condition, const std::string& message) {
+    if (!condition) {
+        throw std::runtime_error(message);
+    }
+}
+
+// Temporary fake sysfs PWM tree with one chip and two channels
+class FakeSysfs {
+public:
+    std::string root;
+
+    FakeSysfs() {
+        char dir[] = "/tmp/kart_pwm_test.XXXXXX";
+        check(mkdtemp(dir) != nullptr, "mkdtemp failed");
+        root = dir;
+        std::string chip = root + "/pwmchip0";
+        ::mkdir(chip.c_str(), 0755);
+        touch(chip + "/export");
+        for (int channel = 0; channel < 2; ++channel) {
+            std::string path = chip + "/pwm" + std::to_string(channel);
+            ::mkdir(path.c_str(), 0755);
+            for (const char* attribute : {"period", "duty_cycle", "enable"}) {
+                touch(path + "/" + attribute);
+            }
+        }
+    }
+
+    ~FakeSysfs() {
+        std::string command = "rm -rf '" + root + "'";
+        if (std::system(command.c_str()) != 0) {
+            std::cerr << "could not remove " << root << std::endl;
+        }
+    }
+
+    // First line of an attribute file (writes are newline terminated)
+    std::string read(const std::string& relative) const {
+        std::ifstream file(root + "/" + relative);
+        std::string line;
+        std::getline(file, line);
+        return line;
+    }
+
+private:
+    static void touch(const std::string& path) {
+        std::ofstream file(path);
+    }
+};
+
+static void test_setup_configures_channel() {
+    FakeSysfs sysfs;
+    SysfsPwmBackend backend(sysfs.root);
+
+    check(backend.available(), "fake chip should be detected");
+    check(backend.setup(18, 20000000), "setup of GPIO 18 should succeed");
+    check(sysfs.read("pwmchip0/pwm0/period") == "20000000", "period should be 20 ms in ns");
+    check(sysfs.read("pwmchip0/pwm0/enable") == "1", "channel should be enabled");
+    check(sysfs.read("pwmchip0/pwm0/duty_cycle") == "0", "duty cycle should start at 0");
+}
+
+static void test_write_sets_nanosecond_duty() {
+    FakeSysfs sysfs;
+    SysfsPwmBackend backend(sysfs.root);
+
+    check(backend.setup(19, 20000000), "setup of GPIO 19 should succeed");
+    backend.write(19, 1500000);
+    check(sysfs.read("pwmchip0/pwm1/duty_cycle") == "1500000", "neutral pulse should be 1.5 ms");
+    backend.write(19, 1000123);
+    check(sysfs.read("pwmchip0/pwm1/duty_cycle") == "1000123", "pulse should keep ns resolution");
+    backend.write(19, 999999);
+    check(sysfs.read("pwmchip0/pwm1/duty_cycle") == "999999", "shorter values should replace longer ones");
+}
+
+static void test_pin_mapping() {
+    check(SysfsPwmBackend::channel_for_pin(12) == 0, "GPIO 12 is PWM0");
+    check(SysfsPwmBackend::channel_for_pin(18) == 0, "GPIO 18 is PWM0");
+    check(SysfsPwmBackend::channel_for_pin(13) == 1, "GPIO 13 is PWM1");
+    check(SysfsPwmBackend::channel_for_pin(19) == 1, "GPIO 19 is PWM1");
+    check(SysfsPwmBackend::channel_for_pin(21) == -1, "GPIO 21 has no PWM channel");
+}
+
+static void test_rejects_unusable_pins_and_chips() {
+    FakeSysfs sysfs;
+    SysfsPwmBackend backend(sysfs.root);
+    check(!backend.setup(21, 20000000), "GPIO 21 must be rejected");
+
+    SysfsPwmBackend missing(sysfs.root, 3);
+    check(!missing.available(), "pwmchip3 does not exist");
+    check(!missing.setup(18, 20000000), "setup on a missing chip must fail");
+}
+
+static void test_release_disables_channel() {
+    FakeSysfs sysfs;
+    SysfsPwmBackend backend(sysfs.root);
+
+    check(backend.setup(18, 20000000), "setup should succeed");
+    backend.release(18);
+    check(sysfs.read("pwmchip0/pwm0/enable") == "0", "release should disable the channel");
+    backend.write(18, 1500000);
+    check(sysfs.read("pwmchip0/pwm0/duty_cycle") == "0", "writes after release are ignored");
+}
+
+static void test_one_pin_per_channel() {
+    FakeSysfs sysfs;
+    SysfsPwmBackend backend(sysfs.root);
+
+    check(backend.setup(18, 20000000), "setup of GPIO 18 should succeed");
+    check(!backend.setup(12, 2000000), "GPIO 12 is on the channel of GPIO 18");
+    check(sysfs.read("pwmchip0/pwm0/period") == "20000000", "period of GPIO 18 is kept");
+    check(backend.setup(18, 20000000), "the owner may set up its pin again");
+    check(backend.setup(13, 20000000), "the other channel is free");
+    backend.release(18);
+    check(backend.setup(12, 2000000), "channel free again after release");
+}
+
+int main() {
+    std::cout << "Kart PWM Backend - Test Suite" << std::endl;
+    std::cout << "=============================" << std::endl;
+
+    std::vector<std::pair<const char*, std::function<void()>>> tests = {
+        {"Setup Configures Channel", test_setup_configures_channel},
+        {"Write Sets Nanosecond Duty", test_write_sets_nanosecond_duty},
+        {"Pin Mapping", test_pin_mapping},
+        {"Rejects Unusable Pins And Chips", test_rejects_unusable_pins_and_chips},
+        {"Release Disables Channel", test_release_disables_channel},
+        {"One Pin Per Channel", test_one_pin_per_channel},
+    };
+
+    int failed = 0;
+    for (const auto& [name, test] : tests) {
+        try {
+            test();
+            std::cout << "✓ " << name << " PASSED" << std::endl;
+        } catch (const std::exception& e) {
+            std::cout << "✗ " << name << " FAILED: " << e.what() << std::endl;
+            ++failed;
+        }
+    }
+
+    std::cout << "Tests Passed: " << tests.size() - failed << std::endl;
+    std::cout << "Tests Failed: " << failed << std::endl;
+    return failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,181 @@
+/*
+ * Tests for the epoll event loop (Reactor)
+ * ========================================
+ *
+ * Pipes, timers and a blocked signal drive a reactor on the test thread;
+ * every test stops its loop from a handler or a helper thread.
+ *
+ * Compile with: g++ -std=c++20 -pthread -o test_kart_reactor test_kart_reactor.cpp
+ */
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "kart_reactor.h"
+
+static void check(bool condition, const std::string& message) {
+    if (!condition) {
+        throw std::runtime_error(message);
+    }
+}
+
+// Stops the loop from outside if a test hangs
+class Watchdog {
+public:
+    explicit Watchdog(Reactor& reactor) : thread([this, &reactor] {
+        std::unique_lock<std::mutex> lock(mutex);
+        if (!cv.wait_for(lock, std::chrono::seconds(5), [this] { return done; })) {
+            reactor.stop();
+        }
+    }) {}
+
+    ~Watchdog() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            done = true;
+        }
+        cv.notify_one();
+        thread.join();
+    }
+
+private:
+    std::mutex mutex;
+    std::condition_variable cv;
+    bool done = false;
+    std::thread thread;
+};
+
+static void test_fd_events() {
+    Reactor reactor;
+    check(reactor.valid(), "reactor should be valid");
+    int fds[2];
+    check(pipe(fds) == 0, "pipe");
+
+    std::string received;
+    check(reactor.add(fds[0], EPOLLIN, [&](std::uint32_t) {
+        char buf[16];
+        ssize_t length = read(fds[0], buf, sizeof(buf));
+        received.append(buf, static_cast<std::size_t>(length));
+        if (received == "kart") {
+            reactor.remove(fds[0]);
+            reactor.stop();
+        }
+    }), "add pipe");
+
+    std::thread writer([&] {
+        for (const char* part : {"ka", "rt"}) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            ssize_t ignored = write(fds[1], part, 2);
+            (void)ignored;
+        }
+    });
+    {
+        Watchdog guard(reactor);
+        reactor.run();
+    }
+    writer.join();
+
+    check(received == "kart", "both writes dispatched, got '" + received + "'");
+    check(reactor.statistics().events >= 2, "events counted");
+    close(fds[0]);
+    close(fds[1]);
+}
+
+static void test_periodic_timer_and_disarm() {
+    Reactor reactor;
+    int ticks = 0;
+    int timer = -1;
+    timer = reactor.add_timer(std::chrono::milliseconds(5), [&] {
+        if (++ticks == 3) {
+            check(reactor.set_timer(timer, std::chrono::nanoseconds::zero()), "disarm");
+            reactor.add_timeout(std::chrono::milliseconds(50), [&] { reactor.stop(); });
+        }
+    });
+    check(timer >= 0, "timer created");
+
+    {
+        Watchdog guard(reactor);
+        reactor.run();
+    }
+    check(ticks == 3, "disarmed timer stops ticking, got " + std::to_string(ticks));
+}
+
+static void test_timeout_fires_once() {
+    Reactor reactor;
+    int fired = 0;
+    int timeout = reactor.add_timeout(std::chrono::milliseconds(5), [&] { ++fired; });
+    check(timeout >= 0, "timeout created");
+    reactor.add_timeout(std::chrono::milliseconds(60), [&] { reactor.stop(); });
+
+    {
+        Watchdog guard(reactor);
+        reactor.run();
+    }
+    check(fired == 1, "timeout fired once");
+    check(!reactor.set_timer(timeout, std::chrono::milliseconds(1)), "fired timeout is closed");
+}
+
+static void test_signals_as_events() {
+    Reactor reactor;
+    int received = 0;
+    check(reactor.add_signals({SIGUSR1}, [&](int signum) {
+        received = signum;
+        reactor.stop();
+    }), "add signals");
+
+    // Blocked for this thread, so it waits in the signalfd
+    raise(SIGUSR1);
+    {
+        Watchdog guard(reactor);
+        reactor.run();
+    }
+    check(received == SIGUSR1, "SIGUSR1 delivered as event");
+}
+
+static void test_stop_from_other_thread() {
+    Reactor reactor;
+    auto start = std::chrono::steady_clock::now();
+    std::thread stopper([&] {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        reactor.stop();
+    });
+    reactor.run();
+    stopper.join();
+    check(std::chrono::steady_clock::now() - start < std::chrono::seconds(2), "stop wakes the loop");
+    check(reactor.statistics().wakeups == 1, "idle loop wakes up only to stop");
+}
+
+int main() {
+    std::cout << "Kart Event Loop - Test Suite" << std::endl;
+    std::cout << "============================" << std::endl;
+
+    std::vector<std::pair<const char*, std::function<void()>>> tests = {
+        {"Fd Events", test_fd_events},
+        {"Periodic Timer And Disarm", test_periodic_timer_and_disarm},
+        {"Timeout Fires Once", test_timeout_fires_once},
+        {"Signals As Events", test_signals_as_events},
+        {"Stop From Other Thread", test_stop_from_other_thread},
+    };
+
+    int failed = 0;
+    for (const auto& [name, test] : tests) {
+        try {
+            test();
+            std::cout << "✓ " << name << " PASSED" << std::endl;
+        } catch (const std::exception& e) {
+            std::cout << "✗ " << name << " FAILED: " << e.what() << std::endl;
+            ++failed;
+        }
+    }
+
+    std::cout << "Tests Passed: " << tests.size() - failed << std::endl;
+    std::cout << "Tests Failed: " << failed << std::endl;
+    return failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,247 @@
+/*
+ * Tests for the binary remote command interface (kart_remote.h)
+ * =============================================================
+ *
+ * Packet codec and sequence filter, then real datagrams from a local
+ * client over a Unix domain socket and UDP on loopback.
+ *
+ * Compile with: g++ -std=c++20 -pthread -o test_kart_remote test_kart_remote.cpp
+ */
+
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include <sys/stat.h>
+#include "kart_remote.h"
+
+static void check(bool condition, const std::string& message) {
+    if (!condition) {
+        throw std::runtime_error(message);
+    }
+}
+
+static RemoteCommand make_command(std::uint32_t session, std::uint32_t sequence, std::uint32_t mask,
+                                  std::int16_t target = 0, std::uint8_t flags = 0) {
+    RemoteCommand command;
+    command.flags = flags;
+    command.session = session;
+    command.sequence = sequence;
+    command.motor_mask = mask;
+    for (std::size_t i = 0; i < REMOTE_MAX_MOTORS; ++i) {
+        if (mask & (1u << i)) {
+            command.targets[i] = static_cast<std::int16_t>(target + i);
+        }
+    }
+    return command;
+}
+
+// Local client: unconnected datagram socket sending to the controller
+class Client {
+public:
+    explicit Client(int family) : fd(::socket(family, SOCK_DGRAM | SOCK_CLOEXEC, 0)) {}
+
+    ~Client() {
+        ::close(fd);
+    }
+
+    void send_unix(const std::string& path, const std::uint8_t* data, std::size_t length) {
+        sockaddr_un address{};
+        address.sun_family = AF_UNIX;
+        std::strcpy(address.sun_path, path.c_str());
+        check(::sendto(fd, data, length, 0, reinterpret_cast<sockaddr*>(&address), sizeof(address)) ==
+                  static_cast<ssize_t>(length), "send over the Unix socket");
+    }
+
+    void send_udp(int port, const std::uint8_t* data, std::size_t length) {
+        sockaddr_in address{};
+        address.sin_family = AF_INET;
+        address.sin_port = htons(static_cast<std::uint16_t>(port));
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        check(::sendto(fd, data, length, 0, reinterpret_cast<sockaddr*>(&address), sizeof(address)) ==
+                  static_cast<ssize_t>(length), "send over UDP");
+    }
+
+private:
+    int fd;
+};
+
+static bool wait_for(const std::function<bool()>& condition) {
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (!condition()) {
+        if (std::chrono::steady_clock::now() > deadline) {
+            return false;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return true;
+}
+
+static void test_codec_round_trip() {
+    std::uint8_t buffer[REMOTE_MAX_PACKET];
+    RemoteCommand sent = make_command(0xdeadbeef, 42, 0b1010, -2500, RemoteCommand::IMMEDIATE);
+    const std::size_t length = encode_remote_command(sent, buffer);
+    check(length == REMOTE_HEADER_BYTES + 4, "two targets take four bytes");
+    check(buffer[0] == 0x52 && buffer[1] == 0x4b, "magic is little-endian");
+
+    RemoteCommand received;
+    check(parse_remote_command(buffer, length, received) == RemoteParse::OK, "parse");
+    check(received.session == 0xdeadbeef && received.sequence == 42, "session and sequence");
+    check(received.motor_mask == 0b1010 && received.immediate() && !received.emergency_stop(), "mask and flags");
+    check(received.targets[1] == -2499 && received.targets[3] == -2497, "targets by motor index");
+    check(received.speed(1) == -24.99, "speed in percent");
+
+    RemoteCommand heartbeat = make_command(1, 1, 0);
+    check(encode_remote_command(heartbeat, buffer) == REMOTE_HEADER_BYTES, "heartbeat is header only");
+    check(parse_remote_command(buffer, REMOTE_HEADER_BYTES, received) == RemoteParse::OK && received.heartbeat(),
+          "heartbeat");
+}
+
+static void test_malformed_packets() {
+    std::uint8_t buffer[REMOTE_MAX_PACKET];
+    RemoteCommand command;
+    const std::size_t length = encode_remote_command(make_command(1, 1, 0b11, 100), buffer);
+
+    check(parse_remote_command(buffer, 10, command) == RemoteParse::TOO_SHORT, "short packet");
+    check(parse_remote_command(buffer, length - 1, command) == RemoteParse::BAD_LENGTH, "missing target");
+    check(parse_remote_command(buffer, length + 2, command) == RemoteParse::BAD_LENGTH, "extra bytes");
+
+    buffer[2] = REMOTE_PROTOCOL_VERSION + 1;
+    check(parse_remote_command(buffer, length, command) == RemoteParse::BAD_VERSION, "unknown version");
+    buffer[2] = REMOTE_PROTOCOL_VERSION;
+    buffer[0] ^= 0xff;
+    check(parse_remote_command(buffer, length, command) == RemoteParse::BAD_MAGIC, "wrong magic");
+    buffer[0] ^= 0xff;
+
+    const std::size_t over = encode_remote_command(make_command(1, 1, 0b1, 10001), buffer);
+    check(parse_remote_command(buffer, over, command) == RemoteParse::BAD_TARGET, "target above 100 %");
+}
+
+static void test_sequence_filter() {
+    SequenceFilter filter;
+    check(filter.accept(7, 10), "first packet of a session");
+    check(!filter.accept(7, 10), "duplicate");
+    check(!filter.accept(7, 9), "out of order");
+    check(filter.accept(7, 12), "gap is fine");
+    check(filter.accept(8, 1), "other session is independent");
+    check(filter.accept(7, 0xfffffff0u) == false, "far behind is stale");
+
+    SequenceFilter wrapping;
+    check(wrapping.accept(1, 0xfffffffeu), "near the wrap");
+    check(wrapping.accept(1, 2), "after the wrap");
+
+    // Session 100 is the least recently used once the table is full
+    SequenceFilter full;
+    for (std::uint32_t session = 100; session < 100 + SequenceFilter::MAX_SESSIONS; ++session) {
+        full.accept(session, 50);
+    }
+    for (std::uint32_t session = 101; session < 100 + SequenceFilter::MAX_SESSIONS; ++session) {
+        full.accept(session, 51);
+    }
+    check(full.accept(999, 1), "new session evicts the oldest");
+    check(!full.accept(101, 51), "recent sessions are kept");
+    check(full.accept(100, 1), "evicted session starts over");
+}
+
+static void test_unix_socket_loopback() {
+    const std::string dir = "/tmp/kart_remote_test_" + std::to_string(getpid());
+    const std::string path = dir + "/control.sock";
+    CommandSocket socket;
+    check(socket.open_unix(path), "bind the Unix socket");
+    struct stat st;
+    check(::stat(dir.c_str(), &st) == 0 && (st.st_mode & 0777) == 0700, "directory created private");
+    check(::stat(path.c_str(), &st) == 0 && (st.st_mode & 0777) == 0600, "socket for the owner only");
+
+    std::vector<RemoteCommand> taken;
+    CommandSocket::Handler handler = [&taken](const RemoteCommand& command) {
+        taken.push_back(command);
+        return command.motor_mask != 0b100;   // pretend motor 2 is unknown
+    };
+
+    Client client(AF_UNIX);
+    std::uint8_t buffer[REMOTE_MAX_PACKET];
+    auto send = [&](const RemoteCommand& command) {
+        client.send_unix(path, buffer, encode_remote_command(command, buffer));
+    };
+    send(make_command(5, 1, 0b1, 3000));
+    send(make_command(5, 3, 0b11, 4000));
+    send(make_command(5, 2, 0b1, 1000));                                      // late: dropped
+    send(make_command(5, 2, 0, 0, RemoteCommand::EMERGENCY_STOP));           // late but a stop
+    send(make_command(5, 4, 0b100, 10));
+    const std::uint8_t garbage[] = {1, 2, 3};
+    client.send_unix(path, garbage, sizeof(garbage));
+    std::uint8_t oversized[REMOTE_MAX_PACKET + 8] = {};
+    client.send_unix(path, oversized, sizeof(oversized));
+
+    check(socket.receive(socket.unix_fd(), handler) == 7, "all datagrams read");
+    check(taken.size() == 4, "stale packet not handed on");
+    check(taken[0].speed(0) == 30.0 && taken[1].speed(1) == 40.01, "targets in order");
+    check(taken[2].emergency_stop(), "stale emergency stop still handled");
+
+    CommandSocket::Stats stats = socket.stats();
+    check(stats.received == 7 && stats.accepted == 3 && stats.rejected == 1, "accepted and rejected counts");
+    check(stats.stale == 1 && stats.malformed == 2, "stale and malformed counts");
+
+    socket.stop();
+    check(access(path.c_str(), F_OK) != 0, "socket file removed on stop");
+    ::rmdir(dir.c_str());
+}
+
+static void test_udp_thread_loopback() {
+    CommandSocket socket;
+    check(socket.open_udp("127.0.0.1", 0), "bind UDP");
+    const int port = socket.udp_port();
+    check(port > 0, "ephemeral port");
+
+    std::atomic<int> handled{0};
+    std::atomic<double> last_speed{0.0};
+    check(socket.start([&](const RemoteCommand& command) {
+        last_speed.store(command.speed(0));
+        handled.fetch_add(1);
+        return true;
+    }), "start the receive thread");
+
+    Client client(AF_INET);
+    std::uint8_t buffer[REMOTE_MAX_PACKET];
+    for (std::uint32_t sequence = 1; sequence <= 100; ++sequence) {
+        RemoteCommand command = make_command(9, sequence, 0b1, static_cast<std::int16_t>(sequence * 10));
+        client.send_udp(port, buffer, encode_remote_command(command, buffer));
+    }
+    check(wait_for([&] { return handled.load() == 100; }), "every packet handled on the thread");
+    check(last_speed.load() == 10.0, "newest target last");
+
+    socket.stop();
+    check(socket.stats().accepted == 100, "accepted count");
+}
+
+int main() {
+    std::cout << "Kart Remote Commands - Test Suite" << std::endl;
+    std::cout << "=================================" << std::endl;
+
+    std::vector<std::pair<const char*, std::function<void()>>> tests = {
+        {"Codec Round Trip", test_codec_round_trip},
+        {"Malformed Packets", test_malformed_packets},
+        {"Sequence Filter", test_sequence_filter},
+        {"Unix Socket Loopback", test_unix_socket_loopback},
+        {"UDP Thread Loopback", test_udp_thread_loopback},
+    };
+
+    int failed = 0;
+    for (const auto& [name, test] : tests) {
+        try {
+            test();
+            std::cout << "✓ " << name << " PASSED" << std::endl;
+        } catch (const std::exception& e) {
+            std::cout << "✗ " << name << " FAILED: " << e.what() << std::endl;
+            ++failed;
+        }
+    }
+
+    std::cout << "Tests Passed: " << tests.size() - failed << std::endl;
+    std::cout << "Tests Failed: " << failed << std::endl;
+    return failed == 0 ? 0 : 1;
+}
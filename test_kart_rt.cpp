@@ -0,0 +1,157 @@
+/*
+ * Tests for the real-time setup (kart_rt.h) and config reader (kart_ini.h)
+ * ========================================================================
+ *
+ * Only exercises steps that work without privileges: mlockall and real-time
+ * scheduling policies need root and are checked on the kart itself.
+ *
+ * Compile with: g++ -std=c++17 -pthread -o test_kart_rt test_kart_rt.cpp
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+#include <unistd.h>
+#include "kart_ini.h"
+#include "kart_rt.h"
+
+static void check(bool condition, const std::string& message) {
+    if (!condition) {
+        throw std::runtime_error(message);
+    }
+}
+
+static void test_ini_parsing() {
+    char path[] = "/tmp/kart_ini_test.XXXXXX";
+    int fd = mkstemp(path);
+    check(fd >= 0, "mkstemp failed");
+    close(fd);
+    {
+        std::ofstream file(path);
+        file << "# comment\n"
+             << "[performance]\n"
+             << "control_frequency = 500   # Hz\n"
+             << "; other comment\n"
+             << "worker_cpus = 0-2\n"
+             << "lock_memory = false\n"
+             << "ratio = 0.25\n"
+             << "broken = 12abc\n"
+             << "[other]\n"
+             << "control_frequency = 7\n";
+    }
+
+    IniFile ini;
+    bool loaded = ini.load(path);
+    std::remove(path);
+
+    check(loaded, "file should load");
+    check(ini.get_int("performance", "control_frequency", 0) == 500, "inline comment stripped");
+    check(ini.get_int("other", "control_frequency", 0) == 7, "sections are separate");
+    check(ini.get("performance", "worker_cpus") == "0-2", "string values kept");
+    check(!ini.get_bool("performance", "lock_memory", true), "boolean parsed");
+    check(ini.get_double("performance", "ratio", 0.0) == 0.25, "double parsed");
+    check(ini.get_int("performance", "broken", -1) == -1, "malformed number falls back");
+    check(ini.get_int("performance", "missing", 42) == 42, "missing key falls back");
+    check(!ini.has("missing", "control_frequency"), "unknown section is empty");
+    check(!IniFile().load("/nonexistent/kart_config.ini"), "missing file reported");
+}
+
+static void test_shipped_config() {
+    IniFile ini;
+    check(ini.load("kart_config.ini"), "kart_config.ini should load");
+    check(ini.get_int("performance", "control_frequency", 0) == 50, "control_frequency");
+    check(ini.get_int("performance", "real_time_priority", 0) == 80, "real_time_priority");
+
+    RtSettings::Scheduler scheduler;
+    check(RtSettings::parse_scheduler(ini.get("performance", "scheduler"), scheduler), "scheduler is valid");
+    cpu_set_t cpus;
+    check(parse_cpu_list(ini.get("performance", "worker_cpus"), cpus), "worker_cpus is valid");
+}
+
+static void test_cpu_list() {
+    cpu_set_t set;
+    check(parse_cpu_list("0-2,5", set), "range and single CPU");
+    check(CPU_COUNT(&set) == 4, "four CPUs selected");
+    check(CPU_ISSET(0, &set) && CPU_ISSET(2, &set) && CPU_ISSET(5, &set) && !CPU_ISSET(3, &set), "right CPUs");
+    check(!parse_cpu_list("", set), "empty list rejected");
+    check(!parse_cpu_list("2-1", set), "reversed range rejected");
+    check(!parse_cpu_list("1,x", set), "garbage rejected");
+}
+
+static void test_process_setup_without_mlock() {
+    RtSettings settings;
+    settings.lock_memory = false;
+    settings.heap_reserve_bytes = 1024 * 1024;
+
+    std::string report;
+    check(rt_prepare_process(settings, report), "heap reserve should succeed");
+    check(report == "heap reserve 1024 KiB", "report lists the applied steps: " + report);
+}
+
+static void test_control_thread_setup() {
+    RtSettings settings;
+    settings.scheduler = RtSettings::OTHER;
+    settings.stack_prefault_bytes = 64 * 1024;
+    // First CPU this process may run on (containers may not allow CPU 0)
+    cpu_set_t allowed;
+    sched_getaffinity(0, sizeof(allowed), &allowed);
+    settings.control_cpu = 0;
+    while (!CPU_ISSET(settings.control_cpu, &allowed)) {
+        ++settings.control_cpu;
+    }
+    const std::string cpu = std::to_string(settings.control_cpu);
+
+    std::string report;
+    bool ok = rt_prepare_control_thread(settings, std::chrono::milliseconds(1), report);
+    check(ok, "unprivileged setup should succeed: " + report);
+    check(report.find("stack prefault 64 KiB") != std::string::npos, "stack prefault reported");
+    check(report.find("control on CPU " + cpu) != std::string::npos, "affinity reported");
+    check(sched_getcpu() == settings.control_cpu, "thread runs on the pinned CPU");
+}
+
+static void test_deadline_budget_validated() {
+    RtSettings settings;
+    settings.scheduler = RtSettings::DEADLINE;
+    settings.stack_prefault_bytes = 0;
+    settings.deadline_runtime = std::chrono::microseconds(5000);
+
+    std::string report;
+    check(!rt_prepare_control_thread(settings, std::chrono::milliseconds(1), report),
+          "runtime above the period must be rejected");
+    check(report.find("within the control period") != std::string::npos, "reason reported");
+}
+
+int main() {
+    std::cout << "Kart Real-Time Setup - Test Suite" << std::endl;
+    std::cout << "=================================" << std::endl;
+
+    std::vector<std::pair<const char*, std::function<void()>>> tests = {
+        {"INI Parsing", test_ini_parsing},
+        {"Shipped Config", test_shipped_config},
+        {"CPU List", test_cpu_list},
+        {"Process Setup Without mlock", test_process_setup_without_mlock},
+        {"Control Thread Setup", test_control_thread_setup},
+        {"Deadline Budget Validated", test_deadline_budget_validated},
+    };
+
+    int failed = 0;
+    for (const auto& [name, test] : tests) {
+        try {
+            test();
+            std::cout << "✓ " << name << " PASSED" << std::endl;
+        } catch (const std::exception& e) {
+            std::cout << "✗ " << name << " FAILED: " << e.what() << std::endl;
+            ++failed;
+        }
+    }
+
+    std::cout << "Tests Passed: " << tests.size() - failed << std::endl;
+    std::cout << "Tests Failed: " << failed << std::endl;
+    return failed == 0 ? 0 : 1;
+}
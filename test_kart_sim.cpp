@@ -0,0 +1,188 @@
+/*
+ * Tests for the plant simulation (kart_sim.h)
+ * ===========================================
+ *
+ * The plant model and scenario parser on their own, then short scenarios
+ * against the real controller on the virtual clock (no hardware, no
+ * waiting: seconds of control loop run in milliseconds).
+ *
+ * Compile with: g++ -std=c++20 -pthread -DTEST_MODE -o test_kart_sim test_kart_sim.cpp
+ */
+
+#include <functional>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+#include "kart_sim.h"
+
+static Logger::Options test_log_options() {
+    Logger::Options options = Logger::default_options();
+    options.text_path.clear();
+    options.binary_path.clear();
+    options.console_output = false;
+    return options;
+}
+
+Logger g_logger(test_log_options());
+
+static void check(bool condition, const std::string& message) {
+    if (!condition) {
+        throw std::runtime_error(message);
+    }
+}
+
+static SimScenario parse_one(const std::string& text) {
+    std::istringstream in(text);
+    std::vector<SimScenario> scenarios;
+    std::string error;
+    check(parse_sim_scenarios(in, scenarios, error), "parse failed: " + error);
+    check(scenarios.size() == 1, "one scenario");
+    return scenarios[0];
+}
+
+static void test_clock_and_sink() {
+    SimClock clock(5000);
+    std::vector<std::int64_t> ticks;
+    clock.set_tick([&ticks](std::int64_t now) { ticks.push_back(now); });
+
+    SimPwmBackend sink(clock);
+    check(sink.setup(18, 20000000), "setup");
+    check(!sink.setup(MAX_GPIO_PIN, 20000000), "pin out of range");
+    sink.write(18, 1500000);
+    check(sink.pulse(18) == 1500000 && sink.written_at(18) == 5000, "pulse recorded at virtual time");
+
+    clock.sleep_until(25000);
+    check(clock.now_ns() == 25000, "sleep jumps to the deadline");
+    check(ticks.size() == 1 && ticks[0] == 25000, "tick after the jump");
+    sink.write(18, 1600000);
+    check(sink.written_at(18) == 25000 && sink.writes(18) == 2, "second write");
+
+    clock.halt();
+    clock.sleep_until(45000);
+    check(clock.now_ns() == 45000 && ticks.size() == 1, "no ticks after halt");
+}
+
+static void test_plant() {
+    const EscProfile esc{1000000, 1500000, 2000000, 20000000};
+    check(KartPlant::throttle(esc, 1500000, 0.03) == 0.0, "neutral");
+    check(KartPlant::throttle(esc, 1510000, 0.03) == 0.0, "inside the deadband");
+    check(KartPlant::throttle(esc, 2000000, 0.03) == 1.0, "full forward");
+    check(KartPlant::throttle(esc, 900000, 0.03) == -1.0, "clamped full reverse");
+
+    KartPlant plant(PlantParams(), {esc});
+    std::vector<std::uint32_t> pulses{1500000};
+    plant.step(pulses, 0.02);
+    check(plant.speed_mps() == 0.0, "no throttle, no motion");
+
+    pulses[0] = 2000000;
+    double previous = 0.0;
+    for (int i = 0; i < 3000; ++i) {
+        plant.step(pulses, 0.02);
+        check(plant.speed_mps() >= previous, "accelerates monotonically");
+        previous = plant.speed_mps();
+    }
+    // Full throttle: drag and rolling resistance balance 300 N near 31 m/s
+    check(plant.speed_mps() > 29.0 && plant.speed_mps() < 32.0, "terminal speed");
+    check(plant.motor_output(0) > 0.99, "motor follows the throttle");
+
+    pulses[0] = 1500000;
+    for (int i = 0; i < 10000; ++i) {
+        plant.step(pulses, 0.02);
+    }
+    check(plant.speed_mps() == 0.0, "coasts to a stop and stays there");
+    check(plant.distance_m() > 0.0, "distance travelled");
+}
+
+static void test_parse_errors() {
+    auto error_of = [](const std::string& text) {
+        std::istringstream in(text);
+        std::vector<SimScenario> scenarios;
+        std::string error;
+        return parse_sim_scenarios(in, scenarios, error) ? std::string() : error;
+    };
+    check(error_of("0 speed 10\n").find("before the first") != std::string::npos, "step outside a scenario");
+    check(error_of("scenario a\n0 fly 10\n").find("unknown verb") != std::string::npos, "unknown verb");
+    check(error_of("scenario a\n0 speed\n").find("arguments") != std::string::npos, "missing argument");
+    check(error_of("scenario a\n0 speed fast\n").find("not a number") != std::string::npos, "bad number");
+    check(error_of("scenario a\n1 speed 1\n0.5 speed 2\n").find("time order") != std::string::npos, "order");
+    check(error_of("scenario a\nsoon speed 1\n").find("line 2") != std::string::npos, "line number");
+
+    SimScenario scenario = parse_one("# comment\nscenario ramp\n0 speed 50  # go\n0.5 motor main_motor 20\n1 end\n");
+    check(scenario.name == "ramp" && scenario.steps.size() == 3, "steps parsed");
+    check(scenario.steps[1].at_ns == 500000000 && scenario.steps[1].args.size() == 2, "time and arguments");
+    check(scenario.end_ns == 1000000000, "end time");
+}
+
+static void test_scenario_passes() {
+    SimRunner runner(create_default_config());
+    SimResult result = runner.run(parse_one("scenario ramp\n"
+                                            "0.00 speed 50\n"
+                                            "0.22 expect_speed 50\n"
+                                            "0.22 expect_pulse 1750\n"
+                                            "1.00 stop_pin\n"
+                                            "1.02 expect_estop on\n"
+                                            "1.02 expect_pulse 1500\n"
+                                            "1.20 release_pin\n"
+                                            "1.20 reset\n"
+                                            "1.22 expect_estop off\n"
+                                            "1.22 end\n"));
+    check(result.passed(), result.messages.empty() ? "failed" : result.messages[0]);
+    check(result.cycles == 61, "one tick per control period");
+    check(result.virtual_ns == 1220000000, "virtual time");
+    check(result.max_vehicle_kmh > 0.0, "kart moved");
+}
+
+static void test_violations_reported() {
+    SimRunner runner(create_default_config());
+    SimResult result = runner.run(parse_one("scenario wrong\n"
+                                            "0.00 speed 50\n"
+                                            "0.06 expect_speed 50\n"       // still ramping
+                                            "0.10 expect_estop on\n"
+                                            "0.10 end\n"));
+    check(result.violations == 2, "both expectations fail");
+    check(result.messages[0].find("line 3") != std::string::npos, "message names the line");
+
+    // No heartbeats: the watchdog stop is expected, not a violation
+    result = runner.run(parse_one("scenario idle\n0 speed 10\n2.1 expect_estop on\n2.1 end\n"));
+    check(result.passed(), result.messages.empty() ? "failed" : result.messages[0]);
+}
+
+static void test_soak() {
+    SimRunner runner(create_default_config());
+    SimResult result = runner.soak(0.05, 7);
+    check(result.passed(), result.messages.empty() ? "failed" : result.messages[0]);
+    check(result.cycles == 9000, "180 s at 50 Hz");
+    check(result.speedup() > 100.0, "faster than real time");
+}
+
+int main() {
+    std::cout << "Kart Plant Simulation - Test Suite" << std::endl;
+    std::cout << "==================================" << std::endl;
+
+    std::vector<std::pair<const char*, std::function<void()>>> tests = {
+        {"Clock And Sink", test_clock_and_sink},
+        {"Plant", test_plant},
+        {"Parse Errors", test_parse_errors},
+        {"Scenario Passes", test_scenario_passes},
+        {"Violations Reported", test_violations_reported},
+        {"Soak", test_soak},
+    };
+
+    int failed = 0;
+    for (const auto& [name, test] : tests) {
+        try {
+            test();
+            std::cout << "✓ " << name << " PASSED" << std::endl;
+        } catch (const std::exception& e) {
+            std::cout << "✗ " << name << " FAILED: " << e.what() << std::endl;
+            ++failed;
+        }
+    }
+
+    std::cout << "Tests Passed: " << tests.size() - failed << std::endl;
+    std::cout << "Tests Failed: " << failed << std::endl;
+    return failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,253 @@
+/*
+ * Tests for the tachometer inputs (kart_tach.h)
+ * =============================================
+ *
+ * The moving window on fixed edge trains, the tachometer thread on
+ * synthetic edges at tens of thousands of edges per second, and the
+ * closed-loop speed mode of the controller against a motor model with
+ * simulated GPIO that reaches only 80 % of the speed it is given, and
+ * against a tachometer stuck at full speed.
+ *
+ * Compile with: g++ -std=c++20 -pthread -DTEST_MODE -o test_kart_tach test_kart_tach.cpp -lrt
+ */
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include <unistd.h>
+#include "kart_tach.h"
+#include "kart_sim.h"
+
+static Logger::Options test_log_options() {
+    Logger::Options options = Logger::default_options();
+    options.text_path.clear();
+    options.binary_path.clear();
+    options.console_output = false;
+    return options;
+}
+
+Logger g_logger(test_log_options());
+
+static void check(bool condition, const std::string& message) {
+    if (!condition) {
+        throw std::runtime_error(message);
+    }
+}
+
+static bool near(double value, double expected, double tolerance) {
+    return std::abs(value - expected) <= tolerance;
+}
+
+static void test_window() {
+    // 1000 edges/s with 2 pulses per revolution: 30000 rpm
+    RpmWindow window(50000000);
+    for (std::uint64_t t = 1000000; t <= 1000000000; t += 1000000) {
+        window.add(t);
+    }
+    const RpmWindow::Snapshot s = window.snapshot();
+    check(s.edges == 51 && s.span_ns == 50000000 && s.newest_ns == 1000000000, "last 50 ms kept");
+    check(near(RpmWindow::rpm(s, 2.0, s.newest_ns), 30000.0, 0.01), "rpm from the window");
+    check(near(RpmWindow::rpm(s, 2.0, s.newest_ns + 1000000), 30000.0, 0.01), "within one interval");
+    check(near(RpmWindow::rpm(s, 2.0, s.newest_ns + 4000000), 7500.0, 0.01), "slows down without edges");
+
+    // Slower than the window: the last two edges still give a speed
+    RpmWindow slow(50000000);
+    slow.add(0);
+    slow.add(200000000);
+    slow.add(400000000);
+    check(slow.snapshot().edges == 2, "at least two edges");
+    check(near(RpmWindow::rpm(slow.snapshot(), 1.0, 400000000), 300.0, 0.01), "5 edges/s");
+    check(RpmWindow::rpm(RpmWindow::Snapshot{}, 1.0, 0) == 0.0, "no edges, no speed");
+
+    // More edges than the ring holds shorten the window instead of wrapping
+    RpmWindow dense(1000000000);
+    for (std::uint64_t t = 1; t <= 10000; ++t) {
+        dense.add(t * 10000);
+    }
+    check(dense.snapshot().edges == RpmWindow::CAPACITY, "ring capacity");
+    check(near(RpmWindow::rpm(dense.snapshot(), 1.0, 100000000), 6000000.0, 1.0), "100 kHz edges");
+}
+
+static void test_high_edge_rate() {
+    // 25000 and 15000 edges/s
+    auto generator = std::make_unique<SyntheticTachSource>();
+    SyntheticTachSource* source = generator.get();
+    source->set_rpm(0, 30000.0, 50.0);
+    source->set_rpm(1, 18000.0, 50.0);
+
+    Tachometer tach({50.0, 50.0}, std::chrono::milliseconds(50));
+    check(tach.start(std::move(generator)), "started");
+    std::this_thread::sleep_for(std::chrono::milliseconds(600));
+    const double left = tach.rpm(0);
+    const double right = tach.rpm(1);
+    tach.stop();
+    const Tachometer::Stats stats = tach.stats();
+
+    check(near(left, 30000.0, 600.0), "motor 0 at 30000 rpm: " + std::to_string(left));
+    check(near(right, 18000.0, 360.0), "motor 1 at 18000 rpm: " + std::to_string(right));
+    check(stats.edges == source->generated() && stats.edges > 15000, "every edge read: " + std::to_string(stats.edges));
+    check(stats.batches * 20 < stats.edges, "many edges per wake-up: " + std::to_string(stats.batches) + " batches");
+    check(stats.max_batch <= Tachometer::BATCH, "batches fit the buffer");
+}
+
+static void test_stopped_motor() {
+    auto generator = std::make_unique<SyntheticTachSource>();
+    SyntheticTachSource* source = generator.get();
+    source->set_rpm(0, 6000.0, 10.0);
+
+    Tachometer tach({10.0, 0.0}, std::chrono::milliseconds(50));
+    check(tach.start(std::move(generator)), "started");
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+    check(near(tach.rpm(0), 6000.0, 300.0), "turning: " + std::to_string(tach.rpm(0)));
+    check(tach.rpm(1) == 0.0 && !tach.has_sensor(1), "motor without a tachometer");
+
+    source->set_rpm(0, 0.0, 10.0);
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    check(tach.rpm(0) < 600.0, "slowing down after the last edge: " + std::to_string(tach.rpm(0)));
+    std::this_thread::sleep_for(std::chrono::milliseconds(400));
+    check(tach.rpm(0) < 60.0, "stopped: " + std::to_string(tach.rpm(0)));
+    check(tach.summary().find("Tach(synthetic edges:") == 0, "summary");
+    tach.stop();
+}
+
+// Motor model: turns at 80 % of the speed the controller writes
+static double settled_rpm(bool closed_loop) {
+    KartConfig config = simulation_config(create_default_config());
+    config.motors[0].tach_pin = 17;
+    config.motors[0].pulses_per_rev = 12.0;
+    config.motors[0].max_rpm = 6000.0;
+    config.closed_loop = closed_loop;
+    config.control_frequency = 200;
+    config.safety_limits.watchdog_timeout = 3600.0;
+    config.telemetry_shm = "/kart_tach_test_" + std::to_string(getpid());
+    compute_pulse_params(config);
+
+    auto generator = std::make_unique<SyntheticTachSource>();
+    SyntheticTachSource* source = generator.get();
+    SimGpio::board().release(config.emergency_pin, HIGH);
+    ESCController controller(config);
+    controller.set_tach_source(std::move(generator));
+    check(controller.start(), "controller started");
+
+    const MotorHandle motor = controller.motor_handle("main_motor");
+    std::atomic<bool> turning{true};
+    std::thread plant([&] {
+        while (turning.load()) {
+            const double speed = std::max(controller.motor_speeds(motor).current, 0.0);
+            source->set_rpm(0, 0.8 * speed / 100.0 * 6000.0, 12.0);
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+    });
+
+    controller.set_motor_speed("main_motor", 50.0);
+    std::this_thread::sleep_for(std::chrono::milliseconds(3000));
+    double rpm = 0.0;
+    for (int i = 0; i < 10; ++i) {
+        rpm += controller.current_rpm(motor) / 10;
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    }
+    const std::string status = controller.get_status();
+    TelemetryReader reader;
+    TelemetryData data{};
+    check(reader.open(config.telemetry_shm) == TelemetryReader::OK && reader.read(data) == TelemetryReader::OK,
+          "telemetry");
+    const double output = controller.motor_speeds(motor).current;
+    turning.store(false);
+    plant.join();
+    controller.stop();
+    check(status.find(" rpm:") != std::string::npos && status.find("Tach(synthetic") != std::string::npos,
+          "status reports the tachometer");
+    // Telemetry reports the same (corrected) output as status and metrics
+    check(near(data.current_speed[0], output, 2.0),
+          "telemetry " + std::to_string(data.current_speed[0]) + ", status " + std::to_string(output));
+    return rpm;
+}
+
+// Tachometer stuck at full speed: the correction may cut the output to
+// 0 but never reverse the motor, in either direction
+static void test_overspeed_keeps_direction() {
+    KartConfig config = simulation_config(create_default_config());
+    config.motors[0].tach_pin = 17;
+    config.motors[0].pulses_per_rev = 12.0;
+    config.motors[0].max_rpm = 6000.0;
+    config.closed_loop = true;
+    config.control_frequency = 200;
+    config.safety_limits.watchdog_timeout = 3600.0;
+    compute_pulse_params(config);
+
+    auto generator = std::make_unique<SyntheticTachSource>();
+    generator->set_rpm(0, 6000.0, 12.0);
+    SimGpio::board().release(config.emergency_pin, HIGH);
+    ESCController controller(config);
+    controller.set_tach_source(std::move(generator));
+    check(controller.start(), "controller started");
+    const MotorHandle motor = controller.motor_handle("main_motor");
+
+    // Samples the output while the commanded speed keeps one sign
+    auto extremes = [&](double speed) {
+        controller.set_motor_speed(motor, speed);
+        double low = 0.0;
+        double high = 0.0;
+        for (int i = 0; i < 400; ++i) {
+            const double output = controller.motor_speeds(motor).current;
+            low = std::min(low, output);
+            high = std::max(high, output);
+            std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        }
+        return std::make_pair(low, high);
+    };
+
+    const auto forward = extremes(10.0);
+    controller.set_motor_speed(motor, 0.0);
+    std::this_thread::sleep_for(std::chrono::milliseconds(500));
+    const double stopped = controller.motor_speeds(motor).current;
+    const auto reverse = extremes(-10.0);
+    controller.stop();
+
+    check(forward.first >= 0.0, "forward output went to " + std::to_string(forward.first));
+    check(stopped == 0.0, "stopped in between: " + std::to_string(stopped));
+    check(reverse.second <= 0.0, "reverse output went to " + std::to_string(reverse.second));
+}
+
+static void test_closed_loop() {
+    const double open = settled_rpm(false);
+    check(near(open, 2400.0, 150.0), "open loop: 80 % of 3000 rpm, got " + std::to_string(open));
+    const double closed = settled_rpm(true);
+    check(near(closed, 3000.0, 150.0), "closed loop: 3000 rpm, got " + std::to_string(closed));
+}
+
+int main() {
+    std::cout << "Kart Tachometer - Test Suite" << std::endl;
+    std::cout << "============================" << std::endl;
+
+    std::vector<std::pair<const char*, std::function<void()>>> tests = {
+        {"Window", test_window},
+        {"High Edge Rate", test_high_edge_rate},
+        {"Stopped Motor", test_stopped_motor},
+        {"Overspeed Keeps Direction", test_overspeed_keeps_direction},
+        {"Closed Loop", test_closed_loop},
+    };
+
+    int failed = 0;
+    for (const auto& [name, test] : tests) {
+        try {
+            test();
+            std::cout << "✓ " << name << " PASSED" << std::endl;
+        } catch (const std::exception& e) {
+            std::cout << "✗ " << name << " FAILED: " << e.what() << std::endl;
+            ++failed;
+        }
+    }
+
+    std::cout << "Tests Passed: " << tests.size() - failed << std::endl;
+    std::cout << "Tests Failed: " << failed << std::endl;
+    return failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,188 @@
+/*
+ * Tests for the shared-memory telemetry (TelemetryWriter, TelemetryReader)
+ * ========================================================================
+ *
+ * Uses a per-process segment name so that it never touches a running
+ * controller's /kart_telemetry.
+ *
+ * Compile with: g++ -std=c++20 -pthread -o test_kart_telemetry test_kart_telemetry.cpp
+ */
+
+#include <atomic>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "kart_telemetry.h"
+
+static void check(bool condition, const std::string& message) {
+    if (!condition) {
+        throw std::runtime_error(message);
+    }
+}
+
+static std::string segment_name() {
+    return "/kart_telemetry_test_" + std::to_string(getpid());
+}
+
+static TelemetryHeader two_motors() {
+    TelemetryHeader header{};
+    header.motor_count = 2;
+    header.control_frequency = 1000;
+    header.motor_pins[0] = 18;
+    header.motor_pins[1] = 19;
+    std::strcpy(header.motor_names[0], "left");
+    std::strcpy(header.motor_names[1], "right");
+    return header;
+}
+
+static void test_round_trip() {
+    TelemetryWriter writer;
+    check(writer.create(segment_name(), two_motors()), "create segment");
+
+    TelemetryReader reader;
+    check(reader.open(segment_name()) == TelemetryReader::OK, "open segment");
+    check(reader.header().motor_count == 2, "motor count");
+    check(reader.header().control_frequency == 1000, "control frequency");
+    check(reader.header().motor_pins[1] == 19, "pin of second motor");
+    check(std::strcmp(reader.header().motor_names[0], "left") == 0, "name of first motor");
+    check(reader.header().writer_pid == getpid(), "writer pid");
+
+    TelemetryData data{};
+    check(reader.read(data) == TelemetryReader::OK, "read before first publish");
+    check(data.publishes == 0, "empty data before first publish");
+
+    TelemetryData published{};
+    published.publishes = 7;
+    published.running = 1;
+    published.cycles = 1234;
+    published.current_speed[0] = 12.5;
+    published.target_speed[1] = -40.0;
+    writer.publish(published);
+
+    check(reader.read(data) == TelemetryReader::OK, "read after publish");
+    check(data.publishes == 7 && data.running == 1 && data.cycles == 1234, "counters");
+    check(data.current_speed[0] == 12.5 && data.target_speed[1] == -40.0, "speeds");
+}
+
+static void test_missing_and_removed_segment() {
+    TelemetryReader reader;
+    check(reader.open("/kart_telemetry_test_missing") == TelemetryReader::NOT_FOUND, "missing segment");
+    TelemetryData data;
+    check(reader.read(data) == TelemetryReader::NOT_FOUND, "read without segment");
+
+    {
+        TelemetryWriter writer;
+        check(writer.create(segment_name(), two_motors()), "create segment");
+    }
+    check(reader.open(segment_name()) == TelemetryReader::NOT_FOUND, "writer removes the segment on close");
+}
+
+static void test_incompatible_segment() {
+    // A segment of the right size but without the magic
+    int fd = shm_open(segment_name().c_str(), O_CREAT | O_RDWR, 0600);
+    check(fd >= 0, "create raw segment");
+    check(ftruncate(fd, 1 << 16) == 0, "size raw segment");
+    close(fd);
+
+    TelemetryReader reader;
+    check(reader.open(segment_name()) == TelemetryReader::INCOMPATIBLE, "segment without magic rejected");
+    shm_unlink(segment_name().c_str());
+}
+
+static void test_replaces_stale_segment() {
+    TelemetryWriter first;
+    check(first.create(segment_name(), two_motors()), "first writer");
+    TelemetryReader old_reader;
+    check(old_reader.open(segment_name()) == TelemetryReader::OK, "reader of first segment");
+
+    TelemetryHeader header = two_motors();
+    header.control_frequency = 50;
+    TelemetryWriter second;
+    check(second.create(segment_name(), header), "second writer replaces the segment");
+
+    TelemetryReader new_reader;
+    check(new_reader.open(segment_name()) == TelemetryReader::OK, "reader of second segment");
+    check(new_reader.header().control_frequency == 50, "new readers see the new segment");
+    TelemetryData data;
+    check(old_reader.read(data) == TelemetryReader::OK, "old mapping stays readable");
+}
+
+// Every field of a published frame carries the same value: a torn copy
+// would mix two of them
+static void test_no_torn_reads() {
+    TelemetryWriter writer;
+    check(writer.create(segment_name(), two_motors()), "create segment");
+    TelemetryReader reader;
+    check(reader.open(segment_name()) == TelemetryReader::OK, "open segment");
+
+    std::atomic<bool> done{false};
+    std::thread publisher([&] {
+        TelemetryData data{};
+        for (std::uint64_t n = 1; n <= 200000; ++n) {
+            data.publishes = n;
+            data.cycles = n;
+            data.late = n;
+            data.estop_latency_max_ns = n;
+            for (std::size_t i = 0; i < TELEMETRY_MAX_MOTORS; ++i) {
+                data.current_speed[i] = static_cast<double>(n);
+                data.target_speed[i] = static_cast<double>(n);
+            }
+            writer.publish(data);
+        }
+        done.store(true);
+    });
+
+    std::uint64_t reads = 0;
+    std::uint64_t last = 0;
+    while (!done.load()) {
+        TelemetryData data;
+        if (reader.read(data) != TelemetryReader::OK) {
+            continue;
+        }
+        const std::uint64_t n = data.publishes;
+        bool consistent = data.cycles == n && data.late == n && data.estop_latency_max_ns == n;
+        for (std::size_t i = 0; i < TELEMETRY_MAX_MOTORS; ++i) {
+            consistent = consistent && data.current_speed[i] == static_cast<double>(n) &&
+                         data.target_speed[i] == static_cast<double>(n);
+        }
+        check(consistent, "torn snapshot at publish " + std::to_string(n));
+        check(n >= last, "snapshots never go back in time");
+        last = n;
+        ++reads;
+    }
+    publisher.join();
+    check(reads > 0, "reader got snapshots while the writer was busy");
+}
+
+int main() {
+    std::cout << "Kart Telemetry - Test Suite" << std::endl;
+    std::cout << "===========================" << std::endl;
+
+    std::vector<std::pair<const char*, std::function<void()>>> tests = {
+        {"Round Trip", test_round_trip},
+        {"Missing And Removed Segment", test_missing_and_removed_segment},
+        {"Incompatible Segment", test_incompatible_segment},
+        {"Replaces Stale Segment", test_replaces_stale_segment},
+        {"No Torn Reads", test_no_torn_reads},
+    };
+
+    int failed = 0;
+    for (const auto& [name, test] : tests) {
+        try {
+            test();
+            std::cout << "✓ " << name << " PASSED" << std::endl;
+        } catch (const std::exception& e) {
+            std::cout << "✗ " << name << " FAILED: " << e.what() << std::endl;
+            ++failed;
+        }
+    }
+
+    std::cout << "Tests Passed: " << tests.size() - failed << std::endl;
+    std::cout << "Tests Failed: " << failed << std::endl;
+    return failed == 0 ? 0 : 1;
+}
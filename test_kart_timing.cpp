@@ -0,0 +1,125 @@
+/*
+ * Tests for the control loop timing (CycleTimer, LatencyHistogram)
+ * ================================================================
+ *
+ * Runs short 1 kHz loops on the real monotonic clock. Timing bounds are
+ * one-sided or generous so that the tests also pass on a loaded machine.
+ *
+ * Compile with: g++ -std=c++17 -pthread -o test_kart_timing test_kart_timing.cpp
+ */
+
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "kart_timing.h"
+
+static void check(bool condition, const std::string& message) {
+    if (!condition) {
+        throw std::runtime_error(message);
+    }
+}
+
+static void test_histogram_buckets() {
+    check(LatencyHistogram::bucket_for(0) == 0, "0 ns goes to bucket 0");
+    check(LatencyHistogram::bucket_for(1) == 1, "1 ns goes to bucket 1");
+    check(LatencyHistogram::bucket_for(1023) == 10, "1023 ns is below 1024");
+    check(LatencyHistogram::bucket_for(1024) == 11, "1024 ns starts bucket 11");
+    check(LatencyHistogram::bucket_for(~0ull) == LatencyHistogram::BUCKETS - 1, "huge values are clamped");
+    check(LatencyHistogram::bucket_limit_ns(10) == 1024, "bucket 10 ends at 1024 ns");
+}
+
+static void test_histogram_percentiles() {
+    LatencyHistogram histogram;
+    for (int i = 0; i < 99; ++i) {
+        histogram.record(1000);
+    }
+    histogram.record(500000);
+
+    LatencyHistogram::Snapshot snap = histogram.snapshot();
+    check(snap.count == 100, "all samples counted");
+    check(snap.max_ns == 500000, "max tracked exactly");
+    check(snap.mean_ns() == (99 * 1000 + 500000) / 100, "mean from sum");
+    check(snap.percentile_ns(50.0) == 1024, "p50 is the 1 us bucket bound");
+    check(snap.percentile_ns(99.5) == 500000, "tail percentile is capped at max");
+}
+
+static void test_no_drift() {
+    CycleTimer timer(std::chrono::milliseconds(1));
+    const int cycles = 200;
+
+    auto begin = std::chrono::steady_clock::now();
+    timer.start();
+    for (int i = 0; i < cycles; ++i) {
+        timer.wait();
+    }
+    auto elapsed = std::chrono::steady_clock::now() - begin;
+
+    check(timer.timing().cycles.load() == cycles, "every wait() counts a cycle");
+    check(elapsed >= std::chrono::milliseconds(cycles), "cycles must not start early");
+    check(elapsed < std::chrono::milliseconds(cycles + 50), "wake-up latency must not accumulate");
+    check(timer.timing().wakeup.snapshot().count == cycles, "wake-up error recorded per cycle");
+}
+
+static void test_overrun_detection() {
+    CycleTimer timer(std::chrono::milliseconds(1));
+    timer.start();
+    timer.wait();
+
+    // Work for 3.5 periods: next deadline plus two more are gone
+    std::this_thread::sleep_for(std::chrono::microseconds(3500));
+    timer.wait();
+    timer.wait();
+
+    const LoopTimingStats& stats = timer.timing();
+    check(stats.overruns.load() >= 1, "overrun must be counted");
+    check(stats.missed.load() >= 2, "skipped periods must be counted as missed");
+    check(stats.late.load() >= 1, "cycle after the overrun starts late");
+    check(stats.execution.snapshot().max_ns >= 3500000, "execution time includes the long cycle");
+}
+
+static void test_report() {
+    CycleTimer timer(std::chrono::milliseconds(2));
+    timer.start();
+    timer.wait();
+
+    std::string summary = timer.summary();
+    check(summary.find("period_us:2000") != std::string::npos, "summary shows the period");
+    check(summary.find("cycles:1") != std::string::npos, "summary shows the cycle count");
+
+    std::string report = timer.report();
+    check(report.find("Wake-up error") != std::string::npos, "report has the wake-up histogram");
+    check(report.find("Execution time") != std::string::npos, "report has the execution histogram");
+}
+
+int main() {
+    std::cout << "Kart Control Loop Timing - Test Suite" << std::endl;
+    std::cout << "=====================================" << std::endl;
+
+    std::vector<std::pair<const char*, std::function<void()>>> tests = {
+        {"Histogram Buckets", test_histogram_buckets},
+        {"Histogram Percentiles", test_histogram_percentiles},
+        {"No Drift", test_no_drift},
+        {"Overrun Detection", test_overrun_detection},
+        {"Report", test_report},
+    };
+
+    int failed = 0;
+    for (const auto& [name, test] : tests) {
+        try {
+            test();
+            std::cout << "✓ " << name << " PASSED" << std::endl;
+        } catch (const std::exception& e) {
+            std::cout << "✗ " << name << " FAILED: " << e.what() << std::endl;
+            ++failed;
+        }
+    }
+
+    std::cout << "Tests Passed: " << tests.size() - failed << std::endl;
+    std::cout << "Tests Failed: " << failed << std::endl;
+    return failed == 0 ? 0 : 1;
+}
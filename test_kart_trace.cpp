@@ -0,0 +1,249 @@
+/*
+ * Tests for the control loop trace (kart_trace.h) and its replay
+ * ==============================================================
+ *
+ * The file format on its own, then traces recorded by the simulator
+ * (kart_sim.h) replayed through a fresh controller.
+ *
+ * Compile with: g++ -std=c++20 -pthread -DTEST_MODE -o test_kart_trace test_kart_trace.cpp -lrt
+ */
+
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+#include "kart_sim.h"
+#include "kart_trace.h"
+
+static Logger::Options test_log_options() {
+    Logger::Options options = Logger::default_options();
+    options.text_path.clear();
+    options.binary_path.clear();
+    options.console_output = false;
+    return options;
+}
+
+Logger g_logger(test_log_options());
+
+static void check(bool condition, const std::string& message) {
+    if (!condition) {
+        throw std::runtime_error(message);
+    }
+}
+
+class TempDir {
+public:
+    std::string path;
+
+    TempDir() {
+        char dir[] = "/tmp/kart_trace_test.XXXXXX";
+        check(mkdtemp(dir) != nullptr, "mkdtemp failed");
+        path = dir;
+    }
+
+    ~TempDir() {
+        std::string command = "rm -rf '" + path + "'";
+        if (std::system(command.c_str()) != 0) {
+            std::cerr << "could not remove " << path << std::endl;
+        }
+    }
+};
+
+static TraceRecord cycle_record(std::uint32_t cycle) {
+    return TraceRecord{1000000 * static_cast<std::int64_t>(cycle), cycle, TraceRecord::CYCLE, 0, 0, 0.0, 0, 0};
+}
+
+// Ramp, emergency stop from the pin, reset, ramp again, rest
+static const char* const DRIVE =
+    "scenario drive\n"
+    "0.00 speed 60\n"
+    "0.50 speed -40\n"
+    "1.00 stop_pin\n"
+    "1.20 release_pin\n"
+    "1.20 reset\n"
+    "1.20 motor main_motor 30\n"
+    "1.80 speed 0\n"
+    "2.40 calibrate\n"
+    "3.00 cancel\n"
+    "3.40 speed 20\n"
+    "3.60 end\n";
+
+// Run a scenario in the simulator with tracing on; returns the trace path
+static std::string record(const TempDir& dir, const std::string& text) {
+    std::istringstream in(text);
+    std::vector<SimScenario> scenarios;
+    std::string error;
+    check(parse_sim_scenarios(in, scenarios, error), "parse: " + error);
+    SimRunner runner(create_default_config());
+    runner.set_trace_prefix(dir.path + "/");
+    SimResult result = runner.run(scenarios[0]);
+    check(result.passed(), result.messages.empty() ? "simulation failed" : result.messages[0]);
+    return dir.path + "/" + scenarios[0].name + ".bin";
+}
+
+// Copy records into a new trace with the given ring capacity
+static void rewrite(const std::string& path, const std::vector<TraceRecord>& records, std::uint64_t capacity) {
+    TraceWriter writer;
+    check(writer.create(path, capacity, 50, 1, 0), "create " + path);
+    for (const TraceRecord& rec : records) {
+        writer.append(rec);
+    }
+}
+
+static void test_write_read() {
+    TempDir dir;
+    const std::string path = dir.path + "/trace.bin";
+    TraceWriter writer;
+    check(writer.create(path, 100, 1000, 2, 42), "create");
+    writer.append(cycle_record(0));
+    writer.append(TraceRecord{5, 0, TraceRecord::COMMAND, Command::SET_SPEED, 1, 25.5, 0, TraceRecord::IMMEDIATE});
+    writer.append(TraceRecord{7, 0, TraceRecord::MOTOR, 0, 1, 25.5, 1627500, 0});
+    check(writer.records_written() == 3, "records written");
+
+    // Readable while the writer is still open (it is a shared mapping)
+    TraceReader reader;
+    check(reader.open(path) == TraceReader::OK, "open");
+    check(reader.header().capacity == 100 && reader.header().control_frequency == 1000, "header");
+    check(reader.header().motor_count == 2 && reader.header().created_ns == 42, "header motors");
+    check(!reader.wrapped() && reader.records().size() == 3, "record count");
+    const TraceRecord& cmd = reader.records()[1];
+    check(cmd.type == TraceRecord::COMMAND && cmd.motor == 1 && cmd.speed == 25.5 &&
+          (cmd.flags & TraceRecord::IMMEDIATE), "command record");
+    check(reader.records()[2].pulse_ns == 1627500, "motor record");
+}
+
+static void test_ring_wraps() {
+    TempDir dir;
+    const std::string path = dir.path + "/trace.bin";
+    {
+        TraceWriter writer;
+        check(writer.create(path, 8, 50, 1, 0), "create");
+        for (std::uint32_t i = 0; i < 20; ++i) {
+            writer.append(cycle_record(i));
+        }
+    }
+    TraceReader reader;
+    check(reader.open(path) == TraceReader::OK, "open after close");
+    check(reader.wrapped() && reader.header().head == 20, "wrapped");
+    check(reader.records().size() == 8, "capacity records kept");
+    for (std::uint32_t i = 0; i < 8; ++i) {
+        check(reader.records()[i].cycle == 12 + i, "oldest first");
+    }
+}
+
+static void test_bad_files() {
+    TempDir dir;
+    TraceReader reader;
+    check(reader.open(dir.path + "/missing.bin") == TraceReader::NOT_FOUND, "missing file");
+    std::ofstream(dir.path + "/junk.bin") << std::string(200, 'x');
+    check(reader.open(dir.path + "/junk.bin") == TraceReader::INCOMPATIBLE, "not a trace");
+    std::ofstream(dir.path + "/short.bin") << "KTRC";
+    check(reader.open(dir.path + "/short.bin") == TraceReader::INCOMPATIBLE, "truncated header");
+
+    TraceWriter writer;
+    check(!writer.create(dir.path + "/none/trace.bin", 8, 50, 1, 0), "directory missing");
+    check(!writer.is_open(), "closed after failure");
+    writer.append(cycle_record(0));    // no-op
+}
+
+static void test_replay_matches() {
+    TempDir dir;
+    TraceReader reader;
+    check(reader.open(record(dir, DRIVE)) == TraceReader::OK, "open trace");
+
+    TraceReplay replay(create_default_config(), reader);
+    ReplayResult result = replay.run();
+    check(result.error.empty(), result.error);
+    check(result.passed(), result.messages.empty() ? "differences" : result.messages[0]);
+    check(result.cycles >= 180, "every cycle compared");
+    check(result.commands == 7 && result.stops == 1, "inputs replayed");
+    check(result.skipped == 0, "nothing skipped");
+}
+
+static void test_replay_finds_difference() {
+    TempDir dir;
+    TraceReader reader;
+    const std::string path = record(dir, DRIVE);
+    check(reader.open(path) == TraceReader::OK, "open trace");
+
+    // One speed the controller would not have written
+    std::vector<TraceRecord> records = reader.records();
+    for (TraceRecord& rec : records) {
+        if (rec.type == TraceRecord::MOTOR && rec.cycle == 10) {
+            rec.speed += 0.01;
+        }
+    }
+    rewrite(path, records, records.size());
+    check(reader.open(path) == TraceReader::OK, "reopen");
+
+    TraceReplay replay(create_default_config(), reader);
+    ReplayResult result = replay.run();
+    check(result.differences == 1, "one difference");
+    check(result.messages[0].find("cycle 10 ") != std::string::npos, "difference names the cycle");
+}
+
+static void test_replay_wrapped() {
+    TempDir dir;
+    TraceReader reader;
+    const std::string path = record(dir, DRIVE);
+    check(reader.open(path) == TraceReader::OK, "open trace");
+
+    // Keep the part from the middle of the first ramp on
+    const std::vector<TraceRecord> records = reader.records();
+    rewrite(path, records, records.size() - 20);
+    check(reader.open(path) == TraceReader::OK && reader.wrapped(), "wrapped trace");
+
+    TraceReplay replay(create_default_config(), reader);
+    ReplayResult result = replay.run();
+    check(result.passed(), result.messages.empty() ? result.error : result.messages[0]);
+    check(result.skipped > 0, "replay starts at a rest point");
+    check(result.cycles > 0, "cycles after the rest point compared");
+}
+
+static void test_config_mismatch() {
+    TempDir dir;
+    TraceReader reader;
+    check(reader.open(record(dir, DRIVE)) == TraceReader::OK, "open trace");
+
+    KartConfig two_motors = create_default_config();
+    two_motors.motors.push_back(MotorConfig(19, "second_motor"));
+    compute_pulse_params(two_motors);
+    TraceReplay replay(two_motors, reader);
+    ReplayResult result = replay.run();
+    check(!result.error.empty() && !result.passed(), "motor count mismatch rejected");
+}
+
+int main() {
+    std::cout << "Kart Control Loop Trace - Test Suite" << std::endl;
+    std::cout << "====================================" << std::endl;
+
+    std::vector<std::pair<const char*, std::function<void()>>> tests = {
+        {"Write Read", test_write_read},
+        {"Ring Wraps", test_ring_wraps},
+        {"Bad Files", test_bad_files},
+        {"Replay Matches", test_replay_matches},
+        {"Replay Finds Difference", test_replay_finds_difference},
+        {"Replay Wrapped", test_replay_wrapped},
+        {"Config Mismatch", test_config_mismatch},
+    };
+
+    int failed = 0;
+    for (const auto& [name, test] : tests) {
+        try {
+            test();
+            std::cout << "✓ " << name << " PASSED" << std::endl;
+        } catch (const std::exception& e) {
+            std::cout << "✗ " << name << " FAILED: " << e.what() << std::endl;
+            ++failed;
+        }
+    }
+
+    std::cout << "Tests Passed: " << tests.size() - failed << std::endl;
+    std::cout << "Tests Failed: " << failed << std::endl;
+    return failed == 0 ? 0 : 1;
+}